@@ -190,6 +190,17 @@ start_bfd(__attribute__((unused)) data_t *prev_global_data)
 			global_data->bfd_realtime_priority, global_data->max_auto_priority, global_data->min_auto_priority_delay,
 			global_data->bfd_rlimit_rt, global_data->bfd_process_priority, global_data->bfd_no_swap ? 4096 : 0);
 
+#ifdef _WITH_IO_URING_
+	/* Use io_uring rather than epoll if configured */
+	thread_set_io_uring(master, global_data->bfd_io_uring);
+#endif
+
+	/* Limit the number of unused threads kept for reuse */
+	thread_set_unuse_high_water(master, global_data->thread_cache_high_water);
+
+	/* Collect thread function statistics if configured */
+	thread_set_stats(global_data->thread_stats);
+
 	/* Set the process cpu affinity if configured */
 	set_process_cpu_affinity(&global_data->bfd_cpu_mask, "bfd");
 }
@@ -240,6 +251,7 @@ bfd_signal_init(void)
 	signal_set(SIGINT, sigend_bfd, NULL);
 	signal_set(SIGTERM, sigend_bfd, NULL);
 	signal_set(SIGUSR1, sigdump_bfd, NULL);
+	signal_set(SIGTSTATS, thread_stats_signal, NULL);
 #ifdef THREAD_DUMP
 	signal_set(SIGTDUMP, thread_dump_signal, NULL);
 #endif
@@ -278,7 +290,7 @@ reload_bfd_thread(__attribute__((unused)) thread_ref_t thread)
 	reinitialise_global_vars();
 
 	/* Reload the conf */
-	signal_set(SIGCHLD, thread_child_handler, master);
+	thread_set_child_handler(master);
 	start_bfd(old_global_data);
 
 	free_bfd_data(old_bfd_data);
@@ -205,17 +205,10 @@ dump_bfd_list(FILE *fp, const list_head_t *l)
 static bfd_t * __attribute__ ((pure))
 find_bfd_by_name2(const char *name, const bfd_data_t *data)
 {
-	bfd_t *bfd;
-
 	assert(name);
 	assert(data);
 
-	list_for_each_entry(bfd, &data->bfd, e_list) {
-		if (!strcmp(name, bfd->iname))
-			return bfd;
-	}
-
-	return NULL;
+	return str_map_find_entry(&data->bfd_names, name, bfd_t, n_node);
 }
 
 bfd_t * __attribute__ ((pure))
@@ -257,6 +250,7 @@ free_bfd_data(bfd_data_t *data)
 	assert(data);
 
 	free_bfd_list(&data->bfd);
+	str_map_free(&data->bfd_names);
 	FREE(data);
 }
 
@@ -309,6 +309,7 @@ bfd_vrrp_end_handler(void)
 	}
 
 	list_add_tail(&tbfd->e_list, &vrrp_data->vrrp_track_bfds);
+	str_map_add(&vrrp_data->vrrp_track_bfd_names, &tbfd->n_node, tbfd->bname);
 }
 #endif
 
@@ -324,6 +325,7 @@ bfd_checker_end_handler(void)
 	}
 
 	list_add_tail(&cbfd->e_list, &check_data->track_bfds);
+	str_map_add(&check_data->track_bfd_names, &cbfd->n_node, cbfd->bname);
 }
 #endif
 
@@ -395,6 +397,7 @@ bfd_end_handler(void)
 #endif
 
 	list_add_tail(&bfd->e_list, &bfd_data->bfd);
+	str_map_add(&bfd_data->bfd_names, &bfd->n_node, bfd->iname);
 }
 
 #ifdef _WITH_VRRP_
@@ -405,7 +408,7 @@ bfd_vrrp_handler(const vector_t *strvec)
 	if (!strvec)
 		return;
 
-	current_bfd = alloc_vrrp_tracked_bfd(strvec_slot(strvec, 1), &vrrp_data->vrrp_track_bfds);
+	current_bfd = alloc_vrrp_tracked_bfd(strvec_slot(strvec, 1));
 
 	specified_event_processes = 0;
 }
@@ -457,12 +460,10 @@ bfd_checker_handler(const vector_t *strvec)
 
 	name = vector_slot(strvec, 1);
 
-	list_for_each_entry(cbfd, &check_data->track_bfds, e_list) {
-		if (!strcmp(name, cbfd->bname)) {
-			report_config_error(CONFIG_GENERAL_ERROR, "BFD %s already specified", name);
-			skip_block(true);
-			return;
-		}
+	if (str_map_find(&check_data->track_bfd_names, name)) {
+		report_config_error(CONFIG_GENERAL_ERROR, "BFD %s already specified", name);
+		skip_block(true);
+		return;
 	}
 
 	PMALLOC(cbfd);
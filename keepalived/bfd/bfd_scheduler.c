@@ -138,8 +138,8 @@ bfd_sender_schedule(bfd_t *bfd)
 	assert(!bfd->thread_out);
 
 	bfd->thread_out =
-	    thread_add_timer(master, bfd_sender_thread, bfd,
-			     bfd->local_tx_intv - get_jitter(bfd));
+	    thread_add_timer_flags(master, bfd_sender_thread, bfd,
+				   bfd->local_tx_intv - get_jitter(bfd), THREAD_REALTIME);
 }
 
 /* Cancels bfd_sender_thread run */
@@ -194,7 +194,7 @@ bfd_sender_resume(bfd_t *bfd)
 
 	if (!bfd->passive || bfd->local_state == BFD_STATE_UP)
 		bfd->thread_out =
-		    thread_add_timer(master, bfd_sender_thread, bfd, bfd->sands_out);
+		    thread_add_timer_flags(master, bfd_sender_thread, bfd, bfd->sands_out, THREAD_REALTIME);
 	bfd->sands_out = TIMER_NEVER;
 }
 
@@ -53,6 +53,10 @@
 #endif
 #include "track_file.h"
 #include "check_parser.h"
+#include "smtp.h"
+#ifdef _WITH_CHECKER_WORKERS_
+#include "check_workers.h"
+#endif
 
 
 /* Global vars */
@@ -507,12 +511,34 @@ free_checkers_queue(void)
 	free_checker_list(&checkers_queue);
 }
 
+/* Time until a checker first runs */
+unsigned long
+checker_start_delay(const checker_t *checker)
+{
+	unsigned long warmup;
+
+	/* wait for a random timeout to begin checker thread.
+	   It helps avoiding multiple simultaneous checks to
+	   the same RS.
+	*/
+	warmup = checker->warmup;
+	if (warmup) {
+		/* coverity[dont_call] */
+		warmup = warmup * (unsigned)random() / RAND_MAX;
+	}
+
+	return BOOTSTRAP_DELAY + warmup;
+}
+
 /* register checkers to the global I/O scheduler */
 void
 register_checkers_thread(void)
 {
 	checker_t *checker;
-	unsigned long warmup;
+
+#ifdef _WITH_CHECKER_WORKERS_
+	start_checker_workers(global_data->checker_worker_threads);
+#endif
 
 	list_for_each_entry(checker, &checkers_queue, e_list) {
 		if (checker->launch) {
@@ -524,17 +550,13 @@ register_checkers_thread(void)
 					    , FMT_RS(checker->rs, checker->vs)
 					    , FMT_VS(checker->vs));
 
-			/* wait for a random timeout to begin checker thread.
-			   It helps avoiding multiple simultaneous checks to
-			   the same RS.
-			*/
-			warmup = checker->warmup;
-			if (warmup) {
-				/* coverity[dont_call] */
-				warmup = warmup * (unsigned)random() / RAND_MAX;
-			}
-			thread_add_timer(master, checker->launch, checker,
-					 BOOTSTRAP_DELAY + warmup);
+#ifdef _WITH_CHECKER_WORKERS_
+			if (checker_master(checker) != master)
+				launch_worker_checker(checker);
+			else
+#endif
+				thread_add_timer(master, checker->launch, checker,
+						 checker_start_delay(checker));
 		}
 	}
 
@@ -547,6 +569,55 @@ register_checkers_thread(void)
 #endif
 }
 
+/* Update the state of a checker and its real server following a check,
+ * and send an alert if the state of the checker has changed. */
+void
+apply_checker_result(checker_t *checker, bool alive, const char *alert)
+{
+	bool checker_was_up = checker->is_up;
+	bool rs_was_alive = checker->rs->alive;
+
+	update_svr_checker_state(alive, checker);
+
+	if (alert && checker->rs->smtp_alert && checker_was_up != alive &&
+	    (rs_was_alive != checker->rs->alive || !global_data->no_checker_emails))
+		smtp_alert(SMTP_MSG_RS, checker, NULL, alert);
+}
+
+/* Report the result of a check. Only the main thread changes IPVS and
+ * sends alerts, so a checker run by a worker thread passes it over. */
+void
+checker_report_result(checker_t *checker, bool alive, const char *alert)
+{
+#ifdef _WITH_CHECKER_WORKERS_
+	if (checker_master(checker) != master) {
+		post_checker_result(checker, alive, alert);
+		return;
+	}
+#endif
+
+	apply_checker_result(checker, alive, alert);
+}
+
+/* Terminate the checker process. Only the main thread master can be
+ * terminated, so a checker run by a worker thread asks it to. */
+void
+checker_terminate(
+#ifndef _WITH_CHECKER_WORKERS_
+		  __attribute__((unused))
+#endif
+					  const checker_t *checker)
+{
+#ifdef _WITH_CHECKER_WORKERS_
+	if (checker_master(checker) != master) {
+		post_checker_terminate();
+		return;
+	}
+#endif
+
+	thread_add_terminate_event(master);
+}
+
 /* Sync checkers activity with netlink kernel reflection */
 static bool __attribute__ ((pure))
 addr_matches(const virtual_server_t *vs, void *address)
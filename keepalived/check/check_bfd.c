@@ -118,16 +118,9 @@ compare_bfd_check(const checker_t *old_c, checker_t *new_c)
 }
 
 static checker_tracked_bfd_t * __attribute__ ((pure))
-find_checker_tracked_bfd_by_name(char *name)
+find_checker_tracked_bfd_by_name(const char *name)
 {
-	checker_tracked_bfd_t *cbfd;
-
-	list_for_each_entry(cbfd, &check_data->track_bfds, e_list) {
-		if (!strcmp(cbfd->bname, name))
-			return cbfd;
-	}
-
-	return NULL;
+	return str_map_find_entry(&check_data->track_bfd_names, name, checker_tracked_bfd_t, n_node);
 }
 
 static const checker_funcs_t bfd_checker_funcs = { CHECKER_BFD, free_bfd_check, dump_bfd_check, compare_bfd_check, NULL };
@@ -285,33 +278,30 @@ bfd_check_handle_event(bfd_event_t * evt)
 			    evt->iname, BFD_STATE_STR(evt->state), delivery_time);
 	}
 
-	list_for_each_entry(cbfd, &check_data->track_bfds, e_list) {
-		if (strcmp(cbfd->bname, evt->iname))
+	if (!(cbfd = find_checker_tracked_bfd_by_name(evt->iname)))
+		return;
+
+	/* We can't assume the state of the bfd instance up state
+	 * matches the checker up state due to the potential of
+	 * alpha state for some checkers and not others */
+	list_for_each_entry(top, &cbfd->tracking_rs, e_list) {
+		checker = top->obj.checker;
+		if ((evt->state == BFD_STATE_UP) == checker->is_up &&
+		    checker->has_run)
 			continue;
 
-		/* We can't assume the state of the bfd instance up state
-		 * matches the checker up state due to the potential of
-		 * alpha state for some checkers and not others */
-		list_for_each_entry(top, &cbfd->tracking_rs, e_list) {
-			checker = top->obj.checker;
-			if ((evt->state == BFD_STATE_UP) == checker->is_up &&
-			    checker->has_run)
-				continue;
-
-			log_message(LOG_INFO, "BFD check of [%s] RS(%s) is %s"
-					    , evt->iname, FMT_RS(checker->rs, checker->vs), evt->state == BFD_STATE_UP ? "UP" : "DOWN");
-
-			checker_was_up = checker->is_up;
-			rs_was_alive = checker->rs->alive;
-			update_svr_checker_state(evt->state == BFD_STATE_UP ? UP : DOWN, checker);
-			if (checker->rs->smtp_alert &&
-			    (rs_was_alive != checker->rs->alive || !global_data->no_checker_emails) &&
-			    (evt->state == BFD_STATE_UP) != checker_was_up) {
-				snprintf(message, sizeof(message), "=> BFD CHECK %s %s on service <=", evt->iname, evt->state == BFD_STATE_UP ? "succeeded" : "failed");
-				smtp_alert(SMTP_MSG_RS, checker, NULL, message);
-			}
+		log_message(LOG_INFO, "BFD check of [%s] RS(%s) is %s"
+				    , evt->iname, FMT_RS(checker->rs, checker->vs), evt->state == BFD_STATE_UP ? "UP" : "DOWN");
+
+		checker_was_up = checker->is_up;
+		rs_was_alive = checker->rs->alive;
+		update_svr_checker_state(evt->state == BFD_STATE_UP ? UP : DOWN, checker);
+		if (checker->rs->smtp_alert &&
+		    (rs_was_alive != checker->rs->alive || !global_data->no_checker_emails) &&
+		    (evt->state == BFD_STATE_UP) != checker_was_up) {
+			snprintf(message, sizeof(message), "=> BFD CHECK %s %s on service <=", evt->iname, evt->state == BFD_STATE_UP ? "succeeded" : "failed");
+			smtp_alert(SMTP_MSG_RS, checker, NULL, message);
 		}
-		break;
 	}
 }
 
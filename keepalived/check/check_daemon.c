@@ -79,6 +79,9 @@
 #ifndef _ONE_PROCESS_DEBUG_
 #include "config_notify.h"
 #endif
+#ifdef _WITH_CHECKER_WORKERS_
+#include "check_workers.h"
+#endif
 
 /* Global variables */
 bool using_ha_suspend;
@@ -232,6 +235,10 @@ checker_shutdown_backstop_thread(thread_ref_t thread)
 static void
 checker_terminate_phase1(bool schedule_next_thread)
 {
+#ifdef _WITH_CHECKER_WORKERS_
+	stop_checker_workers();
+#endif
+
 	if (using_ha_suspend || __test_bit(LOG_ADDRESS_CHANGES, &debug))
 		kernel_netlink_close();
 
@@ -422,7 +429,7 @@ start_check(list_head_t *old_checkers_queue, data_t *prev_global_data)
 
 	/* Set up the track files */
 	add_rs_to_track_files();
-	init_track_files(&check_data->track_files);
+	init_track_files(&check_data->track_files, &check_data->track_file_names);
 
 	/* Processing differential configuration parsing */
 	set_track_file_weights();
@@ -447,6 +454,9 @@ start_check(list_head_t *old_checkers_queue, data_t *prev_global_data)
 	if (__test_bit(DUMP_CONF_BIT, &debug))
 		dump_data_check(NULL);
 
+	/* Allow checker timers to be coalesced */
+	thread_set_timer_slack(master, global_data->checker_timer_slack);
+
 	/* Register checkers thread */
 	register_checkers_thread();
 
@@ -454,8 +464,24 @@ start_check(list_head_t *old_checkers_queue, data_t *prev_global_data)
 	set_process_priorities(global_data->checker_realtime_priority, global_data->max_auto_priority, global_data->min_auto_priority_delay,
 			       global_data->checker_rlimit_rt, global_data->checker_process_priority, global_data->checker_no_swap ? 4096 : 0);
 
+#ifdef _WITH_IO_URING_
+	/* Use io_uring rather than epoll if configured */
+	thread_set_io_uring(master, global_data->checker_io_uring);
+#endif
+
+	/* Limit the number of unused threads kept for reuse */
+	thread_set_unuse_high_water(master, global_data->thread_cache_high_water);
+
+	/* Collect thread function statistics if configured */
+	thread_set_stats(global_data->thread_stats);
+
 	/* Set the process cpu affinity if configured */
 	set_process_cpu_affinity(&global_data->checker_cpu_mask, "checker");
+
+#ifdef _WITH_CHECKER_WORKERS_
+	/* The worker threads inherit the priorities and affinity set above */
+	run_checker_workers();
+#endif
 }
 
 void
@@ -486,6 +512,11 @@ reload_check_thread(__attribute__((unused)) thread_ref_t thread)
 	/* set the reloading flag */
 	SET_RELOAD;
 
+#ifdef _WITH_CHECKER_WORKERS_
+	/* The workers' checkers are about to be replaced */
+	stop_checker_workers();
+#endif
+
 	/* Terminate all script process */
 	script_killall(master, SIGTERM, false);
 
@@ -573,6 +604,7 @@ check_signal_init(void)
 	signal_set(SIGINT, sigend_check, NULL);
 	signal_set(SIGTERM, sigend_check, NULL);
 	signal_set(SIGUSR1, sigusr1_check, NULL);
+	signal_set(SIGTSTATS, thread_stats_signal, NULL);
 #ifdef THREAD_DUMP
 	signal_set(SIGTDUMP, thread_dump_signal, NULL);
 #endif
@@ -639,6 +671,9 @@ register_check_thread_addresses(void)
 #ifdef _WITH_BFD_
 	register_check_bfd_addresses();
 #endif
+#ifdef _WITH_CHECKER_WORKERS_
+	register_check_workers_addresses();
+#endif
 
 #ifndef _ONE_PROCESS_DEBUG_
 	register_thread_address("reload_check_thread", reload_check_thread);
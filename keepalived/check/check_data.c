@@ -933,9 +933,12 @@ free_check_data(check_data_t *data)
 {
 	free_vs_list(&data->vs);
 	free_vsg_list(&data->vs_group);
+	str_map_free(&data->vs_group_names);
 	free_track_file_list(&data->track_files);
+	str_map_free(&data->track_file_names);
 #ifdef _WITH_BFD_
 	free_checker_bfd_list(&data->track_bfds);
+	str_map_free(&data->track_bfd_names);
 #endif
 	FREE(data);
 }
@@ -983,7 +986,7 @@ const char *
 format_vs(const virtual_server_t *vs)
 {
 	/* alloc large buffer because of unknown length of vs->vsgname */
-	static char ret[512];
+	static __thread char ret[512];
 
 	if (vs->vsgname)
 		snprintf (ret, sizeof (ret) - 1, "[%s]:%d"
@@ -1001,7 +1004,7 @@ format_vs(const virtual_server_t *vs)
 const char *
 format_vsge(const virtual_server_group_entry_t *vsge)
 {
-	static char ret[INET6_ADDRSTRLEN + 1 + INET6_ADDRSTRLEN + 1 + 5 + 1]; /* IPv6 addr-IPv6 addr:ppppp */
+	static __thread char ret[INET6_ADDRSTRLEN + 1 + INET6_ADDRSTRLEN + 1 + 5 + 1]; /* IPv6 addr-IPv6 addr:ppppp */
 	unsigned offs;
 
 	if (vsge->is_fwmark)
@@ -1022,7 +1025,7 @@ format_vsge(const virtual_server_group_entry_t *vsge)
 const char *
 format_rs(const real_server_t *rs, const virtual_server_t *vs)
 {
-	static char buf[SOCKADDRTRIO_STR_LEN];
+	static __thread char buf[SOCKADDRTRIO_STR_LEN];
 
 	inet_sockaddrtotrio_r(&rs->addr, vs->service_type, buf);
 
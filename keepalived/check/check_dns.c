@@ -107,8 +107,6 @@ dns_final(thread_ref_t thread, bool error, const char *fmt, ...)
 	char buf[MAX_LOG_MSG];
 	va_list args;
 	int len;
-	bool checker_was_up;
-	bool rs_was_alive;
 
 	checker_t *checker = THREAD_ARG(thread);
 
@@ -142,23 +140,13 @@ dns_final(thread_ref_t thread, bool error, const char *fmt, ...)
 						 checker->delay_before_retry);
 				return 0;
 			}
-			checker_was_up = checker->is_up;
-			rs_was_alive = checker->rs->alive;
-			update_svr_checker_state(DOWN, checker);
-			if (checker_was_up && checker->rs->smtp_alert &&
-			    (rs_was_alive != checker->rs->alive || !global_data->no_checker_emails))
-				smtp_alert(SMTP_MSG_RS, checker, NULL,
-					   "=> DNS_CHECK: failed on service <=");
+			checker_report_result(checker, DOWN,
+					      "=> DNS_CHECK: failed on service <=");
 		}
 	} else {
 		if (!checker->is_up || !checker->has_run) {
-			checker_was_up = checker->is_up;
-			rs_was_alive = checker->rs->alive;
-			update_svr_checker_state(UP, checker);
-			if (!checker_was_up && checker->rs->smtp_alert &&
-			    (rs_was_alive != checker->rs->alive || !global_data->no_checker_emails))
-				smtp_alert(SMTP_MSG_RS, checker, NULL,
-					   "=> DNS_CHECK: succeed on service <=");
+			checker_report_result(checker, UP,
+					      "=> DNS_CHECK: succeed on service <=");
 		}
 	}
 
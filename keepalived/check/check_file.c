@@ -58,7 +58,7 @@ track_file_handler(const vector_t *strvec)
 {
 	tracked_file_t *vsf;
 
-	vsf = find_tracked_file_by_name(strvec_slot(strvec, 1), &check_data->track_files);
+	vsf = find_tracked_file_by_name(strvec_slot(strvec, 1), &check_data->track_file_names);
 	if (!vsf) {
 		report_config_error(CONFIG_GENERAL_ERROR, "track_file %s not found", strvec_slot(strvec, 1));
 		return;
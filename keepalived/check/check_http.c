@@ -102,8 +102,9 @@ static int conf_regex_options;
 static PCRE2_SIZE jit_stack_start;
 static PCRE2_SIZE jit_stack_max;
 
-static pcre2_match_context *mcontext;
-static pcre2_jit_stack *jit_stack;
+/* Each checker worker thread needs its own JIT stack */
+static __thread pcre2_match_context *mcontext;
+static __thread pcre2_jit_stack *jit_stack;
 #endif
 
 static LIST_HEAD_INITIALIZE(regexs);	/* regex_t */
@@ -153,7 +154,6 @@ free_regex(regex_t *regex)
 	/* Free up the regular expression. */
 	FREE_CONST_PTR(regex->pattern);
 	pcre2_code_free(regex->pcre2_reCompiled);
-	pcre2_match_data_free(regex->pcre2_match_data);
 
 #ifdef _WITH_REGEX_TIMERS_
 	total_regex_times.tv_sec += regex->regex_time.tv_sec;
@@ -170,6 +170,22 @@ free_regex(regex_t *regex)
 }
 #endif
 
+/* Free anything the calling thread allocated for running HTTP checks */
+void
+free_http_check_thread_data(void)
+{
+#if defined _WITH_REGEX_CHECK_ && !defined PCRE2_DONT_USE_JIT
+	if (mcontext) {
+		pcre2_match_context_free(mcontext);
+		mcontext = NULL;
+	}
+	if (jit_stack) {
+		pcre2_jit_stack_free(jit_stack);
+		jit_stack = NULL;
+	}
+#endif
+}
+
 static void
 free_url(url_t *url)
 {
@@ -178,21 +194,14 @@ free_url(url_t *url)
 	FREE_CONST_PTR(url->digest);
 	FREE_CONST_PTR(url->virtualhost);
 #ifdef _WITH_REGEX_CHECK_
+	if (url->pcre2_match_data)
+		pcre2_match_data_free(url->pcre2_match_data);
 	if (url->regex) {
 		if (!--url->regex->refcnt) {
 			free_regex(url->regex);
 
 			if (list_empty(&regexs)) {
-#ifndef PCRE2_DONT_USE_JIT
-				if (mcontext) {
-					pcre2_match_context_free(mcontext);
-					mcontext = NULL;
-				}
-				if (jit_stack) {
-					pcre2_jit_stack_free(jit_stack);
-					jit_stack = NULL;
-				}
-#endif
+				free_http_check_thread_data();
 
 #ifdef _WITH_REGEX_TIMERS_
 				if (do_regex_timers)
@@ -761,6 +770,7 @@ prepare_regex(url_t *url)
 			url->regex = r;
 			FREE_CONST_PTR(conf_regex_pattern);
 			url->regex->refcnt++;
+			url->pcre2_match_data = pcre2_match_data_create_from_pattern(r->pcre2_reCompiled, NULL);
 
 			return;
 		}
@@ -789,7 +799,6 @@ prepare_regex(url_t *url)
 		return;
 	}
 
-	r->pcre2_match_data = pcre2_match_data_create_from_pattern(r->pcre2_reCompiled, NULL);
 	pcre2_pattern_info(r->pcre2_reCompiled, PCRE2_INFO_MAXLOOKBEHIND, &r->pcre2_max_lookbehind);
 
 #ifndef PCRE2_DONT_USE_JIT
@@ -805,6 +814,8 @@ prepare_regex(url_t *url)
 	}
 #endif
 
+	url->pcre2_match_data = pcre2_match_data_create_from_pattern(r->pcre2_reCompiled, NULL);
+
 	list_add_tail(&r->e_list, &regexs);
 }
 #endif
@@ -1008,8 +1019,6 @@ epilog(thread_ref_t thread, register_checker_t method)
 	http_checker_t *http_get_check = CHECKER_ARG(checker);
 	request_t *req = http_get_check->req;
 	unsigned long delay = 0;
-	bool checker_was_up;
-	bool rs_was_alive;
 
 	if (method == REGISTER_CHECKER_NEW) {
 		if (list_is_last(&http_get_check->url_it->e_list, &http_get_check->url))
@@ -1027,13 +1036,8 @@ epilog(thread_ref_t thread, register_checker_t method)
 		if (!checker->is_up || !checker->has_run) {
 			log_message(LOG_INFO, "Remote Web server %s succeed on service."
 					    , FMT_CHK(checker));
-			checker_was_up = checker->is_up;
-			rs_was_alive = checker->rs->alive;
-			update_svr_checker_state(UP, checker);
-			if (!checker_was_up && checker->rs->smtp_alert &&
-			    (rs_was_alive != checker->rs->alive || !global_data->no_checker_emails))
-				smtp_alert(SMTP_MSG_RS, checker, NULL,
-					   "=> CHECK succeed on service <=");
+			checker_report_result(checker, UP,
+					      "=> CHECK succeed on service <=");
 
 			/* We have done all the checks, so mark as has run */
 			checker->has_run = true;
@@ -1062,14 +1066,9 @@ epilog(thread_ref_t thread, register_checker_t method)
 				   , "%s_CHECK on service %s failed."
 				   , (http_get_check->proto == PROTO_SSL) ? "SSL" : "HTTP"
 				   , FMT_CHK(checker));
-			checker_was_up = checker->is_up;
-			rs_was_alive = checker->rs->alive;
-			update_svr_checker_state(DOWN, checker);
-			if (checker_was_up && checker->rs->smtp_alert &&
-			    (rs_was_alive != checker->rs->alive || !global_data->no_checker_emails))
-				smtp_alert(SMTP_MSG_RS, checker, NULL,
-					   "=> CHECK failed on service"
-					   " : HTTP/SSL request failed <=");
+			checker_report_result(checker, DOWN,
+					      "=> CHECK failed on service"
+					      " : HTTP/SSL request failed <=");
 		}
 
 		/* Mark we have a failed URL */
@@ -1122,7 +1121,7 @@ timeout_epilog(thread_ref_t thread, const char *debug_msg)
 	if (checker->is_up || !checker->has_run) {
 		if (((http_checker_t *)checker->data)->genhash_flags & GENHASH) {
 			printf("%s\n", debug_msg);
-			thread_add_terminate_event(thread->master);
+			checker_terminate(checker);
 			return;
 		}
 		if (global_data->checker_log_all_failures || checker->log_all_failures)
@@ -1220,7 +1219,7 @@ check_regex(url_t *url, request_t *req)
 				 req->len,
 				 start_offset,
 				 PCRE2_PARTIAL_HARD,
-				 url->regex->pcre2_match_data,
+				 url->pcre2_match_data,
 #ifndef PCRE2_DONT_USE_JIT
 				 url->regex_use_stack ? mcontext : NULL
 #else
@@ -1241,7 +1240,7 @@ check_regex(url_t *url, request_t *req)
 	req->start_offset = 0;
 
 	if (pcreExecRet == PCRE2_ERROR_PARTIAL) {
-		ovector = pcre2_get_ovector_pointer(url->regex->pcre2_match_data);
+		ovector = pcre2_get_ovector_pointer(url->pcre2_match_data);
 #ifdef _REGEX_DEBUG_
 		if (do_regex_debug)
 			log_message(LOG_INFO, "Partial returned, ovector %zu, max_lookbehind %u", ovector[0], url->regex->pcre2_max_lookbehind);
@@ -1299,7 +1298,7 @@ check_regex(url_t *url, request_t *req)
 	if(pcreExecRet == 0)
 		log_message(LOG_INFO, "Too many substrings found");
 
-	ovector = pcre2_get_ovector_pointer(url->regex->pcre2_match_data);
+	ovector = pcre2_get_ovector_pointer(url->pcre2_match_data);
 
 	/* Check if there was a match at or before regex_max_offset */
 	if (!url->regex_max_offset ||
@@ -1342,7 +1341,7 @@ http_handle_response(thread_ref_t thread, unsigned char digest[MD5_DIGEST_LENGTH
 			printf("\n");
 		}
 
-		thread_add_terminate_event(thread->master);
+		checker_terminate(checker);
 		return;
 	}
 
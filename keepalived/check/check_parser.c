@@ -147,6 +147,7 @@ vsg_handler(const vector_t *strvec)
 	}
 
 	list_add_tail(&current_vsg->e_list, &check_data->vs_group);
+	str_map_add(&check_data->vs_group_names, &current_vsg->n_node, current_vsg->gname);
 	current_vsg = NULL;
 }
 
@@ -47,7 +47,7 @@ static const char * const ping_group_range = "/proc/sys/net/ipv4/ping_group_rang
 static gid_t save_gid_min;
 static bool checked_ping_group_range;
 
-static uint16_t seq_no;
+static __thread uint16_t seq_no;
 
 static void icmp_connect_thread(thread_ref_t);
 
@@ -283,8 +283,6 @@ icmp_epilog(thread_ref_t thread, bool is_success)
 {
 	checker_t *checker;
 	unsigned long delay;
-	bool checker_was_up;
-	bool rs_was_alive;
 
 	checker = THREAD_ARG(thread);
 
@@ -295,13 +293,8 @@ icmp_epilog(thread_ref_t thread, bool is_success)
 		if (is_success && (!checker->is_up || !checker->has_run)) {
 			log_message(LOG_INFO, "ICMP connection to %s success."
 					, FMT_CHK(checker));
-			checker_was_up = checker->is_up;
-			rs_was_alive = checker->rs->alive;
-			update_svr_checker_state(UP, checker);
-			if (checker->rs->smtp_alert && !checker_was_up &&
-			    (rs_was_alive != checker->rs->alive || !global_data->no_checker_emails))
-				smtp_alert(SMTP_MSG_RS, checker, NULL,
-					   "=> ICMP CHECK succeed on service <=");
+			checker_report_result(checker, UP,
+					      "=> ICMP CHECK succeed on service <=");
 		} else if (!is_success &&
 			   (checker->is_up || !checker->has_run)) {
 			if (checker->retry && checker->has_run)
@@ -313,13 +306,8 @@ icmp_epilog(thread_ref_t thread, bool is_success)
 				log_message(LOG_INFO
 				    , "ICMP CHECK on service %s failed."
 				    , FMT_CHK(checker));
-			checker_was_up = checker->is_up;
-			rs_was_alive = checker->rs->alive;
-			update_svr_checker_state(DOWN, checker);
-			if (checker->rs->smtp_alert && checker_was_up &&
-			    (rs_was_alive != checker->rs->alive || !global_data->no_checker_emails))
-				smtp_alert(SMTP_MSG_RS, checker, NULL,
-					   "=> ICMP CHECK failed on service <=");
+			checker_report_result(checker, DOWN,
+					      "=> ICMP CHECK failed on service <=");
 		}
 	} else if (checker->is_up) {
 		delay = checker->delay_before_retry;
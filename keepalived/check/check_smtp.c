@@ -336,8 +336,6 @@ smtp_final(thread_ref_t thread, const char *format, ...)
 	char error_buff[512];
 	char smtp_buff[542];
 	va_list varg_list;
-	bool checker_was_up;
-	bool rs_was_alive;
 
 	/* Error or no error we should always have to close the socket */
 	if (thread->type != THREAD_READY_TIMER)
@@ -376,11 +374,7 @@ smtp_final(thread_ref_t thread, const char *format, ...)
 		 * we don't have to keep them statically allocated.
 		 */
 		if (checker->is_up || !checker->has_run) {
-			checker_was_up = checker->is_up;
-			rs_was_alive = checker->rs->alive;
-			update_svr_checker_state(DOWN, checker);
-			if (checker->rs->smtp_alert && checker_was_up &&
-			    (rs_was_alive != checker->rs->alive || !global_data->no_checker_emails)) {
+			if (checker->rs->smtp_alert) {
 				if (format != NULL) {
 					snprintf(error_buff, sizeof(error_buff), "=> CHECK failed on service : %s <=", format);
 					va_start(varg_list, format);
@@ -390,8 +384,8 @@ smtp_final(thread_ref_t thread, const char *format, ...)
 					strncpy(smtp_buff, "=> CHECK failed on service <=", sizeof(smtp_buff));
 
 				smtp_buff[sizeof(smtp_buff) - 1] = '\0';
-				smtp_alert(SMTP_MSG_RS, checker, NULL, smtp_buff);
 			}
+			checker_report_result(checker, DOWN, checker->rs->smtp_alert ? smtp_buff : NULL);
 		}
 
 		/* Reschedule the main thread using the configured delay loop */
@@ -419,13 +413,8 @@ smtp_final(thread_ref_t thread, const char *format, ...)
 		log_message(LOG_INFO, "Remote SMTP server %s succeed on service."
 				    , FMT_CHK(checker));
 
-		checker_was_up = checker->is_up;
-		rs_was_alive = checker->rs->alive;
-		update_svr_checker_state(UP, checker);
-		if (checker->rs->smtp_alert && !checker_was_up &&
-		    (rs_was_alive != checker->rs->alive || !global_data->no_checker_emails))
-			smtp_alert(SMTP_MSG_RS, checker, NULL,
-				   "=> CHECK succeed on service <=");
+		checker_report_result(checker, UP,
+				      "=> CHECK succeed on service <=");
 	}
 
 	checker->has_run = true;
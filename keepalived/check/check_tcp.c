@@ -100,8 +100,6 @@ tcp_epilog(thread_ref_t thread, bool is_success)
 {
 	checker_t *checker;
 	unsigned long delay;
-	bool checker_was_up;
-	bool rs_was_alive;
 
 	checker = THREAD_ARG(thread);
 
@@ -112,13 +110,8 @@ tcp_epilog(thread_ref_t thread, bool is_success)
 		if (is_success && (!checker->is_up || !checker->has_run)) {
 			log_message(LOG_INFO, "TCP connection to %s success."
 					, FMT_CHK(checker));
-			checker_was_up = checker->is_up;
-			rs_was_alive = checker->rs->alive;
-			update_svr_checker_state(UP, checker);
-			if (checker->rs->smtp_alert && !checker_was_up &&
-			    (rs_was_alive != checker->rs->alive || !global_data->no_checker_emails))
-				smtp_alert(SMTP_MSG_RS, checker, NULL,
-					   "=> TCP CHECK succeed on service <=");
+			checker_report_result(checker, UP,
+					      "=> TCP CHECK succeed on service <=");
 		} else if (!is_success &&
 			   (checker->is_up || !checker->has_run)) {
 			if (checker->retry && checker->has_run)
@@ -130,13 +123,8 @@ tcp_epilog(thread_ref_t thread, bool is_success)
 				log_message(LOG_INFO
 				    , "TCP_CHECK on service %s failed."
 				    , FMT_CHK(checker));
-			checker_was_up = checker->is_up;
-			rs_was_alive = checker->rs->alive;
-			update_svr_checker_state(DOWN, checker);
-			if (checker->rs->smtp_alert && checker_was_up &&
-			    (rs_was_alive != checker->rs->alive || !global_data->no_checker_emails))
-				smtp_alert(SMTP_MSG_RS, checker, NULL,
-					   "=> TCP CHECK failed on service <=");
+			checker_report_result(checker, DOWN,
+					      "=> TCP CHECK failed on service <=");
 		}
 	} else {
 		delay = checker->delay_before_retry;
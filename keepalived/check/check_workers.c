@@ -0,0 +1,309 @@
+/*
+ * Soft:        Keepalived is a failover program for the LVS project
+ *              <www.linuxvirtualserver.org>. It monitor & manipulate
+ *              a loadbalanced server pool using multi-layer checks.
+ *
+ * Part:        Checker worker threads. Each worker runs its own thread
+ *              master, and all the network checkers of a real server are
+ *              run by the same worker. Anything that changes IPVS, runs
+ *              scripts or sends alerts stays on the main thread, and
+ *              workers pass check results to it.
+ *
+ * Author:      Alexandre Cassen, <acassen@linux-vs.org>
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *              See the GNU General Public License for more details.
+ *
+ *              This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU General Public License
+ *              as published by the Free Software Foundation; either version
+ *              2 of the License, or (at your option) any later version.
+ *
+ * Copyright (C) 2001-2017 Alexandre Cassen, <acassen@gmail.com>
+ */
+
+#include "config.h"
+
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+
+#include "check_workers.h"
+#include "check_http.h"
+#include "global_data.h"
+#include "memory.h"
+#include "logger.h"
+#include "bitops.h"
+#include "utils.h"
+#include "timer.h"
+
+typedef struct _checker_worker {
+	thread_master_t		*master;
+	pthread_t		thread;
+} checker_worker_t;
+
+/* The result of a check run by a worker */
+typedef struct _checker_result {
+	checker_t		*checker;
+	bool			alive;
+	bool			has_run;	/* checker->has_run when the check completed */
+	char			alert[];	/* empty if no alert */
+} checker_result_t;
+
+static checker_worker_t *checker_workers;
+static unsigned num_checker_workers;
+static unsigned num_running_workers;
+
+/* MISC_CHECKs fork scripts and FILE_CHECKs and BFD_CHECKs are driven by
+ * the main thread, so only these checkers can be run by a worker. */
+static bool
+checker_worker_capable(const checker_t *checker)
+{
+	switch (checker->checker_funcs->type) {
+	case CHECKER_TCP:
+	case CHECKER_UDP:
+	case CHECKER_DNS:
+	case CHECKER_HTTP:
+	case CHECKER_SSL:
+	case CHECKER_SMTP:
+	case CHECKER_PING:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/* The thread master that runs a checker */
+thread_master_t * __attribute__ ((pure))
+checker_master(const checker_t *checker)
+{
+	if (checker->rs->check_master && checker_worker_capable(checker))
+		return checker->rs->check_master;
+
+	return master;
+}
+
+static void *
+checker_worker_thread(void *arg)
+{
+	checker_worker_t *worker = arg;
+
+	set_time_now();
+
+	process_threads(worker->master);
+
+	/* The checkers are about to be freed or reloaded by the main thread */
+	thread_destroy_master(worker->master);
+	worker->master = NULL;
+	free_http_check_thread_data();
+
+	return NULL;
+}
+
+static void
+checker_worker_terminate_thread(thread_ref_t thread)
+{
+	thread_add_terminate_event(thread->master);
+}
+
+static void
+checker_worker_launch_thread(thread_ref_t thread)
+{
+	checker_t *checker = THREAD_ARG(thread);
+
+	thread_add_timer(thread->master, checker->launch, checker, checker_start_delay(checker));
+}
+
+static void
+checker_result_thread(thread_ref_t thread)
+{
+	checker_result_t *result = THREAD_ARG(thread);
+
+	/* The worker sets has_run once it has reported the result, but
+	 * update_svr_checker_state() needs to know if this is the first one. */
+	result->checker->has_run = result->has_run;
+
+	apply_checker_result(result->checker, result->alive, result->alert[0] ? result->alert : NULL);
+
+	FREE(result);
+}
+
+static void
+checker_terminate_thread(__attribute__((unused)) thread_ref_t thread)
+{
+	thread_add_terminate_event(master);
+}
+
+/* Start a checker on its worker */
+void
+launch_worker_checker(checker_t *checker)
+{
+	thread_add_remote_event(checker_master(checker), checker_worker_launch_thread, checker, 0, 0);
+}
+
+/* Pass the result of a check to the main thread. It is only applied there,
+ * so checker->is_up may briefly be stale in the worker. */
+void
+post_checker_result(checker_t *checker, bool alive, const char *alert)
+{
+	checker_result_t *result;
+	size_t len = alert ? strlen(alert) : 0;
+
+	result = MALLOC(sizeof(*result) + len + 1);
+	result->checker = checker;
+	result->alive = alive;
+	result->has_run = checker->has_run;
+	if (alert)
+		memcpy(result->alert, alert, len + 1);
+
+	thread_add_remote_event(master, checker_result_thread, result, 0, THREAD_DESTROY_FREE_ARG);
+}
+
+/* Ask the main thread to terminate the checker process */
+void
+post_checker_terminate(void)
+{
+	thread_add_remote_event(master, checker_terminate_thread, NULL, 0, 0);
+}
+
+/* Create the workers' thread masters and share the real servers out between
+ * them. The threads are only created by run_checker_workers(), once the
+ * checker process has set its priorities and CPU affinity, which the
+ * threads then inherit. */
+void
+start_checker_workers(unsigned num)
+{
+	checker_worker_t *worker;
+	checker_t *checker;
+	unsigned n = 0;
+
+	if (!num)
+		return;
+
+#ifdef _MEM_CHECK_
+	if (__test_bit(MEM_CHECK_BIT, &debug)) {
+		log_message(LOG_INFO, "Memory checking is not thread safe - not using checker worker threads");
+		return;
+	}
+#endif
+
+	if (!thread_enable_remote_events(master))
+		return;
+
+	checker_workers = MALLOC(num * sizeof(*checker_workers));
+
+	for (num_checker_workers = 0; num_checker_workers < num; num_checker_workers++) {
+		worker = &checker_workers[num_checker_workers];
+
+		if (!(worker->master = thread_make_worker_master()))
+			break;
+
+		thread_set_timer_slack(worker->master, global_data->checker_timer_slack);
+		thread_set_unuse_high_water(worker->master, global_data->thread_cache_high_water);
+#ifdef _WITH_IO_URING_
+		if (global_data->checker_io_uring)
+			thread_set_io_uring(worker->master, true);
+#endif
+	}
+
+	if (!num_checker_workers) {
+		FREE(checker_workers);
+		return;
+	}
+
+	list_for_each_entry(checker, &checkers_queue, e_list) {
+		if (checker_worker_capable(checker) && !checker->rs->check_master)
+			checker->rs->check_master = checker_workers[n++ % num_checker_workers].master;
+	}
+}
+
+/* Give the checkers of the workers back to the main thread */
+static void
+release_checker_workers(void)
+{
+	checker_t *checker;
+	unsigned i;
+
+	for (i = 0; i < num_checker_workers; i++) {
+		if (checker_workers[i].master)
+			thread_destroy_master(checker_workers[i].master);
+	}
+
+	FREE(checker_workers);
+	num_checker_workers = 0;
+
+	list_for_each_entry(checker, &checkers_queue, e_list)
+		checker->rs->check_master = NULL;
+}
+
+void
+run_checker_workers(void)
+{
+	checker_t *checker;
+	sigset_t sigset, cursigset;
+	unsigned i;
+	int ret = 0;
+
+	if (!num_checker_workers)
+		return;
+
+	/* Only the main thread handles signals */
+	sigfillset(&sigset);
+	pthread_sigmask(SIG_SETMASK, &sigset, &cursigset);
+
+	for (i = 0; i < num_checker_workers; i++) {
+		if ((ret = pthread_create(&checker_workers[i].thread, NULL, checker_worker_thread, &checker_workers[i])))
+			break;
+	}
+
+	pthread_sigmask(SIG_SETMASK, &cursigset, NULL);
+
+	if (!ret) {
+		num_running_workers = num_checker_workers;
+		log_message(LOG_INFO, "Running network checkers in %u worker threads", num_checker_workers);
+		return;
+	}
+
+	log_message(LOG_INFO, "Unable to create checker worker thread - %s, running checkers in main thread", strerror(ret));
+
+	/* Run all the checkers here, and stop the workers already running */
+	num_running_workers = i;
+	list_for_each_entry(checker, &checkers_queue, e_list) {
+		if (checker->launch && checker_master(checker) != master)
+			thread_add_timer(master, checker->launch, checker, checker_start_delay(checker));
+	}
+
+	stop_checker_workers();
+}
+
+void
+stop_checker_workers(void)
+{
+	unsigned i;
+
+	if (!num_checker_workers)
+		return;
+
+	for (i = 0; i < num_running_workers; i++)
+		thread_add_remote_event(checker_workers[i].master, checker_worker_terminate_thread, NULL, 0, 0);
+
+	for (i = 0; i < num_running_workers; i++)
+		pthread_join(checker_workers[i].thread, NULL);
+
+	num_running_workers = 0;
+
+	release_checker_workers();
+}
+
+#ifdef THREAD_DUMP
+void
+register_check_workers_addresses(void)
+{
+	register_thread_address("checker_worker_terminate_thread", checker_worker_terminate_thread);
+	register_thread_address("checker_worker_launch_thread", checker_worker_launch_thread);
+	register_thread_address("checker_result_thread", checker_result_thread);
+	register_thread_address("checker_terminate_thread", checker_terminate_thread);
+}
+#endif
@@ -69,16 +69,9 @@ ipvs_cmd_str(int cmd)
 
 /* fetch virtual server group from group name */
 virtual_server_group_t * __attribute__ ((pure))
-ipvs_get_group_by_name(const char *gname, list_head_t *l)
+ipvs_get_group_by_name(const char *gname, const str_map_t *vs_group_names)
 {
-	virtual_server_group_t *vsg;
-
-	list_for_each_entry(vsg, l, e_list) {
-		if (!strcmp(vsg->gname, gname))
-			return vsg;
-	}
-
-	return NULL;
+	return str_map_find_entry(vs_group_names, gname, virtual_server_group_t, n_node);
 }
 
 /* Initialization helpers */
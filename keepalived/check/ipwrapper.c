@@ -1213,7 +1213,7 @@ link_vsg_to_vs(void)
 		if (!vs->vsgname)
 			continue;
 
-		vs->vsg = ipvs_get_group_by_name(vs->vsgname, &check_data->vs_group);
+		vs->vsg = ipvs_get_group_by_name(vs->vsgname, &check_data->vs_group_names);
 		if (!vs->vsg) {
 			log_message(LOG_INFO, "Virtual server group %s specified but not configured"
 					      " - ignoring virtual server %s"
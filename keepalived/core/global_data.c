@@ -43,6 +43,7 @@
 #endif
 #include "align.h"
 #include "pidfile.h"
+#include "scheduler.h"
 #ifdef _WITH_JSON_
 #include "global_json.h"
 #endif
@@ -184,6 +185,7 @@ alloc_global_data(void)
 	new->notify_fifo.fd = -1;
 	new->max_auto_priority = 0;
 	new->min_auto_priority_delay = 1000000;	/* 1 second */
+	new->thread_cache_high_water = THREAD_UNUSE_HIGH_WATER;
 #ifdef _WITH_VRRP_
 	new->vrrp_notify_fifo.fd = -1;
 	new->vrrp_rlimit_rt = RT_RLIMIT_DEFAULT;
@@ -672,6 +674,8 @@ dump_global_data(FILE *fp, data_t * data)
 	conf_write(fp, " Send advert after receive higher priority advert = %s", data->vrrp_higher_prio_send_advert ? "true" : "false");
 	conf_write(fp, " Gratuitous ARP interval = %f", data->vrrp_garp_interval / TIMER_HZ_DOUBLE);
 	conf_write(fp, " Gratuitous NA interval = %f", data->vrrp_gna_interval / TIMER_HZ_DOUBLE);
+	if (data->vrrp_garp_refresh_rate)
+		conf_write(fp, " Gratuitous ARP/NA refresh rate = %u/s", data->vrrp_garp_refresh_rate);
 	conf_write(fp, " VRRP default protocol version = %d", data->vrrp_version);
 #ifdef _WITH_IPTABLES_
 	if (data->vrrp_iptables_inchain) {
@@ -724,6 +728,8 @@ dump_global_data(FILE *fp, data_t * data)
 	else
 		conf_write(fp, " Max auto priority = %d", data->max_auto_priority);
 	conf_write(fp, " Min auto priority delay = %ld usecs", data->min_auto_priority_delay);
+	conf_write(fp, " Thread cache high water = %u", data->thread_cache_high_water);
+	conf_write(fp, " Thread statistics = %s", data->thread_stats ? "true" : "false");
 	conf_write(fp, " VRRP process priority = %d", data->vrrp_process_priority);
 	conf_write(fp, " VRRP don't swap = %s", data->vrrp_no_swap ? "true" : "false");
 	conf_write(fp, " VRRP realtime priority = %u", data->vrrp_realtime_priority);
@@ -732,6 +738,10 @@ dump_global_data(FILE *fp, data_t * data)
 		conf_write(fp, " VRRP CPU Affinity = %s", cpu_str);
 	}
 	conf_write(fp, " VRRP realtime limit = %" PRI_rlim_t, data->vrrp_rlimit_rt);
+#ifdef _WITH_IO_URING_
+	conf_write(fp, " VRRP io_uring = %s", data->vrrp_io_uring ? "true" : "false");
+#endif
+	conf_write(fp, " VRRP watchdog budget = %f", data->vrrp_watchdog_budget / TIMER_HZ_DOUBLE);
 #endif
 #ifdef _WITH_LVS_
 	conf_write(fp, " Checker process priority = %d", data->checker_process_priority);
@@ -742,6 +752,13 @@ dump_global_data(FILE *fp, data_t * data)
 		conf_write(fp, " Checker CPU Affinity = %s", cpu_str);
 	}
 	conf_write(fp, " Checker realtime limit = %" PRI_rlim_t, data->checker_rlimit_rt);
+#ifdef _WITH_IO_URING_
+	conf_write(fp, " Checker io_uring = %s", data->checker_io_uring ? "true" : "false");
+#endif
+	conf_write(fp, " Checker timer slack = %lu usecs", data->checker_timer_slack);
+#ifdef _WITH_CHECKER_WORKERS_
+	conf_write(fp, " Checker worker threads = %u", data->checker_worker_threads);
+#endif
 #endif
 #ifdef _WITH_BFD_
 	conf_write(fp, " BFD process priority = %d", data->bfd_process_priority);
@@ -752,6 +769,9 @@ dump_global_data(FILE *fp, data_t * data)
 		conf_write(fp, " BFD CPU Affinity = %s", cpu_str);
 	}
 	conf_write(fp, " BFD realtime limit = %" PRI_rlim_t, data->bfd_rlimit_rt);
+#ifdef _WITH_IO_URING_
+	conf_write(fp, " BFD io_uring = %s", data->bfd_io_uring ? "true" : "false");
+#endif
 #endif
 #ifdef _WITH_SNMP_VRRP_
 	conf_write(fp, " SNMP vrrp %s", data->enable_snmp_vrrp ? "enabled" : "disabled");
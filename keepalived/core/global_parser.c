@@ -63,6 +63,9 @@
 #ifdef _WITH_NFTABLES_
 #include "check_nftables.h"
 #endif
+#ifdef _WITH_CHECKER_WORKERS_
+#include "check_workers.h"
+#endif
 #endif
 #include "namespaces.h"
 #ifdef _WITH_JSON_
@@ -403,6 +406,27 @@ min_auto_priority_delay_handler(const vector_t *strvec)
 
 	global_data->min_auto_priority_delay = delay;
 }
+static void
+thread_cache_high_water_handler(const vector_t *strvec)
+{
+	unsigned high_water;
+
+	if (vector_size(strvec) < 2) {
+		report_config_error(CONFIG_GENERAL_ERROR, "thread_cache_high_water requires value");
+		return;
+	}
+	if (!read_unsigned_strvec(strvec, 1, &high_water, 0, 1000000, true)) {
+		report_config_error(CONFIG_GENERAL_ERROR, "thread_cache_high_water '%s' must be in [0, 1000000] - ignoring", strvec_slot(strvec, 1));
+		return;
+	}
+
+	global_data->thread_cache_high_water = high_water;
+}
+static void
+thread_stats_handler(__attribute__((unused)) const vector_t *strvec)
+{
+	global_data->thread_stats = true;
+}
 #ifdef _WITH_VRRP_
 static void
 smtp_alert_vrrp_handler(const vector_t *strvec)
@@ -972,6 +996,16 @@ vrrp_gna_interval_handler(const vector_t *strvec)
 		log_message(LOG_INFO, "The vrrp_gna_interval is very large - %s seconds", strvec_slot(strvec, 1));
 }
 static void
+vrrp_garp_refresh_rate_handler(const vector_t *strvec)
+{
+	unsigned rate;
+
+	if (!read_unsigned_strvec(strvec, 1, &rate, 0, 1000000, true))
+		report_config_error(CONFIG_GENERAL_ERROR, "vrrp_garp_refresh_rate '%s' is invalid", strvec_slot(strvec, 1));
+	else
+		global_data->vrrp_garp_refresh_rate = rate;
+}
+static void
 vrrp_min_garp_handler(const vector_t *strvec)
 {
 	int res = false;
@@ -1321,6 +1355,24 @@ vrrp_no_swap_handler(__attribute__((unused)) const vector_t *strvec)
 {
 	global_data->vrrp_no_swap = true;
 }
+#ifdef _WITH_IO_URING_
+static void
+vrrp_io_uring_handler(__attribute__((unused)) const vector_t *strvec)
+{
+	global_data->vrrp_io_uring = true;
+}
+#endif
+
+static void
+vrrp_watchdog_budget_handler(const vector_t *strvec)
+{
+	unsigned budget;
+
+	if (!read_decimal_unsigned_strvec(strvec, 1, &budget, 0, TIMER_HZ, TIMER_HZ_DIGITS, true))
+		report_config_error(CONFIG_GENERAL_ERROR, "vrrp_watchdog_budget '%s' is invalid - ignoring", strvec_slot(strvec, 1));
+	else
+		global_data->vrrp_watchdog_budget = budget;
+}
 
 static void
 vrrp_rt_priority_handler(const vector_t *strvec)
@@ -1454,6 +1506,47 @@ checker_no_swap_handler(__attribute__((unused)) const vector_t *strvec)
 {
 	global_data->checker_no_swap = true;
 }
+#ifdef _WITH_IO_URING_
+static void
+checker_io_uring_handler(__attribute__((unused)) const vector_t *strvec)
+{
+	global_data->checker_io_uring = true;
+}
+#endif
+static void
+checker_timer_slack_handler(const vector_t *strvec)
+{
+	unsigned slack;
+
+	if (vector_size(strvec) < 2) {
+		report_config_error(CONFIG_GENERAL_ERROR, "checker_timer_slack requires value");
+		return;
+	}
+	if (!read_unsigned_strvec(strvec, 1, &slack, 0, 10000, true)) {
+		report_config_error(CONFIG_GENERAL_ERROR, "checker_timer_slack '%s' must be in [0, 10000] - ignoring", strvec_slot(strvec, 1));
+		return;
+	}
+
+	global_data->checker_timer_slack = slack * (TIMER_HZ / 1000);
+}
+#ifdef _WITH_CHECKER_WORKERS_
+static void
+checker_worker_threads_handler(const vector_t *strvec)
+{
+	unsigned threads;
+
+	if (vector_size(strvec) < 2) {
+		report_config_error(CONFIG_GENERAL_ERROR, "checker_worker_threads requires value");
+		return;
+	}
+	if (!read_unsigned_strvec(strvec, 1, &threads, 0, CHECKER_WORKERS_MAX, true)) {
+		report_config_error(CONFIG_GENERAL_ERROR, "checker_worker_threads '%s' must be in [0, %d] - ignoring", strvec_slot(strvec, 1), CHECKER_WORKERS_MAX);
+		return;
+	}
+
+	global_data->checker_worker_threads = threads;
+}
+#endif
 
 static void
 checker_rt_priority_handler(const vector_t *strvec)
@@ -1486,6 +1579,13 @@ bfd_no_swap_handler(__attribute__((unused)) const vector_t *strvec)
 {
 	global_data->bfd_no_swap = true;
 }
+#ifdef _WITH_IO_URING_
+static void
+bfd_io_uring_handler(__attribute__((unused)) const vector_t *strvec)
+{
+	global_data->bfd_io_uring = true;
+}
+#endif
 
 static void
 bfd_rt_priority_handler(const vector_t *strvec)
@@ -2333,6 +2433,8 @@ init_global_keywords(bool global_active)
 	install_keyword("shutdown_script_timeout", &shutdown_script_timeout_handler);
 	install_keyword("max_auto_priority", &max_auto_priority_handler);
 	install_keyword("min_auto_priority_delay", &min_auto_priority_delay_handler);
+	install_keyword("thread_cache_high_water", &thread_cache_high_water_handler);
+	install_keyword("thread_stats", &thread_stats_handler);
 #ifdef _WITH_VRRP_
 	install_keyword("smtp_alert_vrrp", &smtp_alert_vrrp_handler);
 #endif
@@ -2368,6 +2470,7 @@ init_global_keywords(bool global_active)
 	install_keyword("vrrp_down_timer_adverts", &vrrp_down_timer_adverts_handler);
 	install_keyword("vrrp_garp_interval", &vrrp_garp_interval_handler);
 	install_keyword("vrrp_gna_interval", &vrrp_gna_interval_handler);
+	install_keyword("vrrp_garp_refresh_rate", &vrrp_garp_refresh_rate_handler);
 	install_keyword("vrrp_min_garp", &vrrp_min_garp_handler);
 #ifdef _HAVE_VRRP_VMAC_
 	install_keyword("vrrp_garp_extra_if", &vrrp_vmac_garp_extra_if_handler);
@@ -2407,6 +2510,10 @@ init_global_keywords(bool global_active)
 	install_keyword("vrrp_cpu_affinity", &vrrp_cpu_affinity_handler);
 	install_keyword("vrrp_rlimit_rttime", &vrrp_rt_rlimit_handler);
 	install_keyword("vrrp_rlimit_rtime", &vrrp_rt_rlimit_handler);		/* Deprecated 02/02/2020 */
+#ifdef _WITH_IO_URING_
+	install_keyword("vrrp_io_uring", &vrrp_io_uring_handler);
+#endif
+	install_keyword("vrrp_watchdog_budget", &vrrp_watchdog_budget_handler);
 #endif
 	install_keyword("notify_fifo", &global_notify_fifo);
 	install_keyword("notify_fifo_script", &global_notify_fifo_script);
@@ -2425,6 +2532,13 @@ init_global_keywords(bool global_active)
 	install_keyword("checker_cpu_affinity", &checker_cpu_affinity_handler);
 	install_keyword("checker_rlimit_rttime", &checker_rt_rlimit_handler);
 	install_keyword("checker_rlimit_rtime", &checker_rt_rlimit_handler);	/* Deprecated 02/02/2020 */
+#ifdef _WITH_IO_URING_
+	install_keyword("checker_io_uring", &checker_io_uring_handler);
+#endif
+	install_keyword("checker_timer_slack", &checker_timer_slack_handler);
+#ifdef _WITH_CHECKER_WORKERS_
+	install_keyword("checker_worker_threads", &checker_worker_threads_handler);
+#endif
 #endif
 #ifdef _WITH_BFD_
 	install_keyword("bfd_priority", &bfd_prio_handler);
@@ -2433,6 +2547,9 @@ init_global_keywords(bool global_active)
 	install_keyword("bfd_cpu_affinity", &bfd_cpu_affinity_handler);
 	install_keyword("bfd_rlimit_rttime", &bfd_rt_rlimit_handler);
 	install_keyword("bfd_rlimit_rtime", &bfd_rt_rlimit_handler);		/* Deprecated 02/02/2020 */
+#ifdef _WITH_IO_URING_
+	install_keyword("bfd_io_uring", &bfd_io_uring_handler);
+#endif
 #endif
 #ifdef _WITH_SNMP_
 	install_keyword("snmp_socket", &snmp_socket_handler);
@@ -50,6 +50,8 @@
 #include <unistd.h>
 #include <inttypes.h>
 #include <linux/if_link.h>
+#include <linux/filter.h>
+#include <stddef.h>
 
 #ifdef THREAD_DUMP
 #include "scheduler.h"
@@ -91,8 +93,46 @@
 /* Default values */
 #define IF_DEFAULT_BUFSIZE	(64*1024)
 
+/* The kernel limits the datagrams of a dump to 32k, however big our buffer */
+#define NL_RCV_BUF_SIZE		(64*1024)
+
+/* Each acknowledgement takes an skb on the receive queue, so the number of
+ * commands in a batch is limited to avoid overrunning the receive buffer */
+#define NL_BATCH_MAX_CMDS	64
+#define NL_BATCH_BUF_SIZE	(16*1024)
+
 /* Global vars */
 nl_handle_t nl_cmd = { .fd = -1 };	/* Command channel */
+
+#ifdef _WITH_VRRP_
+/* Commands sent, or queued to be sent, to the kernel on the cmd channel */
+typedef struct _nl_batch_cmd {
+	uint32_t		seq;
+	uint16_t		type;
+	int			error_ignore;
+	bool			acked;
+	void			(*done)(void *, int);
+	void			*arg;
+} nl_batch_cmd_t;
+
+/* cmds[] is a ring of the commands awaiting their ACKs, starting at head.
+ * The first num_sent of them have been sent, and the rest are in buf. */
+static struct {
+	char			buf[NL_BATCH_BUF_SIZE] __attribute__((aligned(__alignof__(struct nlmsghdr))));
+	size_t			len;
+	nl_batch_cmd_t		cmds[NL_BATCH_MAX_CMDS];
+	unsigned		head;
+	unsigned		num;
+	unsigned		num_sent;
+	unsigned		depth;
+} nl_batch;
+
+#define NL_BATCH_CMD(i)	(&nl_batch.cmds[(nl_batch.head + (i)) % NL_BATCH_MAX_CMDS])
+
+static void netlink_batch_send(void);
+static void netlink_batch_fail_sent(int);
+static bool netlink_batch_ack(struct nlmsghdr *);
+#endif
 #ifdef _WITH_VRRP_
 int netlink_error_ignore;	/* If we get this error, ignore it */
 #endif
@@ -185,26 +225,18 @@ addr_is_equal(struct ifaddrmsg* ifa, void* addr, ip_address_t* vip_addr, interfa
 static vrrp_t * __attribute__ ((pure))
 address_is_ours(struct ifaddrmsg *ifa, struct in_addr *addr, interface_t *ifp)
 {
-	tracking_obj_t *top;
-	vrrp_t *vrrp;
-	ip_address_t *ip_addr;
-	list_head_t *vip_list;
+	vip_index_entry_t *entry;
 
-	list_for_each_entry(top, &ifp->tracking_vrrp, e_list) {
-		vrrp = top->obj.vrrp;
+	if (!vrrp_data)
+		return NULL;
 
+	vip_index_for_each_entry(entry, &vrrp_data->vip_index, ifa->ifa_family, addr) {
 		/* If we are not master, then we won't have the address configured */
-		if (vrrp->state != VRRP_STATE_MAST)
+		if (entry->vrrp->state != VRRP_STATE_MAST)
 			continue;
 
-		for (vip_list = ifa->ifa_family == vrrp->family ? &vrrp->vip : &vrrp->evip;
-		     vip_list;
-		     vip_list = vip_list == &vrrp->vip ? &vrrp->evip : NULL) {
-			list_for_each_entry(ip_addr, vip_list, e_list) {
-				if (addr_is_equal(ifa, addr, ip_addr, ifp))
-					return ip_addr->dont_track ? NULL : vrrp;
-			}
-		}
+		if (addr_is_equal(ifa, addr, entry->ip_addr, ifp))
+			return entry->ip_addr->dont_track ? NULL : entry->vrrp;
 	}
 
 	return NULL;
@@ -213,29 +245,20 @@ address_is_ours(struct ifaddrmsg *ifa, struct in_addr *addr, interface_t *ifp)
 static bool __attribute__ ((pure))
 ignore_address_if_ours_or_link_local(struct ifaddrmsg *ifa, struct in_addr *addr, interface_t *ifp)
 {
-	tracking_obj_t *top;
-	vrrp_t *vrrp;
-	ip_address_t *ip_addr;
+	vip_index_entry_t *entry;
 
 	/* We are only interested in link local for IPv6 */
 	if (ifa->ifa_family == AF_INET6 &&
 	    ifa->ifa_scope != RT_SCOPE_LINK)
 		return true;
 
-	list_for_each_entry(top, &ifp->tracking_vrrp, e_list) {
-		vrrp = top->obj.vrrp;
-
-		if (ifa->ifa_family == vrrp->family) {
-			list_for_each_entry(ip_addr, &vrrp->vip, e_list) {
-				if (addr_is_equal2(ifa, addr, ip_addr, ifp, vrrp))
-					return true;
-			}
-		}
+	/* Addresses are read before the configuration at startup */
+	if (!vrrp_data)
+		return false;
 
-		list_for_each_entry(ip_addr, &vrrp->evip, e_list) {
-			if (addr_is_equal2(ifa, addr, ip_addr, ifp, vrrp))
-				return true;
-		}
+	vip_index_for_each_entry(entry, &vrrp_data->vip_index, ifa->ifa_family, addr) {
+		if (addr_is_equal2(ifa, addr, entry->ip_addr, ifp, entry->vrrp))
+			return true;
 	}
 
 	return false;
@@ -263,67 +286,43 @@ static ip_route_t *
 route_is_ours(struct rtmsg* rt, struct rtattr *tb[RTA_MAX + 1], vrrp_t** ret_vrrp)
 {
 	uint32_t table;
-	int family;
-	int mask_len = rt->rtm_dst_len;
 	uint32_t priority = 0;
 	uint8_t tos = rt->rtm_tos;
-	vrrp_t *vrrp;
+	route_index_entry_t *entry;
 	ip_route_t *route;
-	union {
-		struct in_addr in;
-		struct in6_addr in6;
-	} default_addr;
 
 	*ret_vrrp = NULL;
 
 	table = tb[RTA_TABLE] ? *PTR_CAST(uint32_t, RTA_DATA(tb[RTA_TABLE])) : rt->rtm_table;
-	family = rt->rtm_family;
 	if (tb[RTA_PRIORITY])
 		priority = *PTR_CAST(uint32_t, RTA_DATA(tb[RTA_PRIORITY]));
 
-	list_for_each_entry(vrrp, &vrrp_data->vrrp, e_list) {
-		list_for_each_entry(route, &vrrp->vroutes, e_list) {
-			if (table != route->table ||
-			    family != route->family ||
-			    mask_len != route->dst->ifa.ifa_prefixlen ||
-			    priority != route->metric ||
-			    tos != route->tos)
-				continue;
+	/* The index matches the family, table and destination. The vrrp routes
+	 * come before the static routes. */
+	route_index_for_each_entry(entry, &vrrp_data->route_index, rt->rtm_family, table, rt->rtm_dst_len,
+				   tb[RTA_DST] ? RTA_DATA(tb[RTA_DST]) : NULL) {
+		route = entry->route;
 
-			if (route->oif) {
-				if (!tb[RTA_OIF] || route->oif->ifindex != *PTR_CAST(uint32_t, RTA_DATA(tb[RTA_OIF])))
-					continue;
-			} else {
-				if (route->set && route->configured_ifindex &&
-				    (!tb[RTA_OIF] || route->configured_ifindex != *PTR_CAST(uint32_t, RTA_DATA(tb[RTA_OIF]))))
-					continue;
-			}
-
-			if (!tb[RTA_DST])
-				memset(&default_addr, 0, sizeof(default_addr));
-
-			if (compare_addr(family, tb[RTA_DST] ? RTA_DATA(tb[RTA_DST]) : &default_addr, route->dst))
-				continue;
+		if (tos != route->tos)
+			continue;
 
-			*ret_vrrp = vrrp;
+		/* Static routes do not need to match the metric or interface */
+		if (!entry->vrrp)
 			return route;
-		}
-	}
 
-	/* Now check the static routes */
-	list_for_each_entry(route, &vrrp_data->static_routes, e_list) {
-		if (table != route->table ||
-		    family != route->family ||
-		    mask_len != route->dst->ifa.ifa_prefixlen ||
-		    tos != route->tos)
+		if (priority != route->metric)
 			continue;
 
-		if (!tb[RTA_DST])
-			memset(&default_addr, 0, sizeof(default_addr));
-
-		if (compare_addr(family, tb[RTA_DST] ? RTA_DATA(tb[RTA_DST]) : &default_addr, route->dst))
-			continue;
+		if (route->oif) {
+			if (!tb[RTA_OIF] || route->oif->ifindex != *PTR_CAST(uint32_t, RTA_DATA(tb[RTA_OIF])))
+				continue;
+		} else {
+			if (route->set && route->configured_ifindex &&
+			    (!tb[RTA_OIF] || route->configured_ifindex != *PTR_CAST(uint32_t, RTA_DATA(tb[RTA_OIF]))))
+				continue;
+		}
 
+		*ret_vrrp = entry->vrrp;
 		return route;
 	}
 
@@ -489,23 +488,19 @@ compare_rule(struct fib_rule_hdr *frh, struct rtattr *tb[FRA_MAX + 1], ip_rule_t
 static ip_rule_t *
 rule_is_ours(struct fib_rule_hdr* frh, struct rtattr *tb[FRA_MAX + 1], vrrp_t **ret_vrrp)
 {
-	vrrp_t *vrrp;
-	ip_rule_t *rule;
+	rule_index_entry_t *entry;
 
 	*ret_vrrp = NULL;
 
-	list_for_each_entry(vrrp, &vrrp_data->vrrp, e_list) {
-		list_for_each_entry(rule, &vrrp->vrules, e_list) {
-			if (compare_rule(frh, tb, rule)) {
-				*ret_vrrp = vrrp;
-				return rule;
-			}
-		}
-	}
+	/* Our rules always have a priority */
+	if (!tb[FRA_PRIORITY])
+		return NULL;
 
-	list_for_each_entry(rule, &vrrp_data->static_rules, e_list) {
-		if (compare_rule(frh, tb, rule))
-			return rule;
+	rule_index_for_each_entry(entry, &vrrp_data->rule_index, frh->family, *PTR_CAST(uint32_t, RTA_DATA(tb[FRA_PRIORITY]))) {
+		if (compare_rule(frh, tb, entry->rule)) {
+			*ret_vrrp = entry->vrrp;
+			return entry->rule;
+		}
 	}
 
 	return NULL;
@@ -539,9 +534,42 @@ kernel_netlink_set_membership(int group, bool add)
 		log_message(LOG_INFO, "Netlink: Cannot add membership on netlink socket : (%s)", strerror(errno));
 }
 
+/* Route monitoring delivers every route added or deleted on the system,
+ * but netlink_route_filter() only wants the ones with protocol keepalived.
+ * Rules cannot be filtered in the same way since the rule protocol is an
+ * attribute. */
+static void
+kernel_netlink_set_route_filter(bool set)
+{
+	struct sock_filter bpfcode[] = {
+		BPF_STMT(BPF_LD | BPF_H | BPF_ABS, offsetof(struct nlmsghdr, nlmsg_type)),
+		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htons(RTM_NEWROUTE), 1, 0),
+		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htons(RTM_DELROUTE), 0, 2),
+		BPF_STMT(BPF_LD | BPF_B | BPF_ABS, NLMSG_HDRLEN + offsetof(struct rtmsg, rtm_protocol)),
+		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, RTPROT_KEEPALIVED, 0, 1),
+		BPF_STMT(BPF_RET | BPF_K, UINT32_MAX),
+		BPF_STMT(BPF_RET | BPF_K, 0),
+	};
+	struct sock_fprog bpf = { .filter = bpfcode, .len = sizeof(bpfcode) / sizeof(bpfcode[0]) };
+	int dummy = 0;
+
+	if (!set) {
+		/* ENOENT just means there was no filter attached */
+		if (setsockopt(nl_kernel.fd, SOL_SOCKET, SO_DETACH_FILTER, &dummy, sizeof(dummy)) < 0 && errno != ENOENT)
+			log_message(LOG_INFO, "Netlink: Cannot detach route filter : (%s)", strerror(errno));
+		return;
+	}
+
+	if (setsockopt(nl_kernel.fd, SOL_SOCKET, SO_ATTACH_FILTER, &bpf, sizeof(bpf)) < 0)
+		log_message(LOG_INFO, "Netlink: Cannot attach route filter : (%s)", strerror(errno));
+}
+
 void
 set_extra_netlink_monitoring(bool ipv4_routes, bool ipv6_routes, bool ipv4_rules, bool ipv6_rules)
 {
+	/* Have the kernel drop the route messages we would ignore before they are queued */
+	kernel_netlink_set_route_filter(ipv4_routes || ipv6_routes);
+
 	kernel_netlink_set_membership(RTNLGRP_IPV4_ROUTE, ipv4_routes);
 	kernel_netlink_set_membership(RTNLGRP_IPV6_ROUTE, ipv6_routes);
 	kernel_netlink_set_membership(RTNLGRP_IPV4_RULE, ipv4_rules);
@@ -549,6 +577,18 @@ set_extra_netlink_monitoring(bool ipv4_routes, bool ipv6_routes, bool ipv4_rules
 }
 #endif
 
+/* The receive buffer is kept for the life of the socket */
+static void
+netlink_alloc_rcv_buf(nl_handle_t *nl, size_t size)
+{
+	if (nl->rcv_buf_size >= size)
+		return;
+
+	FREE_PTR(nl->rcv_buf);
+	nl->rcv_buf = MALLOC(size);
+	nl->rcv_buf_size = size;
+}
+
 /* Create a socket to netlink interface_t */
 static void
 netlink_socket(nl_handle_t *nl, unsigned rcvbuf_size, bool force, int flags, unsigned group, ...)
@@ -661,8 +701,7 @@ netlink_close(nl_handle_t *nl)
 	if (!nl)
 		return;
 
-	/* First of all release pending thread. There is no thread
-	 * for nl_cmd since it is used synchronously. */
+	/* First of all release pending thread */
 	if (nl->thread) {
 		thread_cancel(nl->thread);
 		nl->thread = NULL;
@@ -672,6 +711,9 @@ netlink_close(nl_handle_t *nl)
 		close(nl->fd);
 
 	nl->fd = -1;
+
+	FREE_PTR(nl->rcv_buf);
+	nl->rcv_buf_size = 0;
 }
 
 /* iproute2 utility function */
@@ -1253,12 +1295,14 @@ netlink_parse_info(int (*filter) (struct sockaddr_nl *, struct nlmsghdr *),
 	ssize_t len;
 	int ret = 0;
 	int error;
-	char *nlmsg_buf __attribute__((aligned(__alignof__(struct nlmsghdr)))) = NULL;
-	int nlmsg_buf_size = 0;
+
+	if (!nl->rcv_buf)
+		netlink_alloc_rcv_buf(nl, NL_RCV_BUF_SIZE);
 
 	while (true) {
 		struct iovec iov = {
-			.iov_len = 0
+			.iov_base = nl->rcv_buf,
+			.iov_len = nl->rcv_buf_size
 		};
 		struct sockaddr_nl snl;
 		struct msghdr msg = {
@@ -1272,38 +1316,23 @@ netlink_parse_info(int (*filter) (struct sockaddr_nl *, struct nlmsghdr *),
 		};
 		struct nlmsghdr *h;
 
-		/* Find out how big our receive buffer needs to be */
+		/* MSG_TRUNC makes recvmsg() return the real length of a
+		 * datagram that doesn't fit in the buffer */
 		do {
-			len = recvmsg(nl->fd, &msg, MSG_PEEK | MSG_TRUNC);
-		} while (len < 0 && check_EINTR(errno));
-
-		if (len < 0) {
-			ret = -1;
-			break;
-		}
-
-		if (len == 0)
-			break;
-
-		if (len > nlmsg_buf_size) {
-			FREE_PTR(nlmsg_buf);
-			nlmsg_buf = MALLOC(len);
-			nlmsg_buf_size = len;
-		}
-
-		iov.iov_base = nlmsg_buf;
-		iov.iov_len = nlmsg_buf_size;
-
-		do {
-			len = recvmsg(nl->fd, &msg, 0);
+			len = recvmsg(nl->fd, &msg, MSG_TRUNC);
 		} while (len < 0 && check_EINTR(errno));
 
 		if (len < 0) {
 			if (check_EAGAIN(errno))
 				break;
 			if (errno == ENOBUFS) {
+				nl->rcv_overruns++;
 				log_message(LOG_INFO, "Netlink: Receive buffer overrun on %s socket - (%m)", nl == &nl_kernel ? "monitor" : "cmd");
 				log_message(LOG_INFO, "  - increase the relevant netlink_rcv_bufs global parameter and/or set force");
+#ifdef _WITH_VRRP_
+				if (nl == &nl_cmd)
+					netlink_batch_fail_sent(-ENOBUFS);
+#endif
 			}
 			else
 				log_message(LOG_INFO, "Netlink: recvmsg error on %s socket  - %d (%m)", nl == &nl_kernel ? "monitor" : "cmd", errno);
@@ -1316,6 +1345,15 @@ netlink_parse_info(int (*filter) (struct sockaddr_nl *, struct nlmsghdr *),
 			break;
 		}
 
+		/* The datagram is lost, but make sure the next one will fit */
+		if (msg.msg_flags & MSG_TRUNC) {
+			log_message(LOG_INFO, "Netlink: error: message truncated on %s socket - %zd bytes", nl == &nl_kernel ? "monitor" : "cmd", len);
+			netlink_alloc_rcv_buf(nl, (size_t)len);
+			continue;
+		}
+
+		nl->rcv_bytes += (uint64_t)len;
+
 		if (msg.msg_namelen != sizeof snl) {
 			log_message(LOG_INFO,
 			       "Netlink: Sender address length error: length %u",
@@ -1325,12 +1363,18 @@ netlink_parse_info(int (*filter) (struct sockaddr_nl *, struct nlmsghdr *),
 		}
 
 		/* See -Wcast-align comment above, also applies to NLMSG_NEXT */
-		for (h = PTR_CAST(struct nlmsghdr, nlmsg_buf); NLMSG_OK(h, (size_t)len); h = NLMSG_NEXT(h, len)) {
+		for (h = PTR_CAST(struct nlmsghdr, nl->rcv_buf); NLMSG_OK(h, (size_t)len); h = NLMSG_NEXT(h, len)) {
+			nl->rcv_msgs++;
+
 			/* Finish off reading. */
-			if (h->nlmsg_type == NLMSG_DONE) {
-				FREE(nlmsg_buf);
+			if (h->nlmsg_type == NLMSG_DONE)
 				return ret;
-			}
+
+#ifdef _WITH_VRRP_
+			/* The ACK of an asynchronous command */
+			if (nl == &nl_cmd && netlink_batch_ack(h))
+				continue;
+#endif
 
 			/* Error handling. */
 			if (h->nlmsg_type == NLMSG_ERROR) {
@@ -1341,24 +1385,20 @@ netlink_parse_info(int (*filter) (struct sockaddr_nl *, struct nlmsghdr *),
 				 * return if not related to multipart message.
 				 */
 				if (err->error == 0) {
-					if (!(h->nlmsg_flags & NLM_F_MULTI) && !read_all) {
-						FREE(nlmsg_buf);
+					if (!(h->nlmsg_flags & NLM_F_MULTI) && !read_all)
 						return 0;
-					}
 					continue;
 				}
 
 				if (h->nlmsg_len < NLMSG_LENGTH(sizeof (struct nlmsgerr))) {
 					log_message(LOG_INFO,
 					       "Netlink: error: message truncated");
-					FREE(nlmsg_buf);
 					return -1;
 				}
 
 				if (n && (err->error == -EEXIST) &&
 				    ((n->nlmsg_type == RTM_NEWROUTE) ||
 				     (n->nlmsg_type == RTM_NEWADDR))) {
-					FREE(nlmsg_buf);
 					return 0;
 				}
 
@@ -1368,10 +1408,8 @@ netlink_parse_info(int (*filter) (struct sockaddr_nl *, struct nlmsghdr *),
 				 * in the same CIDR are deleted */
 				if (n && err->error == -EADDRNOTAVAIL &&
 				    n->nlmsg_type == RTM_DELADDR) {
-					if (!(h->nlmsg_flags & NLM_F_MULTI)) {
-						FREE(nlmsg_buf);
+					if (!(h->nlmsg_flags & NLM_F_MULTI))
 						return 0;
-					}
 					continue;
 				}
 #ifdef _WITH_VRRP_
@@ -1383,7 +1421,6 @@ netlink_parse_info(int (*filter) (struct sockaddr_nl *, struct nlmsghdr *),
 					       get_nl_msg_type(err->msg.nlmsg_type), err->msg.nlmsg_type,
 					       err->msg.nlmsg_seq, err->msg.nlmsg_pid);
 
-				FREE(nlmsg_buf);
 				return -1;
 			}
 
@@ -1408,17 +1445,11 @@ netlink_parse_info(int (*filter) (struct sockaddr_nl *, struct nlmsghdr *),
 				ret = error;
 			}
 
-			if (!(h->nlmsg_flags & NLM_F_MULTI) && !read_all) {
-				FREE(nlmsg_buf);
+			if (!(h->nlmsg_flags & NLM_F_MULTI) && !read_all)
 				return ret;
-			}
 		}
 
 		/* After error care. */
-		if (msg.msg_flags & MSG_TRUNC) {
-			log_message(LOG_INFO, "Netlink: error: message truncated");
-			continue;
-		}
 		if (len) {
 			log_message(LOG_INFO, "Netlink: error: data remnant size %zd",
 			       len);
@@ -1428,9 +1459,6 @@ netlink_parse_info(int (*filter) (struct sockaddr_nl *, struct nlmsghdr *),
 		}
 	}
 
-	if (nlmsg_buf)
-		FREE(nlmsg_buf);
-
 	return ret;
 }
 
@@ -1467,6 +1495,10 @@ netlink_talk(nl_handle_t *nl, struct nlmsghdr *n)
 	memset(&snl, 0, sizeof snl);
 	snl.nl_family = AF_NETLINK;
 
+	/* Commands queued earlier must be processed first */
+	if (nl == &nl_cmd)
+		netlink_batch_send();
+
 	n->nlmsg_seq = ++nl->seq;
 
 	/* Request Netlink acknowledgement */
@@ -1503,6 +1535,273 @@ netlink_talk(nl_handle_t *nl, struct nlmsghdr *n)
 
 	return status;
 }
+
+static void
+netlink_batch_cmd_done(nl_batch_cmd_t *cmd, int error)
+{
+	/* The same errors are not errors as for netlink_talk() */
+	if ((error == -EEXIST && (cmd->type == RTM_NEWROUTE || cmd->type == RTM_NEWADDR)) ||
+	    (error == -EADDRNOTAVAIL && cmd->type == RTM_DELADDR))
+		error = 0;
+
+	if (error && cmd->error_ignore != -error)
+		log_message(LOG_INFO, "Netlink: error: %s(%d), type=%s(%u), seq=%u, pid=%u",
+			       strerror(-error), -error,
+			       get_nl_msg_type(cmd->type), cmd->type,
+			       cmd->seq, nl_cmd.nl_pid);
+
+	cmd->acked = true;
+	if (cmd->done)
+		cmd->done(cmd->arg, error);
+}
+
+/* Drop the commands at the head of the ring that have completed */
+static void
+netlink_batch_retire(void)
+{
+	while (nl_batch.num_sent && NL_BATCH_CMD(0)->acked) {
+		nl_batch.head = (nl_batch.head + 1) % NL_BATCH_MAX_CMDS;
+		nl_batch.num--;
+		nl_batch.num_sent--;
+	}
+}
+
+/* Fail all the commands that have been sent but not acknowledged, for
+ * when their ACKs cannot be read. */
+static void
+netlink_batch_fail_sent(int error)
+{
+	unsigned i;
+
+	for (i = 0; i < nl_batch.num_sent; i++) {
+		if (!NL_BATCH_CMD(i)->acked)
+			netlink_batch_cmd_done(NL_BATCH_CMD(i), error);
+	}
+
+	netlink_batch_retire();
+}
+
+/* If h is the ACK of a command sent in a batch, complete the command.
+ * ACKs can arrive interleaved with the replies to netlink_talk() and
+ * dump requests on the cmd channel, so netlink_parse_info() uses this too. */
+static bool
+netlink_batch_ack(struct nlmsghdr *h)
+{
+	unsigned i;
+
+	if (h->nlmsg_type != NLMSG_ERROR ||
+	    h->nlmsg_len < NLMSG_LENGTH(sizeof(struct nlmsgerr)))
+		return false;
+
+	i = h->nlmsg_seq - NL_BATCH_CMD(0)->seq;
+	if (!nl_batch.num_sent || i >= nl_batch.num_sent || NL_BATCH_CMD(i)->acked)
+		return false;
+
+	netlink_batch_cmd_done(NL_BATCH_CMD(i), PTR_CAST(struct nlmsgerr, NLMSG_DATA(h))->error);
+	netlink_batch_retire();
+
+	return true;
+}
+
+/* Read whatever is available on the cmd channel, or block until
+ * something is if wait is set, and process any batch ACKs in it.
+ * Returns -errno on error, or 0 if there is nothing to read. */
+static ssize_t
+netlink_batch_read(bool wait)
+{
+	struct sockaddr_nl snl;
+	struct iovec iov;
+	struct msghdr msg = {
+		.msg_name = &snl,
+		.msg_namelen = sizeof(snl),
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+	};
+	struct nlmsghdr *h;
+	ssize_t len;
+
+	if (!nl_cmd.rcv_buf)
+		netlink_alloc_rcv_buf(&nl_cmd, NL_RCV_BUF_SIZE);
+	iov.iov_base = nl_cmd.rcv_buf;
+	iov.iov_len = nl_cmd.rcv_buf_size;
+
+	do {
+		len = recvmsg(nl_cmd.fd, &msg, MSG_TRUNC | (wait ? 0 : MSG_DONTWAIT));
+	} while (len < 0 && check_EINTR(errno));
+
+	if (len < 0) {
+		if (!wait && check_EAGAIN(errno))
+			return 0;
+
+		len = -errno;
+		if (errno == ENOBUFS) {
+			nl_cmd.rcv_overruns++;
+			log_message(LOG_INFO, "Netlink: Receive buffer overrun on cmd socket - (%m)");
+			log_message(LOG_INFO, "  - increase the relevant netlink_rcv_bufs global parameter and/or set force");
+		} else
+			log_message(LOG_INFO, "Netlink: recvmsg error on cmd socket reading batch acknowledgements - %d (%m)", errno);
+
+		/* The ACKs may have been lost */
+		netlink_batch_fail_sent((int)len);
+		return len;
+	}
+
+	if (!len) {
+		netlink_batch_fail_sent(-EPIPE);
+		return -EPIPE;
+	}
+
+	if (msg.msg_flags & MSG_TRUNC) {
+		log_message(LOG_INFO, "Netlink: error: message truncated on cmd socket - %zd bytes", len);
+		netlink_alloc_rcv_buf(&nl_cmd, (size_t)len);
+		netlink_batch_fail_sent(-EMSGSIZE);
+		return -EMSGSIZE;
+	}
+
+	nl_cmd.rcv_bytes += (uint64_t)len;
+
+	for (h = PTR_CAST(struct nlmsghdr, nl_cmd.rcv_buf); NLMSG_OK(h, (size_t)len); h = NLMSG_NEXT(h, len)) {
+		nl_cmd.rcv_msgs++;
+		if (!netlink_batch_ack(h))
+			log_message(LOG_INFO, "Netlink: ignoring message type 0x%04x", h->nlmsg_type);
+	}
+
+	return 1;
+}
+
+/* Send all the queued commands in one message. The kernel processes
+ * every command in the message even if some of them fail, and
+ * acknowledges each of them. */
+static void
+netlink_batch_send(void)
+{
+	struct sockaddr_nl snl = { .nl_family = AF_NETLINK };
+	struct iovec iov = { .iov_base = nl_batch.buf, .iov_len = nl_batch.len };
+	struct msghdr msg = {
+		.msg_name = &snl,
+		.msg_namelen = sizeof(snl),
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+	};
+	unsigned i;
+	int error;
+
+	if (nl_batch.num == nl_batch.num_sent)
+		return;
+
+	nl_batch.len = 0;
+
+	if (sendmsg(nl_cmd.fd, &msg, 0) >= 0) {
+		nl_batch.num_sent = nl_batch.num;
+		return;
+	}
+
+	error = -errno;
+	log_message(LOG_INFO, "Netlink: sendmsg(%d) batch of %u commands error: %m", nl_cmd.fd, nl_batch.num - nl_batch.num_sent);
+
+	for (i = nl_batch.num_sent; i < nl_batch.num; i++) {
+		if (NL_BATCH_CMD(i)->done)
+			NL_BATCH_CMD(i)->done(NL_BATCH_CMD(i)->arg, error);
+	}
+	nl_batch.num = nl_batch.num_sent;
+}
+
+/* Send any queued commands and wait for all outstanding ACKs */
+static void
+netlink_batch_flush(void)
+{
+	netlink_batch_send();
+
+	while (nl_batch.num_sent && netlink_batch_read(true) > 0);
+}
+
+static void
+netlink_batch_ack_thread(__attribute__((unused)) thread_ref_t thread)
+{
+	nl_cmd.thread = NULL;
+
+	while (nl_batch.num_sent && netlink_batch_read(false) > 0);
+
+	if (nl_batch.num_sent)
+		nl_cmd.thread = thread_add_read(master, netlink_batch_ack_thread, NULL, nl_cmd.fd, TIMER_NEVER, 0);
+}
+
+/* Queue a command to be sent in the current batch. done, which may be
+ * NULL, is called with the command's result (0 or -errno) when its ACK is
+ * read. Errors matching error_ignore are not logged. */
+void
+netlink_batch_add(struct nlmsghdr *n, int error_ignore, void (*done)(void *, int), void *arg)
+{
+	nl_batch_cmd_t *cmd;
+	size_t len = NLMSG_ALIGN(n->nlmsg_len);
+
+	/* Limiting the outstanding commands stops their ACKs overrunning
+	 * the socket's receive buffer */
+	if (nl_batch.num == NL_BATCH_MAX_CMDS)
+		netlink_batch_flush();
+	else if (nl_batch.len + len > sizeof(nl_batch.buf))
+		netlink_batch_send();
+
+	n->nlmsg_seq = ++nl_cmd.seq;
+	n->nlmsg_flags |= NLM_F_ACK;
+	memcpy(nl_batch.buf + nl_batch.len, n, n->nlmsg_len);
+	nl_batch.len += len;
+
+	cmd = NL_BATCH_CMD(nl_batch.num++);
+	cmd->seq = n->nlmsg_seq;
+	cmd->type = n->nlmsg_type;
+	cmd->error_ignore = error_ignore ? error_ignore : netlink_error_ignore;
+	cmd->acked = false;
+	cmd->done = done;
+	cmd->arg = arg;
+
+	if (!nl_batch.depth)
+		netlink_batch_flush();
+}
+
+/* Commands added between netlink_batch_open() and netlink_batch_close()
+ * are sent together; batches may be nested. */
+void
+netlink_batch_open(void)
+{
+	nl_batch.depth++;
+}
+
+void
+netlink_batch_close(void)
+{
+	if (!--nl_batch.depth)
+		netlink_batch_flush();
+}
+
+/* As netlink_batch_close(), but don't wait for the ACKs; they are read
+ * by a read thread on the cmd channel and the commands' done functions
+ * are called from there. */
+void
+netlink_batch_close_async(void)
+{
+	if (--nl_batch.depth)
+		return;
+
+	netlink_batch_send();
+
+	if (nl_batch.num_sent && !nl_cmd.thread && master)
+		nl_cmd.thread = thread_add_read(master, netlink_batch_ack_thread, NULL, nl_cmd.fd, TIMER_NEVER, 0);
+	else if (!master)
+		netlink_batch_flush();
+}
+
+/* Wait for the ACKs of any commands sent asynchronously */
+void
+netlink_batch_wait(void)
+{
+	netlink_batch_flush();
+
+	if (nl_cmd.thread) {
+		thread_cancel(nl_cmd.thread);
+		nl_cmd.thread = NULL;
+	}
+}
 #endif
 
 /* Fetch a specific type of information from netlink kernel */
@@ -1523,6 +1822,12 @@ netlink_request(nl_handle_t *nl,
 		char buf[64];
 	} req = { .nlh.nlmsg_type = type };
 
+#ifdef _WITH_VRRP_
+	/* Commands queued earlier must be processed first */
+	if (nl == &nl_cmd)
+		netlink_batch_send();
+#endif
+
 	req.nlh.nlmsg_len = NLMSG_LENGTH(sizeof req.i);
 	req.nlh.nlmsg_flags = NLM_F_REQUEST;
 	req.nlh.nlmsg_pid = 0;
@@ -1731,6 +2036,7 @@ netlink_if_get_ll_addr(interface_t *ifp, struct rtattr *tb[],
 		case IFLA_ADDRESS:
 			ifp->hw_addr_len = hw_addr_len;
 			memcpy(ifp->hw_addr, RTA_DATA(tb[type]), hw_addr_len);
+			if_rehash(ifp);
 			/*
 			 * Don't allow a hardware address of all zeroes
 			 * Mark hw_addr_len as 0 to warn
@@ -1818,6 +2124,7 @@ netlink_if_link_populate(interface_t *ifp, struct rtattr *tb[], struct ifinfomsg
 	/* Fill the interface structure */
 	strcpy_safe(ifp->ifname, name);
 	ifp->ifindex = (ifindex_t)ifi->ifi_index;
+	if_rehash(ifp);
 #ifdef _HAVE_VRRP_VMAC_
 	ifp->if_type = IF_TYPE_STANDARD;
 #endif
@@ -2107,6 +2414,7 @@ netlink_link_filter(__attribute__((unused)) struct sockaddr_nl *snl, struct nlms
 			if (prog_type != PROG_TYPE_VRRP) {
 				ifp->ifi_flags = 0;
 				ifp->ifindex = 0;
+				if_rehash(ifp);
 			} else
 #endif
 				cleanup_lost_interface(ifp);
@@ -2141,6 +2449,7 @@ netlink_link_filter(__attribute__((unused)) struct sockaddr_nl *snl, struct nlms
 						}
 						ifp->hw_addr_len = hw_addr_len;
 						memcpy(ifp->hw_addr, RTA_DATA(tb[IFLA_ADDRESS]), hw_addr_len);
+						if_rehash(ifp);
 						if (__test_bit(LOG_DETAIL_BIT, &debug)) {
 							format_mac_buf(mac_buf, sizeof mac_buf, ifp->hw_addr, ifp->hw_addr_len);
 							log_message(LOG_INFO, "(%s) MAC %s changed from %s to %s",
@@ -2180,6 +2489,7 @@ netlink_link_filter(__attribute__((unused)) struct sockaddr_nl *snl, struct nlms
 				if (prog_type != PROG_TYPE_VRRP) {
 					ifp->ifi_flags = 0;
 					ifp->ifindex = 0;
+					if_rehash(ifp);
 				} else
 #endif
 					cleanup_lost_interface(ifp);
@@ -2261,6 +2571,9 @@ netlink_link_filter(__attribute__((unused)) struct sockaddr_nl *snl, struct nlms
 			/* Save the list_head entry itself */
 			sav_e_list = ifp->e_list;
 
+			/* netlink_if_link_populate() hashes it again */
+			if_unhash(ifp);
+
 			memset(ifp, 0, sizeof(interface_t));
 
 			/* Restore the list_head entry */
@@ -2522,6 +2835,10 @@ kernel_netlink_close_monitor(void)
 void
 kernel_netlink_close_cmd(void)
 {
+#ifdef _WITH_VRRP_
+	if (nl_cmd.fd != -1)
+		netlink_batch_wait();
+#endif
 	netlink_close(&nl_cmd);
 }
 
@@ -2579,7 +2896,7 @@ kernel_netlink_init(void)
 	} else
 		log_message(LOG_INFO, "Error while registering Kernel netlink reflector channel");
 
-	/* Prepare netlink command channel. The cmd socket is used synchronously.*/
+	/* Prepare netlink command channel. */
 #ifdef _ONE_PROCESS_DEBUG_
 #ifdef _WITH_VRRP_
 	netlink_socket(&nl_cmd, global_data->vrrp_netlink_cmd_rcv_bufs, global_data->vrrp_netlink_cmd_rcv_bufs_force, 0, 0);
@@ -2625,6 +2942,32 @@ cancel_kernel_netlink_threads(void)
 		thread_cancel(nl_kernel.thread);
 		nl_kernel.thread = NULL;
 	}
+
+#ifdef _WITH_VRRP_
+	/* The commands' done functions may refer to the configuration */
+	if (nl_cmd.fd != -1)
+		netlink_batch_wait();
+#endif
+}
+
+static void
+netlink_print_handle_stats(FILE *fp, const char *name, nl_handle_t *nl, bool clear_stats)
+{
+	fprintf(fp, "  %s socket:\n", name);
+	fprintf(fp, "    Messages: %" PRIu64 "\n", nl->rcv_msgs);
+	fprintf(fp, "    Bytes: %" PRIu64 "\n", nl->rcv_bytes);
+	fprintf(fp, "    Receive buffer overruns: %" PRIu64 "\n", nl->rcv_overruns);
+
+	if (clear_stats)
+		nl->rcv_msgs = nl->rcv_bytes = nl->rcv_overruns = 0;
+}
+
+void
+netlink_print_stats(FILE *fp, bool clear_stats)
+{
+	fprintf(fp, "Netlink:\n");
+	netlink_print_handle_stats(fp, "Monitor", &nl_kernel, clear_stats);
+	netlink_print_handle_stats(fp, "Command", &nl_cmd, clear_stats);
 }
 
 #ifdef _WITH_VRRP_
@@ -2657,5 +3000,6 @@ register_keepalived_netlink_addresses(void)
 {
 	register_thread_address("kernel_netlink", kernel_netlink);
 	register_thread_address("delayed_if_flags_change_thread", delayed_if_flags_change_thread);
+	register_thread_address("netlink_batch_ack_thread", netlink_batch_ack_thread);
 }
 #endif
@@ -525,7 +525,7 @@ stop_keepalived(void)
 
 /* Daemon init sequence */
 static void
-start_keepalived(__attribute__((unused)) thread_ref_t thread)
+start_keepalived(thread_ref_t thread)
 {
 	bool have_child = false;
 
@@ -538,6 +538,9 @@ start_keepalived(__attribute__((unused)) thread_ref_t thread)
 	 * termination of their immediate parent. */
 	prctl(PR_SET_CHILD_SUBREAPER, 1);
 
+	/* Orphaned descendants are now reparented to us, and must be reaped */
+	thread_set_child_handler(thread->master);
+
 #ifdef _WITH_BFD_
 	/* must be opened before vrrp and bfd start */
 	if (!open_bfd_pipes()) {
@@ -1105,6 +1108,43 @@ process_reload_signal(__attribute__((unused)) void *v, __attribute__((unused)) i
 
 #endif
 
+void
+thread_stats_signal(__attribute__((unused)) void *v, __attribute__((unused)) int sig)
+{
+	const char *file_name = "keepalived.tstats";
+	const char *stats_file;
+	FILE *fp;
+
+#ifndef _ONE_PROCESS_DEBUG_
+	if (prog_type == PROG_TYPE_PARENT)
+		propagate_signal(NULL, sig);
+#ifdef _WITH_VRRP_
+	else if (prog_type == PROG_TYPE_VRRP)
+		file_name = "keepalived_vrrp.tstats";
+#endif
+#ifdef _WITH_LVS_
+	else if (prog_type == PROG_TYPE_CHECKER)
+		file_name = "keepalived_check.tstats";
+#endif
+#ifdef _WITH_BFD_
+	else if (prog_type == PROG_TYPE_BFD)
+		file_name = "keepalived_bfd.tstats";
+#endif
+#endif
+
+	stats_file = make_tmp_filename(file_name);
+	fp = fopen_safe(stats_file, "w");
+	if (!fp)
+		log_message(LOG_INFO, "Can't open %s (%d: %m)", stats_file, errno);
+	else {
+		dump_thread_stats(fp);
+		dump_thread_watchdog(master, fp);
+		fclose(fp);
+	}
+
+	FREE_CONST(stats_file);
+}
+
 #ifdef THREAD_DUMP
 void
 thread_dump_signal(__attribute__((unused)) void *v, __attribute__((unused)) int sig)
@@ -1151,6 +1191,9 @@ sigend(__attribute__((unused)) void *v, __attribute__((unused)) int sig)
 	sigaddset(&sigmask, SIGCHLD);
 	signalfd(signal_fd, &sigmask, 0);
 
+	/* If children were being reaped via pidfds, SIGCHLD won't be blocked */
+	sigmask_func(SIG_BLOCK, &sigmask, NULL);
+
 	/* Signal our children to terminate */
 	for (i = 0; i < NUM_CHILD_TERM; i++) {
 		if (*children_term[i].pid_p > 0) {
@@ -1279,6 +1322,7 @@ signal_init(void)
 #ifdef _WITH_JSON_
 	signal_set(SIGJSON, propagate_signal, NULL);
 #endif
+	signal_set(SIGTSTATS, thread_stats_signal, NULL);
 	signal_set(SIGINT, sigend, NULL);
 	signal_set(SIGTERM, sigend, NULL);
 #ifdef THREAD_DUMP
@@ -1298,6 +1342,7 @@ signals_ignore(void) {
 #ifdef _WITH_JSON_
 	signal_ignore(SIGJSON);
 #endif
+	signal_ignore(SIGTSTATS);
 #endif
 }
 
@@ -1841,7 +1886,7 @@ usage(const char *prog)
 	fprintf(stderr, "  -i, --config-id id           Skip any configuration lines beginning '@' that don't match id\n"
 			"                                or any lines beginning @^ that do match.\n"
 			"                                The config-id defaults to the node name if option not used\n");
-	fprintf(stderr, "      --signum=SIGFUNC         Return signal number for STOP, RELOAD, DATA, STATS, STATS_CLEAR"
+	fprintf(stderr, "      --signum=SIGFUNC         Return signal number for STOP, RELOAD, DATA, STATS, STATS_CLEAR, TSTATS"
 #ifdef _WITH_JSON_
 								", JSON"
 #endif
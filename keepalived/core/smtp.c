@@ -666,6 +666,14 @@ smtp_alert(smtp_msg_t msg_type, void* data, const char *subject, const char *bod
 	smtp_connect(smtp);
 }
 
+/* Sending alerts can wait while protocol timers are about to expire */
+void
+smtp_add_deferrable(thread_master_t *m)
+{
+	thread_add_deferrable(m, connection_in_progress);
+	thread_add_deferrable(m, smtp_read_thread);
+}
+
 #ifdef THREAD_DUMP
 void
 register_smtp_addresses(void)
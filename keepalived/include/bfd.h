@@ -29,6 +29,7 @@
 #include "scheduler.h"
 #include "timer.h"
 #include "sockaddr.h"
+#include "str_map.h"
 
 /*
  *	RFC5881
@@ -130,6 +131,9 @@ typedef struct _bfd {
 	uint64_t		remote_detect_time;	/* Remote detection time */
 	timeval_t		last_seen;		/* Time of the last packet received */
 
+	/* Name hash member */
+	str_map_node_t		n_node;			/* bfd_data->bfd_names */
+
 	/* Linked list member */
 	list_head_t		e_list;
 } bfd_t;
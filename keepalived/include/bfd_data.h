@@ -31,6 +31,7 @@
 
 typedef struct _bfd_data {
 	list_head_t	bfd;		/* bfd_t - BFD instances */
+	str_map_t	bfd_names;	/* bfd_t by iname */
 	int		fd_in;		/* Input socket fd */
 	int		multihop_fd_in;	/* Input socket for multihop */
 	thread_ref_t	thread_in;	/* Input socket thread */
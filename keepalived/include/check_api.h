@@ -131,5 +131,9 @@ extern void install_checkers_keyword(void);
 extern void checker_set_dst_port(sockaddr_t *, uint16_t);
 extern void install_checker_common_keywords(bool);
 extern void update_checker_activity(sa_family_t, void *, bool);
+extern unsigned long checker_start_delay(const checker_t *);
+extern void apply_checker_result(checker_t *, bool, const char *);
+extern void checker_report_result(checker_t *, bool, const char *);
+extern void checker_terminate(const checker_t *);
 
 #endif
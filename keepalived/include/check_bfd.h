@@ -24,6 +24,7 @@
 #define _CHECK_BFD_H
 
 #include "scheduler.h"
+#include "str_map.h"
 
 /* external bfd we read to track forwarding to remote systems */
 typedef struct _checker_tracked_bfd {
@@ -31,6 +32,9 @@ typedef struct _checker_tracked_bfd {
 //	int			weight;		/* Default weight */
 	list_head_t		tracking_rs;	/* tracking_obj_t */
 
+	/* Name hash member */
+	str_map_node_t		n_node;		/* check_data->track_bfd_names */
+
 	/* Linked list member */
 	list_head_t		e_list;
 } checker_tracked_bfd_t;
@@ -38,6 +38,7 @@
 #include "logger.h"
 #include "ip_vs.h"
 #include "list_head.h"
+#include "str_map.h"
 #include "vector.h"
 #include "notify.h"
 #include "utils.h"
@@ -126,6 +127,9 @@ typedef struct _real_server {
 #ifdef _WITH_BFD_
 	list_head_t			tracked_bfds;	/* cref_tracked_bfd_t */
 #endif
+#ifdef _WITH_CHECKER_WORKERS_
+	thread_master_t			*check_master;	/* worker running the network checkers, if any */
+#endif
 
 	/* Linked list member */
 	list_head_t			e_list;
@@ -166,6 +170,9 @@ typedef struct _virtual_server_group {
 	unsigned			auto_fwmark[PROTO_INDEX_MAX];
 #endif
 
+	/* Name hash member */
+	str_map_node_t			n_node;		/* check_data->vs_group_names */
+
 	/* Linked list member */
 	list_head_t			e_list;
 } virtual_server_group_t;
@@ -238,10 +245,13 @@ typedef struct _check_data {
 	bool				ssl_required;
 	ssl_data_t			*ssl;
 	list_head_t			vs_group;	/* virtual_server_group_t */
+	str_map_t			vs_group_names;	/* virtual_server_group_t by gname */
 	list_head_t			vs;		/* virtual_server_t */
 	list_head_t			track_files;	/* tracked_file_t */
+	str_map_t			track_file_names; /* tracked_file_t by fname */
 #ifdef _WITH_BFD_
 	list_head_t			track_bfds;	/* checker_tracked_bfd_t */
+	str_map_t			track_bfd_names; /* checker_tracked_bfd_t by bname */
 #endif
 	unsigned			num_checker_fd_required;
 	unsigned			num_smtp_alert;
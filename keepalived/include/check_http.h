@@ -81,7 +81,6 @@ typedef struct _regex {
 	const unsigned char		*pattern;
 	int				pcre2_options;
 	pcre2_code			*pcre2_reCompiled;
-	pcre2_match_data		*pcre2_match_data;
 	uint32_t			pcre2_max_lookbehind;
 	unsigned			refcnt;
 #ifdef _WITH_REGEX_TIMERS_
@@ -105,6 +104,7 @@ typedef struct _url {
 #ifdef _WITH_REGEX_CHECK_
 	bool				regex_no_match;
 	regex_t				*regex;
+	pcre2_match_data		*pcre2_match_data;	/* per url, since checkers may run in different threads */
 	size_t				regex_min_offset;
 	size_t				regex_max_offset;	/* One beyond max offset */
 #ifndef PCRE2_DONT_USE_JIT
@@ -149,6 +149,7 @@ extern bool do_regex_timers;
 
 /* Define prototypes */
 extern void free_http_check(checker_t *);
+extern void free_http_check_thread_data(void);
 extern void install_http_check_keyword(void);
 extern void timeout_epilog(thread_ref_t, const char *);
 extern void dump_digest(unsigned char *, unsigned);
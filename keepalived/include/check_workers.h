@@ -0,0 +1,49 @@
+/*
+ * Soft:        Keepalived is a failover program for the LVS project
+ *              <www.linuxvirtualserver.org>. It monitor & manipulate
+ *              a loadbalanced server pool using multi-layer checks.
+ *
+ * Part:        check_workers.c include file.
+ *
+ * Author:      Alexandre Cassen, <acassen@linux-vs.org>
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *              See the GNU General Public License for more details.
+ *
+ *              This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU General Public License
+ *              as published by the Free Software Foundation; either version
+ *              2 of the License, or (at your option) any later version.
+ *
+ * Copyright (C) 2001-2017 Alexandre Cassen, <acassen@gmail.com>
+ */
+
+#ifndef _CHECK_WORKERS_H
+#define _CHECK_WORKERS_H
+
+#include "config.h"
+
+/* global includes */
+#include <stdbool.h>
+
+/* local includes */
+#include "scheduler.h"
+#include "check_api.h"
+
+#define CHECKER_WORKERS_MAX	256
+
+/* Prototypes */
+extern thread_master_t *checker_master(const checker_t *);
+extern void start_checker_workers(unsigned);
+extern void run_checker_workers(void);
+extern void stop_checker_workers(void);
+extern void launch_worker_checker(checker_t *);
+extern void post_checker_result(checker_t *, bool, const char *);
+extern void post_checker_terminate(void);
+#ifdef THREAD_DUMP
+extern void register_check_workers_addresses(void);
+#endif
+
+#endif
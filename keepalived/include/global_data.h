@@ -146,6 +146,8 @@ typedef struct _data {
 #endif
 	int				max_auto_priority;
 	long				min_auto_priority_delay;
+	unsigned			thread_cache_high_water;
+	bool				thread_stats;
 #ifdef _WITH_VRRP_
 	struct sockaddr_in6		vrrp_mcast_group6 __attribute__((aligned(__alignof__(sockaddr_t))));
 	struct sockaddr_in		vrrp_mcast_group4 __attribute__((aligned(__alignof__(sockaddr_t))));
@@ -157,6 +159,7 @@ typedef struct _data {
 	unsigned			vrrp_garp_lower_prio_rep;
 	unsigned			vrrp_garp_interval;
 	unsigned			vrrp_gna_interval;
+	unsigned			vrrp_garp_refresh_rate;
 	unsigned			vrrp_down_timer_adverts;
 #ifdef _HAVE_VRRP_VMAC_
 	unsigned			vrrp_vmac_garp_intvl;
@@ -191,6 +194,10 @@ typedef struct _data {
 	unsigned			vrrp_realtime_priority;
 	cpu_set_t			vrrp_cpu_mask;
 	rlim_t				vrrp_rlimit_rt;
+#ifdef _WITH_IO_URING_
+	bool				vrrp_io_uring;
+#endif
+	unsigned			vrrp_watchdog_budget;	/* usecs */
 #endif
 #ifdef _WITH_LVS_
 	bool				have_checker_config;
@@ -199,6 +206,13 @@ typedef struct _data {
 	unsigned			checker_realtime_priority;
 	cpu_set_t			checker_cpu_mask;
 	rlim_t				checker_rlimit_rt;
+#ifdef _WITH_IO_URING_
+	bool				checker_io_uring;
+#endif
+	unsigned long			checker_timer_slack;
+#ifdef _WITH_CHECKER_WORKERS_
+	unsigned			checker_worker_threads;
+#endif
 #ifdef _WITH_NFTABLES_
 	const char			*ipvs_nf_table_name;
 	int				ipvs_nf_chain_priority;
@@ -215,6 +229,9 @@ typedef struct _data {
 	unsigned			bfd_realtime_priority;
 	cpu_set_t			bfd_cpu_mask;
 	rlim_t				bfd_rlimit_rt;
+#ifdef _WITH_IO_URING_
+	bool				bfd_io_uring;
+#endif
 #endif
 	notify_fifo_t			notify_fifo;
 #ifdef _WITH_VRRP_
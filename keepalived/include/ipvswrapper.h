@@ -66,7 +66,7 @@ extern int ipvs_start(void);
 extern void ipvs_stop(void);
 extern void ipvs_set_timeouts(const ipvs_timeout_t *);
 extern void ipvs_flush_cmd(void);
-extern virtual_server_group_t *ipvs_get_group_by_name(const char *, list_head_t *) __attribute__ ((pure));
+extern virtual_server_group_t *ipvs_get_group_by_name(const char *, const str_map_t *) __attribute__ ((pure));
 extern void ipvs_group_sync_entry(virtual_server_t *vs, virtual_server_group_entry_t *vsge);
 extern void ipvs_group_remove_entry(virtual_server_t *, virtual_server_group_entry_t *);
 extern void unset_vsge_alive(virtual_server_group_entry_t *, const virtual_server_t *);
@@ -28,6 +28,7 @@
 /* global includes */
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <sys/types.h>
 #include <linux/netlink.h>
 #include <linux/rtnetlink.h>
@@ -45,6 +46,13 @@ typedef struct _nl_handle {
 	uint32_t		nl_pid;
 	__u32			seq;
 	thread_ref_t		thread;
+	char			*rcv_buf;
+	size_t			rcv_buf_size;
+
+	/* Statistics */
+	uint64_t		rcv_msgs;
+	uint64_t		rcv_bytes;
+	uint64_t		rcv_overruns;
 } nl_handle_t;
 
 /* Define types */
@@ -128,6 +136,11 @@ rta_addattr64(struct rtattr *rta, size_t maxlen, unsigned short type, uint64_t d
 extern struct rtattr *rta_nest(struct rtattr *, size_t, unsigned short);
 extern size_t rta_nest_end(struct rtattr *, struct rtattr *);
 extern ssize_t netlink_talk(nl_handle_t *, struct nlmsghdr *);
+extern void netlink_batch_add(struct nlmsghdr *, int, void (*)(void *, int), void *);
+extern void netlink_batch_open(void);
+extern void netlink_batch_close(void);
+extern void netlink_batch_close_async(void);
+extern void netlink_batch_wait(void);
 extern int netlink_interface_lookup(char *);
 extern void kernel_netlink_poll(void);
 extern void process_if_status_change(interface_t *);
@@ -144,6 +157,7 @@ extern void kernel_netlink_read_interfaces(void);
 extern void kernel_netlink_close(void);
 extern void kernel_netlink_close_monitor(void);
 extern void kernel_netlink_close_cmd(void);
+extern void netlink_print_stats(FILE *, bool);
 #ifdef THREAD_DUMP
 extern void register_keepalived_netlink_addresses(void);
 #endif
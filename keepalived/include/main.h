@@ -94,6 +94,7 @@ extern bool running_checker(void) __attribute__ ((pure));
 extern void reinitialise_global_vars(void);
 extern void start_reload(thread_ref_t);
 
+extern void thread_stats_signal(void *, int);
 #ifdef THREAD_DUMP
 extern void thread_dump_signal(void *, int);
 #endif
@@ -126,6 +126,7 @@ extern bool do_smtp_connect_debug;
 
 /* Prototypes defs */
 extern void smtp_alert(smtp_msg_t, void *data, const char *, const char *);
+extern void smtp_add_deferrable(thread_master_t *);
 #ifdef THREAD_DUMP
 extern void register_smtp_addresses(void);
 #endif
@@ -30,6 +30,7 @@
 
 /* local includes */
 #include "list_head.h"
+#include "str_map.h"
 #ifdef _WITH_VRRP_
 #include "vrrp.h"
 #endif
@@ -49,6 +50,9 @@ typedef struct _tracked_file {
 	int64_t			last_status;	/* Last status returned by file. Used to report changes */
 	bool			reloaded;	/* Set if this track_file existing in previous config */
 
+	/* Name hash member */
+	str_map_node_t		n_node;		/* vrrp_track_file_names or track_file_names */
+
 	/* linked list member */
 	list_head_t		e_list;
 } tracked_file_t;
@@ -77,8 +81,8 @@ extern void dump_track_file_monitor_list(FILE *, const list_head_t *);
 extern void free_track_file_monitor(tracked_file_monitor_t *);
 extern void free_track_file_monitor_list(list_head_t *);
 
-extern tracked_file_t * __attribute__ ((pure)) find_tracked_file_by_name(const char *, list_head_t *);
-extern void vrrp_alloc_track_file(const char *, list_head_t *, list_head_t *, const vector_t *);
+extern tracked_file_t * __attribute__ ((pure)) find_tracked_file_by_name(const char *, const str_map_t *);
+extern void vrrp_alloc_track_file(const char *, const str_map_t *, list_head_t *, const vector_t *);
 extern void add_track_file_keywords(bool active);
 
 extern void free_tracking_obj_list(list_head_t *);
@@ -91,7 +95,7 @@ extern void add_obj_to_track_file(void *, tracked_file_monitor_t *, const char *
 
 extern void process_update_checker_track_file_status(const tracked_file_t *, int, const tracking_obj_t *);
 
-extern void init_track_files(list_head_t *);
+extern void init_track_files(list_head_t *, str_map_t *);
 extern void stop_track_files(void);
 
 #ifdef THREAD_DUMP
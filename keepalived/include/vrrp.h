@@ -47,6 +47,7 @@
 #include "vrrp_sock.h"
 #include "vrrp_track.h"
 #include "sockaddr.h"
+#include "str_map.h"
 
 struct _ip_address;
 
@@ -169,6 +170,9 @@ typedef struct _vrrp_sgroup {
 	int			last_email_state;
 	int			notify_priority_changes;
 
+	/* Name hash member */
+	str_map_node_t		n_node;			/* vrrp_data->vrrp_sync_group_names */
+
 	/* linked list member */
 	list_head_t		e_list;
 } vrrp_sgroup_t;
@@ -234,6 +238,7 @@ typedef struct {
 
 typedef struct _unicast_peer_t {
 	sockaddr_t		address;
+	char			*send_buffer;		/* IPv4 advert with this peer's daddr */
 #ifdef _CHECKSUM_DEBUG_
 	checksum_check_t	chk;
 #endif
@@ -317,6 +322,8 @@ typedef struct _vrrp_t {
 							   effective_priority is this within the range [1,254]. */
 	uint8_t			highest_other_priority;	/* Used for timer_expired_backup */
 	bool			vipset;			/* All the vips are set ? */
+	bool			vips_preset;		/* vips set by sync group before becoming master */
+	bool			master_adv_sent;	/* first master advert sent by sync group */
 	list_head_t		vip;			/* ip_address_t - list of virtual ip addresses */
 	unsigned		vip_cnt;		/* size of vip list */
 	list_head_t		evip;			/* ip_address_t - list of protocol excluded VIPs.
@@ -406,10 +413,27 @@ typedef struct _vrrp_t {
 	/* Sync group list member */
 	list_head_t		s_list;			/* vrrp_sgroup_t->vrrp_instances */
 
+	/* Name hash member */
+	str_map_node_t		n_node;			/* vrrp_data->vrrp_names */
+
+	/* Reload matching */
+	hlist_node_t		i_list;			/* vrrp_data->vrrp_index */
+	uint64_t		fingerprint;		/* of the addresses, routes and rules
+							 * configured, so that an unchanged
+							 * instance can be left alone on reload */
+	bool			reload_unchanged;	/* set if left alone on reload */
+
 	/* Linked list member */
 	list_head_t		e_list;
 } vrrp_t;
 
+/* Index of the vrrp instances on the (vrid, family, interface) that
+ * identifies an instance across a reload */
+typedef struct _vrrp_index {
+	hlist_head_t		*hash;
+	unsigned		hash_mask;		/* number of chains - 1 */
+} vrrp_index_t;
+
 /* VRRP state machine -- rfc2338.6.4 */
 #define VRRP_STATE_INIT			0	/* rfc2338.6.4.1 */
 #define VRRP_STATE_BACK			1	/* rfc2338.6.4.2 */
@@ -472,12 +496,18 @@ extern size_t vrrp_adv_len(const vrrp_t *) __attribute__ ((pure));
 extern const vrrphdr_t *vrrp_get_header(sa_family_t, const char *, size_t);
 extern void open_sockpool_socket(sock_t *);
 extern int new_vrrp_socket(vrrp_t *);
+extern void vrrp_tx_batch_open(void);
+extern void vrrp_tx_batch_close(void);
+extern void vrrp_tx_batch_flush(void);
+extern void free_vrrp_tx_batch(void);
 extern void vrrp_send_adv(vrrp_t *, uint8_t);
 extern void vrrp_send_link_update(vrrp_t *, unsigned);
 extern void add_vrrp_to_interface(vrrp_t *, interface_t *, int, bool, bool, track_t);
 extern void del_vrrp_from_interface(vrrp_t *, interface_t *);
 extern bool vrrp_state_master_rx(vrrp_t *, const vrrphdr_t *, const char *, ssize_t);
 extern void vrrp_state_master_tx(vrrp_t *);
+extern void vrrp_set_vips(vrrp_t *);
+extern void vrrp_send_sync_master_adv(vrrp_t *);
 extern void vrrp_state_backup(vrrp_t *, const vrrphdr_t *, const char *, ssize_t);
 extern void vrrp_state_goto_master(vrrp_t *);
 extern void vrrp_state_leave_master(vrrp_t *, bool);
@@ -486,7 +516,8 @@ extern bool vrrp_complete_init(void);
 extern void vrrp_restore_interfaces_startup(void);
 extern void restore_vrrp_interfaces(void);
 extern void shutdown_vrrp_instances(void);
-extern void clear_diff_vrrp(void);
+extern void vrrp_index_free(vrrp_index_t *);
+extern void clear_diff_vrrp(bool);
 extern void clear_diff_script(void);
 extern void set_previous_sync_group_states(void);
 #ifdef _WITH_BFD_
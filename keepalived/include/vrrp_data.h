@@ -31,7 +31,11 @@
 /* local includes */
 #include "list_head.h"
 #include "vector.h"
+#include "str_map.h"
 #include "vrrp_static_track.h"
+#include "vrrp_ipaddress.h"
+#include "vrrp_iproute.h"
+#include "vrrp_iprule.h"
 
 
 /* Configuration data root */
@@ -41,22 +45,36 @@ typedef struct _vrrp_data {
 	list_head_t		static_routes;		/* ip_route_t */
 	list_head_t		static_rules;		/* ip_rule_t */
 	list_head_t		vrrp_sync_group;	/* vrrp_sgroup_t */
+	str_map_t		vrrp_sync_group_names;	/* vrrp_sgroup_t by gname */
 	list_head_t		vrrp;			/* vrrp_t */
+	str_map_t		vrrp_names;		/* vrrp_t by iname */
+	vrrp_index_t		vrrp_index;		/* vrrp_t by vrid, family and interface */
+	vip_index_t		vip_index;		/* VIPs and eVIPs of vrrp */
+	route_index_t		route_index;		/* vroutes of vrrp and static_routes */
+	rule_index_t		rule_index;		/* vrules of vrrp and static_rules */
 	list_head_t		vrrp_socket_pool;	/* sock_t */
 	list_head_t		vrrp_script;		/* vrrp_script_t */
+	str_map_t		vrrp_script_names;	/* vrrp_script_t by sname */
 	list_head_t		vrrp_track_files;	/* tracked_file_t */
+	str_map_t		vrrp_track_file_names;	/* tracked_file_t by fname */
 #ifdef _WITH_TRACK_PROCESS_
 	list_head_t		vrrp_track_processes;	/* vrrp_tracked_process_t */
+	str_map_t		vrrp_track_process_names; /* vrrp_tracked_process_t by pname */
 	size_t			vrrp_max_process_name_len;
 	bool			vrrp_use_process_cmdline;
 	bool			vrrp_use_process_comm;
 #endif
 #ifdef _WITH_BFD_
 	list_head_t		vrrp_track_bfds;	/* vrrp_tracked_bfd_t */
+	str_map_t		vrrp_track_bfd_names;	/* vrrp_tracked_bfd_t by bname */
 #endif
 	unsigned		num_smtp_alert;		/* No of smtp_alerts configured */
 } vrrp_data_t;
 
+/* Number of adverts received by one recvmmsg() call. vrrp_buffer holds
+ * VRRP_RX_BATCH buffers of vrrp_buffer_len bytes. */
+#define VRRP_RX_BATCH	32
+
 /* Global Vars exported */
 extern vrrp_data_t *vrrp_data;
 extern vrrp_data_t *old_vrrp_data;
@@ -36,6 +36,7 @@ void dbus_remove_object(const vrrp_t *);
 void dbus_reload(const list_head_t *, const list_head_t *);
 bool dbus_start(void);
 void dbus_stop(void);
+extern void vrrp_dbus_add_deferrable(thread_master_t *);
 #ifdef THREAD_DUMP
 extern void register_vrrp_dbus_addresses(void);
 #endif
@@ -0,0 +1,64 @@
+/*
+ * Soft:        Keepalived is a failover program for the LVS project
+ *              <www.linuxvirtualserver.org>. It monitor & manipulate
+ *              a loadbalanced server pool using multi-layer checks.
+ *
+ * Part:        vrrp_garp_tx.c include file.
+ *
+ * Author:      Alexandre Cassen, <acassen@linux-vs.org>
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *              See the GNU General Public License for more details.
+ *
+ *              This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU General Public License
+ *              as published by the Free Software Foundation; either version
+ *              2 of the License, or (at your option) any later version.
+ *
+ * Copyright (C) 2001-2017 Alexandre Cassen, <acassen@gmail.com>
+ */
+
+#ifndef _VRRP_GARP_TX_H
+#define _VRRP_GARP_TX_H
+
+/* system includes */
+#include <stdbool.h>
+#include <stdio.h>
+#include <sys/types.h>
+#include <net/if.h>
+#include <netinet/in.h>
+
+/* local includes */
+#include "vrrp_if.h"
+#include "vrrp_arp.h"
+
+/* The largest frame we send is an unsolicited NA on Infiniband */
+#define GARP_FRAME_MAX		128
+
+/* A gratuitous ARP or unsolicited NA frame for an address. It is kept with
+ * the address so that repeated sends don't have to rebuild it, and is
+ * rebuilt if anything it was built from changes. */
+typedef struct _garp_frame {
+	interface_t		*ifp;		/* base interface */
+	ifindex_t		ifindex;	/* interface sent on */
+	u_char			hw_addr[MAX_ADDR_LEN];	/* source hardware address */
+	bool			router;		/* NA router flag */
+	struct sockaddr_large_ll sll;		/* destination */
+	char			addr_str[INET6_ADDRSTRLEN];	/* for logging */
+	size_t			len;
+	char			data[GARP_FRAME_MAX];
+} garp_frame_t;
+
+typedef struct _garp_tx garp_tx_t;
+
+/* Prototypes */
+extern garp_tx_t *garp_tx_open(int, const char *);
+extern void garp_tx_close(garp_tx_t *);
+extern ssize_t garp_tx_queue(garp_tx_t *, const garp_frame_t *);
+extern void garp_tx_batch_open(void);
+extern void garp_tx_batch_close(void);
+extern void garp_tx_print_stats(FILE *, bool);
+
+#endif
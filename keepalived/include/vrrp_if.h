@@ -70,6 +70,9 @@
  * RFC2553 defines sin6_scopeid to be a uint32_t, and it can hold an ifindex */
 typedef uint32_t ifindex_t;
 
+/* The refresh token bucket holds 1/GARP_REFRESH_BURST of a second's messages */
+#define GARP_REFRESH_BURST	50
+
 /* Structure for delayed sending of gratuitous ARP/NA messages */
 typedef struct _garp_delay {
 	timeval_t		garp_interval;		/* Delay between sending gratuitous ARP messages on an interface */
@@ -80,6 +83,16 @@ typedef struct _garp_delay {
 	timeval_t		gna_next_time;		/* Time when next gratuitous NA message can be sent */
 	int			aggregation_group;	/* Index of multi-interface group */
 
+	/* Refresh gratuitous ARP/NA messages are paced by a token bucket, so that
+	 * they are spread over the refresh interval rather than being sent in a
+	 * burst. All gratuitous ARP/NA messages take tokens, so messages sent on
+	 * a transition delay refresh messages. */
+	unsigned		refresh_rate;		/* Configured maximum refresh messages per second, 0 for no limit */
+	unsigned		refresh_pps;		/* Rate refresh messages are sent at */
+	int64_t			refresh_tokens;		/* Tokens available, TIMER_HZ per message */
+	timeval_t		refresh_tokens_time;	/* When refresh_tokens was last updated */
+	list_head_t		refresh_queue;		/* ip_address_t waiting for a refresh message */
+
 	/* linked list member */
 	list_head_t		e_list;
 } garp_delay_t;
@@ -182,6 +195,11 @@ typedef struct _interface {
 	uint32_t		reset_promote_secondaries; /* Count of how many vrrps have changed promote_secondaries on interface */
 	list_head_t		tracking_vrrp;		/* tracking_obj_t - vrrp instances tracking this interface */
 
+	/* hash chain members, see if_rehash() */
+	hlist_node_t		ifindex_hnode;
+	hlist_node_t		ifname_hnode;
+	hlist_node_t		hw_addr_hnode;
+
 	/* linked list member */
 	list_head_t		e_list;
 } interface_t;
@@ -239,6 +257,8 @@ extern interface_t * if_get_by_vmac(uint8_t, int, const interface_t *, const u_c
 #endif
 extern interface_t *get_default_if(void);
 extern interface_t *if_get_by_ifname(const char *, if_lookup_t);
+extern void if_unhash(interface_t *);
+extern void if_rehash(interface_t *);
 extern sin_addr_t *if_extra_ipaddress_alloc(interface_t *, void *, unsigned char);
 extern void if_extra_ipaddress_free(sin_addr_t *);
 extern void if_extra_ipaddress_free_list(list_head_t *);
@@ -246,6 +266,8 @@ extern void dump_garp_delay_list(FILE *, list_head_t *);
 extern void free_garp_delay(garp_delay_t *);
 extern garp_delay_t *alloc_garp_delay(void);
 extern void set_default_garp_delay(void);
+extern void garp_refresh_fill(garp_delay_t *);
+extern void garp_refresh_charge(garp_delay_t *);
 extern void init_interface_queue(void);
 #ifdef _WITH_LINKBEAT_
 extern void init_interface_linkbeat(void);
@@ -267,6 +289,7 @@ extern int if_setsockopt_mcast_if(sa_family_t, int *, const interface_t *);
 extern int if_setsockopt_priority(int *, int);
 extern int if_setsockopt_rcvbuf(int *, int);
 extern int if_setsockopt_no_receive(int *);
+extern int if_setsockopt_vrid_filter(int, sa_family_t, const uint8_t *, unsigned);
 extern void interface_up(interface_t *);
 extern void interface_down(interface_t *);
 extern void cleanup_lost_interface(interface_t *);
@@ -78,12 +78,37 @@ typedef struct _ip_address {
 	bool			nftable_rule_set;	/* TRUE if in nftables set */
 #endif
 	bool			garp_gna_pending;	/* Is a gratuitous ARP/NA message still to be sent */
+	struct _garp_frame	*garp_frame;		/* Prebuilt gratuitous ARP/NA */
+	unsigned		garp_refresh_rep;	/* Refresh gratuitous ARP/NA messages still to be sent */
+	list_head_t		refresh_list;		/* garp_delay refresh_queue member */
 	uint32_t		preferred_lft;		/* IPv6 preferred_lft (0 means address deprecated) */
 
 	/* linked list member */
 	list_head_t		e_list;
 } ip_address_t;
 
+/* An index of the VIPs and eVIPs of all the vrrp instances, so that the
+ * owner of an address can be found without walking every instance's lists.
+ * Entries are hashed on the address family and address, and the interface
+ * is matched against ip_addr->ifp, so entries with the same address on
+ * different interfaces share a chain. */
+typedef struct _vip_index_entry {
+	vrrp_t			*vrrp;
+	ip_address_t		*ip_addr;
+	bool			evip;
+	unsigned		seen;		/* generation of last advert check */
+
+	/* hash chain member */
+	hlist_node_t		h_list;
+} vip_index_entry_t;
+
+typedef struct _vip_index {
+	hlist_head_t		*hash;
+	unsigned		hash_mask;	/* number of chains - 1 */
+	unsigned		count;
+	unsigned		seen;		/* advert check generation */
+} vip_index_t;
+
 #define IPADDRESS_DEL 0
 #define IPADDRESS_ADD 1
 #define DFLT_INT	"eth0"
@@ -112,9 +137,19 @@ extern void dump_ipaddress_list(FILE *, const list_head_t *);
 extern ip_address_t *parse_ipaddress(ip_address_t *, const char *, bool);
 extern ip_address_t *parse_route(const char *);
 extern ip_address_t *alloc_ipaddress(const vector_t *, bool);
-extern void get_diff_address(vrrp_t *, vrrp_t *, list_head_t *);
+extern void get_diff_address(vrrp_t *, vrrp_t *, const vip_index_t *, list_head_t *);
 extern void clear_address_list(list_head_t *, bool);
-extern void clear_diff_static_addresses(void);
+extern bool clear_diff_static_addresses(void);
 extern void reinstate_static_address(ip_address_t *);
+extern bool ipaddress_list_same(list_head_t *, list_head_t *, bool) __attribute__((pure));
+extern void ipaddress_list_copy_state(list_head_t *, list_head_t *);
+extern void vip_index_build(vip_index_t *, list_head_t *);
+extern void vip_index_free(vip_index_t *);
+extern vip_index_entry_t *vip_index_first(const vip_index_t *, int, const void *) __attribute__((pure));
+extern vip_index_entry_t *vip_index_next(const vip_index_entry_t *) __attribute__((pure));
+
+/* Iterate over the entries of the index for an address, on any interface */
+#define vip_index_for_each_entry(entry, index, family, addr)		\
+	for (entry = vip_index_first(index, family, addr); entry; entry = vip_index_next(entry))
 
 #endif
@@ -249,6 +249,23 @@ typedef struct _ip_route {
 	list_head_t		e_list;
 } ip_route_t;
 
+/* Index of the virtual and static routes, so that the routes reported by
+ * netlink can be matched without walking the routes of every instance.
+ * Entries are hashed on the table, destination prefix length and
+ * destination address. */
+typedef struct _route_index_entry {
+	vrrp_t			*vrrp;		/* NULL for a static route */
+	ip_route_t		*route;
+
+	/* hash chain member */
+	hlist_node_t		h_list;
+} route_index_entry_t;
+
+typedef struct _route_index {
+	hlist_head_t		*hash;
+	unsigned		hash_mask;	/* number of chains - 1 */
+} route_index_t;
+
 #define IPROUTE_DEL	0
 #define IPROUTE_ADD	1
 #define IPROUTE_REPLACE	2
@@ -262,8 +279,19 @@ extern void format_iproute(const ip_route_t *, char *, size_t);
 extern void dump_iproute(FILE *, const ip_route_t *);
 extern void dump_iproute_list(FILE *, const list_head_t *);
 extern void alloc_route(list_head_t *, const vector_t *, bool);
-extern void clear_diff_routes(list_head_t *, list_head_t *);
+extern void clear_diff_routes(list_head_t *, list_head_t *, const route_index_t *, const vrrp_t *);
 extern void clear_diff_static_routes(void);
 extern void reinstate_static_route(ip_route_t *);
+extern bool iproute_list_same(list_head_t *, list_head_t *, bool) __attribute__((pure));
+extern void iproute_list_copy_state(list_head_t *, list_head_t *);
+extern void route_index_build(route_index_t *, list_head_t *, list_head_t *);
+extern void route_index_free(route_index_t *);
+extern route_index_entry_t *route_index_first(const route_index_t *, int, uint32_t, uint8_t, const void *) __attribute__((pure));
+extern route_index_entry_t *route_index_next(const route_index_entry_t *) __attribute__((pure));
+
+/* Iterate over the entries which may match a route. Any entry returned still
+ * has to be compared against the rest of the route. */
+#define route_index_for_each_entry(entry, index, family, table, dst_len, dst)	\
+	for (entry = route_index_first(index, family, table, dst_len, dst); entry; entry = route_index_next(entry))
 
 #endif
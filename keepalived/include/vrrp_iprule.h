@@ -113,6 +113,21 @@ typedef struct _ip_rule {
 	list_head_t			e_list;
 } ip_rule_t;
 
+/* Index of the virtual and static rules, hashed on the rule priority,
+ * which all our rules have */
+typedef struct _rule_index_entry {
+	vrrp_t				*vrrp;		/* NULL for a static rule */
+	ip_rule_t			*rule;
+
+	/* hash chain member */
+	hlist_node_t			h_list;
+} rule_index_entry_t;
+
+typedef struct _rule_index {
+	hlist_head_t			*hash;
+	unsigned			hash_mask;	/* number of chains - 1 */
+} rule_index_t;
+
 #define IPRULE_DEL 0
 #define IPRULE_ADD 1
 
@@ -125,8 +140,17 @@ extern void format_iprule(const ip_rule_t *, char *, size_t);
 extern void dump_iprule(FILE *, const ip_rule_t *);
 extern void dump_iprule_list(FILE *, const list_head_t *);
 extern void alloc_rule(list_head_t *, const vector_t *, bool);
-extern void clear_diff_rules(list_head_t *, list_head_t *);
+extern void clear_diff_rules(list_head_t *, list_head_t *, const rule_index_t *, const vrrp_t *);
+extern bool iprule_list_same(list_head_t *, list_head_t *, bool) __attribute__((pure));
+extern void iprule_list_copy_state(list_head_t *, list_head_t *);
 extern void clear_diff_static_rules(void);
 extern void reset_next_rule_priority(void);
+extern void rule_index_build(rule_index_t *, list_head_t *, list_head_t *);
+extern void rule_index_free(rule_index_t *);
+extern rule_index_entry_t *rule_index_first(const rule_index_t *, int, uint32_t) __attribute__((pure));
+extern rule_index_entry_t *rule_index_next(const rule_index_entry_t *) __attribute__((pure));
+
+#define rule_index_for_each_entry(entry, index, family, priority)	\
+	for (entry = rule_index_first(index, family, priority); entry; entry = rule_index_next(entry))
 
 #endif
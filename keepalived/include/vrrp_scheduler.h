@@ -38,6 +38,7 @@
 /* global vars */
 extern timeval_t garp_next_time;
 extern thread_ref_t garp_thread;
+extern thread_ref_t garp_refresh_thread;
 extern bool vrrp_initialised;
 extern timeval_t vrrp_delayed_start_time;
 
@@ -61,6 +62,7 @@ extern bool do_recvmsg_debug_dump;
 extern void vrrp_init_instance_sands(vrrp_t *);
 extern void vrrp_thread_requeue_read(vrrp_t *);
 extern void vrrp_thread_add_read(vrrp_t *);
+extern bool vrrp_next_deadline(timeval_t *);
 extern void vrrp_dispatcher_init(thread_ref_t);
 #ifdef _WITH_BFD_
 extern void cancel_vrrp_threads(void);
@@ -69,6 +71,8 @@ extern void vrrp_dispatcher_release(vrrp_data_t *);
 extern void vrrp_gratuitous_arp_thread(thread_ref_t);
 extern void vrrp_lower_prio_gratuitous_arp_thread(thread_ref_t);
 extern void vrrp_arp_thread(thread_ref_t);
+extern void vrrp_garp_refresh_queue(ip_address_t *, unsigned);
+extern void vrrp_garp_refresh_dequeue(ip_address_t *);
 extern void try_up_instance(vrrp_t *, bool);
 #ifdef _WITH_DUMP_THREADS_
 extern void dump_threads(void);
@@ -41,6 +41,7 @@
 #include "rbtree_ka.h"
 #endif
 #include "tracker.h"
+#include "str_map.h"
 
 /* VRRP script tracking defaults */
 #define VRRP_SCRIPT_DI 1	/* external script track interval (in sec) */
@@ -77,6 +78,9 @@ typedef struct _vrrp_script {
 	script_init_state_t	init_state;	/* current initialisation state of script */
 	bool			insecure;	/* Set if script is run by root, but is non-root modifiable */
 
+	/* Name hash member */
+	str_map_node_t		n_node;		/* vrrp_data->vrrp_script_names */
+
 	/* linked list member */
 	list_head_t		e_list;
 } vrrp_script_t;
@@ -120,6 +124,9 @@ typedef struct _vrrp_tracked_process {
 	bool			have_quorum;	/* Set if quorum is treated as achieved */
 	unsigned		sav_num_cur_proc; /* Used if have ENOBUFS on netlink socket read */
 
+	/* Name hash member */
+	str_map_node_t		n_node;		/* vrrp_data->vrrp_track_process_names */
+
 	/* linked list member */
 	list_head_t		e_list;
 } vrrp_tracked_process_t;
@@ -161,6 +168,9 @@ typedef struct _vrrp_tracked_bfd {
 	list_head_t		tracking_vrrp;	/* tracking_obj_t - for vrrp instances tracking this bfd */
 	bool			bfd_up;		/* Last status returned by bfd. Used to report changes */
 
+	/* Name hash member */
+	str_map_node_t		n_node;		/* vrrp_data->vrrp_track_bfd_names */
+
 	/* linked list member */
 	list_head_t		e_list;
 } vrrp_tracked_bfd_t;
@@ -196,7 +206,7 @@ extern void alloc_track_process(const char *, list_head_t *, const vector_t *);
 #endif
 #ifdef _WITH_BFD_
 extern vrrp_tracked_bfd_t *find_vrrp_tracked_bfd_by_name(const char *) __attribute__ ((pure));
-extern vrrp_tracked_bfd_t *alloc_vrrp_tracked_bfd(const char *, list_head_t *);
+extern vrrp_tracked_bfd_t *alloc_vrrp_tracked_bfd(const char *);
 extern void dump_tracked_bfd_list(FILE *, const list_head_t *);
 extern void free_track_bfd(tracked_bfd_t *);
 extern void free_track_bfd_list(list_head_t *);
@@ -169,20 +169,14 @@ free_track_file_monitor_list(list_head_t *l)
 }
 
 tracked_file_t * __attribute__ ((pure))
-find_tracked_file_by_name(const char *name, list_head_t *l)
+find_tracked_file_by_name(const char *name, const str_map_t *tracked_files)
 {
-	tracked_file_t *file;
-
-	list_for_each_entry(file, l, e_list) {
-		if (!strcmp(file->fname, name))
-			return file;
-	}
-	return NULL;
+	return str_map_find_entry(tracked_files, name, tracked_file_t, n_node);
 }
 
 // Some of the following code is VRRP specific, and so should be in vrrp_track_file.c
 void
-vrrp_alloc_track_file(const char *name, list_head_t *tracked_files, list_head_t *track_file, const vector_t *strvec)
+vrrp_alloc_track_file(const char *name, const str_map_t *tracked_files, list_head_t *track_file, const vector_t *strvec)
 {
 	tracked_file_t *vsf;
 	tracked_file_monitor_t *tfile;
@@ -497,12 +491,20 @@ track_file_end_handler(void)
 	}
 
 #ifdef _WITH_VRRP_
-	if (vrrp_data)
+	if (vrrp_data) {
 		list_add_tail(&track_file->e_list, &vrrp_data->vrrp_track_files);
+		str_map_add(&vrrp_data->vrrp_track_file_names, &track_file->n_node, track_file->fname);
+	}
 #endif
 
 #ifdef _WITH_LVS_
-	if (check_data) {
+	/* When testing the configuration the checker data is still allocated
+	 * while the vrrp configuration is read */
+	if (check_data
+#ifndef _ONE_PROCESS_DEBUG_
+	    && prog_type == PROG_TYPE_CHECKER
+#endif
+	    ) {
 #if defined _ONE_PROCESS_DEBUG_ && defined _WITH_VRRP_
 		/* If we want it for both VRRP and LVS we must duplicate the data */
 		if (vrrp_data) {
@@ -514,6 +516,7 @@ track_file_end_handler(void)
 		}
 #endif
 		list_add_tail(&track_file->e_list, &check_data->track_files);
+		str_map_add(&check_data->track_file_names, &track_file->n_node, track_file->fname);
 	}
 #endif
 
@@ -636,7 +639,7 @@ add_obj_to_track_file(void *obj, tracked_file_monitor_t *tfl, const char *name,
 }
 
 static void
-remove_track_file(tracked_file_t *file)
+remove_track_file(tracked_file_t *file, str_map_t *track_file_names)
 {
 	tracked_file_monitor_t *tft, *tft_tmp;
 	list_head_t *track_file_list;
@@ -665,6 +668,7 @@ remove_track_file(tracked_file_t *file)
 		}
 	}
 
+	str_map_del(track_file_names, &file->n_node);
 	free_track_file(file);
 }
 
@@ -900,7 +904,7 @@ process_inotify(thread_ref_t thread)
 }
 
 void
-init_track_files(list_head_t *track_files)
+init_track_files(list_head_t *track_files, str_map_t *track_file_names)
 {
 	tracked_file_t *tfile, *tfile_tmp;
 	char *resolved_path;
@@ -921,7 +925,7 @@ init_track_files(list_head_t *track_files)
 	list_for_each_entry_safe(tfile, tfile_tmp, track_files, e_list) {
 		if (list_empty(&tfile->tracking_obj)) {
 			/* Nothing is tracking this file, so forget it */
-			remove_track_file(tfile);
+			remove_track_file(tfile, track_file_names);
 			continue;
 		}
 
@@ -956,7 +960,7 @@ init_track_files(list_head_t *track_files)
 				report_config_error(CONFIG_GENERAL_ERROR, "Track file directory for %s "
 									  "does not exist - removing"
 									, tfile->fname);
-				remove_track_file(tfile);
+				remove_track_file(tfile, track_file_names);
 				continue;
 			}
 
@@ -975,7 +979,7 @@ init_track_files(list_head_t *track_files)
 		else {
 			report_config_error(CONFIG_GENERAL_ERROR, "track file %s is not accessible"
 								  " - ignoring", tfile->fname);
-			remove_track_file(tfile);
+			remove_track_file(tfile, track_file_names);
 			continue;
 		}
 
@@ -50,6 +50,7 @@
 
 #include "vrrp_arp.h"
 #include "vrrp_ndisc.h"
+#include "vrrp_garp_tx.h"
 #include "vrrp_scheduler.h"
 #include "vrrp_notify.h"
 #include "vrrp.h"
@@ -268,6 +269,7 @@ check_vrrp_script_security(void)
 	/* Now walk through the vrrp_script list, removing any that aren't used */
 	list_for_each_entry_safe(vscript, vscript_tmp, &vrrp_data->vrrp_script, e_list) {
 		if (vscript->insecure) {
+			str_map_del(&vrrp_data->vrrp_script_names, &vscript->n_node);
 			free_vscript(vscript);
 		}
 	}
@@ -370,6 +372,23 @@ expected_vrrp_pkt_len(const vrrphdr_t *vh, int family)
 	return len;
 }
 
+/* Set the destination address of an IPv4 advert, updating the checksum
+ * if the VRRPv3 pseudo header includes it */
+static void
+vrrp_set_pkt_daddr(const vrrp_t *vrrp, struct iphdr *ip, vrrphdr_t *hd, uint32_t new_daddr)
+{
+	if (ip->daddr == new_daddr)
+		return;
+
+	if (vrrp->version == VRRP_VERSION_3
+#ifdef _WITH_UNICAST_CHKSUM_COMPAT_
+	    && vrrp->unicast_chksum_compat < CHKSUM_COMPATIBILITY_MIN_COMPAT
+#endif
+								    )
+		hd->chksum = csum_incremental_update32(hd->chksum, ip->daddr, new_daddr);
+	ip->daddr = new_daddr;
+}
+
 static void
 vrrp_update_pkt(vrrp_t *vrrp, uint8_t prio, sockaddr_t *addr)
 {
@@ -380,7 +399,6 @@ vrrp_update_pkt(vrrp_t *vrrp, uint8_t prio, sockaddr_t *addr)
 	unicast_peer_t *peer = NULL;
 #endif
 	uint32_t new_saddr = 0;
-	uint32_t new_daddr;
 
 #ifdef _WITH_VRRP_AUTH_
 	/* We will need to be called again if there is more than one unicast peer, so don't calculate checksums */
@@ -422,19 +440,7 @@ vrrp_update_pkt(vrrp_t *vrrp, uint8_t prio, sockaddr_t *addr)
 		}
 		else {
 			/* If unicast address */
-			if (vrrp->version == VRRP_VERSION_2)
-				ip->daddr = inet_sockaddrip4(addr);
-			else {
-				new_daddr = inet_sockaddrip4(addr);
-
-				if (ip->daddr != new_daddr) {
-#ifdef _WITH_UNICAST_CHKSUM_COMPAT_
-					if (vrrp->unicast_chksum_compat < CHKSUM_COMPATIBILITY_MIN_COMPAT)
-#endif
-						hd->chksum = csum_incremental_update32(hd->chksum, ip->daddr, new_daddr);
-					ip->daddr = new_daddr;
-				}
-			}
+			vrrp_set_pkt_daddr(vrrp, ip, hd, inet_sockaddrip4(addr));
 		}
 
 		/* Has the source address changed? */
@@ -502,6 +508,20 @@ vrrp_update_pkt(vrrp_t *vrrp, uint8_t prio, sockaddr_t *addr)
 	}
 }
 
+/* Update the advert template of a unicast peer from the instance's advert,
+ * which vrrp_update_pkt() has updated. The VIPs in the template never
+ * change, so only the IP and VRRP headers are copied, and the checksum is
+ * adjusted for the peer's address. */
+static void
+vrrp_update_peer_pkt(vrrp_t *vrrp, unicast_peer_t *peer)
+{
+	struct iphdr *ip = PTR_CAST(struct iphdr, peer->send_buffer);
+	vrrphdr_t *hd = PTR_CAST(vrrphdr_t, peer->send_buffer + sizeof(struct iphdr));
+
+	memcpy(peer->send_buffer, vrrp->send_buffer, sizeof(struct iphdr) + sizeof(vrrphdr_t));
+	vrrp_set_pkt_daddr(vrrp, ip, hd, inet_sockaddrip4(&peer->address));
+}
+
 #ifdef _WITH_UNICAST_CHKSUM_COMPAT_
 static void
 vrrp_csum_mcast(vrrp_t *vrrp)
@@ -597,33 +617,55 @@ vrrp_in_chk_ipsecah(vrrp_t *vrrp, const struct iphdr *ip, const ipsec_ah_t *ah,
 }
 #endif
 
-/* check if ipaddr is present in VIP buffer */
-static int
-vrrp_in_chk_vips(const vrrp_t *vrrp, const ip_address_t *ipaddress, const unsigned char *buffer)
+/* Check the VIPs in an advert are our VIPs. Each address in the advert is
+ * looked up in the VIP index, and marks the VIP it matches as seen. Since
+ * the advert has as many addresses as we have VIPs, they all match if each
+ * address marks a different VIP. Returns a VIP not in the advert, or NULL. */
+static ip_address_t *
+vrrp_in_chk_vips(const vrrp_t *vrrp, const unsigned char *buffer)
 {
+	vip_index_t *index = &vrrp_data->vip_index;
+	vip_index_entry_t *entry;
+	ip_address_t *ipaddress;
+	size_t addr_len = vrrp->family == AF_INET ? sizeof(struct in_addr) : sizeof(struct in6_addr);
+	unsigned num_seen = 0;
 	size_t i;
 
-	if (vrrp->family == AF_INET) {
-		for (i = 0; i < vrrp->vip_cnt; i++) {
-			if (!memcmp(&ipaddress->u.sin.sin_addr.s_addr, buffer + i * sizeof(struct in_addr), sizeof (struct in_addr)))
-				return 1;
+	/* Generation 0 is never used, since entries start with seen == 0 */
+	if (!++index->seen)
+		index->seen = 1;
+
+	for (i = 0; i < vrrp->vip_cnt; i++) {
+		vip_index_for_each_entry(entry, index, vrrp->family, buffer + i * addr_len) {
+			if (entry->vrrp == vrrp && !entry->evip && entry->seen != index->seen) {
+				entry->seen = index->seen;
+				num_seen++;
+				break;
+			}
 		}
-	} else if (vrrp->family == AF_INET6) {
-		for (i = 0; i < vrrp->vip_cnt; i++) {
-			if (!memcmp(&ipaddress->u.sin6_addr, buffer + i * sizeof(struct in6_addr), sizeof (struct in6_addr)))
-				return 1;
+	}
+
+	if (num_seen == vrrp->vip_cnt)
+		return NULL;
+
+	list_for_each_entry(ipaddress, &vrrp->vip, e_list) {
+		vip_index_for_each_entry(entry, index, vrrp->family, &ipaddress->u) {
+			if (entry->ip_addr == ipaddress)
+				break;
 		}
+		if (!entry || entry->seen != index->seen)
+			return ipaddress;
 	}
 
-	return 0;
+	return NULL;
 }
 
 #ifdef _CHECKSUM_DEBUG_
 static void
-check_tx_checksum(vrrp_t *vrrp, unicast_peer_t *peer)
+check_tx_checksum(vrrp_t *vrrp, unicast_peer_t *peer, char *buf)
 {
-	struct iphdr *ip = PTR_CAST(struct iphdr, vrrp->send_buffer);
-	vrrphdr_t *hd = PTR_CAST(vrrphdr_t, ((char *)vrrp->send_buffer + sizeof(struct iphdr)));
+	struct iphdr *ip = PTR_CAST(struct iphdr, buf);
+	vrrphdr_t *hd = PTR_CAST(vrrphdr_t, (buf + sizeof(struct iphdr)));
 	size_t vrrppkt_len;
 	uint32_t acc_csum;
 	ipv4_phdr_t ipv4_phdr;
@@ -1100,16 +1142,14 @@ vrrp_check_packet(vrrp_t *vrrp, const vrrphdr_t *hd, const char *buffer, ssize_t
 			return VRRP_PACKET_KO;
 		}
 
-		list_for_each_entry(ipaddress, &vrrp->vip, e_list) {
-			if (!vrrp_in_chk_vips(vrrp, ipaddress, vips)) {
-				log_message(LOG_INFO, "(%s) ip address associated with VRID %d"
-						      " not present in MASTER advert: %s"
-						    , vrrp->iname, vrrp->vrid
-						    , inet_ntop(vrrp->family, vrrp->family == AF_INET6 ? &ipaddress->u.sin6_addr : (void *)&ipaddress->u.sin.sin_addr.s_addr,
-						      addr_str, sizeof(addr_str)));
-				++vrrp->stats->addr_list_err;
-				return VRRP_PACKET_KO;
-			}
+		if ((ipaddress = vrrp_in_chk_vips(vrrp, vips))) {
+			log_message(LOG_INFO, "(%s) ip address associated with VRID %d"
+					      " not present in MASTER advert: %s"
+					    , vrrp->iname, vrrp->vrid
+					    , inet_ntop(vrrp->family, vrrp->family == AF_INET6 ? &ipaddress->u.sin6_addr : (void *)&ipaddress->u.sin.sin_addr.s_addr,
+					      addr_str, sizeof(addr_str)));
+			++vrrp->stats->addr_list_err;
+			return VRRP_PACKET_KO;
 		}
 
 		/* check a unicast source address is in the unicast_peer list */
@@ -1363,6 +1403,36 @@ vrrp_build_vrrp(vrrp_t *vrrp, char *buffer, struct iphdr *ip_hdr)
 		vrrp_build_vrrp_v2(vrrp, buffer);
 }
 
+/* Build an advert template for each IPv4 unicast peer, so that sending
+ * an advert to a peer doesn't need to rewrite the instance's advert. With
+ * IPSEC AH the ICV has to be computed for each peer anyway, so the
+ * instance's advert is updated for each peer instead. */
+static void
+vrrp_build_peer_pkts(vrrp_t *vrrp)
+{
+	unicast_peer_t *peer;
+
+	if (!__test_bit(VRRP_FLAG_UNICAST, &vrrp->flags))
+		return;
+
+#ifdef _WITH_VRRP_AUTH_
+	if (vrrp->auth_type == VRRP_AUTH_AH)
+		return;
+#endif
+
+	list_for_each_entry(peer, &vrrp->unicast_peer, e_list) {
+		if (peer->address.ss_family != AF_INET)
+			continue;
+
+		if (!peer->send_buffer)
+			peer->send_buffer = MALLOC(vrrp->send_buffer_size);
+		memcpy(peer->send_buffer, vrrp->send_buffer, vrrp->send_buffer_size);
+		vrrp_set_pkt_daddr(vrrp, PTR_CAST(struct iphdr, peer->send_buffer),
+				   PTR_CAST(vrrphdr_t, peer->send_buffer + sizeof(struct iphdr)),
+				   inet_sockaddrip4(&peer->address));
+	}
+}
+
 /* build VRRP packet */
 static void
 vrrp_build_pkt(vrrp_t * vrrp)
@@ -1390,11 +1460,68 @@ vrrp_build_pkt(vrrp_t * vrrp)
 		if (vrrp->auth_type == VRRP_AUTH_AH)
 			vrrp_build_ipsecah(vrrp, vrrp->send_buffer, vrrp->send_buffer_size);
 #endif
+
+		vrrp_build_peer_pkts(vrrp);
 	}
 	else if (vrrp->family == AF_INET6)
 		vrrp_build_vrrp(vrrp, vrrp->send_buffer, NULL);
 }
 
+/* Adverts queued to be sent by a single sendmmsg() call. All the adverts
+ * of a batch are sent on the same socket with the same flags. */
+#define VRRP_TX_BATCH		64
+#define VRRP_TX_CBUF_SIZE	(CMSG_SPACE(sizeof(struct in6_pktinfo)) + CMSG_SPACE(sizeof(unsigned)))
+
+typedef struct _vrrp_tx_pkt {
+	vrrp_t			*vrrp;
+	unicast_peer_t		*peer;
+	uint8_t			prio;
+	char			*buf;		/* copy of vrrp->send_buffer */
+	size_t			buf_size;
+	char			cbuf[VRRP_TX_CBUF_SIZE] __attribute__((aligned(__alignof__(struct cmsghdr))));
+} vrrp_tx_pkt_t;
+
+static struct {
+	struct mmsghdr		msgs[VRRP_TX_BATCH];
+	struct iovec		iovs[VRRP_TX_BATCH];
+	vrrp_tx_pkt_t		pkts[VRRP_TX_BATCH];
+	unsigned		count;
+	unsigned		depth;		/* nesting of vrrp_tx_batch_open() */
+	int			fd;
+	int			flags;
+} vrrp_tx;
+
+static void
+vrrp_tx_batch_send(void)
+{
+	const vrrp_tx_pkt_t *pkt;
+	unsigned sent = 0;
+	int ret;
+
+	while (sent < vrrp_tx.count) {
+		ret = sendmmsg(vrrp_tx.fd, &vrrp_tx.msgs[sent], vrrp_tx.count - sent, vrrp_tx.flags);
+		if (ret > 0) {
+			sent += (unsigned)ret;
+			continue;
+		}
+
+		/* Sending the first unsent packet failed. Don't log an error if it
+		 * is a prio 0 message and the interface is down. */
+		pkt = &vrrp_tx.pkts[sent++];
+		if (pkt->prio == VRRP_PRIO_STOP && errno == ENETUNREACH &&
+		    (!pkt->vrrp->ifp || !IF_FLAGS_UP(pkt->vrrp->ifp)))
+			continue;
+
+		if (pkt->peer)
+			log_message(LOG_INFO, "(%s) Cant send advert to %s (%m)"
+					    , pkt->vrrp->iname, inet_sockaddrtos(&pkt->peer->address));
+		else
+			log_message(LOG_INFO, "(%s): send advert error %d (%m)", pkt->vrrp->iname, errno);
+	}
+
+	vrrp_tx.count = 0;
+}
+
 /* send VRRP packet */
 static int
 vrrp_build_ancillary_data(struct msghdr *msg, char *cbuf, sockaddr_t *src, const vrrp_t *vrrp)
@@ -1445,49 +1572,112 @@ vrrp_build_ancillary_data(struct msghdr *msg, char *cbuf, sockaddr_t *src, const
 	return 0;
 }
 
-static ssize_t
-vrrp_send_pkt(vrrp_t * vrrp, unicast_peer_t *peer)
+/* Queue a VRRP packet on the transmit batch */
+static void
+vrrp_queue_pkt(vrrp_t * vrrp, unicast_peer_t *peer, uint8_t prio)
 {
 	sockaddr_t *src = &vrrp->saddr;
-	struct msghdr msg;
-	struct iovec iov;
-	char cbuf[256] __attribute__((aligned(__alignof__(struct cmsghdr))));
+	vrrp_tx_pkt_t *pkt;
+	struct msghdr *msg;
+	int flags = peer ? 0 : MSG_DONTROUTE;
+
+	if (vrrp_tx.count &&
+	    (vrrp_tx.count == VRRP_TX_BATCH ||
+	     vrrp_tx.fd != vrrp->sockets->fd_out ||
+	     vrrp_tx.flags != flags))
+		vrrp_tx_batch_send();
+
+	vrrp_tx.fd = vrrp->sockets->fd_out;
+	vrrp_tx.flags = flags;
+
+	pkt = &vrrp_tx.pkts[vrrp_tx.count];
+	pkt->vrrp = vrrp;
+	pkt->peer = peer;
+	pkt->prio = prio;
+
+	/* The send buffer will be updated for the next peer before the batch is sent */
+	if (pkt->buf_size < vrrp->send_buffer_size) {
+		if (pkt->buf)
+			FREE(pkt->buf);
+		pkt->buf = MALLOC(vrrp->send_buffer_size);
+		pkt->buf_size = vrrp->send_buffer_size;
+	}
+	memcpy(pkt->buf, peer && peer->send_buffer ? peer->send_buffer : vrrp->send_buffer, vrrp->send_buffer_size);
 
 	/* Build the message data */
-	memset(&msg, 0, sizeof(msg));
-	msg.msg_iov = &iov;
-	msg.msg_iovlen = 1;
-	iov.iov_base = vrrp->send_buffer;
-	iov.iov_len = vrrp->send_buffer_size;
+	msg = &vrrp_tx.msgs[vrrp_tx.count].msg_hdr;
+	memset(msg, 0, sizeof(*msg));
+	msg->msg_iov = &vrrp_tx.iovs[vrrp_tx.count];
+	msg->msg_iovlen = 1;
+	vrrp_tx.iovs[vrrp_tx.count].iov_base = pkt->buf;
+	vrrp_tx.iovs[vrrp_tx.count].iov_len = vrrp->send_buffer_size;
 
 	/* glibc's CMSG_NXTHDR requires the buffer to have been initialised to all 0s */
 	if (vrrp->family == AF_INET6)
-		memset(cbuf, 0, sizeof(cbuf));
+		memset(pkt->cbuf, 0, sizeof(pkt->cbuf));
 
 	/* Unicast sending path */
 	if (peer && peer->address.ss_family == AF_INET) {
-		msg.msg_name = &peer->address;
-		msg.msg_namelen = sizeof(struct sockaddr_in);
+		msg->msg_name = &peer->address;
+		msg->msg_namelen = sizeof(struct sockaddr_in);
 	} else if (peer && peer->address.ss_family == AF_INET6) {
-		msg.msg_name = &peer->address;
-		msg.msg_namelen = sizeof(struct sockaddr_in6);
-		vrrp_build_ancillary_data(&msg, cbuf, src, vrrp);
+		msg->msg_name = &peer->address;
+		msg->msg_namelen = sizeof(struct sockaddr_in6);
+		vrrp_build_ancillary_data(msg, pkt->cbuf, src, vrrp);
 	} else if (vrrp->family == AF_INET) { /* Multicast sending path */
-		msg.msg_name = &vrrp->mcast_daddr;
-		msg.msg_namelen = sizeof(struct sockaddr_in);
+		msg->msg_name = &vrrp->mcast_daddr;
+		msg->msg_namelen = sizeof(struct sockaddr_in);
 	} else if (vrrp->family == AF_INET6) {
-		msg.msg_name = &vrrp->mcast_daddr;
-		msg.msg_namelen = sizeof(struct sockaddr_in6);
-		vrrp_build_ancillary_data(&msg, cbuf, src, vrrp);
+		msg->msg_name = &vrrp->mcast_daddr;
+		msg->msg_namelen = sizeof(struct sockaddr_in6);
+		vrrp_build_ancillary_data(msg, pkt->cbuf, src, vrrp);
 	}
 
 #ifdef _CHECKSUM_DEBUG_
 	if (vrrp->family == AF_INET && do_checksum_debug)
-		check_tx_checksum(vrrp, peer);
+		check_tx_checksum(vrrp, peer, pkt->buf);
 #endif
 
-	/* Send the packet */
-	return sendmsg(vrrp->sockets->fd_out, &msg, (peer) ? 0 : MSG_DONTROUTE);
+	vrrp_tx.count++;
+}
+
+/* Adverts sent while a transmit batch is open are queued, and sent
+ * when the outermost batch is closed. */
+void
+vrrp_tx_batch_open(void)
+{
+	vrrp_tx.depth++;
+}
+
+void
+vrrp_tx_batch_close(void)
+{
+	if (--vrrp_tx.depth)
+		return;
+
+	if (vrrp_tx.count)
+		vrrp_tx_batch_send();
+}
+
+/* Send the queued adverts now, even if a batch is open */
+void
+vrrp_tx_batch_flush(void)
+{
+	if (vrrp_tx.count)
+		vrrp_tx_batch_send();
+}
+
+void
+free_vrrp_tx_batch(void)
+{
+	unsigned i;
+
+	for (i = 0; i < VRRP_TX_BATCH; i++) {
+		if (vrrp_tx.pkts[i].buf) {
+			FREE(vrrp_tx.pkts[i].buf);
+			vrrp_tx.pkts[i].buf_size = 0;
+		}
+	}
 }
 
 /* Allocate the sending buffer */
@@ -1524,24 +1714,22 @@ vrrp_send_adv(vrrp_t * vrrp, uint8_t prio)
 	/* build the packet */
 	vrrp_update_pkt(vrrp, prio, NULL);
 
-	/* Send the packet, but don't log an error if it is a prio 0 message
-	 * and the interface is down. */
+	/* Queue the packet for each peer, and send them together */
 	vrrp->last_advert_sent = time_now;
+	vrrp_tx_batch_open();
 	if (!__test_bit(VRRP_FLAG_UNICAST, &vrrp->flags)) {
 // What if mcast_src_ip is configured?
-		if (vrrp_send_pkt(vrrp, NULL) == -1 &&
-		    (prio != VRRP_PRIO_STOP || errno != ENETUNREACH || (vrrp->ifp && IF_FLAGS_UP(vrrp->ifp))))
-			log_message(LOG_INFO, "(%s): send advert error %d (%m)", vrrp->iname, errno);
+		vrrp_queue_pkt(vrrp, NULL, prio);
 	} else {
 		list_for_each_entry(peer, &vrrp->unicast_peer, e_list) {
-			if (vrrp->family == AF_INET)
+			if (peer->send_buffer)
+				vrrp_update_peer_pkt(vrrp, peer);
+			else if (vrrp->family == AF_INET)
 				vrrp_update_pkt(vrrp, prio, &peer->address);
-			if (vrrp_send_pkt(vrrp, peer) == -1 &&
-			    (prio != VRRP_PRIO_STOP || errno != ENETUNREACH || (vrrp->ifp && IF_FLAGS_UP(vrrp->ifp))))
-				log_message(LOG_INFO, "(%s) Cant send advert to %s (%m)"
-						    , vrrp->iname, inet_sockaddrtos(&peer->address));
+			vrrp_queue_pkt(vrrp, peer, prio);
 		}
 	}
+	vrrp_tx_batch_close();
 
 	++vrrp->stats->advert_sent;
 }
@@ -1583,6 +1771,7 @@ vrrp_send_link_update(vrrp_t * vrrp, unsigned rep)
 		return;
 
 	/* send gratuitous arp for each virtual ip */
+	garp_tx_batch_open();
 	for (j = 0; j < rep; j++) {
 		list_for_each_entry(ip_addr, &vrrp->vip, e_list)
 			vrrp_send_update(vrrp, ip_addr, !j);
@@ -1590,6 +1779,7 @@ vrrp_send_link_update(vrrp_t * vrrp, unsigned rep)
 		list_for_each_entry(ip_addr, &vrrp->evip, e_list)
 			vrrp_send_update(vrrp, ip_addr, !j);
 	}
+	garp_tx_batch_close();
 }
 
 #ifdef _HAVE_VRRP_VMAC_
@@ -1611,6 +1801,7 @@ vrrp_send_vmac_update(vrrp_t *vrrp)
 		return;
 
 	/* send a gratuitous arp for each VMAC interface that is not sending adverts */
+	garp_tx_batch_open();
 	for (vip_list = &vrrp->vip; vip_list; vip_list = vip_list == &vrrp->vip ? &vrrp->evip : NULL) {
 		list_for_each_entry(ip_addr, vip_list, e_list) {
 			/* Don't send for non VMAC i/fs unless specified */
@@ -1641,6 +1832,7 @@ vrrp_send_vmac_update(vrrp_t *vrrp)
 			list_add_tail(&if_entry->e_list, &if_list);
 		}
 	}
+	garp_tx_batch_close();
 
 	/* Free the list of ifindices we have sent on */
 	list_for_each_entry_safe(if_entry, next_if_entry, &if_list, e_list)
@@ -1648,6 +1840,26 @@ vrrp_send_vmac_update(vrrp_t *vrrp)
 }
 #endif
 
+/* Queue the refresh gratuitous ARP/NA messages, to be paced out by the
+ * garp_delay of each address's interface */
+static void
+vrrp_queue_link_refresh(vrrp_t *vrrp)
+{
+	ip_address_t *ip_addr;
+
+	if (!VRRP_VIP_ISSET(vrrp))
+		return;
+
+	if (__test_bit(LOG_DETAIL_BIT, &debug))
+		log_message(LOG_INFO, "(%s) Queueing refresh gratuitous ARPs/NAs", vrrp->iname);
+
+	list_for_each_entry(ip_addr, &vrrp->vip, e_list)
+		vrrp_garp_refresh_queue(ip_addr, vrrp->garp_refresh_rep);
+
+	list_for_each_entry(ip_addr, &vrrp->evip, e_list)
+		vrrp_garp_refresh_queue(ip_addr, vrrp->garp_refresh_rep);
+}
+
 static void
 vrrp_remove_delayed_arp(vrrp_t *vrrp)
 {
@@ -1655,15 +1867,61 @@ vrrp_remove_delayed_arp(vrrp_t *vrrp)
 
 	list_for_each_entry(ip_addr, &vrrp->vip, e_list) {
 		ip_addr->garp_gna_pending = false;
+		vrrp_garp_refresh_dequeue(ip_addr);
 	}
 
 	list_for_each_entry(ip_addr, &vrrp->evip, e_list) {
 		ip_addr->garp_gna_pending = false;
+		vrrp_garp_refresh_dequeue(ip_addr);
 	}
 	vrrp->garp_pending = false;
 	vrrp->gna_pending = false;
 }
 
+/* Set the firewall rules, VIPs and eVIPs for becoming master. The VIPs
+ * and eVIPs are installed in one netlink batch, and we don't wait for
+ * the kernel's ACKs. */
+void
+vrrp_set_vips(vrrp_t *vrrp)
+{
+#ifdef _WITH_FIREWALL_
+	vrrp_handle_accept_mode(vrrp, IPADDRESS_ADD, false);
+#endif
+	netlink_batch_open();
+	if (!list_empty(&vrrp->vip))
+		vrrp_handle_ipaddress(vrrp, IPADDRESS_ADD, VRRP_VIP_TYPE, false);
+	if (!list_empty(&vrrp->evip))
+		vrrp_handle_ipaddress(vrrp, IPADDRESS_ADD, VRRP_EVIP_TYPE, false);
+	netlink_batch_close_async();
+}
+
+#if defined _WITH_VRRP_AUTH_
+/* If becoming MASTER in IPSEC AH AUTH, we reset the anti-replay */
+static void
+vrrp_reset_ipsecah_counter(vrrp_t *vrrp)
+{
+	if (vrrp->ipsecah_counter.cycle) {
+		vrrp->ipsecah_counter.cycle = false;
+		vrrp->ipsecah_counter.seq_number = 0;
+	}
+}
+#endif
+
+/* Send the first advert of an instance a sync group is taking to master
+ * state. The group sends these before installing the members' addresses,
+ * so that the old master can drop the VIPs first, and
+ * vrrp_state_master_tx() then doesn't send the advert again. */
+void
+vrrp_send_sync_master_adv(vrrp_t *vrrp)
+{
+#if defined _WITH_VRRP_AUTH_
+	vrrp_reset_ipsecah_counter(vrrp);
+#endif
+
+	vrrp_send_adv(vrrp, vrrp->effective_priority);
+	vrrp->master_adv_sent = true;
+}
+
 /* becoming master */
 static void
 vrrp_state_become_master(vrrp_t * vrrp)
@@ -1678,14 +1936,14 @@ vrrp_state_become_master(vrrp_t * vrrp)
 		vrrp->master_adver_int = vrrp->adver_int;
 	}
 
-	/* add the ip addresses */
-#ifdef _WITH_FIREWALL_
-	vrrp_handle_accept_mode(vrrp, IPADDRESS_ADD, false);
-#endif
-	if (!list_empty(&vrrp->vip))
-		vrrp_handle_ipaddress(vrrp, IPADDRESS_ADD, VRRP_VIP_TYPE, false);
-	if (!list_empty(&vrrp->evip))
-		vrrp_handle_ipaddress(vrrp, IPADDRESS_ADD, VRRP_EVIP_TYPE, false);
+	/* The kernel has applied the commands once they have been sent, so
+	 * the adverts and GARPs needn't wait for the ACKs */
+	netlink_batch_open();
+
+	/* add the ip addresses, unless the sync group has already */
+	if (!vrrp->vips_preset)
+		vrrp_set_vips(vrrp);
+	vrrp->vips_preset = false;
 	vrrp->vipset = true;
 
 	/* add virtual routes */
@@ -1696,6 +1954,8 @@ vrrp_state_become_master(vrrp_t * vrrp)
 	if (!list_empty(&vrrp->vrules))
 		vrrp_handle_iprules(vrrp, IPRULE_ADD, false);
 
+	netlink_batch_close_async();
+
 	kernel_netlink_poll();
 
 	vrrp_send_link_update(vrrp, vrrp->garp_rep);
@@ -1730,11 +1990,7 @@ vrrp_state_goto_master(vrrp_t * vrrp)
 	}
 
 #if defined _WITH_VRRP_AUTH_
-	/* If becoming MASTER in IPSEC AH AUTH, we reset the anti-replay */
-	if (vrrp->ipsecah_counter.cycle) {
-		vrrp->ipsecah_counter.cycle = false;
-		vrrp->ipsecah_counter.seq_number = 0;
-	}
+	vrrp_reset_ipsecah_counter(vrrp);
 #endif
 
 #ifdef _WITH_SNMP_RFCV3_
@@ -1758,6 +2014,9 @@ vrrp_restore_interface(vrrp_t * vrrp, bool advF, bool force)
 			log_message(LOG_INFO, "(%s) sent 0 priority", vrrp->iname);
 	}
 
+	/* The rules, routes and addresses are removed in one netlink batch */
+	netlink_batch_open();
+
 	/* remove virtual rules */
 	if (!list_empty(&vrrp->vrules))
 		vrrp_handle_iprules(vrrp, IPRULE_DEL, force);
@@ -1789,11 +2048,13 @@ vrrp_restore_interface(vrrp_t * vrrp, bool advF, bool force)
 			vrrp_handle_ipaddress(vrrp, IPADDRESS_DEL, VRRP_VIP_TYPE, force);
 		if (!list_empty(&vrrp->evip))
 			vrrp_handle_ipaddress(vrrp, IPADDRESS_DEL, VRRP_EVIP_TYPE, force);
+		netlink_batch_close_async();
 #ifdef _WITH_FIREWALL_
 		vrrp_handle_accept_mode(vrrp, IPADDRESS_DEL, force);
 #endif
 		vrrp->vipset = false;
-	}
+	} else
+		netlink_batch_close_async();
 }
 
 void
@@ -2021,9 +2282,15 @@ vrrp_state_master_tx(vrrp_t * vrrp)
 	 * remove the VIPs before we send the gratuitous ARPs, so send
 	 * the advert first.
 	 */
-	vrrp_send_adv(vrrp, vrrp->effective_priority);
+	if (vrrp->master_adv_sent)
+		vrrp->master_adv_sent = false;
+	else
+		vrrp_send_adv(vrrp, vrrp->effective_priority);
 
 	if (!VRRP_VIP_ISSET(vrrp)) {
+		/* Only the steady state adverts can wait in a transmit batch */
+		vrrp_tx_batch_flush();
+
 		log_message(LOG_INFO, "(%s) Entering MASTER STATE"
 				    , vrrp->iname);
 		vrrp_state_become_master(vrrp);
@@ -2037,7 +2304,7 @@ vrrp_state_master_tx(vrrp_t * vrrp)
 	} else {
 		if (timerisset(&vrrp->garp_refresh) &&
 		    timercmp(&time_now, &vrrp->garp_refresh_timer, >)) {
-			vrrp_send_link_update(vrrp, vrrp->garp_refresh_rep);
+			vrrp_queue_link_refresh(vrrp);
 			vrrp->garp_refresh_timer = timer_add_now(vrrp->garp_refresh);
 		}
 
@@ -2556,6 +2823,33 @@ open_vrrp_read_socket(sa_family_t family, int proto, const interface_t *ifp,
 	return fd;
 }
 
+/* Have the kernel drop adverts for VRIDs not on the socket, which are
+ * otherwise only dropped after being received. Since the socket pool is
+ * rebuilt on a reload, the filter always matches the configuration.
+ * With IPSEC AH the VRRP header follows the AH header, and if unknown
+ * VRIDs are to be logged we need to receive them, so no filter is set
+ * in those cases. Adverts with a bad TTL or version for our VRIDs are
+ * still received, so that they are counted. */
+static void
+vrrp_set_vrid_filter(sock_t *sock)
+{
+	uint8_t vrids[255];
+	unsigned num_vrids = 0;
+	vrrp_t *vrrp;
+
+	if (sock->proto != IPPROTO_VRRP || global_data->log_unknown_vrids)
+		return;
+
+	/* The socket's instances are in vrid order, but with unicast there
+	 * can be more than one instance with the same vrid */
+	rb_for_each_entry(vrrp, &sock->rb_vrid, rb_vrid) {
+		if (!num_vrids || vrids[num_vrids - 1] != vrrp->vrid)
+			vrids[num_vrids++] = vrrp->vrid;
+	}
+
+	if_setsockopt_vrid_filter(sock->fd_in, sock->family, vrids, num_vrids);
+}
+
 void
 open_sockpool_socket(sock_t *sock)
 {
@@ -2591,6 +2885,9 @@ open_sockpool_socket(sock_t *sock)
 		sock->fd_in = -1;
 	}
 
+	if (sock->fd_in != -1)
+		vrrp_set_vrid_filter(sock);
+
 	if (sock->fd_in == -1)
 		sock->fd_out = -1;
 	else
@@ -2601,13 +2898,97 @@ open_sockpool_socket(sock_t *sock)
 						     unicast_src_p);
 }
 
+/* Instance index, on the (vrid, family, configured interface) vrrp_exist() matches */
+static unsigned __attribute__ ((pure))
+vrrp_index_hash(const vrrp_index_t *index, const vrrp_t *vrrp)
+{
+	return hash_mix32((uint32_t)((uintptr_t)VRRP_CONFIGURED_IFP(vrrp) >> 4) ^
+			  ((uint32_t)vrrp->vrid << 16) ^ vrrp->family) & index->hash_mask;
+}
+
+/* The list is walked backwards so that vrrp_exist() sees the instances in
+ * list order */
+static void
+vrrp_index_build(vrrp_index_t *index, list_head_t *l)
+{
+	vrrp_t *vrrp;
+	unsigned num_vrrp = 0;
+	unsigned num_chains = 16;
+	unsigned i;
+
+	vrrp_index_free(index);
+
+	list_for_each_entry(vrrp, l, e_list)
+		num_vrrp++;
+
+	while (num_chains < num_vrrp)
+		num_chains <<= 1;
+
+	index->hash = MALLOC(num_chains * sizeof(*index->hash));
+	for (i = 0; i < num_chains; i++)
+		INIT_HLIST_HEAD(&index->hash[i]);
+	index->hash_mask = num_chains - 1;
+
+	list_for_each_entry_reverse(vrrp, l, e_list)
+		hlist_add_head(&vrrp->i_list, &index->hash[vrrp_index_hash(index, vrrp)]);
+}
+
+void
+vrrp_index_free(vrrp_index_t *index)
+{
+	if (!index->hash)
+		return;
+
+	FREE(index->hash);
+	index->hash = NULL;
+	index->hash_mask = 0;
+}
+
+/* Fingerprint the addresses, routes and rules of an instance, including
+ * the route options that route_exist() doesn't compare */
+static uint64_t
+vrrp_fingerprint(vrrp_t *vrrp)
+{
+	char buf[ROUTE_BUF_SIZE];
+	ip_address_t *ip_addr;
+	ip_route_t *route;
+	ip_rule_t *rule;
+	uint64_t h = STR_HASH64_INIT;
+
+	list_for_each_entry(ip_addr, &vrrp->vip, e_list) {
+		format_ipaddress(ip_addr, buf, sizeof(buf));
+		h = str_hash64(h, buf);
+	}
+	h = str_hash64(h, "evip");
+	list_for_each_entry(ip_addr, &vrrp->evip, e_list) {
+		format_ipaddress(ip_addr, buf, sizeof(buf));
+		h = str_hash64(h, buf);
+	}
+	h = str_hash64(h, "vroutes");
+	list_for_each_entry(route, &vrrp->vroutes, e_list) {
+		format_iproute(route, buf, sizeof(buf));
+		h = str_hash64(h, buf);
+	}
+	h = str_hash64(h, "vrules");
+	list_for_each_entry(rule, &vrrp->vrules, e_list) {
+		format_iprule(rule, buf, sizeof(buf));
+		h = str_hash64(h, buf);
+	}
+
+	return h;
+}
+
 /* Try to find a VRRP instance */
 static vrrp_t * __attribute__ ((pure))
-vrrp_exist(vrrp_t *old_vrrp, list_head_t *l)
+vrrp_exist(vrrp_t *old_vrrp, const vrrp_index_t *index)
 {
 	vrrp_t *vrrp;
+	hlist_node_t *pos;
 
-	list_for_each_entry(vrrp, l, e_list) {
+	if (!index->hash)
+		return NULL;
+
+	hlist_for_each_entry(vrrp, pos, &index->hash[vrrp_index_hash(index, old_vrrp)], i_list) {
 		if (vrrp->vrid != old_vrrp->vrid ||
 		    vrrp->family != old_vrrp->family ||
 #ifdef _HAVE_VRRP_VMAC_
@@ -2717,6 +3098,7 @@ shutdown_vrrp_instances(void)
 					netlink_link_del_vmac(&addr_vrrp);
 
 					vip->ifp->ifindex = 0;		/* We are no longer running the kernel_netlink_monitor */
+					if_rehash(vip->ifp);
 				}
 			}
 #endif
@@ -3661,6 +4043,7 @@ vrrp_complete_instance(vrrp_t * vrrp)
 						ifp->hw_addr[4] = vrrp->family == AF_INET ?  0x01 : 0x02;
 						ifp->hw_addr[5] = vrrp->vrid;
 					}
+					if_rehash(ifp);
 					vrrp->ifp = ifp;
 				}
 			}
@@ -3804,6 +4187,7 @@ vrrp_complete_instance(vrrp_t * vrrp)
 							ifp->hw_addr[4] = ip_addr->ifa.ifa_family == AF_INET ?  0x01 : 0x02;
 							ifp->hw_addr[5] = vrrp->vrid;
 						}
+						if_rehash(ifp);
 					}
 
 					if (!ip_addr->dont_track)
@@ -4635,12 +5019,15 @@ vrrp_complete_init(void)
 			report_config_error(CONFIG_GENERAL_ERROR, "Sync group %s has no virtual router(s)."
 								  " removing"
 								, sgroup->gname);
+			str_map_del(&vrrp_data->vrrp_sync_group_names, &sgroup->n_node);
 			free_sync_group(sgroup);
 			continue;
 		}
 
-		if (!vrrp_sync_set_group(sgroup))
+		if (!vrrp_sync_set_group(sgroup)) {
+			str_map_del(&vrrp_data->vrrp_sync_group_names, &sgroup->n_node);
 			free_sync_group(sgroup);
+		}
 	}
 
 	/* Complete VRRP instance initialization */
@@ -4669,6 +5056,9 @@ vrrp_complete_init(void)
 	if (check_vrid_conflicts())
 		return false;
 
+	/* Index the VIPs and eVIPs now their interfaces are set */
+	vip_index_build(&vrrp_data->vip_index, &vrrp_data->vrrp);
+
 #ifdef _HAVE_VRRP_VMAC_
 	check_vmac_conflicts();
 #endif
@@ -4707,13 +5097,22 @@ vrrp_complete_init(void)
 	notify_fifo_open(&global_data->notify_fifo, &global_data->vrrp_notify_fifo,
 			 vrrp_notify_fifo_script_exit, "vrrp_");
 
-	/* If we have a global garp_delay add it to any interfaces without a garp_delay */
-	if (global_data->vrrp_garp_interval || global_data->vrrp_gna_interval)
-		set_default_garp_delay();
+	/* If we have a global garp_delay, or are refreshing gratuitous ARPs, add
+	 * a garp_delay to any interfaces without one */
+	set_default_garp_delay();
 
 	/* See if any static routes or rules need monitoring */
 	process_static_entries();
 
+	/* Index the routes and rules netlink reports need to be matched against */
+	route_index_build(&vrrp_data->route_index, &vrrp_data->vrrp, &vrrp_data->static_routes);
+	rule_index_build(&vrrp_data->rule_index, &vrrp_data->vrrp, &vrrp_data->static_rules);
+
+	/* Index and fingerprint the instances, for matching them on a reload */
+	vrrp_index_build(&vrrp_data->vrrp_index, &vrrp_data->vrrp);
+	list_for_each_entry(vrrp, &vrrp_data->vrrp, e_list)
+		vrrp->fingerprint = vrrp_fingerprint(vrrp);
+
 	/* If we are tracking any routes/rules, ask netlink to monitor them */
 	set_extra_netlink_monitoring(monitor_ipv4_routes, monitor_ipv6_routes, monitor_ipv4_rules, monitor_ipv6_rules);
 
@@ -4723,7 +5122,7 @@ vrrp_complete_init(void)
 #endif
 
 	/* Initialise any tracking files */
-	init_track_files(&vrrp_data->vrrp_track_files);
+	init_track_files(&vrrp_data->vrrp_track_files, &vrrp_data->vrrp_track_file_names);
 
 #ifdef _WITH_TRACK_PROCESS_
 	/* Initialise any process tracking */
@@ -4776,7 +5175,7 @@ vrrp_complete_init(void)
 			/* If we are reloading and the vrrp instance was already
 			 * in fault state, we don't need to notify again */
 			if (reload) {
-				old_vrrp = vrrp_exist(vrrp, &old_vrrp_data->vrrp);
+				old_vrrp = vrrp_exist(vrrp, &old_vrrp_data->vrrp_index);
 				if (old_vrrp && old_vrrp->state == VRRP_STATE_FAULT)
 					continue;
 			}
@@ -4796,7 +5195,7 @@ vrrp_complete_init(void)
 			if (old_vrrp->state == VRRP_STATE_FAULT)
 				continue;
 
-			vrrp = vrrp_exist(old_vrrp, &vrrp_data->vrrp);
+			vrrp = vrrp_exist(old_vrrp, &vrrp_data->vrrp_index);
 			if (vrrp) {
 				/* If we have detected a fault, don't override it */
 				if (vrrp->state == VRRP_STATE_FAULT || vrrp->num_script_init)
@@ -4860,6 +5259,7 @@ vrrp_complete_init(void)
 	list_for_each_entry_safe(scr, scr_tmp, &vrrp_data->vrrp_script, e_list) {
 		if (list_empty(&scr->tracking_vrrp)) {
 			report_config_error(CONFIG_GENERAL_ERROR, "Warning - script %s is not used", scr->sname);
+			str_map_del(&vrrp_data->vrrp_script_names, &scr->n_node);
 			free_vscript(scr);
 		}
 	}
@@ -4882,19 +5282,21 @@ void vrrp_restore_interfaces_startup(void)
 	}
 }
 
-/* Clear VIP|EVIP not present in the new data */
-static void
+/* Clear VIP|EVIP not present in the new data. Returns true if any were removed. */
+static bool
 clear_diff_vrrp_vip(vrrp_t *old_vrrp, vrrp_t *vrrp)
 {
 	list_head_t addr_list;
 	bool fw_set = false;
+	bool removed;
 
 // !!!! TODO need to handle accept_mode changing - either remove all or add all. Do new entries get added for new VIPs?
 	if (!old_vrrp->vipset)
-		return;
+		return false;
 
 	INIT_LIST_HEAD(&addr_list);
-	get_diff_address(old_vrrp, vrrp, &addr_list);
+	get_diff_address(old_vrrp, vrrp, &vrrp_data->vip_index, &addr_list);
+	removed = !list_empty(&addr_list);
 
 #ifdef _WITH_FIREWALL_
 	fw_set = (old_vrrp->base_priority != VRRP_PRIO_OWNER && !old_vrrp->accept);
@@ -4911,28 +5313,61 @@ clear_diff_vrrp_vip(vrrp_t *old_vrrp, vrrp_t *vrrp)
 #endif
 	clear_address_list(&addr_list, fw_set);
 	free_ipaddress_list(&addr_list);
+
+	return removed;
 }
 
 /* Clear virtual routes not present in the new data */
 static void
 clear_diff_vrrp_vroutes(vrrp_t *old_vrrp, vrrp_t *vrrp)
 {
-	clear_diff_routes(&old_vrrp->vroutes, &vrrp->vroutes);
+	clear_diff_routes(&old_vrrp->vroutes, &vrrp->vroutes, &vrrp_data->route_index, vrrp);
 }
 
 /* Clear virtual rules not present in the new data */
 static void
 clear_diff_vrrp_vrules(vrrp_t *old_vrrp, vrrp_t *vrrp)
 {
-	clear_diff_rules(&old_vrrp->vrules, &vrrp->vrules);
+	clear_diff_rules(&old_vrrp->vrules, &vrrp->vrules, &vrrp_data->rule_index, vrrp);
 }
 
-/* Keep the state from before reload */
+/* Check if nothing the kernel has been given for an instance is changed by
+ * a reload, in which case the instance can be left as it is. */
 static bool
-restore_vrrp_state(vrrp_t *old_vrrp, vrrp_t *vrrp)
+vrrp_unchanged(vrrp_t *old_vrrp, vrrp_t *vrrp)
 {
-	bool added_ip_addr = false;
+	if (old_vrrp->fingerprint != vrrp->fingerprint ||
+	    old_vrrp->ifp != vrrp->ifp ||
+	    (old_vrrp->base_priority == VRRP_PRIO_OWNER) != (vrrp->base_priority == VRRP_PRIO_OWNER))
+		return false;
+
+#ifdef _WITH_FIREWALL_
+	if (old_vrrp->accept != vrrp->accept)
+		return false;
+#endif
+
+#ifdef _HAVE_VRRP_VMAC_
+	if (__test_bit(VRRP_VMAC_BIT, &vrrp->flags) != __test_bit(VRRP_VMAC_BIT, &old_vrrp->flags) ||
+	    __test_bit(VRRP_VMAC_ADDR_BIT, &vrrp->flags) != __test_bit(VRRP_VMAC_ADDR_BIT, &old_vrrp->flags))
+		return false;
+#ifdef _HAVE_VRRP_IPVLAN_
+	if (__test_bit(VRRP_IPVLAN_BIT, &vrrp->flags) != __test_bit(VRRP_IPVLAN_BIT, &old_vrrp->flags))
+		return false;
+#endif
+#endif
 
+	/* The fingerprints could match by chance, and the addresses, routes
+	 * and rules must all be set or not, so that there is nothing to add. */
+	return ipaddress_list_same(&old_vrrp->vip, &vrrp->vip, old_vrrp->vipset) &&
+	       ipaddress_list_same(&old_vrrp->evip, &vrrp->evip, old_vrrp->vipset) &&
+	       iproute_list_same(&old_vrrp->vroutes, &vrrp->vroutes, old_vrrp->vipset) &&
+	       iprule_list_same(&old_vrrp->vrules, &vrrp->vrules, old_vrrp->vipset);
+}
+
+/* Copy the state that doesn't depend on the configuration */
+static void
+copy_vrrp_state(vrrp_t *old_vrrp, vrrp_t *vrrp)
+{
 	/* If the new state is master, we must be reloading from master */
 	vrrp->reload_master = vrrp->state == VRRP_STATE_MAST;
 
@@ -4944,8 +5379,41 @@ restore_vrrp_state(vrrp_t *old_vrrp, vrrp_t *vrrp)
 	memcpy(&vrrp->ipsecah_counter, &old_vrrp->ipsecah_counter, sizeof(seq_counter_t));
 #endif
 
-	/* Remember if we had vips up and add new ones if needed */
+	/* Remember if we had vips up */
 	vrrp->vipset = old_vrrp->vipset;
+}
+
+/* Keep the state of an unchanged instance from before reload */
+static void
+keep_vrrp_state(vrrp_t *old_vrrp, vrrp_t *vrrp)
+{
+	copy_vrrp_state(old_vrrp, vrrp);
+	vrrp->reload_unchanged = true;
+
+	ipaddress_list_copy_state(&old_vrrp->vip, &vrrp->vip);
+	ipaddress_list_copy_state(&old_vrrp->evip, &vrrp->evip);
+	iproute_list_copy_state(&old_vrrp->vroutes, &vrrp->vroutes);
+	iprule_list_copy_state(&old_vrrp->vrules, &vrrp->vrules);
+
+#ifdef _WITH_FIREWALL_
+	if (vrrp->vipset) {
+		vrrp->firewall_rules_set = old_vrrp->base_priority != VRRP_PRIO_OWNER && !old_vrrp->accept;
+
+		/* This only adds any drop rules that are missing */
+		vrrp_handle_accept_mode(vrrp, IPADDRESS_ADD, false);
+	}
+#endif
+}
+
+/* Keep the state from before reload */
+static bool
+restore_vrrp_state(vrrp_t *old_vrrp, vrrp_t *vrrp)
+{
+	bool added_ip_addr = false;
+
+	copy_vrrp_state(old_vrrp, vrrp);
+
+	/* Add new vips if we had vips up */
 	if (vrrp->vipset) {
 #ifdef _WITH_FIREWALL_
 		vrrp_handle_accept_mode(vrrp, IPADDRESS_ADD, false);
@@ -4973,20 +5441,23 @@ restore_vrrp_state(vrrp_t *old_vrrp, vrrp_t *vrrp)
 
 /* Diff when reloading configuration */
 void
-clear_diff_vrrp(void)
+clear_diff_vrrp(bool addresses_removed)
 {
 	vrrp_t *vrrp;
 	vrrp_t *new_vrrp;
+	bool unchanged_vroutes = false;
 
 	list_for_each_entry(vrrp, &old_vrrp_data->vrrp, e_list) {
 		/*
 		 * Try to find this vrrp in the new conf data
 		 * reloaded.
 		 */
-		new_vrrp = vrrp_exist(vrrp, &vrrp_data->vrrp);
+		new_vrrp = vrrp_exist(vrrp, &vrrp_data->vrrp_index);
 		if (!new_vrrp) {
-			if (vrrp->state == VRRP_STATE_MAST)
+			if (vrrp->state == VRRP_STATE_MAST) {
 				vrrp_restore_interface(vrrp, true, false);
+				addresses_removed = true;
+			}
 
 			/* We used to send FAULT if an instance was deleted, so that
 			 * needs to continue as the default. If vrrp->notify_deleted
@@ -4999,6 +5470,7 @@ clear_diff_vrrp(void)
 			/* Remove VMAC if one was created so long as no new VRRP instance is using it */
 			if (vrrp->ifp && vrrp->ifp->is_ours && list_empty(&vrrp->ifp->tracking_vrrp)) {
 				netlink_link_del_vmac(vrrp);
+				addresses_removed = true;
 				/* Need to delete ADDR VMACs */
 			}
 #endif
@@ -5015,8 +5487,16 @@ clear_diff_vrrp(void)
 		 * Try to find this vrrp in the new conf data
 		 * reloaded.
 		 */
-		new_vrrp = vrrp_exist(vrrp, &vrrp_data->vrrp);
+		new_vrrp = vrrp_exist(vrrp, &vrrp_data->vrrp_index);
 		if (new_vrrp) {
+			/* If nothing has changed, leave the instance alone */
+			if (vrrp_unchanged(vrrp, new_vrrp)) {
+				keep_vrrp_state(vrrp, new_vrrp);
+				if (new_vrrp->vipset && !list_empty(&new_vrrp->vroutes))
+					unchanged_vroutes = true;
+				continue;
+			}
+
 			/*
 			 * If this vrrp instance exist in new
 			 * data, then perform a VIP|EVIP diff.
@@ -5028,7 +5508,8 @@ clear_diff_vrrp(void)
 			/* virtual routes diff */
 			clear_diff_vrrp_vroutes(vrrp, new_vrrp);
 
-			clear_diff_vrrp_vip(vrrp, new_vrrp);
+			if (clear_diff_vrrp_vip(vrrp, new_vrrp))
+				addresses_removed = true;
 
 #ifdef _HAVE_VRRP_VMAC_
 			/*
@@ -5045,6 +5526,7 @@ clear_diff_vrrp(void)
 #endif
 										     )) {
 				netlink_link_del_vmac(vrrp);
+				addresses_removed = true;
 			}
 #endif
 
@@ -5097,9 +5579,23 @@ list_head_t *if_queue = get_interface_queue();
 			strcpy(addr_vrrp.vmac_ifname, ifp->ifname);
 			__set_bit(VRRP_VMAC_BIT, &addr_vrrp.flags);        // This should be superfluous
 			netlink_link_del_vmac(&addr_vrrp);
+			addresses_removed = true;
 		}
 	}
 #endif
+
+	/* As in restore_vrrp_state(), the kernel may have deleted routes that
+	 * depended on an address that has been removed, or that used a device
+	 * which has lost its last address, so re-add all the virtual routes of
+	 * the unchanged instances too. */
+	if (addresses_removed && unchanged_vroutes) {
+		netlink_batch_open();
+		list_for_each_entry(vrrp, &vrrp_data->vrrp, e_list) {
+			if (vrrp->reload_unchanged && vrrp->vipset && !list_empty(&vrrp->vroutes))
+				vrrp_handle_iproutes(vrrp, IPROUTE_ADD, true);
+		}
+		netlink_batch_close();
+	}
 }
 
 /* Set script status to a sensible value on reload */
@@ -5155,13 +5651,9 @@ set_previous_sync_group_states(void)
 	vrrp_sgroup_t *ogroup, *ngroup;
 
 	list_for_each_entry(ngroup, &vrrp_data->vrrp_sync_group, e_list) {
-		list_for_each_entry(ogroup, &old_vrrp_data->vrrp_sync_group, e_list) {
-			if (!strcmp(ngroup->gname, ogroup->gname)) {
-				if (ngroup->state == ogroup->state)
-					ngroup->state_same_at_reload = true;
-				break;
-			}
-		}
+		ogroup = str_map_find_entry(&old_vrrp_data->vrrp_sync_group_names, ngroup->gname, vrrp_sgroup_t, n_node);
+		if (ogroup && ngroup->state == ogroup->state)
+			ngroup->state_same_at_reload = true;
 	}
 }
 
@@ -40,91 +40,56 @@
 #include "bitops.h"
 #include "vrrp_scheduler.h"
 #include "vrrp_arp.h"
-
-/*
- * The size of the garp_buffer should be the large enough to hold
- * the largest arp packet to be sent + the size of the link layer header
- * for the corresponding protocol
- * For infiniband the link layer header consists of the destination MAC
- * address(20 bytes) and protocol identifier of the encapsulated
- * datagram(4 bytes). This is larger than the space required for Ethernet
- */
-#define GARP_BUFFER_SIZE (sizeof(inf_arphdr_t) + sizeof (ipoib_hdr_t) +\
-			  (INFINIBAND_ALEN))
+#include "vrrp_garp_tx.h"
 
 /* static vars */
-static char *garp_buffer;
 static int garp_fd = -1;
+static garp_tx_t *garp_tx;
 
-/* Send the gratuitous ARP message */
-static ssize_t send_arp(ip_address_t *ipaddress, ssize_t pack_len)
+/* Build a gratuitous ARP message over a specific interface */
+static void build_gratuitous_arp(interface_t *ifp, ip_address_t *ipaddress, garp_frame_t *frame)
 {
-	interface_t *ifp = ipaddress->ifp;
-	struct sockaddr_storage ss;
-	struct sockaddr_large_ll *sll = PTR_CAST(struct sockaddr_large_ll, &ss);
-	ssize_t len;
+	char *hwaddr = PTR_CAST(char, IF_HWADDR(ipaddress->ifp));
+	struct sockaddr_large_ll *sll = &frame->sll;
+	struct arphdr *arph;
+	char *arp_ptr;
+
+	memset(frame, 0, sizeof(*frame));
+	frame->ifp = ifp;
+	frame->ifindex = ipaddress->ifp->ifindex;
+	memcpy(frame->hw_addr, hwaddr, ifp->hw_addr_len);
+	inet_ntop(AF_INET, &ipaddress->u.sin.sin_addr, frame->addr_str, sizeof(frame->addr_str));
 
 	/* Build the dst device */
-	memset(&ss, 0, sizeof(ss));
 	sll->sll_family = AF_PACKET;
 	sll->sll_hatype = ifp->hw_type;
 	sll->sll_protocol = htons(ETHERTYPE_ARP);
-	sll->sll_ifindex = (int) ifp->ifindex;
+	sll->sll_ifindex = (int) ipaddress->ifp->ifindex;
 
 	/* The values in sll_addr and sll_halen appear to be ignored */
 	sll->sll_halen = ifp->hw_addr_len;
 	memcpy(sll->sll_addr,
 	       ifp->hw_addr_bcast, ifp->hw_addr_len);
 
-	if (__test_bit(LOG_DETAIL_BIT, &debug))
-		log_message(LOG_INFO, "Sending gratuitous ARP on %s for %s",
-			    ifp->ifname,
-			    inet_ntop2(ipaddress->u.sin.sin_addr.s_addr));
-
-	/* Send packet */
-	len = sendto(garp_fd, garp_buffer, pack_len, 0,
-		     PTR_CAST(struct sockaddr, sll), sizeof(*sll));
-	if (len < 0) {
-		/* coverity[bad_printf_format_string] */
-		log_message(LOG_INFO, "Error %d (%m) sending gratuitous ARP on %s for %s", errno,
-			    IF_NAME(ipaddress->ifp), inet_ntop2(ipaddress->u.sin.sin_addr.s_addr));
-	}
-	return len;
-}
-
-/* Build a gratuitous ARP message over a specific interface */
-ssize_t send_gratuitous_arp_immediate(interface_t *ifp, ip_address_t *ipaddress)
-{
-	char *hwaddr = PTR_CAST(char, IF_HWADDR(ipaddress->ifp));
-	struct arphdr *arph;
-	char *arp_ptr;
-	ssize_t len, pack_len;
-
-	if (ifp->hw_addr_len == 0)
-		return -1;
-
-	if (!garp_buffer)
-		return -1;
-
 	/* Setup link layer header */
 	if (ifp->hw_type == ARPHRD_INFINIBAND) {
 		struct ipoib_hdr  *ipoib;
 
 		/*  Add ipoib link layer header MAC + proto */
-		memcpy(garp_buffer, ifp->hw_addr_bcast, ifp->hw_addr_len);
-		ipoib = PTR_CAST(struct ipoib_hdr, (garp_buffer + ifp->hw_addr_len));
+		memcpy(frame->data, ifp->hw_addr_bcast, ifp->hw_addr_len);
+		ipoib = PTR_CAST(struct ipoib_hdr, (frame->data + ifp->hw_addr_len));
 		ipoib->proto = htons(ETHERTYPE_ARP);
 		ipoib->reserved = 0;
-		arph = PTR_CAST(struct arphdr, garp_buffer + ifp->hw_addr_len +
+		arph = PTR_CAST(struct arphdr, frame->data + ifp->hw_addr_len +
 					 sizeof(*ipoib));
 	} else {
 		struct ether_header *eth;
 
-		eth = PTR_CAST(struct ether_header, garp_buffer);
+		eth = PTR_CAST(struct ether_header, frame->data);
 		memcpy(eth->ether_dhost, ifp->hw_addr_bcast, ETH_ALEN < ifp->hw_addr_len ? ETH_ALEN : ifp->hw_addr_len);
 		memcpy(eth->ether_shost, hwaddr, ETH_ALEN < ifp->hw_addr_len ? ETH_ALEN : ifp->hw_addr_len);
 		eth->ether_type = htons(ETHERTYPE_ARP);
-		arph = PTR_CAST(struct arphdr, (garp_buffer + ETHER_HDR_LEN));
+		arph = PTR_CAST(struct arphdr, (frame->data + ETHER_HDR_LEN));
 	}
 
 	/* ARP payload */
@@ -145,15 +110,40 @@ ssize_t send_gratuitous_arp_immediate(interface_t *ifp, ip_address_t *ipaddress)
 	       sizeof(struct in_addr));
 	arp_ptr += sizeof(struct in_addr);
 
-	pack_len = arp_ptr - garp_buffer;
-	len = send_arp(ipaddress, pack_len);
+	frame->len = (size_t)(arp_ptr - frame->data);
+}
+
+/* Send, or queue if a batch is open, a gratuitous ARP message over a
+ * specific interface. The message is built the first time, and kept with
+ * the address. */
+ssize_t send_gratuitous_arp_immediate(interface_t *ifp, ip_address_t *ipaddress)
+{
+	garp_frame_t *frame = ipaddress->garp_frame;
+	ssize_t len;
+
+	if (ifp->hw_addr_len == 0)
+		return -1;
+
+	if (!garp_tx)
+		return -1;
+
+	if (!frame ||
+	    frame->ifp != ifp ||
+	    frame->ifindex != ipaddress->ifp->ifindex ||
+	    memcmp(frame->hw_addr, IF_HWADDR(ipaddress->ifp), ifp->hw_addr_len)) {
+		if (!frame)
+			frame = ipaddress->garp_frame = MALLOC(sizeof(*frame));
+		build_gratuitous_arp(ifp, ipaddress, frame);
+	}
+
+	len = garp_tx_queue(garp_tx, frame);
 
 	/* If we have to delay between sending garps, note the next time we can */
 	if (ifp->garp_delay && ifp->garp_delay->have_garp_interval)
 		ifp->garp_delay->garp_next_time = timer_add_now(ifp->garp_delay->garp_interval);
 
-	/* Cleanup room for next round */
-	memset(garp_buffer, 0, GARP_BUFFER_SIZE);
+	/* Every message sent on the interface holds back refresh messages */
+	garp_refresh_charge(ifp->garp_delay);
 
 	return len;
 }
@@ -205,7 +195,7 @@ void send_gratuitous_arp(vrrp_t *vrrp, ip_address_t *ipaddress)
 bool
 gratuitous_arp_init(void)
 {
-	if (garp_buffer)
+	if (garp_tx)
 		return true;
 
 	/* Create the socket descriptor */
@@ -222,17 +212,16 @@ gratuitous_arp_init(void)
 	/* We don't want to receive any data on this socket */
 	if_setsockopt_no_receive(&garp_fd);
 
-	/* Initalize shared buffer */
-	garp_buffer = PTR_CAST(char, MALLOC(GARP_BUFFER_SIZE));
+	garp_tx = garp_tx_open(garp_fd, "ARP");
 
 	return true;
 }
 
 void gratuitous_arp_close(void)
 {
-	if (garp_buffer) {
-		FREE(garp_buffer);
-		garp_buffer = NULL;
+	if (garp_tx) {
+		garp_tx_close(garp_tx);
+		garp_tx = NULL;
 	}
 
 	if (garp_fd != -1) {
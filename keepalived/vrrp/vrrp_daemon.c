@@ -36,7 +36,6 @@
 #include "snmp.h"
 #endif
 #include "scheduler.h"
-#include "smtp.h"
 #include "vrrp_track.h"
 #endif
 #include "vrrp_daemon.h"
@@ -57,6 +56,7 @@
 #include "memory.h"
 #include "bitops.h"
 #include "rttables.h"
+#include "smtp.h"
 #if defined _WITH_SNMP_RFC_ || defined _WITH_SNMP_VRRP_
   #include "vrrp_snmp.h"
 #endif
@@ -324,6 +324,7 @@ vrrp_terminate_phase2(int exit_status)
 	free_global_data(global_data);
 	free_vrrp_data(vrrp_data);
 	free_vrrp_buffer();
+	free_vrrp_tx_batch();
 	free_interface_queue();
 	free_parent_mallocs_exit();
 
@@ -503,6 +504,8 @@ delayed_start_clear_thread(__attribute__((unused)) thread_ref_t thread)
 static void
 start_vrrp(data_t *prev_global_data)
 {
+	bool static_addresses_removed = false;
+
 	/* Clear the flags used for optimising performance */
 	clear_summary_flags();
 
@@ -585,7 +588,7 @@ start_vrrp(data_t *prev_global_data)
 
 			clear_diff_static_rules();
 			clear_diff_static_routes();
-			clear_diff_static_addresses();
+			static_addresses_removed = clear_diff_static_addresses();
 			clear_diff_script();
 #ifdef _WITH_BFD_
 			clear_diff_bfd();
@@ -653,7 +656,7 @@ start_vrrp(data_t *prev_global_data)
 	/* clear_diff_vrrp must be called after vrrp_complete_init, since the latter
 	 * sets ifp on the addresses, which is used for the address comparison */
 	if (reload) {
-		clear_diff_vrrp();
+		clear_diff_vrrp(static_addresses_removed);
 		vrrp_dispatcher_release(old_vrrp_data);
 
 		/* Set previous sync group states to suppress duplicate notifies */
@@ -686,6 +689,31 @@ start_vrrp(data_t *prev_global_data)
 	set_process_priorities(global_data->vrrp_realtime_priority, global_data->max_auto_priority, global_data->min_auto_priority_delay,
 			       global_data->vrrp_rlimit_rt, global_data->vrrp_process_priority, global_data->vrrp_no_swap ? 4096 : 0);
 
+#ifdef _WITH_IO_URING_
+	/* Use io_uring rather than epoll if configured */
+	thread_set_io_uring(master, global_data->vrrp_io_uring);
+#endif
+
+	/* Limit the number of unused threads kept for reuse */
+	thread_set_unuse_high_water(master, global_data->thread_cache_high_water);
+
+	/* Collect thread function statistics if configured */
+	thread_set_stats(global_data->thread_stats);
+
+	/* Defer background threads when VRRP timers are about to expire */
+	thread_set_watchdog(master, vrrp_next_deadline, global_data->vrrp_watchdog_budget);
+	if (global_data->vrrp_watchdog_budget) {
+		thread_add_deferrable(master, print_vrrp_data);
+		thread_add_deferrable(master, print_vrrp_stats);
+#ifdef _WITH_JSON_
+		thread_add_deferrable(master, print_vrrp_json);
+#endif
+		smtp_add_deferrable(master);
+#ifdef _WITH_DBUS_
+		vrrp_dbus_add_deferrable(master);
+#endif
+	}
+
 	/* Set the process cpu affinity if configured */
 	set_process_cpu_affinity(&global_data->vrrp_cpu_mask, "vrrp");
 
@@ -782,6 +810,7 @@ vrrp_signal_init(void)
 #ifdef _WITH_JSON_
 	signal_set(SIGJSON, sigjson_vrrp, NULL);
 #endif
+	signal_set(SIGTSTATS, thread_stats_signal, NULL);
 #ifdef THREAD_DUMP
 	signal_set(SIGTDUMP, thread_dump_signal, NULL);
 #endif
@@ -841,6 +870,8 @@ reload_vrrp_thread(__attribute__((unused)) thread_ref_t thread)
 	cancel_kernel_netlink_threads();
 	thread_cleanup_master(master, true);
 	thread_add_base_threads(master, with_snmp);
+	garp_thread = NULL;
+	garp_refresh_thread = NULL;
 
 	/* Remove the notify fifo - we don't know if it will be the same after a reload */
 	notify_fifo_close(&global_data->notify_fifo, &global_data->vrrp_notify_fifo);
@@ -1036,11 +1067,6 @@ start_vrrp_child(void)
 	if (main_pid != getppid())
 		kill(getpid(), SIGTERM);
 
-#ifdef _WITH_PERF_
-	if (perf_run == PERF_ALL)
-		run_perf("vrrp", global_data->network_namespace, global_data->instance_name);
-#endif
-
 	prog_type = PROG_TYPE_VRRP;
 
 	initialise_debug_options();
@@ -1109,6 +1135,12 @@ start_vrrp_child(void)
 	/* Create the new master thread */
 	thread_destroy_master(master);	/* This destroys any residual settings from the parent */
 	master = thread_make_master();
+
+#ifdef _WITH_PERF_
+	/* perf is run once our thread master exists, so that it can reap it */
+	if (perf_run == PERF_ALL)
+		run_perf("vrrp", global_data->network_namespace, global_data->instance_name);
+#endif
 #endif
 
 	/* If last process died during a reload, we can get there and we
@@ -508,6 +508,7 @@ static void
 free_unicast_peer(unicast_peer_t *peer)
 {
 	list_del_init(&peer->e_list);
+	FREE_PTR(peer->send_buffer);
 	FREE(peer);
 }
 static void
@@ -1050,7 +1051,7 @@ alloc_vrrp_track_script(const vector_t *strvec)
 void
 alloc_vrrp_track_file(const vector_t *strvec)
 {
-	vrrp_alloc_track_file(current_vrrp->iname, &vrrp_data->vrrp_track_files, &current_vrrp->track_file, strvec);
+	vrrp_alloc_track_file(current_vrrp->iname, &vrrp_data->vrrp_track_file_names, &current_vrrp->track_file, strvec);
 }
 
 #ifdef _WITH_TRACK_PROCESS_
@@ -1084,7 +1085,7 @@ alloc_vrrp_group_track_script(const vector_t *strvec)
 void
 alloc_vrrp_group_track_file(const vector_t *strvec)
 {
-	vrrp_alloc_track_file(current_vsyncg->gname, &vrrp_data->vrrp_track_files, &current_vsyncg->track_file, strvec);
+	vrrp_alloc_track_file(current_vsyncg->gname, &vrrp_data->vrrp_track_file_names, &current_vsyncg->track_file, strvec);
 }
 
 #ifdef _WITH_TRACK_PROCESS_
@@ -1197,7 +1198,7 @@ alloc_vrrp_buffer(size_t len)
 	if (vrrp_buffer)
 		FREE(vrrp_buffer);
 
-	vrrp_buffer = MALLOC(len);
+	vrrp_buffer = MALLOC(len * VRRP_RX_BATCH);
 	vrrp_buffer_len = (vrrp_buffer) ? len : 0;
 }
 
@@ -1247,15 +1248,25 @@ free_vrrp_data(vrrp_data_t * data)
 	free_iprule_list(&data->static_rules);
 	free_static_track_groups_list(&data->static_track_groups);
 	free_sync_group_list(&data->vrrp_sync_group);
+	str_map_free(&data->vrrp_sync_group_names);
 	free_vscript_list(&data->vrrp_script);
+	str_map_free(&data->vrrp_script_names);
 	free_track_file_list(&data->vrrp_track_files);
+	str_map_free(&data->vrrp_track_file_names);
 #ifdef _WITH_TRACK_PROCESS_
 	free_vprocess_list(&data->vrrp_track_processes);
+	str_map_free(&data->vrrp_track_process_names);
 #endif
 #ifdef _WITH_BFD_
 	free_vrrp_tracked_bfd_list(&data->vrrp_track_bfds);
+	str_map_free(&data->vrrp_track_bfd_names);
 #endif
+	vrrp_index_free(&data->vrrp_index);
+	vip_index_free(&data->vip_index);
+	route_index_free(&data->route_index);
+	rule_index_free(&data->rule_index);
 	free_vrrp_list(&data->vrrp);
+	str_map_free(&data->vrrp_names);
 	FREE(data);
 }
 
@@ -852,7 +852,7 @@ handle_dbus_msg(__attribute__((unused)) thread_ref_t thread)
 			log_message(LOG_INFO, "Write from main thread to DBus thread failed");
 	}
 
-	thread_add_read(master, handle_dbus_msg, NULL, dbus_in_pipe[0], TIMER_NEVER, 0);
+	thread_add_read(master, handle_dbus_msg, NULL, dbus_in_pipe[0], TIMER_NEVER, THREAD_BACKGROUND);
 }
 
 void
@@ -918,7 +918,7 @@ dbus_reload(const list_head_t *o, const list_head_t *n)
 	dbus_send_reload_signal();
 
 	/* We need to reinstate the read thread */
-	thread_add_read(master, handle_dbus_msg, NULL, dbus_in_pipe[0], TIMER_NEVER, 0);
+	thread_add_read(master, handle_dbus_msg, NULL, dbus_in_pipe[0], TIMER_NEVER, THREAD_BACKGROUND);
 }
 
 static bool
@@ -986,7 +986,7 @@ dbus_start(void)
 	    fcntl(dbus_out_pipe[0], F_SETFL, flags & ~O_NONBLOCK) == -1)
 		log_message(LOG_INFO, "Unable to set dbus thread out_pipe blocking - (%d - %m)", errno);
 
-	thread_add_read(master, handle_dbus_msg, NULL, dbus_in_pipe[0], TIMER_NEVER, 0);
+	thread_add_read(master, handle_dbus_msg, NULL, dbus_in_pipe[0], TIMER_NEVER, THREAD_BACKGROUND);
 
 	/* Initialise the thread termination semaphore */
 	sem_init(&thread_end, 0, 0);
@@ -1073,6 +1073,13 @@ dbus_stop(void)
 	dbus_out_pipe[0] = -1;
 }
 
+/* DBus requests can wait while VRRP timers are about to expire */
+void
+vrrp_dbus_add_deferrable(thread_master_t *m)
+{
+	thread_add_deferrable(m, handle_dbus_msg);
+}
+
 #ifdef THREAD_DUMP
 void
 register_vrrp_dbus_addresses(void)
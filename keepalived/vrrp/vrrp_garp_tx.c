@@ -0,0 +1,461 @@
+/*
+ * Soft:        Keepalived is a failover program for the LVS project
+ *              <www.linuxvirtualserver.org>. It monitor & manipulate
+ *              a loadbalanced server pool using multi-layer checks.
+ *
+ * Part:        Gratuitous ARP and unsolicited NA transmission. Frames are
+ *              queued and sent in bulk, through a PACKET_TX_RING if the
+ *              kernel provides one, otherwise by sendmmsg().
+ *
+ * Author:      Alexandre Cassen, <acassen@linux-vs.org>
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *              See the GNU General Public License for more details.
+ *
+ *              This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU General Public License
+ *              as published by the Free Software Foundation; either version
+ *              2 of the License, or (at your option) any later version.
+ *
+ * Copyright (C) 2001-2017 Alexandre Cassen, <acassen@gmail.com>
+ */
+
+#include "config.h"
+
+/* system includes */
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <inttypes.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <linux/if_packet.h>
+
+/* local includes */
+#include "vrrp_garp_tx.h"
+#include "logger.h"
+#include "memory.h"
+#include "list_head.h"
+#include "timer.h"
+#include "utils.h"
+#include "bitops.h"
+
+/* Number of frames sent by one sendmmsg() call */
+#define GARP_TX_BATCH		64
+
+#ifdef PACKET_TX_RING
+/* The transmit ring uses TPACKET_V2 frames. Without PACKET_TX_HAS_OFF the
+ * kernel expects the frame data to follow the aligned tpacket2_hdr. */
+#define GARP_TX_RING_FRAMES	256
+#define GARP_TX_RING_FRAME_SIZE	256
+#define GARP_TX_RING_DATA_OFF	TPACKET_ALIGN(sizeof(struct tpacket2_hdr))
+#define GARP_TX_RING_WAIT	10		/* 100us waits for a frame to be free */
+#endif
+
+typedef struct _garp_tx_msg {
+	struct sockaddr_large_ll sll;
+	char			addr_str[INET6_ADDRSTRLEN];
+	char			data[GARP_FRAME_MAX];
+} garp_tx_msg_t;
+
+struct _garp_tx {
+	int			fd;
+	const char		*name;		/* "ARP" or "NA" */
+	unsigned		count;		/* frames queued */
+
+#ifdef PACKET_TX_RING
+	char			*ring;
+	size_t			ring_size;
+	unsigned		frame_num;
+	unsigned		head;		/* next frame to fill */
+	unsigned		first;		/* first queued frame */
+	struct sockaddr_large_ll sll;	/* destination of the queued frames */
+	bool			stalled;	/* no free frame, drop until the batch closes */
+#endif
+
+	/* sendmmsg() */
+	struct mmsghdr		*msgs;
+	struct iovec		*iovs;
+	garp_tx_msg_t		*bufs;
+
+	/* Statistics */
+	uint64_t		frames_sent;
+	uint64_t		frames_dropped;
+	uint64_t		send_calls;
+	uint64_t		send_time;	/* usecs spent in send calls */
+	unsigned		max_burst;
+
+	/* linked list member */
+	list_head_t		e_list;
+};
+
+static LIST_HEAD_INITIALIZE(garp_tx_list);
+static unsigned garp_tx_depth;		/* nesting of garp_tx_batch_open() */
+
+static const char *
+garp_tx_ifname(int ifindex)
+{
+	interface_t *ifp = if_get_by_ifindex((ifindex_t)ifindex);
+
+	return ifp ? IF_NAME(ifp) : "unknown interface";
+}
+
+static void
+garp_tx_account(garp_tx_t *tx, timeval_t start, unsigned frames)
+{
+	tx->send_calls++;
+	tx->send_time += timer_long(timer_sub_now(start));
+
+	if (frames > tx->max_burst)
+		tx->max_burst = frames;
+}
+
+#ifdef PACKET_TX_RING
+static inline struct tpacket2_hdr *
+garp_tx_ring_frame(const garp_tx_t *tx, unsigned idx)
+{
+	return PTR_CAST(struct tpacket2_hdr, tx->ring + (size_t)idx * GARP_TX_RING_FRAME_SIZE);
+}
+
+static inline uint32_t
+garp_tx_ring_status(const struct tpacket2_hdr *hdr)
+{
+	return __atomic_load_n(&hdr->tp_status, __ATOMIC_ACQUIRE);
+}
+
+static bool
+garp_tx_ring_setup(garp_tx_t *tx)
+{
+	struct tpacket_req req = { .tp_frame_size = GARP_TX_RING_FRAME_SIZE };
+	long page_size = sysconf(_SC_PAGESIZE);
+	unsigned frames_per_block;
+	int val;
+
+	if (page_size < GARP_TX_RING_FRAME_SIZE)
+		return false;
+
+	val = TPACKET_V2;
+	if (setsockopt(tx->fd, SOL_PACKET, PACKET_VERSION, &val, sizeof(val)) < 0)
+		return false;
+
+	/* Skip any frame the kernel can't send, rather than stopping there */
+	val = 1;
+	if (setsockopt(tx->fd, SOL_PACKET, PACKET_LOSS, &val, sizeof(val)) < 0)
+		return false;
+
+	/* The blocks are mapped contiguously, and the frames fill each block */
+	frames_per_block = (unsigned)page_size / GARP_TX_RING_FRAME_SIZE;
+	req.tp_block_size = (unsigned)page_size;
+	req.tp_block_nr = (GARP_TX_RING_FRAMES + frames_per_block - 1) / frames_per_block;
+	req.tp_frame_nr = req.tp_block_nr * frames_per_block;
+
+	if (setsockopt(tx->fd, SOL_PACKET, PACKET_TX_RING, &req, sizeof(req)) < 0)
+		return false;
+
+	tx->ring_size = (size_t)req.tp_block_size * req.tp_block_nr;
+	tx->ring = mmap(NULL, tx->ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, tx->fd, 0);
+	if (tx->ring == MAP_FAILED) {
+		/* Once a socket has a ring, all sends go through it */
+		memset(&req, 0, sizeof(req));
+		setsockopt(tx->fd, SOL_PACKET, PACKET_TX_RING, &req, sizeof(req));
+		tx->ring = NULL;
+		return false;
+	}
+
+	tx->frame_num = req.tp_frame_nr;
+
+	return true;
+}
+
+/* Send all the queued frames with one call. The kernel leaves any frames
+ * it did not send as TP_STATUS_SEND_REQUEST, and the first of those is
+ * where it will start next time, so we carry on filling from there. */
+static void
+garp_tx_ring_flush(garp_tx_t *tx)
+{
+	struct tpacket2_hdr *hdr;
+	unsigned i, idx, unsent = 0;
+	timeval_t start;
+	ssize_t ret;
+	int err;
+
+	start = timer_now();
+	ret = sendto(tx->fd, NULL, 0, 0, PTR_CAST(struct sockaddr, &tx->sll), sizeof(tx->sll));
+	err = errno;
+	garp_tx_account(tx, start, tx->count);
+
+	for (i = 0, idx = tx->first; i < tx->count; i++, idx = (idx + 1) % tx->frame_num) {
+		hdr = garp_tx_ring_frame(tx, idx);
+		if (garp_tx_ring_status(hdr) != TP_STATUS_SEND_REQUEST)
+			continue;
+
+		if (!unsent++)
+			tx->head = idx;
+		__atomic_store_n(&hdr->tp_status, TP_STATUS_AVAILABLE, __ATOMIC_RELEASE);
+	}
+
+	tx->frames_sent += tx->count - unsent;
+	tx->frames_dropped += unsent;
+
+	if (unsent) {
+		errno = ret < 0 ? err : 0;
+		log_message(LOG_INFO, "Error %d (%m) sending %u gratuitous %ss on %s", errno,
+			    unsent, tx->name, garp_tx_ifname(tx->sll.sll_ifindex));
+	}
+
+	tx->count = 0;
+}
+
+/* A frame can still be being sent from an earlier batch, but not for long */
+static bool
+garp_tx_ring_wait(const struct tpacket2_hdr *hdr)
+{
+	unsigned i;
+
+	for (i = 0; i < GARP_TX_RING_WAIT; i++) {
+		usleep(100);
+		if (garp_tx_ring_status(hdr) == TP_STATUS_AVAILABLE)
+			return true;
+	}
+
+	return false;
+}
+
+static ssize_t
+garp_tx_ring_queue(garp_tx_t *tx, const garp_frame_t *frame)
+{
+	struct tpacket2_hdr *hdr;
+
+	/* All the frames sent together go to the same interface */
+	if (tx->count &&
+	    (tx->sll.sll_ifindex != frame->sll.sll_ifindex || tx->count == tx->frame_num))
+		garp_tx_ring_flush(tx);
+
+	if (tx->stalled) {
+		tx->frames_dropped++;
+		return -1;
+	}
+
+	hdr = garp_tx_ring_frame(tx, tx->head);
+	if (garp_tx_ring_status(hdr) != TP_STATUS_AVAILABLE) {
+		if (tx->count) {
+			garp_tx_ring_flush(tx);
+			hdr = garp_tx_ring_frame(tx, tx->head);
+		}
+
+		if (garp_tx_ring_status(hdr) != TP_STATUS_AVAILABLE &&
+		    !garp_tx_ring_wait(hdr)) {
+			log_message(LOG_INFO, "gratuitous %s transmit ring is full - dropping frames", tx->name);
+			tx->stalled = true;
+			tx->frames_dropped++;
+			return -1;
+		}
+	}
+
+	memcpy(PTR_CAST(char, hdr) + GARP_TX_RING_DATA_OFF, frame->data, frame->len);
+	hdr->tp_len = (uint32_t)frame->len;
+	__atomic_store_n(&hdr->tp_status, TP_STATUS_SEND_REQUEST, __ATOMIC_RELEASE);
+
+	if (!tx->count++) {
+		tx->first = tx->head;
+		tx->sll = frame->sll;
+	}
+	tx->head = (tx->head + 1) % tx->frame_num;
+
+	return (ssize_t)frame->len;
+}
+#endif
+
+static void
+garp_tx_mmsg_flush(garp_tx_t *tx)
+{
+	const garp_tx_msg_t *msg;
+	unsigned sent = 0;
+	timeval_t start;
+	int ret;
+
+	while (sent < tx->count) {
+		start = timer_now();
+		ret = sendmmsg(tx->fd, &tx->msgs[sent], tx->count - sent, 0);
+		garp_tx_account(tx, start, tx->count - sent);
+		if (ret > 0) {
+			sent += (unsigned)ret;
+			tx->frames_sent += (unsigned)ret;
+			continue;
+		}
+
+		/* Sending the first unsent frame failed */
+		msg = &tx->bufs[sent++];
+		tx->frames_dropped++;
+		/* coverity[bad_printf_format_string] */
+		log_message(LOG_INFO, "Error %d (%m) sending gratuitous %s on %s for %s", errno,
+			    tx->name, garp_tx_ifname(msg->sll.sll_ifindex), msg->addr_str);
+	}
+
+	tx->count = 0;
+}
+
+static ssize_t
+garp_tx_mmsg_queue(garp_tx_t *tx, const garp_frame_t *frame)
+{
+	garp_tx_msg_t *msg;
+
+	if (tx->count == GARP_TX_BATCH)
+		garp_tx_mmsg_flush(tx);
+
+	msg = &tx->bufs[tx->count];
+	msg->sll = frame->sll;
+	strcpy(msg->addr_str, frame->addr_str);
+	memcpy(msg->data, frame->data, frame->len);
+	tx->iovs[tx->count].iov_len = frame->len;
+	tx->count++;
+
+	return (ssize_t)frame->len;
+}
+
+/* Send anything queued, and allow sending again after a stall */
+static void
+garp_tx_complete(garp_tx_t *tx)
+{
+#ifdef PACKET_TX_RING
+	if (tx->ring) {
+		if (tx->count)
+			garp_tx_ring_flush(tx);
+		tx->stalled = false;
+		return;
+	}
+#endif
+
+	if (tx->count)
+		garp_tx_mmsg_flush(tx);
+}
+
+/* Queue a frame, or send it if no batch is open. The frame is copied, so
+ * it may be changed or freed once this returns. */
+ssize_t
+garp_tx_queue(garp_tx_t *tx, const garp_frame_t *frame)
+{
+	ssize_t len;
+
+	if (__test_bit(LOG_DETAIL_BIT, &debug))
+		log_message(LOG_INFO, "Sending gratuitous %s on %s for %s",
+			    tx->name, garp_tx_ifname(frame->sll.sll_ifindex), frame->addr_str);
+
+#ifdef PACKET_TX_RING
+	if (tx->ring)
+		len = garp_tx_ring_queue(tx, frame);
+	else
+#endif
+		len = garp_tx_mmsg_queue(tx, frame);
+
+	if (!garp_tx_depth)
+		garp_tx_complete(tx);
+
+	return len;
+}
+
+/* Frames queued while a batch is open are sent when the outermost batch
+ * is closed */
+void
+garp_tx_batch_open(void)
+{
+	garp_tx_depth++;
+}
+
+void
+garp_tx_batch_close(void)
+{
+	garp_tx_t *tx;
+
+	if (--garp_tx_depth)
+		return;
+
+	list_for_each_entry(tx, &garp_tx_list, e_list)
+		garp_tx_complete(tx);
+}
+
+garp_tx_t *
+garp_tx_open(int fd, const char *name)
+{
+	garp_tx_t *tx;
+	unsigned i;
+
+	PMALLOC(tx);
+	INIT_LIST_HEAD(&tx->e_list);
+	tx->fd = fd;
+	tx->name = name;
+
+#ifdef PACKET_TX_RING
+	if (garp_tx_ring_setup(tx)) {
+		if (__test_bit(LOG_DETAIL_BIT, &debug))
+			log_message(LOG_INFO, "Using a %u frame transmit ring for gratuitous %ss", tx->frame_num, name);
+		list_add_tail(&tx->e_list, &garp_tx_list);
+		return tx;
+	}
+#endif
+
+	tx->msgs = MALLOC(GARP_TX_BATCH * sizeof(*tx->msgs));
+	tx->iovs = MALLOC(GARP_TX_BATCH * sizeof(*tx->iovs));
+	tx->bufs = MALLOC(GARP_TX_BATCH * sizeof(*tx->bufs));
+	for (i = 0; i < GARP_TX_BATCH; i++) {
+		tx->iovs[i].iov_base = tx->bufs[i].data;
+		tx->msgs[i].msg_hdr.msg_iov = &tx->iovs[i];
+		tx->msgs[i].msg_hdr.msg_iovlen = 1;
+		tx->msgs[i].msg_hdr.msg_name = &tx->bufs[i].sll;
+		tx->msgs[i].msg_hdr.msg_namelen = sizeof(tx->bufs[i].sll);
+	}
+
+	list_add_tail(&tx->e_list, &garp_tx_list);
+
+	return tx;
+}
+
+/* Any frames still queued are discarded. The caller closes the socket. */
+void
+garp_tx_close(garp_tx_t *tx)
+{
+#ifdef PACKET_TX_RING
+	if (tx->ring)
+		munmap(tx->ring, tx->ring_size);
+#endif
+
+	FREE_PTR(tx->msgs);
+	FREE_PTR(tx->iovs);
+	FREE_PTR(tx->bufs);
+
+	list_del_init(&tx->e_list);
+	FREE(tx);
+}
+
+void
+garp_tx_print_stats(FILE *fp, bool clear_stats)
+{
+	garp_tx_t *tx;
+
+	if (list_empty(&garp_tx_list))
+		return;
+
+	fprintf(fp, "Gratuitous ARP/NA:\n");
+	list_for_each_entry(tx, &garp_tx_list, e_list) {
+		fprintf(fp, "  %s socket:\n", tx->name);
+#ifdef PACKET_TX_RING
+		fprintf(fp, "    Transmit method: %s\n", tx->ring ? "PACKET_TX_RING" : "sendmmsg");
+#else
+		fprintf(fp, "    Transmit method: sendmmsg\n");
+#endif
+		fprintf(fp, "    Frames sent: %" PRIu64 "\n", tx->frames_sent);
+		fprintf(fp, "    Frames dropped: %" PRIu64 "\n", tx->frames_dropped);
+		fprintf(fp, "    Send calls: %" PRIu64 "\n", tx->send_calls);
+		fprintf(fp, "    Largest burst: %u\n", tx->max_burst);
+		fprintf(fp, "    Time sending (usecs): %" PRIu64 "\n", tx->send_time);
+		fprintf(fp, "    Frames per second: %" PRIu64 "\n",
+			tx->send_time ? tx->frames_sent * TIMER_HZ / tx->send_time : 0);
+
+		if (clear_stats) {
+			tx->frames_sent = tx->frames_dropped = tx->send_calls = tx->send_time = 0;
+			tx->max_burst = 0;
+		}
+	}
+}
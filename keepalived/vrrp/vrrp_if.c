@@ -83,13 +83,124 @@ static LIST_HEAD_INITIALIZE(old_garp_delay);
 /* Global vars */
 LIST_HEAD_INITIALIZE(garp_delay);
 
+/* The interfaces in if_queue are also hashed by ifindex, name and hardware
+ * address, since on hosts with many interfaces walking if_queue for every
+ * netlink message is too slow. All three tables have the same number of
+ * chains, which is doubled as interfaces are added to keep the chains short.
+ * Interfaces with ifindex 0 (not currently existing) are not hashed by ifindex. */
+static struct {
+	hlist_head_t	*ifindex;
+	hlist_head_t	*ifname;
+	hlist_head_t	*hw_addr;
+	unsigned	hash_mask;
+	unsigned	num_if;
+} if_index;
+
+static inline uint32_t
+if_ifindex_hash(ifindex_t ifindex)
+{
+	return hash_mix32(ifindex) & if_index.hash_mask;
+}
+
+static inline uint32_t __attribute__ ((pure))
+if_ifname_hash(const char *ifname)
+{
+	return str_hash(ifname) & if_index.hash_mask;
+}
+
+static inline uint32_t
+if_hw_addr_hash(const u_char *hw_addr)
+{
+	uint32_t a;
+	uint16_t b;
+
+	memcpy(&a, hw_addr, sizeof(a));
+	memcpy(&b, hw_addr + sizeof(a), sizeof(b));
+
+	return hash_mix32(a ^ b) & if_index.hash_mask;
+}
+
+static void
+if_hash(interface_t *ifp)
+{
+	if (ifp->ifindex)
+		hlist_add_head(&ifp->ifindex_hnode, &if_index.ifindex[if_ifindex_hash(ifp->ifindex)]);
+	hlist_add_head(&ifp->ifname_hnode, &if_index.ifname[if_ifname_hash(ifp->ifname)]);
+	hlist_add_head(&ifp->hw_addr_hnode, &if_index.hw_addr[if_hw_addr_hash(ifp->hw_addr)]);
+}
+
+void
+if_unhash(interface_t *ifp)
+{
+	hlist_del_init(&ifp->ifindex_hnode);
+	hlist_del_init(&ifp->ifname_hnode);
+	hlist_del_init(&ifp->hw_addr_hnode);
+}
+
+/* This must be called whenever the ifindex, name or hardware address of an
+ * interface is changed. */
+void
+if_rehash(interface_t *ifp)
+{
+	if_unhash(ifp);
+	if_hash(ifp);
+}
+
+static void
+if_index_resize(unsigned num_chains)
+{
+	interface_t *ifp;
+	unsigned i;
+
+	FREE_PTR(if_index.ifindex);
+	FREE_PTR(if_index.ifname);
+	FREE_PTR(if_index.hw_addr);
+
+	if_index.ifindex = MALLOC(num_chains * sizeof(*if_index.ifindex));
+	if_index.ifname = MALLOC(num_chains * sizeof(*if_index.ifname));
+	if_index.hw_addr = MALLOC(num_chains * sizeof(*if_index.hw_addr));
+	for (i = 0; i < num_chains; i++) {
+		INIT_HLIST_HEAD(&if_index.ifindex[i]);
+		INIT_HLIST_HEAD(&if_index.ifname[i]);
+		INIT_HLIST_HEAD(&if_index.hw_addr[i]);
+	}
+	if_index.hash_mask = num_chains - 1;
+
+	list_for_each_entry(ifp, &if_queue, e_list) {
+		INIT_HLIST_NODE(&ifp->ifindex_hnode);
+		INIT_HLIST_NODE(&ifp->ifname_hnode);
+		INIT_HLIST_NODE(&ifp->hw_addr_hnode);
+		if_hash(ifp);
+	}
+}
+
+static void
+if_index_free(void)
+{
+	FREE_PTR(if_index.ifindex);
+	FREE_PTR(if_index.ifname);
+	FREE_PTR(if_index.hw_addr);
+	if_index.hash_mask = 0;
+	if_index.num_if = 0;
+}
+
 /* Helper functions */
 interface_t * __attribute__ ((pure))
 if_get_by_ifindex(ifindex_t ifindex)
 {
 	interface_t *ifp;
+	hlist_node_t *n;
 
-	list_for_each_entry(ifp, &if_queue, e_list) {
+	if (!ifindex || !if_index.ifindex) {
+		list_for_each_entry(ifp, &if_queue, e_list) {
+			if (ifp->ifindex == ifindex)
+				return ifp;
+		}
+
+		return NULL;
+	}
+
+	hlist_for_each_entry(ifp, n, &if_index.ifindex[if_ifindex_hash(ifindex)], ifindex_hnode) {
 		if (ifp->ifindex == ifindex)
 			return ifp;
 	}
@@ -102,24 +213,26 @@ interface_t * __attribute__ ((pure))
 if_get_by_vmac(uint8_t vrid, int family, const interface_t *base_ifp, const u_char hw_addr[ETH_ALEN])
 {
 	interface_t *ifp;
+	hlist_node_t *n;
+	u_char vrrp_hw_addr[ETH_ALEN] = { 0x00, 0x00, 0x5e, 0x00 };
 
-	list_for_each_entry(ifp, &if_queue, e_list) {
+	if (!if_index.hw_addr)
+		return NULL;
+
+	/* Without a specified address, look for the VRRP virtual router MAC address */
+	if (!hw_addr) {
+		vrrp_hw_addr[4] = family == AF_INET ? 0x01 : 0x02;
+		vrrp_hw_addr[5] = vrid;
+		hw_addr = vrrp_hw_addr;
+	}
+
+	hlist_for_each_entry(ifp, n, &if_index.hw_addr[if_hw_addr_hash(hw_addr)], hw_addr_hnode) {
 		if (ifp->if_type != IF_TYPE_MACVLAN || ifp->vmac_type !=  MACVLAN_MODE_PRIVATE)
 			continue;
 		if (ifp->base_ifp != base_ifp)
 			continue;
-		if (hw_addr) {
-		       if (memcmp(ifp->hw_addr, hw_addr, ETH_ALEN))
-			       continue;
-		} else {
-			if (ifp->hw_addr[0] || ifp->hw_addr[1] || ifp->hw_addr[2] != 0x5e || ifp->hw_addr[3])
-				continue;
-			if ((family == AF_INET && ifp->hw_addr[4] != 0x01) ||
-			    (family == AF_INET6 && ifp->hw_addr[4] != 0x02))
-				continue;
-			if (ifp->hw_addr[5] != vrid)
-				continue;
-		}
+		if (memcmp(ifp->hw_addr, hw_addr, ETH_ALEN))
+			continue;
 
 		ifp->is_ours = true;
 
@@ -194,10 +307,13 @@ interface_t *
 if_get_by_ifname(const char *ifname, if_lookup_t create)
 {
 	interface_t *ifp;
+	hlist_node_t *n;
 
-	list_for_each_entry(ifp, &if_queue, e_list) {
-		if (!strcmp(ifp->ifname, ifname))
-			return create == IF_CREATE_NOT_EXIST ? NULL : ifp;
+	if (if_index.ifname) {
+		hlist_for_each_entry(ifp, n, &if_index.ifname[if_ifname_hash(ifname)], ifname_hnode) {
+			if (!strcmp(ifp->ifname, ifname))
+				return create == IF_CREATE_NOT_EXIST ? NULL : ifp;
+		}
 	}
 
 	if (create == IF_NO_CREATE ||
@@ -221,6 +337,12 @@ if_get_by_ifname(const char *ifname, if_lookup_t create)
 	INIT_LIST_HEAD(&ifp->e_list);
 	list_add_tail(&ifp->e_list, &if_queue);
 
+	/* Keep the hash chains short */
+	if (++if_index.num_if > if_index.hash_mask)
+		if_index_resize(if_index.hash_mask ? (if_index.hash_mask + 1) << 1 : 16);
+	else
+		if_hash(ifp);
+
 	if (create == IF_CREATE_IF_DYNAMIC)
 		log_message(LOG_INFO, "Configuration specifies interface %s which doesn't currently exist - will use if created", ifname);
 
@@ -395,6 +517,14 @@ if_ioctl_flags(const int fd, interface_t *ifp)
 void
 free_garp_delay(garp_delay_t *gd)
 {
+	ip_address_t *ip_addr, *ip_addr_tmp;
+
+	/* The addresses may outlive the garp_delay on a reload */
+	list_for_each_entry_safe(ip_addr, ip_addr_tmp, &gd->refresh_queue, refresh_list) {
+		ip_addr->garp_refresh_rep = 0;
+		list_del_init(&ip_addr->refresh_list);
+	}
+
 	list_del_init(&gd->e_list);
 	FREE(gd);
 }
@@ -428,9 +558,14 @@ dump_garp_delay(FILE *fp, const garp_delay_t *gd)
 			strcpy(time_str, "invalid time ");
 		conf_write(fp, " GNA next time %ld.%6.6ld (%.19s.%6.6ld)", gd->gna_next_time.tv_sec, gd->gna_next_time.tv_usec, time_str, gd->gna_next_time.tv_usec);
 	}
-	else if (!gd->have_garp_interval)
+	else if (!gd->have_garp_interval && !gd->refresh_pps)
 		conf_write(fp, " No configuration");
 
+	if (gd->refresh_rate)
+		conf_write(fp, " Refresh rate limit = %u/s", gd->refresh_rate);
+	if (gd->refresh_pps)
+		conf_write(fp, " Refresh rate = %u/s", gd->refresh_pps);
+
 	conf_write(fp, " Interfaces");
 	list_for_each_entry(ifp, &if_queue, e_list) {
 		if (ifp->garp_delay == gd)
@@ -453,6 +588,7 @@ alloc_garp_delay(void)
 
 	PMALLOC(gd);
 	INIT_LIST_HEAD(&gd->e_list);
+	INIT_LIST_HEAD(&gd->refresh_queue);
 
 	list_add_tail(&gd->e_list, &garp_delay);
 	return gd;
@@ -467,6 +603,71 @@ set_garp_delay(interface_t *ifp, const garp_delay_t *delay)
 	ifp->garp_delay->have_garp_interval = delay->have_garp_interval;
 	ifp->garp_delay->gna_interval = delay->gna_interval;
 	ifp->garp_delay->have_gna_interval = delay->have_gna_interval;
+	ifp->garp_delay->refresh_rate = delay->refresh_rate;
+}
+
+/* Work out the rate each garp_delay needs to send refresh messages at for
+ * them to be spread evenly over the refresh intervals of the instances
+ * using it, limited by any configured refresh rate. */
+static void
+set_garp_refresh_pps(void)
+{
+	vrrp_t *vrrp;
+	list_head_t *vip_list;
+	ip_address_t *vip;
+	garp_delay_t *gd;
+	interface_t *ifp;
+	const char *ifname;
+	unsigned long refresh;
+
+	/* refresh_tokens is used to accumulate the load, in messages per second * TIMER_HZ */
+	list_for_each_entry(gd, &garp_delay, e_list)
+		gd->refresh_tokens = 0;
+
+	list_for_each_entry(vrrp, &vrrp_data->vrrp, e_list) {
+		if (!timerisset(&vrrp->garp_refresh))
+			continue;
+
+		refresh = timer_long(vrrp->garp_refresh);
+		for (vip_list = &vrrp->vip; vip_list; vip_list = vip_list == &vrrp->vip ? &vrrp->evip : NULL) {
+			list_for_each_entry(vip, vip_list, e_list) {
+				if ((gd = IF_BASE_IFP(vip->ifp)->garp_delay))
+					gd->refresh_tokens += (int64_t)vrrp->garp_refresh_rep * TIMER_HZ * TIMER_HZ / refresh;
+			}
+		}
+	}
+
+	list_for_each_entry(gd, &garp_delay, e_list) {
+		if (!gd->refresh_tokens) {
+			gd->refresh_pps = 0;
+			continue;
+		}
+
+		gd->refresh_pps = (unsigned)((gd->refresh_tokens + TIMER_HZ - 1) / TIMER_HZ);
+		if (gd->refresh_rate && gd->refresh_pps > gd->refresh_rate) {
+			if (gd->aggregation_group)
+				log_message(LOG_INFO, "garp refresh rate %u/s for garp group %d is less than the %u/s needed"
+						      " - refresh messages will be delayed",
+						      gd->refresh_rate, gd->aggregation_group, gd->refresh_pps);
+			else {
+				ifname = "unknown interface";
+				list_for_each_entry(ifp, &if_queue, e_list) {
+					if (ifp->garp_delay == gd) {
+						ifname = ifp->ifname;
+						break;
+					}
+				}
+				log_message(LOG_INFO, "garp refresh rate %u/s on %s is less than the %u/s needed"
+						      " - refresh messages will be delayed",
+						      gd->refresh_rate, ifname, gd->refresh_pps);
+			}
+			gd->refresh_pps = gd->refresh_rate;
+		}
+
+		/* Start with a full bucket */
+		gd->refresh_tokens_time.tv_sec = 0;
+		garp_refresh_fill(gd);
+	}
 }
 
 void
@@ -488,15 +689,21 @@ set_default_garp_delay(void)
 		default_delay.gna_interval.tv_usec = global_data->vrrp_gna_interval % 1000000;
 		default_delay.have_gna_interval = true;
 	}
+	default_delay.refresh_rate = global_data->vrrp_garp_refresh_rate;
 
 	/* Allocate a delay structure to each physical interface that doesn't have one and
-	 * is being used by a VRRP instance */
+	 * is being used by a VRRP instance. Refresh messages are paced by the garp_delay,
+	 * so instances that refresh need one even without a global delay. */
 	list_for_each_entry(vrrp, &vrrp_data->vrrp, e_list) {
-		if (!vrrp->ifp)
+		if (!default_delay.have_garp_interval &&
+		    !default_delay.have_gna_interval &&
+		    !timerisset(&vrrp->garp_refresh))
 			continue;
-		ifp = IF_BASE_IFP(vrrp->ifp);
-		if (!ifp->garp_delay)
-			set_garp_delay(ifp, &default_delay);
+		if (vrrp->ifp) {
+			ifp = IF_BASE_IFP(vrrp->ifp);
+			if (!ifp->garp_delay)
+				set_garp_delay(ifp, &default_delay);
+		}
 
 		/* We also need delays for any i/fs used by VIPs/eVIPs */
 		for (vip_list = &vrrp->vip; vip_list; vip_list = vip_list == &vrrp->vip ? &vrrp->evip : NULL) {
@@ -507,6 +714,54 @@ set_default_garp_delay(void)
 			}
 		}
 	}
+
+	set_garp_refresh_pps();
+}
+
+/* Add the tokens earned since the refresh token bucket was last updated.
+ * The bucket holds 1/GARP_REFRESH_BURST of a second's messages, so that at
+ * high rates the pacer can send a few messages each time it runs. */
+void
+garp_refresh_fill(garp_delay_t *gd)
+{
+	int64_t max_tokens;
+	timeval_t diff;
+	unsigned long elapsed;
+
+	if (!gd->refresh_pps)
+		return;
+
+	max_tokens = (int64_t)(gd->refresh_pps / GARP_REFRESH_BURST + 1) * TIMER_HZ;
+
+	if (!gd->refresh_tokens_time.tv_sec)
+		gd->refresh_tokens = max_tokens;
+	else if (timercmp(&time_now, &gd->refresh_tokens_time, >)) {
+		timersub(&time_now, &gd->refresh_tokens_time, &diff);
+		elapsed = timer_long(diff);
+		if (elapsed > 2 * TIMER_HZ)
+			elapsed = 2 * TIMER_HZ;
+		gd->refresh_tokens += (int64_t)elapsed * gd->refresh_pps;
+		if (gd->refresh_tokens > max_tokens)
+			gd->refresh_tokens = max_tokens;
+	}
+
+	gd->refresh_tokens_time = time_now;
+}
+
+/* Take a token for a gratuitous ARP/NA message sent on an interface. Messages sent
+ * on a transition aren't held back, but they can leave the bucket in debt by up to
+ * a second's worth of refresh messages. */
+void
+garp_refresh_charge(garp_delay_t *gd)
+{
+	if (!gd || !gd->refresh_pps)
+		return;
+
+	garp_refresh_fill(gd);
+
+	gd->refresh_tokens -= TIMER_HZ;
+	if (gd->refresh_tokens < -(int64_t)gd->refresh_pps * TIMER_HZ)
+		gd->refresh_tokens = -(int64_t)gd->refresh_pps * TIMER_HZ;
 }
 
 static void
@@ -869,6 +1124,8 @@ free_interface_queue(void)
 	list_for_each_entry_safe(ifp, ifp_tmp, &if_queue, e_list)
 		free_if(ifp);
 
+	if_index_free();
+
 	free_garp_delay_list(&garp_delay);
 }
 
@@ -1328,6 +1585,41 @@ if_setsockopt_no_receive(int *sd)
 	return *sd;
 }
 
+/* Only queue adverts for the vrids, which must be in ascending order, on
+ * the socket. For IPv4 the packet starts with the IP header, but for IPv6
+ * it starts with the VRRP header. */
+int
+if_setsockopt_vrid_filter(int sd, sa_family_t family, const uint8_t *vrids, unsigned num_vrids)
+{
+	struct sock_filter bpfcode[2 + 255 + 2];
+	struct sock_fprog bpf = { .filter = bpfcode };
+	unsigned i, n = 0;
+	int ret;
+
+	if (sd < 0 || !num_vrids || num_vrids > 255)
+		return -1;
+
+	if (family == AF_INET) {
+		bpfcode[n++] = (struct sock_filter)BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 0);	/* x = IP header length */
+		bpfcode[n++] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_B | BPF_IND, offsetof(vrrphdr_t, vrid));
+	} else
+		bpfcode[n++] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_B | BPF_ABS, offsetof(vrrphdr_t, vrid));
+
+	/* A vrid matching jumps to the accept statement after the reject statement */
+	for (i = 0; i < num_vrids; i++, n++)
+		bpfcode[n] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, vrids[i], (uint8_t)(num_vrids - i), 0);
+
+	bpfcode[n++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, 0);
+	bpfcode[n++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, UINT32_MAX);
+	bpf.len = (unsigned short)n;
+
+	ret = setsockopt(sd, SOL_SOCKET, SO_ATTACH_FILTER, &bpf, sizeof(bpf));
+	if (ret < 0)
+		log_message(LOG_INFO, "Can't set SO_ATTACH_FILTER option for VRIDs. errno=%d (%m)", errno);
+
+	return ret;
+}
+
 void
 interface_up(interface_t *ifp)
 {
@@ -1475,6 +1767,7 @@ cleanup_lost_interface(interface_t *ifp)
 	interface_down(ifp);
 
 	ifp->ifindex = 0;
+	if_rehash(ifp);
 	ifp->ifi_flags = 0;
 	ifp->seen_up = false;
 #ifdef _HAVE_VRRP_VMAC_
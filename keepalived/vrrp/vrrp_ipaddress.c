@@ -108,17 +108,21 @@ compare_ipaddress(const ip_address_t *X, const ip_address_t *Y)
 	return X->u.sin.sin_addr.s_addr != Y->u.sin.sin_addr.s_addr;
 }
 
-/* Add/Delete IP address to a specific interface_t */
-int
-netlink_ipaddress(ip_address_t *ip_addr, int cmd)
+typedef struct _ipaddress_req {
+	struct nlmsghdr n;
+	struct ifaddrmsg ifa;
+	char buf[256];
+} ipaddress_req_t;
+
+/* Number of addresses changed by a batch in netlink_iplist() */
+static unsigned iplist_changed;
+
+/* Build the request to add/delete an IP address. Returns 1 if the request
+ * is to be sent, or the result of netlink_ipaddress() if not. */
+static int
+netlink_ipaddress_req(ip_address_t *ip_addr, int cmd, ipaddress_req_t *req, int *error_ignore)
 {
 	struct ifa_cacheinfo cinfo;
-	int status = 1;
-	struct {
-		struct nlmsghdr n;
-		struct ifaddrmsg ifa;
-		char buf[256];
-	} req;
 #if HAVE_DECL_IFA_FLAGS
 	uint32_t ifa_flags = 0;
 #else
@@ -143,12 +147,12 @@ netlink_ipaddress(ip_address_t *ip_addr, int cmd)
 	else if (!ip_addr->ifa.ifa_index)
 		ip_addr->ifa.ifa_index = ip_addr->ifp->ifindex;
 
-	memset(&req, 0, sizeof (req));
+	memset(req, 0, sizeof(*req));
 
-	req.n.nlmsg_len = NLMSG_LENGTH(sizeof (struct ifaddrmsg));
-	req.n.nlmsg_flags = NLM_F_REQUEST;
-	req.n.nlmsg_type = (cmd == IPADDRESS_DEL) ? RTM_DELADDR : RTM_NEWADDR;
-	req.ifa = ip_addr->ifa;
+	req->n.nlmsg_len = NLMSG_LENGTH(sizeof (struct ifaddrmsg));
+	req->n.nlmsg_flags = NLM_F_REQUEST;
+	req->n.nlmsg_type = (cmd == IPADDRESS_DEL) ? RTM_DELADDR : RTM_NEWADDR;
+	req->ifa = ip_addr->ifa;
 
 	if (cmd == IPADDRESS_ADD)
 		ifa_flags = ip_addr->flags;
@@ -163,7 +167,7 @@ netlink_ipaddress(ip_address_t *ip_addr, int cmd)
 				cinfo.ifa_prefered = ip_addr->preferred_lft;
 				cinfo.ifa_valid = INFINITY_LIFE_TIME;
 
-				addattr_l(&req.n, sizeof(req), IFA_CACHEINFO, &cinfo, sizeof(cinfo));
+				addattr_l(&req->n, sizeof(*req), IFA_CACHEINFO, &cinfo, sizeof(cinfo));
 			}
 
 			/* Disable, per VIP, Duplicate Address Detection algorithm (DAD).
@@ -181,20 +185,20 @@ netlink_ipaddress(ip_address_t *ip_addr, int cmd)
 				ifa_flags |= IFA_F_NODAD;
 		}
 
-		addattr_l(&req.n, sizeof(req), IFA_LOCAL,
+		addattr_l(&req->n, sizeof(*req), IFA_LOCAL,
 			  &ip_addr->u.sin6_addr, sizeof(ip_addr->u.sin6_addr));
 	} else {
-		addattr_l(&req.n, sizeof(req), IFA_LOCAL,
+		addattr_l(&req->n, sizeof(*req), IFA_LOCAL,
 			  &ip_addr->u.sin.sin_addr, sizeof(ip_addr->u.sin.sin_addr));
 
 		if (cmd == IPADDRESS_ADD) {
 			if (ip_addr->u.sin.sin_brd.s_addr)
-				addattr_l(&req.n, sizeof(req), IFA_BROADCAST,
+				addattr_l(&req->n, sizeof(*req), IFA_BROADCAST,
 					  &ip_addr->u.sin.sin_brd, sizeof(ip_addr->u.sin.sin_brd));
 		}
 		else {
 			/* IPADDRESS_DEL */
-			addattr_l(&req.n, sizeof(req), IFA_ADDRESS,
+			addattr_l(&req->n, sizeof(*req), IFA_ADDRESS,
 				  &ip_addr->u.sin.sin_addr, sizeof(ip_addr->u.sin.sin_addr));
 		}
 	}
@@ -202,16 +206,16 @@ netlink_ipaddress(ip_address_t *ip_addr, int cmd)
 	if (cmd == IPADDRESS_ADD) {
 #if HAVE_DECL_IFA_FLAGS
 		if (ifa_flags)
-			addattr32(&req.n, sizeof(req), IFA_FLAGS, ifa_flags);
+			addattr32(&req->n, sizeof(*req), IFA_FLAGS, ifa_flags);
 #else
-		req.ifa.ifa_flags = ifa_flags;
+		req->ifa.ifa_flags = ifa_flags;
 #endif
 		if (ip_addr->label)
-			addattr_l(&req.n, sizeof (req), IFA_LABEL,
+			addattr_l(&req->n, sizeof(*req), IFA_LABEL,
 				  ip_addr->label, strlen(ip_addr->label) + 1);
 
 		if (ip_addr->have_peer)
-			addattr_l(&req.n, sizeof(req), IFA_ADDRESS, &ip_addr->peer, req.ifa.ifa_family == AF_INET6 ? 16 : 4);
+			addattr_l(&req->n, sizeof(*req), IFA_ADDRESS, &ip_addr->peer, req->ifa.ifa_family == AF_INET6 ? 16 : 4);
 	}
 
 	/* If the state of the interface or its parent is down, it might be because the interface
@@ -222,7 +226,23 @@ netlink_ipaddress(ip_address_t *ip_addr, int cmd)
 	     || ((IF_BASE_IFP(ip_addr->ifp)->ifi_flags & (IFF_UP | IFF_RUNNING)) != (IFF_UP | IFF_RUNNING))
 #endif
 													     ))
-		netlink_error_ignore = ENODEV;
+		*error_ignore = ENODEV;
+
+	return 1;
+}
+
+/* Add/Delete IP address to a specific interface_t */
+int
+netlink_ipaddress(ip_address_t *ip_addr, int cmd)
+{
+	ipaddress_req_t req;
+	int status;
+	int error_ignore = netlink_error_ignore;
+
+	if ((status = netlink_ipaddress_req(ip_addr, cmd, &req, &error_ignore)) <= 0)
+		return status;
+
+	netlink_error_ignore = error_ignore;
 	if (netlink_talk(&nl_cmd, &req.n) < 0)
 		status = -1;
 	netlink_error_ignore = 0;
@@ -230,12 +250,37 @@ netlink_ipaddress(ip_address_t *ip_addr, int cmd)
 	return status;
 }
 
-/* Add/Delete a list of IP addresses */
+static void
+netlink_iplist_add_done(void *arg, int error)
+{
+	ip_address_t *ip_addr = arg;
+
+	if (error)
+		ip_addr->set = false;
+	else
+		iplist_changed++;
+}
+
+static void
+netlink_iplist_del_done(__attribute__((unused)) void *arg, int error)
+{
+	if (!error)
+		iplist_changed++;
+}
+
+/* Add/Delete a list of IP addresses. The commands are sent in batches,
+ * so if a batch is already open the addresses are not changed, and the
+ * return value not known, until that batch is closed. ip_addr->set is
+ * updated when the command is queued, and cleared again if an add fails. */
 bool
 netlink_iplist(list_head_t *ip_list, int cmd, bool force)
 {
 	ip_address_t *ip_addr;
-	bool changed_entries = false;
+	ipaddress_req_t req;
+	int error_ignore;
+	unsigned changed_before = iplist_changed;
+
+	netlink_batch_open();
 
 	/*
 	 * If "--dont-release-vrrp" is set then try to release addresses
@@ -247,19 +292,21 @@ netlink_iplist(list_head_t *ip_list, int cmd, bool force)
 		     (force || ip_addr->set || __test_bit(DONT_RELEASE_VRRP_BIT, &debug)))) {
 			/* If we are removing addresses left over from previous run
 			 * and they don't exist, don't report an error */
-			if (force)
-				netlink_error_ignore = ENODEV;
+			error_ignore = force ? ENODEV : 0;
 
-			if (netlink_ipaddress(ip_addr, cmd) > 0) {
+			if (netlink_ipaddress_req(ip_addr, cmd, &req, &error_ignore) > 0) {
 				ip_addr->set = (cmd == IPADDRESS_ADD);
-				changed_entries = true;
-			}
-			else
+				netlink_batch_add(&req.n, error_ignore,
+						  cmd == IPADDRESS_ADD ? netlink_iplist_add_done : netlink_iplist_del_done,
+						  ip_addr);
+			} else
 				ip_addr->set = false;
 		}
 	}
 
-	return changed_entries;
+	netlink_batch_close();
+
+	return iplist_changed != changed_before;
 }
 
 /* IP address dump/allocation */
@@ -267,6 +314,9 @@ void
 free_ipaddress(ip_address_t *ip_addr)
 {
 	FREE_PTR(ip_addr->label);
+	FREE_PTR(ip_addr->garp_frame);
+	if (ip_addr->garp_refresh_rep)
+		list_del_init(&ip_addr->refresh_list);
 	list_del_init(&ip_addr->e_list);
 	FREE(ip_addr);
 }
@@ -723,11 +773,27 @@ alloc_ipaddress(const vector_t *strvec, bool static_addr)
 	return new;
 }
 
-/* Find an address in a list */
+/* Copy the state of an address being kept over a reload */
+static void
+copy_ipaddress_state(ip_address_t *ipaddr, const ip_address_t *ip_addr)
+{
+	ipaddr->set = ip_addr->set;
+#ifdef _WITH_IPTABLES_
+	ipaddr->iptable_rule_set = ip_addr->iptable_rule_set;
+#endif
+#ifdef _WITH_NFTABLES_
+	ipaddr->nftable_rule_set = ip_addr->nftable_rule_set;
+#endif
+	ipaddr->ifa.ifa_index = ip_addr->ifa.ifa_index;
+}
+
+/* Find an address in the VIPs or eVIPs of vrrp. If index is not NULL, vrrp
+ * is one of the instances it indexes, and the address is looked up in it. */
 static bool
-address_exist(vrrp_t *vrrp, ip_address_t *ip_addr)
+address_exist(vrrp_t *vrrp, const vip_index_t *index, ip_address_t *ip_addr)
 {
 	ip_address_t *ipaddr;
+	vip_index_entry_t *entry;
 	char addr_str[INET6_ADDRSTRLEN];
 	void *addr;
 	list_head_t *vip_list;
@@ -736,20 +802,22 @@ address_exist(vrrp_t *vrrp, ip_address_t *ip_addr)
 	if (!ip_addr)
 		return true;
 
-	for (vip_list = &vrrp->vip; vip_list; vip_list = vip_list == &vrrp->vip ? &vrrp->evip : NULL ) {
-		list_for_each_entry(ipaddr, vip_list, e_list) {
-			if (!compare_ipaddress(ipaddr, ip_addr)) {
-				ipaddr->set = ip_addr->set;
-#ifdef _WITH_IPTABLES_
-				ipaddr->iptable_rule_set = ip_addr->iptable_rule_set;
-#endif
-#ifdef _WITH_NFTABLES_
-				ipaddr->nftable_rule_set = ip_addr->nftable_rule_set;
-#endif
-				ipaddr->ifa.ifa_index = ip_addr->ifa.ifa_index;
+	if (index) {
+		vip_index_for_each_entry(entry, index, ip_addr->ifa.ifa_family, &ip_addr->u) {
+			if (entry->vrrp == vrrp && !compare_ipaddress(entry->ip_addr, ip_addr)) {
+				copy_ipaddress_state(entry->ip_addr, ip_addr);
 				return true;
 			}
 		}
+	} else {
+		for (vip_list = &vrrp->vip; vip_list; vip_list = vip_list == &vrrp->vip ? &vrrp->evip : NULL ) {
+			list_for_each_entry(ipaddr, vip_list, e_list) {
+				if (!compare_ipaddress(ipaddr, ip_addr)) {
+					copy_ipaddress_state(ipaddr, ip_addr);
+					return true;
+				}
+			}
+		}
 	}
 
 	addr = (IP_IS6(ip_addr)) ? (void *) &ip_addr->u.sin6_addr :
@@ -767,7 +835,7 @@ address_exist(vrrp_t *vrrp, ip_address_t *ip_addr)
 
 /* Clear diff addresses */
 void
-get_diff_address(vrrp_t *old, vrrp_t *new, list_head_t *old_addr)
+get_diff_address(vrrp_t *old, vrrp_t *new, const vip_index_t *index, list_head_t *old_addr)
 {
 	ip_address_t *ip_addr, *ip_addr_tmp;
 	list_head_t *vip_list;
@@ -778,7 +846,7 @@ get_diff_address(vrrp_t *old, vrrp_t *new, list_head_t *old_addr)
 
 	for (vip_list = &old->vip; vip_list; vip_list = vip_list == &old->vip ? &old->evip : NULL ) {
 		list_for_each_entry_safe(ip_addr, ip_addr_tmp, vip_list, e_list) {
-			if (ip_addr->set && !address_exist(new, ip_addr)) {
+			if (ip_addr->set && !address_exist(new, index, ip_addr)) {
 				list_del_init(&ip_addr->e_list);
 				list_add_tail(&ip_addr->e_list, old_addr);
 			}
@@ -806,26 +874,63 @@ clear_address_list(list_head_t *delete_addr,
 #endif
 }
 
-/* Clear static ip address */
-void
+/* Clear static ip address. Returns true if any were removed. */
+bool
 clear_diff_static_addresses(void)
 {
 	LIST_HEAD_INITIALIZE(remove_addr);
 	vrrp_t old = {};
 	vrrp_t new = {};
+	bool removed;
 
 	list_copy(&old.vip, &old_vrrp_data->static_addresses);
 	list_copy(&new.vip, &vrrp_data->static_addresses);
 	INIT_LIST_HEAD(&old.evip);
 	INIT_LIST_HEAD(&new.evip);
 
-	get_diff_address(&old, &new, &remove_addr);
+	get_diff_address(&old, &new, NULL, &remove_addr);
 
 	list_copy(&old_vrrp_data->static_addresses, &old.vip);
 	list_copy(&vrrp_data->static_addresses, &new.vip);
 
+	removed = !list_empty(&remove_addr);
 	clear_address_list(&remove_addr, false);
 	free_ipaddress_list(&remove_addr);
+
+	return removed;
+}
+
+/* Check if the addresses on list n are the same as those on list l, in the
+ * same order, and that each address on l is set if set is true, and not set
+ * otherwise, so that a reload has nothing to do for them. */
+bool
+ipaddress_list_same(list_head_t *l, list_head_t *n, bool set)
+{
+	ip_address_t *ip_addr;
+	ip_address_t *new_addr = list_first_entry(n, ip_address_t, e_list);
+
+	list_for_each_entry(ip_addr, l, e_list) {
+		if (&new_addr->e_list == n ||
+		    ip_addr->set != set ||
+		    compare_ipaddress(ip_addr, new_addr))
+			return false;
+		new_addr = list_entry(new_addr->e_list.next, ip_address_t, e_list);
+	}
+
+	return &new_addr->e_list == n;
+}
+
+/* Copy the state of the addresses on list l to the same addresses on list n */
+void
+ipaddress_list_copy_state(list_head_t *l, list_head_t *n)
+{
+	ip_address_t *ip_addr;
+	ip_address_t *new_addr = list_first_entry(n, ip_address_t, e_list);
+
+	list_for_each_entry(ip_addr, l, e_list) {
+		copy_ipaddress_state(new_addr, ip_addr);
+		new_addr = list_entry(new_addr->e_list.next, ip_address_t, e_list);
+	}
 }
 
 void reinstate_static_address(ip_address_t *ip_addr)
@@ -836,3 +941,128 @@ void reinstate_static_address(ip_address_t *ip_addr)
 	format_ipaddress(ip_addr, buf, sizeof(buf));
 	log_message(LOG_INFO, "Restoring deleted static address %s", buf);
 }
+
+/* VIP index */
+static inline bool
+vip_index_addr_equal(const ip_address_t *ip_addr, int family, const void *addr)
+{
+	if (ip_addr->ifa.ifa_family != family)
+		return false;
+
+	if (family == AF_INET)
+		return ip_addr->u.sin.sin_addr.s_addr == PTR_CAST_CONST(struct in_addr, addr)->s_addr;
+
+	return !memcmp(&ip_addr->u.sin6_addr, addr, sizeof(struct in6_addr));
+}
+
+static unsigned __attribute__ ((pure))
+vip_index_hash(const vip_index_t *index, int family, const void *addr)
+{
+	return inaddr_hash((sa_family_t)family, addr) & index->hash_mask;
+}
+
+static void
+vip_index_add(vip_index_t *index, vrrp_t *vrrp, ip_address_t *ip_addr, bool evip)
+{
+	vip_index_entry_t *entry;
+
+	PMALLOC(entry);
+	entry->vrrp = vrrp;
+	entry->ip_addr = ip_addr;
+	entry->evip = evip;
+
+	hlist_add_head(&entry->h_list, &index->hash[vip_index_hash(index, ip_addr->ifa.ifa_family, &ip_addr->u)]);
+	index->count++;
+}
+
+/* Build the index for the vrrp instances on list l. This must be done
+ * after the instances are completed, since that can move VIPs to the
+ * eVIPs, or remove them. The lists are walked backwards so that lookups
+ * see the VIPs, and then the eVIPs, of each instance in list order. */
+void
+vip_index_build(vip_index_t *index, list_head_t *l)
+{
+	vrrp_t *vrrp;
+	ip_address_t *ip_addr;
+	unsigned num_addr = 0;
+	unsigned num_chains = 16;
+	unsigned i;
+
+	vip_index_free(index);
+
+	list_for_each_entry(vrrp, l, e_list) {
+		list_for_each_entry(ip_addr, &vrrp->vip, e_list)
+			num_addr++;
+		list_for_each_entry(ip_addr, &vrrp->evip, e_list)
+			num_addr++;
+	}
+
+	/* Keep the chains short */
+	while (num_chains < num_addr)
+		num_chains <<= 1;
+
+	index->hash = MALLOC(num_chains * sizeof(*index->hash));
+	for (i = 0; i < num_chains; i++)
+		INIT_HLIST_HEAD(&index->hash[i]);
+	index->hash_mask = num_chains - 1;
+
+	list_for_each_entry_reverse(vrrp, l, e_list) {
+		list_for_each_entry_reverse(ip_addr, &vrrp->evip, e_list)
+			vip_index_add(index, vrrp, ip_addr, true);
+		list_for_each_entry_reverse(ip_addr, &vrrp->vip, e_list)
+			vip_index_add(index, vrrp, ip_addr, false);
+	}
+}
+
+void
+vip_index_free(vip_index_t *index)
+{
+	vip_index_entry_t *entry;
+	hlist_node_t *pos, *n;
+	unsigned i;
+
+	if (!index->hash)
+		return;
+
+	for (i = 0; i <= index->hash_mask; i++) {
+		hlist_for_each_entry_safe(entry, pos, n, &index->hash[i], h_list)
+			FREE(entry);
+	}
+
+	FREE(index->hash);
+	index->hash = NULL;
+	index->hash_mask = 0;
+	index->count = 0;
+}
+
+vip_index_entry_t *
+vip_index_first(const vip_index_t *index, int family, const void *addr)
+{
+	vip_index_entry_t *entry;
+	hlist_node_t *pos;
+
+	if (!index->hash)
+		return NULL;
+
+	hlist_for_each_entry(entry, pos, &index->hash[vip_index_hash(index, family, addr)], h_list) {
+		if (vip_index_addr_equal(entry->ip_addr, family, addr))
+			return entry;
+	}
+
+	return NULL;
+}
+
+vip_index_entry_t *
+vip_index_next(const vip_index_entry_t *entry)
+{
+	const ip_address_t *ip_addr = entry->ip_addr;
+	vip_index_entry_t *next;
+	hlist_node_t *pos = entry->h_list.next;
+
+	hlist_for_each_entry_from(next, pos, h_list) {
+		if (vip_index_addr_equal(next->ip_addr, ip_addr->ifa.ifa_family, &ip_addr->u))
+			return next;
+	}
+
+	return NULL;
+}
@@ -289,92 +289,93 @@ add_nexthops(ip_route_t *route, struct nlmsghdr *nlh, struct rtmsg *rtm)
 		addattr_l(nlh, sizeof(buf), RTA_MULTIPATH, RTA_DATA(rta), RTA_PAYLOAD(rta));
 }
 
-/* Add/Delete IP route to/from a specific interface.
+typedef struct _iproute_req {
+	struct nlmsghdr n;
+	struct rtmsg r;
+	char buf[RTM_SIZE];
+} iproute_req_t;
+
+/* Build the netlink request to add/delete an IP route.
  * Note: By default we do not set the NLM_F_EXCL flag, and so the
  * equivalent ip route command to add a route is: ip route prepend ...
  */
-static bool
-netlink_route(ip_route_t *iproute, int cmd)
+static void
+netlink_route_req(ip_route_t *iproute, int cmd, iproute_req_t *req)
 {
-	struct {
-		struct nlmsghdr n;
-		struct rtmsg r;
-		char buf[RTM_SIZE];
-	} req;
 	char buf[RTA_SIZE] __attribute__((aligned(__alignof__(struct rtattr))));
 	struct rtattr *rta = PTR_CAST(struct rtattr, buf);
 
-	memset(&req, 0, sizeof (req));
+	memset(req, 0, sizeof (*req));
 
-	req.n.nlmsg_len   = NLMSG_LENGTH(sizeof(struct rtmsg));
+	req->n.nlmsg_len   = NLMSG_LENGTH(sizeof(struct rtmsg));
 	if (cmd == IPROUTE_DEL) {
-		req.n.nlmsg_flags = NLM_F_REQUEST;
-		req.n.nlmsg_type  = RTM_DELROUTE;
+		req->n.nlmsg_flags = NLM_F_REQUEST;
+		req->n.nlmsg_type  = RTM_DELROUTE;
 	}
 	else {
-		req.n.nlmsg_flags = NLM_F_REQUEST | NLM_F_CREATE;
+		req->n.nlmsg_flags = NLM_F_REQUEST | NLM_F_CREATE;
 		if (cmd == IPROUTE_REPLACE)
-			req.n.nlmsg_flags |= NLM_F_REPLACE;
+			req->n.nlmsg_flags |= NLM_F_REPLACE;
 		else if (iproute->mask & IPROUTE_BIT_ADD)
-			req.n.nlmsg_flags |= NLM_F_EXCL;
+			req->n.nlmsg_flags |= NLM_F_EXCL;
 		else if (iproute->mask & IPROUTE_BIT_APPEND)
-			req.n.nlmsg_flags |= NLM_F_APPEND;
-		req.n.nlmsg_type  = RTM_NEWROUTE;
+			req->n.nlmsg_flags |= NLM_F_APPEND;
+		req->n.nlmsg_type  = RTM_NEWROUTE;
 	}
 
 	rta->rta_type = RTA_METRICS;
 	rta->rta_len = RTA_LENGTH(0);
 
-	req.r.rtm_family = iproute->family;
+	req->r.rtm_family = iproute->family;
 	if (iproute->table < 256)
-		req.r.rtm_table = (unsigned char)iproute->table;
+		req->r.rtm_table = (unsigned char)iproute->table;
 	else {
-		req.r.rtm_table = RT_TABLE_UNSPEC;
-		addattr32(&req.n, sizeof(req), RTA_TABLE, iproute->table);
+		req->r.rtm_table = RT_TABLE_UNSPEC;
+		addattr32(&req->n, sizeof(*req), RTA_TABLE, iproute->table);
 	}
 
 	if (cmd == IPROUTE_DEL) {
-		req.r.rtm_scope = RT_SCOPE_NOWHERE;
+		req->r.rtm_scope = RT_SCOPE_NOWHERE;
 		if (iproute->mask & IPROUTE_BIT_TYPE)
-			req.r.rtm_type = iproute->type;
+			req->r.rtm_type = iproute->type;
 	}
 	else {
-		req.r.rtm_scope = RT_SCOPE_UNIVERSE;
-		req.r.rtm_type = iproute->type;
+		req->r.rtm_scope = RT_SCOPE_UNIVERSE;
+		req->r.rtm_type = iproute->type;
 	}
 
 	if (iproute->mask & IPROUTE_BIT_PROTOCOL)
-		req.r.rtm_protocol = iproute->protocol;
+		req->r.rtm_protocol = iproute->protocol;
 	else
-		req.r.rtm_protocol = RTPROT_KEEPALIVED;
+		req->r.rtm_protocol = RTPROT_KEEPALIVED;
 
 	if (iproute->mask & IPROUTE_BIT_SCOPE)
-		req.r.rtm_scope = iproute->scope;
+		req->r.rtm_scope = iproute->scope;
 
 	if (iproute->dst) {
-		req.r.rtm_dst_len = iproute->dst->ifa.ifa_prefixlen;
-		add_addr2req(&req.n, sizeof(req), RTA_DST, iproute->dst);
+		req->r.rtm_dst_len = iproute->dst->ifa.ifa_prefixlen;
+		add_addr2req(&req->n, sizeof(*req), RTA_DST, iproute->dst);
 	}
 
 	if (iproute->src) {
-		req.r.rtm_src_len = iproute->src->ifa.ifa_prefixlen;
-		add_addr2req(&req.n, sizeof(req), RTA_SRC, iproute->src);
+		req->r.rtm_src_len = iproute->src->ifa.ifa_prefixlen;
+		add_addr2req(&req->n, sizeof(*req), RTA_SRC, iproute->src);
 	}
 
 	if (iproute->pref_src)
-		add_addr2req(&req.n, sizeof(req), RTA_PREFSRC, iproute->pref_src);
+		add_addr2req(&req->n, sizeof(*req), RTA_PREFSRC, iproute->pref_src);
 
 //#if HAVE_DECL_RTA_NEWDST
 //	if (iproute->as_to)
-//		add_addr2req(&req.n, sizeof(req), RTA_NEWDST, iproute->as_to);
+//		add_addr2req(&req->n, sizeof(*req), RTA_NEWDST, iproute->as_to);
 //#endif
 
 	if (iproute->via) {
 		if (iproute->via->ifa.ifa_family == iproute->family)
-			add_addr2req(&req.n, sizeof(req), RTA_GATEWAY, iproute->via);
+			add_addr2req(&req->n, sizeof(*req), RTA_GATEWAY, iproute->via);
 #if HAVE_DECL_RTA_VIA
 		else
-			add_addr_fam2req(&req.n, sizeof(req), RTA_VIA, iproute->via);
+			add_addr_fam2req(&req->n, sizeof(*req), RTA_VIA, iproute->via);
 #endif
 	}
 
@@ -388,27 +389,27 @@ netlink_route(ip_route_t *iproute, int cmd)
 		add_encap(encap_rta, sizeof(encap_buf), &iproute->encap);
 
 		if (encap_rta->rta_len > RTA_LENGTH(0))
-			addraw_l(&req.n, sizeof(encap_buf), RTA_DATA(encap_rta), RTA_PAYLOAD(encap_rta));
+			addraw_l(&req->n, sizeof(encap_buf), RTA_DATA(encap_rta), RTA_PAYLOAD(encap_rta));
 	}
 #endif
 
 	if (iproute->mask & IPROUTE_BIT_DSFIELD)
-		req.r.rtm_tos = iproute->tos;
+		req->r.rtm_tos = iproute->tos;
 
 	if (iproute->oif)
-		addattr32(&req.n, sizeof(req), RTA_OIF, iproute->oif->ifindex);
+		addattr32(&req->n, sizeof(*req), RTA_OIF, iproute->oif->ifindex);
 
 	if (iproute->mask & IPROUTE_BIT_METRIC)
-		addattr32(&req.n, sizeof(req), RTA_PRIORITY, iproute->metric);
+		addattr32(&req->n, sizeof(*req), RTA_PRIORITY, iproute->metric);
 
-	req.r.rtm_flags = iproute->flags;
+	req->r.rtm_flags = iproute->flags;
 
 	if (iproute->realms)
-		addattr32(&req.n, sizeof(req), RTA_FLOW, iproute->realms);
+		addattr32(&req->n, sizeof(*req), RTA_FLOW, iproute->realms);
 
 #if HAVE_DECL_RTA_EXPIRES
 	if (iproute->mask & IPROUTE_BIT_EXPIRES)
-		addattr32(&req.n, sizeof(req), RTA_EXPIRES, iproute->expires);
+		addattr32(&req->n, sizeof(*req), RTA_EXPIRES, iproute->expires);
 #endif
 
 #if HAVE_DECL_RTAX_CC_ALGO
@@ -462,7 +463,7 @@ netlink_route(ip_route_t *iproute, int cmd)
 
 #if HAVE_DECL_RTA_PREF
 	if (iproute->mask & IPROUTE_BIT_PREF)
-		addattr8(&req.n, sizeof(req), RTA_PREF, iproute->pref);
+		addattr8(&req->n, sizeof(*req), RTA_PREF, iproute->pref);
 #endif
 
 #if HAVE_DECL_RTAX_FASTOPEN_NO_COOKIE
@@ -472,17 +473,17 @@ netlink_route(ip_route_t *iproute, int cmd)
 
 #if HAVE_DECL_RTA_TTL_PROPAGATE
 	if (iproute->mask & IPROUTE_BIT_TTL_PROPAGATE)
-		addattr8(&req.n, sizeof(req), RTA_TTL_PROPAGATE, iproute->ttl_propagate);
+		addattr8(&req->n, sizeof(*req), RTA_TTL_PROPAGATE, iproute->ttl_propagate);
 #endif
 
 	if (rta->rta_len > RTA_LENGTH(0)) {
 		if (iproute->lock)
 			rta_addattr32(rta, sizeof(buf), RTAX_LOCK, iproute->lock);
-		addattr_l(&req.n, sizeof(req), RTA_METRICS, RTA_DATA(rta), RTA_PAYLOAD(rta));
+		addattr_l(&req->n, sizeof(*req), RTA_METRICS, RTA_DATA(rta), RTA_PAYLOAD(rta));
 	}
 
 	if (!list_empty(&iproute->nhs))
-		add_nexthops(iproute, &req.n, &req.r);
+		add_nexthops(iproute, &req->n, &req->r);
 
 #ifdef DEBUG_NETLINK_MSG
 	size_t i, j;
@@ -490,21 +491,30 @@ netlink_route(ip_route_t *iproute, int cmd)
 	char lbuf[3072];
 	char *op = lbuf;
 
-	log_message(LOG_INFO, "rtmsg buffer used %lu, rtattr buffer used %d", req.n.nlmsg_len - NLMSG_LENGTH(sizeof(struct rtmsg)), rta->rta_len);
+	log_message(LOG_INFO, "rtmsg buffer used %lu, rtattr buffer used %d", req->n.nlmsg_len - NLMSG_LENGTH(sizeof(struct rtmsg)), rta->rta_len);
 
-	op += (size_t)snprintf(op, sizeof(lbuf) - (op - lbuf), "nlmsghdr %p(%u):", &req.n, req.n.nlmsg_len);
-	for (i = 0, p = PTR_CAST(uint8_t, &req.n); i < sizeof(struct nlmsghdr); i++)
+	op += (size_t)snprintf(op, sizeof(lbuf) - (op - lbuf), "nlmsghdr %p(%u):", &req->n, req->n.nlmsg_len);
+	for (i = 0, p = PTR_CAST(uint8_t, &req->n); i < sizeof(struct nlmsghdr); i++)
 		op += (size_t)snprintf(op, sizeof(lbuf) - (op - lbuf), " %2.2hhx", *(p++));
 	log_message(LOG_INFO, "%s", lbuf);
 
 	op = lbuf;
-	op += (size_t)snprintf(op, sizeof(lbuf) - (op - lbuf), "rtmsg %p(%lu):", &req.r, req.n.nlmsg_len - sizeof(struct nlmsghdr));
-	for (i = 0, p = PTR_CAST(uint8_t, &req.r); i < req.n.nlmsg_len - sizeof(struct nlmsghdr); i++)
+	op += (size_t)snprintf(op, sizeof(lbuf) - (op - lbuf), "rtmsg %p(%lu):", &req->r, req->n.nlmsg_len - sizeof(struct nlmsghdr));
+	for (i = 0, p = PTR_CAST(uint8_t, &req->r); i < req->n.nlmsg_len - sizeof(struct nlmsghdr); i++)
 		op += (size_t)snprintf(op, sizeof(lbuf) - (op - lbuf), " %2.2hhx", *(p++));
 
 	for (j = 0; lbuf + j < op; j+= MAX_LOG_MSG)
 		log_message(LOG_INFO, "%.*", MAX_LOG_MSG, lbuf+j);
 #endif
+}
+
+/* Add/Delete IP route to/from a specific interface */
+static bool
+netlink_route(ip_route_t *iproute, int cmd)
+{
+	iproute_req_t req;
+
+	netlink_route_req(iproute, cmd, &req);
 
 	/* This returns ESRCH if the address of via address doesn't exist */
 	/* ENETDOWN if dev p33p1.40 for example is down */
@@ -519,25 +529,46 @@ netlink_route(ip_route_t *iproute, int cmd)
 	return false;
 }
 
-/* Add/Delete a list of IP routes */
+static void
+netlink_rtlist_add_done(void *arg, int error)
+{
+	ip_route_t *ip_route = arg;
+
+	if (error)
+		ip_route->set = false;
+}
+
+/* Add/Delete a list of IP routes. The commands are sent in a batch, and
+ * ip_route->set is updated when a command is queued and cleared again if
+ * an add fails. */
 bool
 netlink_rtlist(list_head_t *rt_list, int cmd, bool force)
 {
 	ip_route_t *ip_route;
+	iproute_req_t req;
 
 	/* No routes to add */
 	if (list_empty(rt_list))
 		return false;
 
+	netlink_batch_open();
+
 	list_for_each_entry(ip_route, rt_list, e_list) {
 		if ((cmd == IPROUTE_DEL) == ip_route->set || force) {
-			if (!netlink_route(ip_route, cmd))
-				ip_route->set = (cmd == IPROUTE_ADD);
-			else if (cmd != IPROUTE_ADD)
-				ip_route->set = false;
+			netlink_route_req(ip_route, cmd, &req);
+			ip_route->set = (cmd == IPROUTE_ADD);
+			netlink_batch_add(&req.n,
+#if HAVE_DECL_RTA_EXPIRES
+					  /* If an expiry was set on the route, it may have disappeared already */
+					  cmd == IPROUTE_DEL && (ip_route->mask & IPROUTE_BIT_EXPIRES) ? ESRCH :
+#endif
+					  0,
+					  cmd == IPROUTE_ADD ? netlink_rtlist_add_done : NULL, ip_route);
 		}
 	}
 
+	netlink_batch_close();
+
 	return true;
 }
 
@@ -1990,29 +2021,49 @@ compare_nexthops(const list_head_t *a, const list_head_t *b)
 	return false;
 }
 
-/* Try to find a route in a list */
+/* The kernel's key to a route is (to, tos, preference, table), but since
+ * we don't specify NLM_F_EXCL when adding a route we also need to check
+ * via/nexthops, scope and type. */
+static bool
+route_is_equal(const ip_route_t *x, const ip_route_t *y)
+{
+	return !compare_ipaddress(x->dst, y->dst) &&
+	       x->dst->ifa.ifa_prefixlen == y->dst->ifa.ifa_prefixlen &&
+	       x->tos == y->tos &&
+	       (!((x->mask ^ y->mask) & IPROUTE_BIT_METRIC)) &&
+	       (!(x->mask & IPROUTE_BIT_METRIC) ||
+		x->metric == y->metric) &&
+	       x->table == y->table &&
+	       x->scope == y->scope &&
+	       x->type == y->type &&
+	       !x->via == !y->via &&
+	       (!x->via || !compare_ipaddress(x->via, y->via)) &&
+	       x->oif == y->oif &&
+	       compare_nexthops(&x->nhs, &y->nhs);
+}
+
+/* Try to find a route in list l, or if index is not NULL, in the routes of
+ * vrrp in the index */
 static ip_route_t *
-route_exist(list_head_t *l, ip_route_t *route)
+route_exist(list_head_t *l, const route_index_t *index, const vrrp_t *vrrp, ip_route_t *route)
 {
 	ip_route_t *ip_route;
+	route_index_entry_t *entry;
+
+	if (index) {
+		route_index_for_each_entry(entry, index, route->family, route->table,
+					   route->dst->ifa.ifa_prefixlen, &route->dst->u) {
+			if (entry->vrrp == vrrp && route_is_equal(entry->route, route)) {
+				entry->route->set = route->set;
+				return entry->route;
+			}
+		}
+
+		return NULL;
+	}
 
 	list_for_each_entry(ip_route, l, e_list) {
-		/* The kernel's key to a route is (to, tos, preference, table),
-		 * but since we don't specify NLM_F_EXCL when adding a route we
-		 * also need to check via/nexthops, scope and type. */
-		if (!compare_ipaddress(ip_route->dst, route->dst) &&
-		    ip_route->dst->ifa.ifa_prefixlen == route->dst->ifa.ifa_prefixlen &&
-		    ip_route->tos == route->tos &&
-		    (!((ip_route->mask ^ route->mask) & IPROUTE_BIT_METRIC)) &&
-		    (!(ip_route->mask & IPROUTE_BIT_METRIC) ||
-		     ip_route->metric == route->metric) &&
-		    ip_route->table == route->table &&
-		    ip_route->scope == route->scope &&
-		    ip_route->type == route->type &&
-		    !ip_route->via == !route->via &&
-		    (!ip_route->via || !compare_ipaddress(ip_route->via, route->via)) &&
-		    ip_route->oif == route->oif &&
-		    compare_nexthops(&ip_route->nhs, &route->nhs)) {
+		if (route_is_equal(ip_route, route)) {
 			ip_route->set = route->set;
 			return ip_route;
 		}
@@ -2020,9 +2071,10 @@ route_exist(list_head_t *l, ip_route_t *route)
 	return NULL;
 }
 
-/* Clear diff routes */
+/* Clear diff routes. If index is not NULL, the routes on list n are those of
+ * vrrp in the index. */
 void
-clear_diff_routes(list_head_t *l, list_head_t *n)
+clear_diff_routes(list_head_t *l, list_head_t *n, const route_index_t *index, const vrrp_t *vrrp)
 {
 	ip_route_t *route, *new_route;
 
@@ -2040,7 +2092,7 @@ clear_diff_routes(list_head_t *l, list_head_t *n)
 
 	list_for_each_entry(route, l, e_list) {
 		if (route->set) {
-			if (!(new_route = route_exist(n, route))) {
+			if (!(new_route = route_exist(n, index, vrrp, route))) {
 				if (__test_bit(LOG_DETAIL_BIT, &debug))
 					log_message(LOG_INFO, "Removing route %s"
 							    , ipaddresstos(NULL, route->dst));
@@ -2071,7 +2123,41 @@ clear_diff_routes(list_head_t *l, list_head_t *n)
 void
 clear_diff_static_routes(void)
 {
-	clear_diff_routes(&old_vrrp_data->static_routes, &vrrp_data->static_routes);
+	clear_diff_routes(&old_vrrp_data->static_routes, &vrrp_data->static_routes, NULL, NULL);
+}
+
+/* Check if the routes on list n are the same as those on list l, in the
+ * same order, and that each route on l is set if set is true, and not set
+ * otherwise. Since route_is_equal() doesn't compare all the options of a
+ * route, the vrrp instance fingerprint must also be checked. */
+bool
+iproute_list_same(list_head_t *l, list_head_t *n, bool set)
+{
+	ip_route_t *route;
+	ip_route_t *new_route = list_first_entry(n, ip_route_t, e_list);
+
+	list_for_each_entry(route, l, e_list) {
+		if (&new_route->e_list == n ||
+		    route->set != set ||
+		    !route_is_equal(route, new_route))
+			return false;
+		new_route = list_entry(new_route->e_list.next, ip_route_t, e_list);
+	}
+
+	return &new_route->e_list == n;
+}
+
+/* Copy the state of the routes on list l to the same routes on list n */
+void
+iproute_list_copy_state(list_head_t *l, list_head_t *n)
+{
+	ip_route_t *route;
+	ip_route_t *new_route = list_first_entry(n, ip_route_t, e_list);
+
+	list_for_each_entry(route, l, e_list) {
+		new_route->set = route->set;
+		new_route = list_entry(new_route->e_list.next, ip_route_t, e_list);
+	}
 }
 
 void
@@ -2084,3 +2170,141 @@ reinstate_static_route(ip_route_t *route)
 	format_iproute(route, buf, sizeof(buf));
 	log_message(LOG_INFO, "Restoring deleted static route %s", buf);
 }
+
+/* Route index. A route reported by netlink without an RTA_DST is a default
+ * route, and our default routes have an all zero dst address. */
+static unsigned __attribute__ ((pure))
+route_index_hash(const route_index_t *index, int family, uint32_t table, uint8_t dst_len, const void *dst)
+{
+	static const struct in6_addr any_addr;
+
+	if (!dst)
+		dst = &any_addr;
+
+	return hash_mix32(inaddr_hash((sa_family_t)family, dst) + table + ((uint32_t)dst_len << 24)) & index->hash_mask;
+}
+
+static void
+route_index_add(route_index_t *index, vrrp_t *vrrp, ip_route_t *route)
+{
+	route_index_entry_t *entry;
+
+	PMALLOC(entry);
+	entry->vrrp = vrrp;
+	entry->route = route;
+
+	hlist_add_head(&entry->h_list, &index->hash[route_index_hash(index, route->family, route->table,
+								      route->dst->ifa.ifa_prefixlen, &route->dst->u)]);
+}
+
+/* Build the index of the routes of the vrrp instances on list l and the
+ * static routes on list s. Entries are added at the head of the chains, so
+ * the lists are walked backwards to keep the lookup order the same as the
+ * order of the lists, with the vrrp routes before the static routes. */
+void
+route_index_build(route_index_t *index, list_head_t *l, list_head_t *s)
+{
+	vrrp_t *vrrp;
+	ip_route_t *route;
+	unsigned num_routes = 0;
+	unsigned num_chains = 16;
+	unsigned i;
+
+	route_index_free(index);
+
+	list_for_each_entry(vrrp, l, e_list) {
+		list_for_each_entry(route, &vrrp->vroutes, e_list)
+			num_routes++;
+	}
+	list_for_each_entry(route, s, e_list)
+		num_routes++;
+
+	if (!num_routes)
+		return;
+
+	while (num_chains < num_routes)
+		num_chains <<= 1;
+
+	index->hash = MALLOC(num_chains * sizeof(*index->hash));
+	for (i = 0; i < num_chains; i++)
+		INIT_HLIST_HEAD(&index->hash[i]);
+	index->hash_mask = num_chains - 1;
+
+	list_for_each_entry_reverse(route, s, e_list)
+		route_index_add(index, NULL, route);
+	list_for_each_entry_reverse(vrrp, l, e_list) {
+		list_for_each_entry_reverse(route, &vrrp->vroutes, e_list)
+			route_index_add(index, vrrp, route);
+	}
+}
+
+void
+route_index_free(route_index_t *index)
+{
+	route_index_entry_t *entry;
+	hlist_node_t *pos, *n;
+	unsigned i;
+
+	if (!index->hash)
+		return;
+
+	for (i = 0; i <= index->hash_mask; i++) {
+		hlist_for_each_entry_safe(entry, pos, n, &index->hash[i], h_list)
+			FREE(entry);
+	}
+
+	FREE(index->hash);
+	index->hash = NULL;
+	index->hash_mask = 0;
+}
+
+static bool __attribute__ ((pure))
+route_index_key_equal(const ip_route_t *route, int family, uint32_t table, uint8_t dst_len, const void *dst)
+{
+	if (route->family != family ||
+	    route->table != table ||
+	    route->dst->ifa.ifa_prefixlen != dst_len)
+		return false;
+
+	if (!dst)
+		return family == AF_INET ? !route->dst->u.sin.sin_addr.s_addr : IN6_IS_ADDR_UNSPECIFIED(&route->dst->u.sin6_addr);
+
+	if (family == AF_INET)
+		return route->dst->u.sin.sin_addr.s_addr == PTR_CAST_CONST(struct in_addr, dst)->s_addr;
+
+	return IN6_ARE_ADDR_EQUAL(&route->dst->u.sin6_addr, PTR_CAST_CONST(struct in6_addr, dst));
+}
+
+/* dst is NULL for a route without an RTA_DST */
+route_index_entry_t *
+route_index_first(const route_index_t *index, int family, uint32_t table, uint8_t dst_len, const void *dst)
+{
+	route_index_entry_t *entry;
+	hlist_node_t *pos;
+
+	if (!index->hash)
+		return NULL;
+
+	hlist_for_each_entry(entry, pos, &index->hash[route_index_hash(index, family, table, dst_len, dst)], h_list) {
+		if (route_index_key_equal(entry->route, family, table, dst_len, dst))
+			return entry;
+	}
+
+	return NULL;
+}
+
+route_index_entry_t *
+route_index_next(const route_index_entry_t *entry)
+{
+	const ip_route_t *route = entry->route;
+	route_index_entry_t *next;
+	hlist_node_t *pos = entry->h_list.next;
+
+	hlist_for_each_entry_from(next, pos, h_list) {
+		if (route_index_key_equal(next->route, route->family, route->table,
+					  route->dst->ifa.ifa_prefixlen, &route->dst->u))
+			return next;
+	}
+
+	return NULL;
+}
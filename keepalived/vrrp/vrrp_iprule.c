@@ -141,35 +141,34 @@ inet_proto_a2n(const char *buf)
 }
 #endif
 
-/* Add/Delete IP rule to/from a specific IP/network */
-static int
-netlink_rule(ip_rule_t *iprule, int cmd)
+typedef struct _iprule_req {
+	struct nlmsghdr n;
+	struct fib_rule_hdr frh;
+	char buf[1024];
+} iprule_req_t;
+
+/* Build the netlink request to add/delete an IP rule */
+static void
+netlink_rule_req(ip_rule_t *iprule, int cmd, iprule_req_t *req)
 {
-	int status = 1;
-	struct {
-		struct nlmsghdr n;
-		struct fib_rule_hdr frh;
-		char buf[1024];
-	} req;
+	memset(req, 0, sizeof (*req));
 
-	memset(&req, 0, sizeof (req));
-
-	req.n.nlmsg_len = NLMSG_LENGTH(sizeof(struct rtmsg));
-	req.n.nlmsg_flags = NLM_F_REQUEST;
+	req->n.nlmsg_len = NLMSG_LENGTH(sizeof(struct rtmsg));
+	req->n.nlmsg_flags = NLM_F_REQUEST;
 
 	if (cmd != IPRULE_DEL) {
-		req.n.nlmsg_flags |= NLM_F_CREATE | NLM_F_EXCL;
-		req.n.nlmsg_type = RTM_NEWRULE;
-		req.frh.action = FR_ACT_UNSPEC;
+		req->n.nlmsg_flags |= NLM_F_CREATE | NLM_F_EXCL;
+		req->n.nlmsg_type = RTM_NEWRULE;
+		req->frh.action = FR_ACT_UNSPEC;
 	}
 	else {
-		req.frh.action = FR_ACT_UNSPEC;
-		req.n.nlmsg_type = RTM_DELRULE;
+		req->frh.action = FR_ACT_UNSPEC;
+		req->n.nlmsg_type = RTM_DELRULE;
 	}
-	req.frh.table = RT_TABLE_UNSPEC;
-	req.frh.flags = 0;
-	req.frh.tos = iprule->tos;	// Hex value - 0xnn <= 255, or name from rt_dsfield
-	req.frh.family = iprule->family;
+	req->frh.table = RT_TABLE_UNSPEC;
+	req->frh.flags = 0;
+	req->frh.tos = iprule->tos;	// Hex value - 0xnn <= 255, or name from rt_dsfield
+	req->frh.family = iprule->family;
 
 	if (iprule->action == FR_ACT_TO_TBL
 #if HAVE_DECL_FRA_L3MDEV
@@ -177,100 +176,109 @@ netlink_rule(ip_rule_t *iprule, int cmd)
 #endif
 					   ) {
 		if (iprule->table < 256)	// "Table" or "lookup"
-			req.frh.table = iprule->table ? iprule->table & 0xff : RT_TABLE_MAIN;
+			req->frh.table = iprule->table ? iprule->table & 0xff : RT_TABLE_MAIN;
 		else {
-			req.frh.table = RT_TABLE_UNSPEC;
-			addattr32(&req.n, sizeof(req), FRA_TABLE, iprule->table);
+			req->frh.table = RT_TABLE_UNSPEC;
+			addattr32(&req->n, sizeof(*req), FRA_TABLE, iprule->table);
 		}
 	}
 
 	if (iprule->invert)
-		req.frh.flags |= FIB_RULE_INVERT;	// "not"
+		req->frh.flags |= FIB_RULE_INVERT;	// "not"
 
 	/* Set rule entry */
 	if (iprule->from_addr) {	// can be "default"/"any"/"all" - and to addr => bytelen == bitlen == 0
-		add_addr2req(&req.n, sizeof(req), FRA_SRC, iprule->from_addr);
-		req.frh.src_len = iprule->from_addr->ifa.ifa_prefixlen;
+		add_addr2req(&req->n, sizeof(*req), FRA_SRC, iprule->from_addr);
+		req->frh.src_len = iprule->from_addr->ifa.ifa_prefixlen;
 	}
 	if (iprule->to_addr) {
-		add_addr2req(&req.n, sizeof(req), FRA_DST, iprule->to_addr);
-		req.frh.dst_len = iprule->to_addr->ifa.ifa_prefixlen;
+		add_addr2req(&req->n, sizeof(*req), FRA_DST, iprule->to_addr);
+		req->frh.dst_len = iprule->to_addr->ifa.ifa_prefixlen;
 	}
 
 	if (iprule->mask & IPRULE_BIT_PRIORITY)	// "priority/order/preference"
-		addattr32(&req.n, sizeof(req), FRA_PRIORITY, iprule->priority);
+		addattr32(&req->n, sizeof(*req), FRA_PRIORITY, iprule->priority);
 
 	if (iprule->mask & IPRULE_BIT_FWMARK)	// "fwmark"
-		addattr32(&req.n, sizeof(req), FRA_FWMARK, iprule->fwmark);
+		addattr32(&req->n, sizeof(*req), FRA_FWMARK, iprule->fwmark);
 
 	if (iprule->mask & IPRULE_BIT_FWMASK)	// "fwmark number followed by /nn"
-		addattr32(&req.n, sizeof(req), FRA_FWMASK, iprule->fwmask);
+		addattr32(&req->n, sizeof(*req), FRA_FWMASK, iprule->fwmask);
 
 	if (iprule->realms)	// "realms u16[/u16] using rt_realms. after / is 16 msb (src), pre slash is 16 lsb (dest)"
-		addattr32(&req.n, sizeof(req), FRA_FLOW, iprule->realms);
+		addattr32(&req->n, sizeof(*req), FRA_FLOW, iprule->realms);
 
 #if HAVE_DECL_FRA_SUPPRESS_PREFIXLEN
 	if (iprule->suppress_prefix_len != -1)	// "suppress_prefixlength" - only valid if table != 0
-		addattr32(&req.n, sizeof(req), FRA_SUPPRESS_PREFIXLEN, iprule->suppress_prefix_len);
+		addattr32(&req->n, sizeof(*req), FRA_SUPPRESS_PREFIXLEN, iprule->suppress_prefix_len);
 #endif
 
 #if HAVE_DECL_FRA_SUPPRESS_IFGROUP
 	if (iprule->mask & IPRULE_BIT_SUP_GROUP)	// "suppress_ifgroup" or "sup_group" int32 - only valid if table !=0
-		addattr32(&req.n, sizeof(req), FRA_SUPPRESS_IFGROUP, iprule->suppress_group);
+		addattr32(&req->n, sizeof(*req), FRA_SUPPRESS_IFGROUP, iprule->suppress_group);
 #endif
 
 	if (iprule->iif)	// "dev/iif"
-		addattr_l(&req.n, sizeof(req), FRA_IFNAME, iprule->iif, strlen(iprule->iif->ifname)+1);
+		addattr_l(&req->n, sizeof(*req), FRA_IFNAME, iprule->iif, strlen(iprule->iif->ifname)+1);
 
 	if (iprule->oif)	// "oif"
-		addattr_l(&req.n, sizeof(req), FRA_OIFNAME, iprule->oif, strlen(iprule->oif->ifname)+1);
+		addattr_l(&req->n, sizeof(*req), FRA_OIFNAME, iprule->oif, strlen(iprule->oif->ifname)+1);
 
 #if HAVE_DECL_FRA_TUN_ID
 	if (iprule->tunnel_id)
-		addattr64(&req.n, sizeof(req), FRA_TUN_ID, htobe64(iprule->tunnel_id));
+		addattr64(&req->n, sizeof(*req), FRA_TUN_ID, htobe64(iprule->tunnel_id));
 #endif
 
 #if HAVE_DECL_FRA_UID_RANGE
 	if (iprule->mask & IPRULE_BIT_UID_RANGE)
-		addattr_l(&req.n, sizeof(req), FRA_UID_RANGE, &iprule->uid_range, sizeof(iprule->uid_range));
+		addattr_l(&req->n, sizeof(*req), FRA_UID_RANGE, &iprule->uid_range, sizeof(iprule->uid_range));
 #endif
 
 #if HAVE_DECL_FRA_L3MDEV
 	if (iprule->l3mdev)
-		addattr8(&req.n, sizeof(req), FRA_L3MDEV, 1);
+		addattr8(&req->n, sizeof(*req), FRA_L3MDEV, 1);
 #endif
 
 #if HAVE_DECL_FRA_PROTOCOL
 	if (iprule->mask & IPRULE_BIT_PROTOCOL)
-		addattr8(&req.n, sizeof(req), FRA_PROTOCOL, iprule->protocol);
+		addattr8(&req->n, sizeof(*req), FRA_PROTOCOL, iprule->protocol);
 #endif
 
 #if HAVE_DECL_FRA_IP_PROTO
 	if (iprule->mask & IPRULE_BIT_IP_PROTO)
-		addattr8(&req.n, sizeof(req), FRA_IP_PROTO, iprule->ip_proto);
+		addattr8(&req->n, sizeof(*req), FRA_IP_PROTO, iprule->ip_proto);
 #endif
 
 #if HAVE_DECL_FRA_SPORT_RANGE
 	if (iprule->mask & IPRULE_BIT_SPORT_RANGE)
-		addattr_l(&req.n, sizeof(req), FRA_SPORT_RANGE, &iprule->src_port, sizeof(iprule->src_port));
+		addattr_l(&req->n, sizeof(*req), FRA_SPORT_RANGE, &iprule->src_port, sizeof(iprule->src_port));
 #endif
 
 #if HAVE_DECL_FRA_DPORT_RANGE
 	if (iprule->mask & IPRULE_BIT_DPORT_RANGE)
-		addattr_l(&req.n, sizeof(req), FRA_DPORT_RANGE, &iprule->dst_port, sizeof(iprule->dst_port));
+		addattr_l(&req->n, sizeof(*req), FRA_DPORT_RANGE, &iprule->dst_port, sizeof(iprule->dst_port));
 #endif
 
 	if (iprule->action == FR_ACT_GOTO) {	// "goto"
-		addattr32(&req.n, sizeof(req), FRA_GOTO, iprule->goto_target);
-		req.frh.action = FR_ACT_GOTO;
+		addattr32(&req->n, sizeof(*req), FRA_GOTO, iprule->goto_target);
+		req->frh.action = FR_ACT_GOTO;
 	}
 
-	req.frh.action = iprule->action;
+	req->frh.action = iprule->action;
+}
+
+/* Add/Delete IP rule to/from a specific IP/network */
+static int
+netlink_rule(ip_rule_t *iprule, int cmd)
+{
+	iprule_req_t req;
+
+	netlink_rule_req(iprule, cmd, &req);
 
 	if (netlink_talk(&nl_cmd, &req.n) < 0)
-		status = -1;
+		return -1;
 
-	return status;
+	return 1;
 }
 
 void
@@ -284,33 +292,45 @@ reinstate_static_rule(ip_rule_t *rule)
 	log_message(LOG_INFO, "Restoring deleted static rule %s", buf);
 }
 
+static void
+netlink_rulelist_add_done(void *arg, int error)
+{
+	ip_rule_t *rule = arg;
+
+	if (error)
+		rule->set = false;
+}
+
+/* The commands are sent in a batch, and rule->set is updated when a
+ * command is queued and cleared again if an add fails. */
 void
 netlink_rulelist(list_head_t *l, int cmd, bool force)
 {
 	ip_rule_t *rule;
+	iprule_req_t req;
 
 	/* No rules to add */
 	if (list_empty(l))
 		return;
 
-	/* If force is set, we try to remove all the rules, but the
-	 * rule might not exist. That's not an error, so indicate not
-	 * to report such a situation */
-	if (force && cmd == IPRULE_DEL)
-		netlink_error_ignore = ENOENT;
+	netlink_batch_open();
 
 	list_for_each_entry(rule, l, e_list) {
 		if (force ||
 		    (cmd == IPRULE_ADD && !rule->set) ||
 		    (cmd == IPRULE_DEL && rule->set)) {
-			if (netlink_rule(rule, cmd) > 0)
-				rule->set = (cmd == IPRULE_ADD);
-			else
-				rule->set = false;
+			netlink_rule_req(rule, cmd, &req);
+			rule->set = (cmd == IPRULE_ADD);
+
+			/* If force is set, we try to remove all the rules, but the
+			 * rule might not exist. That's not an error, so indicate not
+			 * to report such a situation */
+			netlink_batch_add(&req.n, force && cmd == IPRULE_DEL ? ENOENT : 0,
+					  cmd == IPRULE_ADD ? netlink_rulelist_add_done : NULL, rule);
 		}
 	}
 
-	netlink_error_ignore = 0;
+	netlink_batch_close();
 }
 
 /* Rule dump/allocation */
@@ -865,11 +885,24 @@ err:
 	FREE_PTR(new);
 }
 
-/* Try to find a rule in a list */
+/* Try to find a rule in list l, or if index is not NULL, in the rules of
+ * vrrp in the index */
 static bool
-rule_exist(list_head_t *l, ip_rule_t *rule)
+rule_exist(list_head_t *l, const rule_index_t *index, const vrrp_t *vrrp, ip_rule_t *rule)
 {
 	ip_rule_t *ip_rule;
+	rule_index_entry_t *entry;
+
+	if (index) {
+		rule_index_for_each_entry(entry, index, rule->family, rule->priority) {
+			if (entry->vrrp == vrrp && rule_is_equal(entry->rule, rule)) {
+				entry->rule->set = rule->set;
+				return true;
+			}
+		}
+
+		return false;
+	}
 
 	list_for_each_entry(ip_rule, l, e_list) {
 		if (rule_is_equal(ip_rule, rule)) {
@@ -881,9 +914,10 @@ rule_exist(list_head_t *l, ip_rule_t *rule)
 	return false;
 }
 
-/* Clear diff rules */
+/* Clear diff rules. If index is not NULL, the rules on list n are those of
+ * vrrp in the index. */
 void
-clear_diff_rules(list_head_t *l, list_head_t *n)
+clear_diff_rules(list_head_t *l, list_head_t *n, const rule_index_t *index, const vrrp_t *vrrp)
 {
 	ip_rule_t *rule;
 	char from_addr[IPADDRESSTOS_BUF_LEN];
@@ -901,7 +935,7 @@ clear_diff_rules(list_head_t *l, list_head_t *n)
 	}
 
 	list_for_each_entry(rule, l, e_list) {
-		if (!rule_exist(n, rule) && rule->set) {
+		if (!rule_exist(n, index, vrrp, rule) && rule->set) {
 			if (__test_bit(LOG_DETAIL_BIT, &debug)) {
 				if (rule->from_addr)
 					ipaddresstos(from_addr, rule->from_addr);
@@ -922,7 +956,41 @@ clear_diff_rules(list_head_t *l, list_head_t *n)
 void
 clear_diff_static_rules(void)
 {
-	clear_diff_rules(&old_vrrp_data->static_rules, &vrrp_data->static_rules);
+	clear_diff_rules(&old_vrrp_data->static_rules, &vrrp_data->static_rules, NULL, NULL);
+}
+
+/* Check if the rules on list n are the same as those on list l, in the
+ * same order, and that each rule on l is set if set is true, and not set
+ * otherwise. */
+bool
+iprule_list_same(list_head_t *l, list_head_t *n, bool set)
+{
+	ip_rule_t *rule;
+	ip_rule_t *new_rule = list_first_entry(n, ip_rule_t, e_list);
+
+	list_for_each_entry(rule, l, e_list) {
+		if (&new_rule->e_list == n ||
+		    rule->set != set ||
+		    rule->family != new_rule->family ||
+		    !rule_is_equal(rule, new_rule))
+			return false;
+		new_rule = list_entry(new_rule->e_list.next, ip_rule_t, e_list);
+	}
+
+	return &new_rule->e_list == n;
+}
+
+/* Copy the state of the rules on list l to the same rules on list n */
+void
+iprule_list_copy_state(list_head_t *l, list_head_t *n)
+{
+	ip_rule_t *rule;
+	ip_rule_t *new_rule = list_first_entry(n, ip_rule_t, e_list);
+
+	list_for_each_entry(rule, l, e_list) {
+		new_rule->set = rule->set;
+		new_rule = list_entry(new_rule->e_list.next, ip_rule_t, e_list);
+	}
 }
 
 void
@@ -931,3 +999,114 @@ reset_next_rule_priority(void)
 	next_rule_priority_ipv4 = RULE_START_PRIORITY;
 	next_rule_priority_ipv6 = RULE_START_PRIORITY;
 }
+
+/* Rule index */
+static unsigned __attribute__ ((pure))
+rule_index_hash(const rule_index_t *index, int family, uint32_t priority)
+{
+	return hash_mix32(priority ^ ((uint32_t)family << 24)) & index->hash_mask;
+}
+
+static void
+rule_index_add(rule_index_t *index, vrrp_t *vrrp, ip_rule_t *rule)
+{
+	rule_index_entry_t *entry;
+
+	PMALLOC(entry);
+	entry->vrrp = vrrp;
+	entry->rule = rule;
+
+	hlist_add_head(&entry->h_list, &index->hash[rule_index_hash(index, rule->family, rule->priority)]);
+}
+
+/* Build the index of the rules of the vrrp instances on list l and the
+ * static rules on list s. As for the route index, the lists are walked
+ * backwards so that lookups see the rules in list order. */
+void
+rule_index_build(rule_index_t *index, list_head_t *l, list_head_t *s)
+{
+	vrrp_t *vrrp;
+	ip_rule_t *rule;
+	unsigned num_rules = 0;
+	unsigned num_chains = 16;
+	unsigned i;
+
+	rule_index_free(index);
+
+	list_for_each_entry(vrrp, l, e_list) {
+		list_for_each_entry(rule, &vrrp->vrules, e_list)
+			num_rules++;
+	}
+	list_for_each_entry(rule, s, e_list)
+		num_rules++;
+
+	if (!num_rules)
+		return;
+
+	while (num_chains < num_rules)
+		num_chains <<= 1;
+
+	index->hash = MALLOC(num_chains * sizeof(*index->hash));
+	for (i = 0; i < num_chains; i++)
+		INIT_HLIST_HEAD(&index->hash[i]);
+	index->hash_mask = num_chains - 1;
+
+	list_for_each_entry_reverse(rule, s, e_list)
+		rule_index_add(index, NULL, rule);
+	list_for_each_entry_reverse(vrrp, l, e_list) {
+		list_for_each_entry_reverse(rule, &vrrp->vrules, e_list)
+			rule_index_add(index, vrrp, rule);
+	}
+}
+
+void
+rule_index_free(rule_index_t *index)
+{
+	rule_index_entry_t *entry;
+	hlist_node_t *pos, *n;
+	unsigned i;
+
+	if (!index->hash)
+		return;
+
+	for (i = 0; i <= index->hash_mask; i++) {
+		hlist_for_each_entry_safe(entry, pos, n, &index->hash[i], h_list)
+			FREE(entry);
+	}
+
+	FREE(index->hash);
+	index->hash = NULL;
+	index->hash_mask = 0;
+}
+
+rule_index_entry_t *
+rule_index_first(const rule_index_t *index, int family, uint32_t priority)
+{
+	rule_index_entry_t *entry;
+	hlist_node_t *pos;
+
+	if (!index->hash)
+		return NULL;
+
+	hlist_for_each_entry(entry, pos, &index->hash[rule_index_hash(index, family, priority)], h_list) {
+		if (entry->rule->family == family && entry->rule->priority == priority)
+			return entry;
+	}
+
+	return NULL;
+}
+
+rule_index_entry_t *
+rule_index_next(const rule_index_entry_t *entry)
+{
+	const ip_rule_t *rule = entry->rule;
+	rule_index_entry_t *next;
+	hlist_node_t *pos = entry->h_list.next;
+
+	hlist_for_each_entry_from(next, pos, h_list) {
+		if (next->rule->family == rule->family && next->rule->priority == rule->priority)
+			return next;
+	}
+
+	return NULL;
+}
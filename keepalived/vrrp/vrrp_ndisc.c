@@ -44,11 +44,13 @@
 #include "vrrp_if_config.h"
 #include "vrrp_scheduler.h"
 #include "vrrp_arp.h"
+#include "vrrp_garp_tx.h"
 #include "bitops.h"
 
 
 /* static vars */
 static int ndisc_fd = -1;
+static garp_tx_t *ndisc_tx;
 
 /*
  * See RFC 4391(Section 4 ) and RFC 4392 for details
@@ -60,48 +62,6 @@ static unsigned char  ipv6_bcast_addr[] = {
 	0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff
 };
 
-/*
- *	Neighbour Advertisement sending routine.
- */
-static void
-ndisc_send_na(ip_address_t *ipaddress, struct iovec *iov, int iovlen)
-{
-	struct sockaddr_large_ll sll;
-	ssize_t len;
-	char addr_str[INET6_ADDRSTRLEN] = "";
-	interface_t *ifp = ipaddress->ifp;
-	struct msghdr msg = { .msg_iov = iov, .msg_iovlen = iovlen };
-
-	/* Build the dst device */
-	memset(&sll, 0, sizeof (sll));
-	sll.sll_family = AF_PACKET;
-	sll.sll_ifindex = (int)IF_INDEX(ifp);
-
-	/* The values in sll_ha_type, sll_addr and sll_halen appear to be ignored */
-	sll.sll_hatype = ifp->hw_type;
-	sll.sll_halen = ifp->hw_addr_len;
-	sll.sll_protocol = htons(ETH_P_IPV6);
-	memcpy(sll.sll_addr, IF_HWADDR(ifp), ifp->hw_addr_len);
-
-	msg.msg_name = &sll;
-	msg.msg_namelen = sizeof(sll);
-
-	if (__test_bit(LOG_DETAIL_BIT, &debug)) {
-		inet_ntop(AF_INET6, &ipaddress->u.sin6_addr, addr_str, sizeof(addr_str));
-		log_message(LOG_INFO, "Sending unsolicited Neighbour Advert on %s for %s",
-			    IF_NAME(ifp), addr_str);
-	}
-
-	/* Send packet */
-	len = sendmsg(ndisc_fd, &msg, 0);
-	if (len < 0) {
-		if (!addr_str[0])
-			inet_ntop(AF_INET6, &ipaddress->u.sin6_addr, addr_str, sizeof(addr_str));
-		log_message(LOG_INFO, "Error %d sending ndisc unsolicited neighbour advert on %s for %s",
-			    errno, IF_NAME(ifp), addr_str);
-	}
-}
-
 /*
  *	ICMPv6 Checksumming.
  */
@@ -162,8 +122,8 @@ ndisc_icmp6_cksum(const struct ip6hdr *ip6, struct iovec *iov, int iovcnt)
  *	Neighbor Advertisements in order to (unreliably) propagate
  *	new information quickly.
  */
-void
-ndisc_send_unsolicited_na_immediate(interface_t *ifp, ip_address_t *ipaddress)
+static void
+ndisc_build_unsolicited_na(interface_t *ifp, ip_address_t *ipaddress, garp_frame_t *frame)
 {
 	struct ether_header eth = { .ether_type = htons(ETHERTYPE_IPV6) };
 	ipoib_hdr_t ipoib = { .proto = htons(ETHERTYPE_IPV6) };
@@ -174,6 +134,24 @@ ndisc_send_unsolicited_na_immediate(interface_t *ifp, ip_address_t *ipaddress)
 	struct iovec iov[7];
 	unsigned num_iov;
 	unsigned icmp6_iov;
+	unsigned i;
+
+	memset(frame, 0, sizeof(*frame));
+	frame->ifp = ifp;
+	frame->ifindex = ipaddress->ifp->ifindex;
+	memcpy(frame->hw_addr, IF_HWADDR(ipaddress->ifp), ipaddress->ifp->hw_addr_len);
+	frame->router = ifp->gna_router;
+	inet_ntop(AF_INET6, &ipaddress->u.sin6_addr, frame->addr_str, sizeof(frame->addr_str));
+
+	/* Build the dst device */
+	frame->sll.sll_family = AF_PACKET;
+	frame->sll.sll_ifindex = (int)IF_INDEX(ipaddress->ifp);
+
+	/* The values in sll_ha_type, sll_addr and sll_halen appear to be ignored */
+	frame->sll.sll_hatype = ipaddress->ifp->hw_type;
+	frame->sll.sll_halen = ipaddress->ifp->hw_addr_len;
+	frame->sll.sll_protocol = htons(ETH_P_IPV6);
+	memcpy(frame->sll.sll_addr, IF_HWADDR(ipaddress->ifp), ipaddress->ifp->hw_addr_len);
 
 	/* For Infiniband see vrrp_arp.c and RFC2461 4.4, RFC4391, RFC4392 9.3 and
 	 * https://datatracker.ietf.org/doc/html/draft-kashyap-ipoib-ipv6-over-infiniband-00 */
@@ -210,11 +188,6 @@ ndisc_send_unsolicited_na_immediate(interface_t *ifp, ip_address_t *ipaddress)
 	num_iov++;
 
 	/* ICMPv6 Header */
-
-	/* Set the router flag if necessary. We recheck each interface if not
-	 * checked in the last 5 seconds. */
-	if (timer_cmp_now_diff(ifp->last_gna_router_check, 5 * TIMER_HZ))
-		set_ipv6_forwarding(ifp);
 	if (ifp->gna_router)
 		ndh.nd_na_flags_reserved |= ND_NA_FLAG_ROUTER;
 
@@ -252,14 +225,50 @@ ndisc_send_unsolicited_na_immediate(interface_t *ifp, ip_address_t *ipaddress)
 	ip6h.payload_len = htons(sizeof(struct nd_neighbor_advert) + nd_opt_h.nd_opt_len * 8);
 
 	/* Compute checksum - ICMP6 header onwards*/
-	ndh.nd_na_hdr.icmp6_cksum = ndisc_icmp6_cksum(&ip6h, &iov[icmp6_iov], num_iov - icmp6_iov);
+	ndh.nd_na_hdr.icmp6_cksum = ndisc_icmp6_cksum(&ip6h, &iov[icmp6_iov], (int)(num_iov - icmp6_iov));
+
+	/* Assemble the frame */
+	for (i = 0; i < num_iov; i++) {
+		memcpy(frame->data + frame->len, iov[i].iov_base, iov[i].iov_len);
+		frame->len += iov[i].iov_len;
+	}
+}
+
+/* Send, or queue if a batch is open, an unsolicited Neighbour Advertisement.
+ * The message, including its checksum, is built the first time and kept
+ * with the address. */
+void
+ndisc_send_unsolicited_na_immediate(interface_t *ifp, ip_address_t *ipaddress)
+{
+	garp_frame_t *frame = ipaddress->garp_frame;
+
+	if (!ndisc_tx)
+		return;
+
+	/* Set the router flag if necessary. We recheck each interface if not
+	 * checked in the last 5 seconds. */
+	if (timer_cmp_now_diff(ifp->last_gna_router_check, 5 * TIMER_HZ))
+		set_ipv6_forwarding(ifp);
+
+	if (!frame ||
+	    frame->ifp != ifp ||
+	    frame->ifindex != ipaddress->ifp->ifindex ||
+	    frame->router != ifp->gna_router ||
+	    memcmp(frame->hw_addr, IF_HWADDR(ipaddress->ifp), ipaddress->ifp->hw_addr_len)) {
+		if (!frame)
+			frame = ipaddress->garp_frame = MALLOC(sizeof(*frame));
+		ndisc_build_unsolicited_na(ifp, ipaddress, frame);
+	}
 
 	/* Send the neighbor advertisement message */
-	ndisc_send_na(ipaddress, iov, num_iov);
+	garp_tx_queue(ndisc_tx, frame);
 
 	/* If we have to delay between sending NAs, note the next time we can */
 	if (ifp->garp_delay && ifp->garp_delay->have_gna_interval)
 		ifp->garp_delay->gna_next_time = timer_add_now(ifp->garp_delay->gna_interval);
+
+	/* Every message sent on the interface holds back refresh messages */
+	garp_refresh_charge(ifp->garp_delay);
 }
 
 static void
@@ -326,12 +335,19 @@ ndisc_init(void)
 	/* We don't want to receive any data on this socket */
 	if_setsockopt_no_receive(&ndisc_fd);
 
+	ndisc_tx = garp_tx_open(ndisc_fd, "NA");
+
 	return true;
 }
 
 void
 ndisc_close(void)
 {
+	if (ndisc_tx) {
+		garp_tx_close(ndisc_tx);
+		ndisc_tx = NULL;
+	}
+
 	if (ndisc_fd != -1) {
 		close(ndisc_fd);
 		ndisc_fd = -1;
@@ -226,7 +226,6 @@ linkbeat_interfaces_handler(const vector_t *strvec)
 static void
 vrrp_sync_group_handler(const vector_t *strvec)
 {
-	vrrp_sgroup_t *sgroup;
 	const char *gname;
 
 	if (!strvec)
@@ -241,12 +240,10 @@ vrrp_sync_group_handler(const vector_t *strvec)
 	gname = strvec_slot(strvec, 1);
 
 	/* check group doesn't already exist */
-	list_for_each_entry(sgroup, &vrrp_data->vrrp_sync_group, e_list) {
-		if (!strcmp(gname, sgroup->gname)) {
-			report_config_error(CONFIG_GENERAL_ERROR, "vrrp sync group %s already defined", gname);
-			skip_block(true);
-			return;
-		}
+	if (str_map_find(&vrrp_data->vrrp_sync_group_names, gname)) {
+		report_config_error(CONFIG_GENERAL_ERROR, "vrrp sync group %s already defined", gname);
+		skip_block(true);
+		return;
 	}
 
 	current_vsyncg = alloc_vrrp_sync_group(gname);
@@ -314,6 +311,7 @@ vrrp_sync_group_end_handler(void)
 	}
 
 	list_add_tail(&current_vsyncg->e_list, &vrrp_data->vrrp_sync_group);
+	str_map_add(&vrrp_data->vrrp_sync_group_names, &current_vsyncg->n_node, current_vsyncg->gname);
 }
 
 static inline notify_script_t*
@@ -416,7 +414,6 @@ vrrp_sg_notify_priority_changes_handler(const vector_t *strvec)
 static void
 vrrp_handler(const vector_t *strvec)
 {
-	vrrp_t *vrrp;
 	const char *iname;
 
 	global_data->have_vrrp_config = true;
@@ -433,12 +430,10 @@ vrrp_handler(const vector_t *strvec)
 	iname = strvec_slot(strvec,1);
 
 	/* Make sure the vrrp instance doesn't already exist */
-	list_for_each_entry(vrrp, &vrrp_data->vrrp, e_list) {
-		if (!strcmp(iname, vrrp->iname)) {
-			report_config_error(CONFIG_GENERAL_ERROR, "vrrp instance %s already defined", iname);
-			skip_block(true);
-			return;
-		}
+	if (vrrp_get_instance(iname)) {
+		report_config_error(CONFIG_GENERAL_ERROR, "vrrp instance %s already defined", iname);
+		skip_block(true);
+		return;
 	}
 
 	current_vrrp = alloc_vrrp(iname);
@@ -476,6 +471,7 @@ vrrp_end_handler(void)
 		__clear_bit(VRRP_FLAG_LINKBEAT_USE_POLLING, &current_vrrp->flags);
 
 	list_add_tail(&current_vrrp->e_list, &vrrp_data->vrrp);
+	str_map_add(&vrrp_data->vrrp_names, &current_vrrp->n_node, current_vrrp->iname);
 }
 
 #ifdef _HAVE_VRRP_VMAC_
@@ -1609,6 +1605,7 @@ vrrp_vscript_end_handler(void)
 	}
 
 	list_add_tail(&current_vscr->e_list, &vrrp_data->vrrp_script);
+	str_map_add(&vrrp_data->vrrp_script_names, &current_vscr->n_node, current_vscr->sname);
 }
 
 #ifdef _WITH_TRACK_PROCESS_
@@ -1808,6 +1805,7 @@ vrrp_tprocess_end_handler(void)
 		vrrp_data->vrrp_use_process_comm = true;
 
 	list_add_tail(&current_tp->e_list, &vrrp_data->vrrp_track_processes);
+	str_map_add(&vrrp_data->vrrp_track_process_names, &current_tp->n_node, current_tp->pname);
 }
 #endif
 static void
@@ -1896,6 +1894,18 @@ garp_group_gna_interval_handler(const vector_t *strvec)
 		log_message(LOG_INFO, "The gna_interval is very large - %s seconds", strvec_slot(strvec,1));
 }
 static void
+garp_group_refresh_rate_handler(const vector_t *strvec)
+{
+	unsigned val;
+
+	if (!read_unsigned_strvec(strvec, 1, &val, 1, 1000000, true)) {
+		report_config_error(CONFIG_GENERAL_ERROR, "garp_group garp_refresh_rate '%s' invalid", strvec_slot(strvec, 1));
+		return;
+	}
+
+	current_ggd->refresh_rate = val;
+}
+static void
 garp_group_interface_handler(const vector_t *strvec)
 {
 	interface_t *ifp = if_get_by_ifname(strvec_slot(strvec, 1), IF_CREATE_IF_DYNAMIC);
@@ -1971,7 +1981,7 @@ garp_group_end_handler(void)
 	interface_t *ifp;
 	list_head_t *ifq;
 
-	if (!current_ggd->have_garp_interval && !current_ggd->have_gna_interval) {
+	if (!current_ggd->have_garp_interval && !current_ggd->have_gna_interval && !current_ggd->refresh_rate) {
 		report_config_error(CONFIG_GENERAL_ERROR, "garp group %d does not have any delay set - removing", current_ggd->aggregation_group);
 
 		/* Remove the garp_delay from any interfaces that are using it */
@@ -2082,6 +2092,7 @@ init_vrrp_keywords(bool active)
 	install_keyword_root("garp_group", &garp_group_handler, active, VPP &current_ggd);
 	install_keyword("garp_interval", &garp_group_garp_interval_handler);
 	install_keyword("gna_interval", &garp_group_gna_interval_handler);
+	install_keyword("garp_refresh_rate", &garp_group_refresh_rate_handler);
 	install_keyword("interface", &garp_group_interface_handler);
 	install_keyword("interfaces", &garp_group_interfaces_handler);
 	install_level_end_handler(&garp_group_end_handler);
@@ -34,6 +34,8 @@
 #include "vrrp.h"
 #include "vrrp_data.h"
 #include "vrrp_print.h"
+#include "keepalived_netlink.h"
+#include "vrrp_garp_tx.h"
 #include "utils.h"
 
 
@@ -104,5 +106,9 @@ vrrp_print_stats(bool clear_stats)
 		if (clear_stats)
 			memset(vrrp->stats, 0, sizeof(*vrrp->stats));
 	}
+
+	netlink_print_stats(file, clear_stats);
+	garp_tx_print_stats(file, clear_stats);
+
 	fclose(file);
 }
@@ -42,6 +42,7 @@
 #include "vrrp_data.h"
 #include "vrrp_arp.h"
 #include "vrrp_ndisc.h"
+#include "vrrp_garp_tx.h"
 #include "vrrp_if.h"
 #include "global_data.h"
 #include "memory.h"
@@ -77,6 +78,7 @@
 /* global vars */
 timeval_t garp_next_time;
 thread_ref_t garp_thread;
+thread_ref_t garp_refresh_thread;
 bool vrrp_initialised;
 timeval_t vrrp_delayed_start_time;
 
@@ -93,6 +95,18 @@ bool do_recvmsg_debug_dump;
 static thread_ref_t bfd_thread;		 /* BFD control pipe read thread */
 #endif
 
+/* recvmmsg() message headers. Packet i is received into the i'th
+ * vrrp_buffer_len bytes of vrrp_buffer. */
+#ifdef _NETWORK_TIMESTAMP_
+#define VRRP_RX_CONTROL_LEN	128
+#else
+#define VRRP_RX_CONTROL_LEN	64
+#endif
+static struct mmsghdr vrrp_rx_msgs[VRRP_RX_BATCH];
+static struct iovec vrrp_rx_iovecs[VRRP_RX_BATCH];
+static sockaddr_t vrrp_rx_addrs[VRRP_RX_BATCH];
+static char vrrp_rx_control[VRRP_RX_BATCH][VRRP_RX_CONTROL_LEN] __attribute__((aligned(__alignof__(struct cmsghdr))));
+
 /* VRRP FSM (Finite State Machine) design.
  *
  * The state transition diagram implemented is :
@@ -375,6 +389,32 @@ vrrp_thread_requeue_read(vrrp_t *vrrp)
 	thread_requeue_read(master, vrrp->sockets->fd_in, vrrp_compute_timer(vrrp->sockets));
 }
 
+/* The earliest time a VRRP advert must be sent, or the master down timer
+ * expires. This is the scheduler watchdog's deadline. */
+bool
+vrrp_next_deadline(timeval_t *deadline)
+{
+	sock_t *sock;
+	const vrrp_t *vrrp;
+	bool found = false;
+
+	list_for_each_entry(sock, &vrrp_data->vrrp_socket_pool, e_list) {
+		if (sock->fd_in == -1 || !rb_first_cached(&sock->rb_sands))
+			continue;
+
+		vrrp = rb_entry_const(rb_first_cached(&sock->rb_sands), vrrp_t, rb_sands);
+		if (vrrp->sands.tv_sec == TIMER_DISABLED)
+			continue;
+
+		if (!found || timercmp(&vrrp->sands, deadline, <)) {
+			*deadline = vrrp->sands;
+			found = true;
+		}
+	}
+
+	return found;
+}
+
 /* Thread functions */
 static void
 vrrp_register_workers(list_head_t *l)
@@ -409,7 +449,7 @@ vrrp_register_workers(list_head_t *l)
 		/* Register a timer thread if interface exists */
 		if (sock->fd_in != -1)
 			sock->thread = thread_add_read_sands(master, vrrp_read_dispatcher_thread,
-						       sock, sock->fd_in, vrrp_compute_timer(sock), 0);
+						       sock, sock->fd_in, vrrp_compute_timer(sock), THREAD_PERSISTENT | THREAD_REALTIME);
 	}
 }
 
@@ -417,7 +457,7 @@ void
 vrrp_thread_add_read(vrrp_t *vrrp)
 {
 	vrrp->sockets->thread = thread_add_read_sands(master, vrrp_read_dispatcher_thread,
-						vrrp->sockets, vrrp->sockets->fd_in, vrrp_compute_timer(vrrp->sockets), 0);
+						vrrp->sockets, vrrp->sockets->fd_in, vrrp_compute_timer(vrrp->sockets), THREAD_PERSISTENT | THREAD_REALTIME);
 }
 
 /* VRRP dispatcher functions */
@@ -738,6 +778,9 @@ try_up_instance(vrrp_t *vrrp, bool leaving_init)
 			ip_addr.u.sin6_addr = PTR_CAST(struct sockaddr_in6, &vrrp->saddr)->sin6_addr;
 			ndisc_send_unsolicited_na_immediate(ip_addr.ifp, &ip_addr);
 		}
+
+		/* The frame has been sent or copied for sending */
+		FREE_PTR(ip_addr.garp_frame);
 	}
 
 	vrrp_init_instance_sands(vrrp);
@@ -773,39 +816,35 @@ vrrp_handle_bfd_event(bfd_event_t * evt)
 			    evt->iname, BFD_STATE_STR(evt->state), delivery_time);
 	}
 
-	list_for_each_entry(vbfd, &vrrp_data->vrrp_track_bfds, e_list) {
-		if (strcmp(vbfd->bname, evt->iname))
-			continue;
-
-		if ((vbfd->bfd_up && evt->state == BFD_STATE_UP) ||
-		    (!vbfd->bfd_up && evt->state == BFD_STATE_DOWN))
-			continue;
+	if (!(vbfd = find_vrrp_tracked_bfd_by_name(evt->iname)))
+		return;
 
-		vbfd->bfd_up = (evt->state == BFD_STATE_UP);
+	if ((vbfd->bfd_up && evt->state == BFD_STATE_UP) ||
+	    (!vbfd->bfd_up && evt->state == BFD_STATE_DOWN))
+		return;
 
-		list_for_each_entry(tbfd, &vbfd->tracking_vrrp, e_list) {
-			vrrp = tbfd->obj.vrrp;
+	vbfd->bfd_up = (evt->state == BFD_STATE_UP);
 
-			log_message(LOG_INFO, "VRRP_Instance(%s) Tracked BFD"
-				    " instance %s is %s", vrrp->iname, evt->iname, vbfd->bfd_up ? "UP" : "DOWN");
+	list_for_each_entry(tbfd, &vbfd->tracking_vrrp, e_list) {
+		vrrp = tbfd->obj.vrrp;
 
-			if (tbfd->weight) {
-				if (vbfd->bfd_up)
-					vrrp->total_priority += abs(tbfd->weight) * tbfd->weight_multiplier;
-				else
-					vrrp->total_priority -= abs(tbfd->weight) * tbfd->weight_multiplier;
-				vrrp_set_effective_priority(vrrp);
+		log_message(LOG_INFO, "VRRP_Instance(%s) Tracked BFD"
+			    " instance %s is %s", vrrp->iname, evt->iname, vbfd->bfd_up ? "UP" : "DOWN");
 
-				continue;
-			}
-
-			if (!!vbfd->bfd_up == (tbfd->weight_multiplier == 1))
-				try_up_instance(vrrp, false);
+		if (tbfd->weight) {
+			if (vbfd->bfd_up)
+				vrrp->total_priority += abs(tbfd->weight) * tbfd->weight_multiplier;
 			else
-				down_instance(vrrp);
+				vrrp->total_priority -= abs(tbfd->weight) * tbfd->weight_multiplier;
+			vrrp_set_effective_priority(vrrp);
+
+			continue;
 		}
 
-		break;
+		if (!!vbfd->bfd_up == (tbfd->weight_multiplier == 1))
+			try_up_instance(vrrp, false);
+		else
+			down_instance(vrrp);
 	}
 }
 
@@ -839,6 +878,9 @@ vrrp_dispatcher_read_timeout(sock_t *sock)
 
 	set_time_now();
 
+	/* Send the adverts of all the instances timing out together */
+	vrrp_tx_batch_open();
+
 	rb_for_each_entry_cached(vrrp, &sock->rb_sands, rb_sands) {
 		if (vrrp->sands.tv_sec == TIMER_DISABLED ||
 		    timercmp(&vrrp->sands, &time_now, >))
@@ -865,53 +907,254 @@ vrrp_dispatcher_read_timeout(sock_t *sock)
 		vrrp_init_instance_sands(vrrp);
 	}
 
+	vrrp_tx_batch_close();
+
 	return sock->fd_in;
 }
 
-/* Handle dispatcher read packet */
-static int
-vrrp_dispatcher_read(sock_t *sock)
+/* Process a received advert. Returns true if no more adverts should be
+ * received this time. */
+static bool
+vrrp_dispatcher_read_pkt(sock_t *sock, const char *buf, ssize_t len, struct msghdr *msghdr, unsigned long *rx_vrid_map)
 {
 	vrrp_t *vrrp;
 	rb_node_t *vrrp_node;
 	const vrrphdr_t *hd;
-	ssize_t len = 0;
 	int prev_state = 0;
-	sockaddr_t src_addr = { .ss_family = AF_UNSPEC };
-#ifdef _NETWORK_TIMESTAMP_
-	char control_buf[128] __attribute__((aligned(__alignof__(struct cmsghdr))));
-#else
-	char control_buf[64] __attribute__((aligned(__alignof__(struct cmsghdr))));
-#endif
-	struct iovec iovec = { .iov_base = vrrp_buffer, .iov_len = vrrp_buffer_len };
-	struct msghdr msghdr = { .msg_name = &src_addr, .msg_namelen = sizeof(src_addr),
-				 .msg_iov = &iovec, .msg_iovlen = 1,
-				 .msg_control = control_buf, .msg_controllen = sizeof(control_buf) };
+	const sockaddr_t *src_addr = msghdr->msg_name;
 	struct cmsghdr *cmsg;
 	bool expected_cmsg;
+	bool terminate_receiving = false;
+	const struct iphdr *iph;
+	unicast_peer_t *unicast_peer;
+
+	if (msghdr->msg_flags & MSG_TRUNC) {
+		log_message(LOG_INFO, "recvmsg(%d) message truncated from %zd to %zu bytes"
+				    , sock->fd_in, len, vrrp_buffer_len);
+		return false;
+	}
+
+	if (msghdr->msg_flags & MSG_CTRUNC) {
+		log_message(LOG_INFO, "recvmsg(%d), control message truncated from %zu to %" PRI_MSG_CONTROLLEN " bytes"
+				    , sock->fd_in, sizeof(vrrp_rx_control[0]), msghdr->msg_controllen);
+		msghdr->msg_controllen = 0;
+	}
+
+	if (vrrp_delayed_start_time.tv_sec)
+		return false;
+
+	/* Check the received data includes at least the IP, possibly
+	 * the AH header and the VRRP header */
+	if (!(hd = vrrp_get_header(sock->family, buf, len)))
+		return true;
+
+	vrrp_node = rb_find(&hd->vrid, &sock->rb_vrid, vrrp_vrid_cmp);
+
+	/* No instance found => ignore the advert */
+	if (!vrrp_node) {
+		if (global_data->log_unknown_vrids)
+			log_message(LOG_INFO, "Unknown VRID(%d) received on interface(%s). ignoring..."
+					    , hd->vrid, IF_NAME(sock->ifp));
+		return false;
+	}
+	vrrp = rb_entry(vrrp_node, vrrp_t, rb_vrid);
+
+	/* Defense strategy here is to handle no more than one advert
+	 * per VRID in order to flush socket rcvq...
+	 * This is a best effort mitigation */
+	if (__test_and_set_bit_array(hd->vrid, rx_vrid_map))
+		terminate_receiving = true;
+
+	if (__test_bit(VRRP_FLAG_UNICAST_DUPLICATE_VRID, &vrrp->flags)) {
+		rb_node_t *first = vrrp_node;	/* Save for second loop */
+
+		/* First check the address we last received an advert from. This is
+		 * an optimisation since we are most likely to receive an advert from
+		 * the same address as last time, and it saves searching all the peers. */
+		for (; vrrp_node; vrrp_node = rb_next_match(&hd->vrid, vrrp_node, vrrp_vrid_cmp)) {
+			vrrp = rb_entry(vrrp_node, vrrp_t, rb_vrid);
+			if (!inet_sockaddrcmp(src_addr, &vrrp->pkt_saddr))
+				break;
+		}
+
+		if (!vrrp_node) {
+			/* Loop through VRRP instances matching hd->vrid if unicast to match
+			 * src address of packet against configured peers */
+			for (vrrp_node = first; vrrp_node; vrrp_node = rb_next_match(&hd->vrid, vrrp_node, vrrp_vrid_cmp)) {
+				vrrp = rb_entry(vrrp_node, vrrp_t, rb_vrid);
+
+				list_for_each_entry(unicast_peer, &vrrp->unicast_peer, e_list) {
+					if (inet_sockaddrcmp(src_addr, &unicast_peer->address) == 0)
+						break;
+					if (list_is_last(&unicast_peer->e_list, &vrrp->unicast_peer)) {
+						unicast_peer = NULL;
+						break;
+					}
+				}
+
+				/* We have found the matching peer */
+				if (unicast_peer)
+					break;
+			}
+
+			if (!vrrp_node) {
+				/* Do nothing and fail because we didn't match any good instance */
+				if (global_data->log_unknown_vrids)
+					log_message(LOG_INFO, "Unknown VRID(%d) received on interface(%s) from %s. ignoring..."
+							    , hd->vrid, IF_NAME(sock->ifp), inet_sockaddrtos(src_addr));
+
+				return terminate_receiving;
+			}
+		}
+	}
+
+	if (vrrp->state == VRRP_STATE_FAULT || vrrp->state == VRRP_STATE_INIT) {
+		/* We just ignore a message received when we are in fault state or
+		 * not yet fully initialised */
+		return terminate_receiving;
+	}
+
+	/* Save non packet data */
+	vrrp->pkt_saddr = *src_addr;
+	vrrp->rx_ttl_hop_limit = -1;           /* Default to not received */
+	if (sock->family == AF_INET) {
+		iph = PTR_CAST_CONST(struct iphdr, buf);
+		vrrp->multicast_pkt = IN_MULTICAST(htonl(iph->daddr));
+		vrrp->rx_ttl_hop_limit = iph->ttl;
+	} else
+		vrrp->multicast_pkt = false;
+	for (cmsg = CMSG_FIRSTHDR(msghdr); cmsg; cmsg = CMSG_NXTHDR(msghdr, cmsg)) {
+		expected_cmsg = false;
+		if (cmsg->cmsg_level == IPPROTO_IPV6) {
+			expected_cmsg = true;
+
+			if (cmsg->cmsg_type == IPV6_HOPLIMIT &&
+			    cmsg->cmsg_len - sizeof(struct cmsghdr) == sizeof(unsigned int))
+				vrrp->rx_ttl_hop_limit = *PTR_CAST(unsigned int, CMSG_DATA(cmsg));
+			else
+			if (cmsg->cmsg_type == IPV6_PKTINFO &&
+			    cmsg->cmsg_len - sizeof(struct cmsghdr) == sizeof(struct in6_pktinfo))
+				vrrp->multicast_pkt = IN6_IS_ADDR_MULTICAST(&(PTR_CAST(struct in6_pktinfo, CMSG_DATA(cmsg)))->ipi6_addr);
+			else
+				expected_cmsg = false;
+		}
+#ifdef _NETWORK_TIMESTAMP_
+		else if (do_network_timestamp && cmsg->cmsg_level == SOL_SOCKET) {
+			struct timespec *ts = (void *)CMSG_DATA(cmsg);
+			char time_buf[9];
+
+			expected_cmsg = true;
+			if (cmsg->cmsg_type == SO_TIMESTAMPNS) {
+				strftime(time_buf, sizeof time_buf, "%T", localtime(&ts->tv_sec));
+				log_message(LOG_INFO, "TIMESTAMPNS (socket %d - VRID %u) %s.%9.9ld"
+						    , sock->fd_in, hd->vrid, time_buf, ts->tv_nsec);
+			}
+#if 0
+			if (cmsg->cmsg_type == SO_TIMESTAMP) {
+				struct timeval *tv = (void *)CMSG_DATA(cmsg);
+				log_message(LOG_INFO, "TIMESTAMP message (%d - %u)  %ld.%9.9ld"
+						    , sock->fd_in, hd->vrid, tv->tv_sec, tv->tv_usec);
+			}
+			else if (cmsg->cmsg_type == SO_TIMESTAMPING) {
+				struct timespec *ts = (void *)CMSG_DATA(cmsg);
+				log_message(LOG_INFO, "TIMESTAMPING message (%d - %u)  %ld.%9.9ld, raw %ld.%9.9ld"
+						    , sock->fd_in, hd->vrid, ts->tv_sec, ts->tv_nsec, (ts+2)->tv_sec, (ts+2)->tv_nsec);
+			}
+#endif
+			else
+				expected_cmsg = false;
+		}
+#endif
+
+		if (!expected_cmsg)
+			log_message(LOG_INFO, "fd %d, unexpected control msg len %" PRI_MSG_CONTROLLEN ", level %d, type %d"
+					    , sock->fd_in, cmsg->cmsg_len
+					    , cmsg->cmsg_level, cmsg->cmsg_type);
+	}
+
+	/* For multicast, we attempt to bind the socket to ::1 to stop receiving any (non ::1)
+	 * unicast packets, but if that fails we will receive unicast packets on the multicast socket,
+	 * so just discard them here.
+	 * For unicast sockets, if any other instance on the same interface is using multicast we
+	 * will also receive the multicast packets, so also discard them here. */
+	if (sock->family == AF_INET6 && vrrp->multicast_pkt == __test_bit(VRRP_FLAG_UNICAST, &vrrp->flags)) {
+		if (__test_bit(LOG_DETAIL_BIT, &debug))
+			log_message(LOG_INFO, "(%s) discarding %sicast packet on %sicast instance", vrrp->iname,
+					vrrp->multicast_pkt ? "mult" : "un", __test_bit(VRRP_FLAG_UNICAST, &vrrp->flags) ? "un" : "mult");
+		return terminate_receiving;
+	}
+
+	prev_state = vrrp->state;
+
+	if (vrrp->state == VRRP_STATE_BACK)
+		vrrp_state_backup(vrrp, hd, buf, len);
+	else if (vrrp->state == VRRP_STATE_MAST) {
+		if (vrrp_state_master_rx(vrrp, hd, buf, len))
+			vrrp_state_leave_master(vrrp, false);
+	} else
+		log_message(LOG_INFO, "(%s) In dispatcher_read with state %d"
+				    , vrrp->iname, vrrp->state);
+
+
+	/* handle instance synchronization */
+#ifdef _TSM_DEBUG_
+	if (do_tsm_debug)
+		log_message(LOG_INFO, "Read [%s] TSM transition : [%d,%d] Wantstate = [%d]"
+				    , vrrp->iname, prev_state, vrrp->state, vrrp->wantstate);
+#endif
+	VRRP_TSM_HANDLE(prev_state, vrrp);
+
+	/* If we have sent an advert, reset the timer */
+	if (vrrp->state != VRRP_STATE_MAST || !vrrp->lower_prio_no_advert)
+		vrrp_init_instance_sands(vrrp);
+
+	return terminate_receiving;
+}
+
+/* Handle dispatcher read packet */
+static int
+vrrp_dispatcher_read(sock_t *sock)
+{
+	struct msghdr *msghdr;
+	int num;
+	int i;
+	ssize_t len;
 	unsigned eintr_count;
 	unsigned long rx_vrid_map[BIT_WORD(256 + BIT_PER_LONG - 1)] = { 0 };
 	bool terminate_receiving = false;
 #ifdef DEBUG_RECVMSG
 	unsigned recv_data_count = 0;
 #endif
-	const struct iphdr *iph;
-	unicast_peer_t *unicast_peer;
 
 	/* Strategy here is to handle incoming adverts pending into socket recvq
 	 * but stop if receive 2nd advert for a VRID on socket (this applies to
 	 * both configured and unconfigured VRIDs).
-	 * Seems a good tradeoff while simulating */
+	 * Seems a good tradeoff while simulating.
+	 * Adverts are received VRRP_RX_BATCH at a time, and once a batch has
+	 * been received all its adverts are processed. */
 	while (!terminate_receiving) {
-		/* read & affect received buffer */
+		/* The buffers may have been reallocated since the last batch */
+		for (i = 0; i < VRRP_RX_BATCH; i++) {
+			vrrp_rx_iovecs[i].iov_base = PTR_CAST(char, vrrp_buffer) + i * vrrp_buffer_len;
+			vrrp_rx_iovecs[i].iov_len = vrrp_buffer_len;
+			msghdr = &vrrp_rx_msgs[i].msg_hdr;
+			msghdr->msg_name = &vrrp_rx_addrs[i];
+			msghdr->msg_namelen = sizeof(vrrp_rx_addrs[i]);
+			msghdr->msg_iov = &vrrp_rx_iovecs[i];
+			msghdr->msg_iovlen = 1;
+			msghdr->msg_control = vrrp_rx_control[i];
+			msghdr->msg_controllen = sizeof(vrrp_rx_control[i]);
+		}
+
+		/* read & affect received buffers */
 		eintr_count = 0;
-		while ((len = recvmsg(sock->fd_in, &msghdr, MSG_TRUNC | MSG_CTRUNC)) == -1 &&
+		while ((num = recvmmsg(sock->fd_in, vrrp_rx_msgs, VRRP_RX_BATCH, MSG_TRUNC | MSG_CTRUNC, NULL)) == -1 &&
 		       check_EINTR(errno) && eintr_count++ < 10);
-		if (len < 0) {
+		if (num < 0) {
 #ifdef DEBUG_RECVMSG
 #ifdef _RECVMSG_DEBUG_
 			if (do_recvmsg_debug && (!recv_data_count || !check_EAGAIN(errno)))
-				log_message(LOG_INFO, "recvmsg(%d) returned errno %d, %u eintr", sock->fd_in, errno, eintr_count);
+				log_message(LOG_INFO, "recvmmsg(%d) returned errno %d, %u eintr", sock->fd_in, errno, eintr_count);
 #endif
 
 #ifdef _RECVMSG_DEBUG_
@@ -919,13 +1162,13 @@ vrrp_dispatcher_read(sock_t *sock)
 #endif
 			{
 				if (check_EINTR(errno))
-					log_message(LOG_INFO, "recvmsg(%d) looped %u times due to EINTR before terminating loop"
+					log_message(LOG_INFO, "recvmmsg(%d) looped %u times due to EINTR before terminating loop"
 							    , sock->fd_in, eintr_count);
 			}
 #endif
 
 			if (!check_EAGAIN(errno))
-				log_message(LOG_INFO, "recvmsg(%d) returned %d (%m)"
+				log_message(LOG_INFO, "recvmmsg(%d) returned %d (%m)"
 						    , sock->fd_in, errno);
 #ifdef DEBUG_RECVMSG
 			else if (
@@ -933,226 +1176,60 @@ vrrp_dispatcher_read(sock_t *sock)
 				 do_recvmsg_debug &&
 #endif
 				 recv_data_count == 0)
-				log_message(LOG_INFO, "recvmsg(%d) returned EAGAIN without any data being received"
+				log_message(LOG_INFO, "recvmmsg(%d) returned EAGAIN without any data being received"
 						    , sock->fd_in);
-
-#ifdef _RECVMSG_DEBUG_
-			if (do_recvmsg_debug)
-#endif
-			{
-				if (recv_data_count != 1)
-					log_message(LOG_INFO, "recvmsg(%d) loop received %u packets"
-							    , sock->fd_in, recv_data_count);
-			}
 #endif
 			break;
 		}
 #ifdef _RECVMSG_DEBUG_
 		else if (do_recvmsg_debug)
-			log_message(LOG_INFO, "recvmsg(%d) looped %u times due to EINTR before returning %zd bytes from %s"
-					    , sock->fd_in, eintr_count, len, inet_sockaddrtos(&src_addr));
+			log_message(LOG_INFO, "recvmmsg(%d) looped %u times due to EINTR before returning %d packets"
+					    , sock->fd_in, eintr_count, num);
 #elif defined DEBUG_RECVMSG
 		if (eintr_count)
-			log_message(LOG_INFO, "recvmsg(%d) looped %u times due to EINTR before returning %ld"
-					    , sock->fd_in, eintr_count, len);
+			log_message(LOG_INFO, "recvmmsg(%d) looped %u times due to EINTR before returning %d"
+					    , sock->fd_in, eintr_count, num);
 #endif
 
-		/* Don't attempt to process data if no data received */
-		if (len == 0) {
-			log_message(LOG_INFO, "recvmsg(%d) returned data length 0", sock->fd_in);
-			continue;
-		}
+		for (i = 0; i < num; i++) {
+			msghdr = &vrrp_rx_msgs[i].msg_hdr;
+			len = vrrp_rx_msgs[i].msg_len;
+
+			/* Don't attempt to process data if no data received */
+			if (len == 0) {
+				log_message(LOG_INFO, "recvmmsg(%d) returned data length 0", sock->fd_in);
+				continue;
+			}
 
 #ifdef _RECVMSG_DEBUG_
-		if (do_recvmsg_debug_dump) {
-			log_buffer("Received data", vrrp_buffer, len);
-		}
+			if (do_recvmsg_debug_dump) {
+				log_buffer("Received data", vrrp_rx_iovecs[i].iov_base, len);
+			}
 #endif
 
 #ifdef DEBUG_RECVMSG
-		recv_data_count++;
+			recv_data_count++;
 #endif
 
-		if (msghdr.msg_flags & MSG_TRUNC) {
-			log_message(LOG_INFO, "recvmsg(%d) message truncated from %zd to %zu bytes"
-					    , sock->fd_in, len, vrrp_buffer_len);
-			continue;
-		}
-
-		if (msghdr.msg_flags & MSG_CTRUNC) {
-			log_message(LOG_INFO, "recvmsg(%d), control message truncated from %zu to %" PRI_MSG_CONTROLLEN " bytes"
-					    , sock->fd_in, sizeof(control_buf), msghdr.msg_controllen);
-			msghdr.msg_controllen = 0;
+			if (vrrp_dispatcher_read_pkt(sock, vrrp_rx_iovecs[i].iov_base, len, msghdr, rx_vrid_map))
+				terminate_receiving = true;
 		}
 
-		if (vrrp_delayed_start_time.tv_sec)
-			continue;
-
-		/* Check the received data includes at least the IP, possibly
-		 * the AH header and the VRRP header */
-		if (!(hd = vrrp_get_header(sock->family, vrrp_buffer, len)))
+		/* A short batch means the receive queue is empty */
+		if (num < VRRP_RX_BATCH || sock->fd_in == -1)
 			break;
+	}
 
-		vrrp_node = rb_find(&hd->vrid, &sock->rb_vrid, vrrp_vrid_cmp);
-
-		/* No instance found => ignore the advert */
-		if (!vrrp_node) {
-			if (global_data->log_unknown_vrids)
-				log_message(LOG_INFO, "Unknown VRID(%d) received on interface(%s). ignoring..."
-						    , hd->vrid, IF_NAME(sock->ifp));
-			continue;
-		}
-		vrrp = rb_entry(vrrp_node, vrrp_t, rb_vrid);
-
-		/* Defense strategy here is to handle no more than one advert
-		 * per VRID in order to flush socket rcvq...
-		 * This is a best effort mitigation */
-		if (__test_and_set_bit_array(hd->vrid, rx_vrid_map))
-			terminate_receiving = true;
-
-		if (__test_bit(VRRP_FLAG_UNICAST_DUPLICATE_VRID, &vrrp->flags)) {
-			rb_node_t *first = vrrp_node;	/* Save for second loop */
-
-			/* First check the address we last received an advert from. This is
-			 * an optimisation since we are most likely to receive an advert from
-			 * the same address as last time, and it saves searching all the peers. */
-			for (; vrrp_node; vrrp_node = rb_next_match(&hd->vrid, vrrp_node, vrrp_vrid_cmp)) {
-				vrrp = rb_entry(vrrp_node, vrrp_t, rb_vrid);
-				if (!inet_sockaddrcmp(&src_addr, &vrrp->pkt_saddr))
-					break;
-			}
-
-			if (!vrrp_node) {
-				/* Loop through VRRP instances matching hd->vrid if unicast to match
-				 * src address of packet against configured peers */
-				for (vrrp_node = first; vrrp_node; vrrp_node = rb_next_match(&hd->vrid, vrrp_node, vrrp_vrid_cmp)) {
-					vrrp = rb_entry(vrrp_node, vrrp_t, rb_vrid);
-
-					list_for_each_entry(unicast_peer, &vrrp->unicast_peer, e_list) {
-						if (inet_sockaddrcmp(&src_addr, &unicast_peer->address) == 0)
-							break;
-						if (list_is_last(&unicast_peer->e_list, &vrrp->unicast_peer)) {
-							unicast_peer = NULL;
-							break;
-						}
-					}
-
-					/* We have found the matching peer */
-					if (unicast_peer)
-						break;
-				}
-
-				if (!vrrp_node) {
-					/* Do nothing and fail because we didn't match any good instance */
-					if (global_data->log_unknown_vrids)
-						log_message(LOG_INFO, "Unknown VRID(%d) received on interface(%s) from %s. ignoring..."
-								    , hd->vrid, IF_NAME(sock->ifp), inet_sockaddrtos(&src_addr));
-
-					continue;
-				}
-			}
-		}
-
-		if (vrrp->state == VRRP_STATE_FAULT || vrrp->state == VRRP_STATE_INIT) {
-			/* We just ignore a message received when we are in fault state or
-			 * not yet fully initialised */
-			continue;
-		}
-
-		/* Save non packet data */
-		vrrp->pkt_saddr = src_addr;
-		vrrp->rx_ttl_hop_limit = -1;           /* Default to not received */
-		if (sock->family == AF_INET) {
-			iph = PTR_CAST_CONST(struct iphdr, vrrp_buffer);
-			vrrp->multicast_pkt = IN_MULTICAST(htonl(iph->daddr));
-			vrrp->rx_ttl_hop_limit = iph->ttl;
-		} else
-			vrrp->multicast_pkt = false;
-		for (cmsg = CMSG_FIRSTHDR(&msghdr); cmsg; cmsg = CMSG_NXTHDR(&msghdr, cmsg)) {
-			expected_cmsg = false;
-			if (cmsg->cmsg_level == IPPROTO_IPV6) {
-				expected_cmsg = true;
-
-				if (cmsg->cmsg_type == IPV6_HOPLIMIT &&
-				    cmsg->cmsg_len - sizeof(struct cmsghdr) == sizeof(unsigned int))
-					vrrp->rx_ttl_hop_limit = *PTR_CAST(unsigned int, CMSG_DATA(cmsg));
-				else
-				if (cmsg->cmsg_type == IPV6_PKTINFO &&
-				    cmsg->cmsg_len - sizeof(struct cmsghdr) == sizeof(struct in6_pktinfo))
-					vrrp->multicast_pkt = IN6_IS_ADDR_MULTICAST(&(PTR_CAST(struct in6_pktinfo, CMSG_DATA(cmsg)))->ipi6_addr);
-				else
-					expected_cmsg = false;
-			}
-#ifdef _NETWORK_TIMESTAMP_
-			else if (do_network_timestamp && cmsg->cmsg_level == SOL_SOCKET) {
-				struct timespec *ts = (void *)CMSG_DATA(cmsg);
-				char time_buf[9];
-
-				expected_cmsg = true;
-				if (cmsg->cmsg_type == SO_TIMESTAMPNS) {
-					strftime(time_buf, sizeof time_buf, "%T", localtime(&ts->tv_sec));
-					log_message(LOG_INFO, "TIMESTAMPNS (socket %d - VRID %u) %s.%9.9ld"
-							    , sock->fd_in, hd->vrid, time_buf, ts->tv_nsec);
-				}
-#if 0
-				if (cmsg->cmsg_type == SO_TIMESTAMP) {
-					struct timeval *tv = (void *)CMSG_DATA(cmsg);
-					log_message(LOG_INFO, "TIMESTAMP message (%d - %u)  %ld.%9.9ld"
-							    , sock->fd_in, hd->vrid, tv->tv_sec, tv->tv_usec);
-				}
-				else if (cmsg->cmsg_type == SO_TIMESTAMPING) {
-					struct timespec *ts = (void *)CMSG_DATA(cmsg);
-					log_message(LOG_INFO, "TIMESTAMPING message (%d - %u)  %ld.%9.9ld, raw %ld.%9.9ld"
-							    , sock->fd_in, hd->vrid, ts->tv_sec, ts->tv_nsec, (ts+2)->tv_sec, (ts+2)->tv_nsec);
-				}
-#endif
-				else
-					expected_cmsg = false;
-			}
-#endif
-
-			if (!expected_cmsg)
-				log_message(LOG_INFO, "fd %d, unexpected control msg len %" PRI_MSG_CONTROLLEN ", level %d, type %d"
-						    , sock->fd_in, cmsg->cmsg_len
-						    , cmsg->cmsg_level, cmsg->cmsg_type);
-		}
-
-		/* For multicast, we attempt to bind the socket to ::1 to stop receiving any (non ::1)
-		 * unicast packets, but if that fails we will receive unicast packets on the multicast socket,
-		 * so just discard them here.
-		 * For unicast sockets, if any other instance on the same interface is using multicast we
-		 * will also receive the multicast packets, so also discard them here. */
-		if (sock->family == AF_INET6 && vrrp->multicast_pkt == __test_bit(VRRP_FLAG_UNICAST, &vrrp->flags)) {
-			if (__test_bit(LOG_DETAIL_BIT, &debug))
-				log_message(LOG_INFO, "(%s) discarding %sicast packet on %sicast instance", vrrp->iname,
-						vrrp->multicast_pkt ? "mult" : "un", __test_bit(VRRP_FLAG_UNICAST, &vrrp->flags) ? "un" : "mult");
-			continue;
-		}
-
-		prev_state = vrrp->state;
-
-		if (vrrp->state == VRRP_STATE_BACK)
-			vrrp_state_backup(vrrp, hd, vrrp_buffer, len);
-		else if (vrrp->state == VRRP_STATE_MAST) {
-			if (vrrp_state_master_rx(vrrp, hd, vrrp_buffer, len))
-				vrrp_state_leave_master(vrrp, false);
-		} else
-			log_message(LOG_INFO, "(%s) In dispatcher_read with state %d"
-					    , vrrp->iname, vrrp->state);
-
-
-		/* handle instance synchronization */
-#ifdef _TSM_DEBUG_
-		if (do_tsm_debug)
-			log_message(LOG_INFO, "Read [%s] TSM transition : [%d,%d] Wantstate = [%d]"
-					    , vrrp->iname, prev_state, vrrp->state, vrrp->wantstate);
+#ifdef DEBUG_RECVMSG
+#ifdef _RECVMSG_DEBUG_
+	if (do_recvmsg_debug)
 #endif
-		VRRP_TSM_HANDLE(prev_state, vrrp);
-
-		/* If we have sent an advert, reset the timer */
-		if (vrrp->state != VRRP_STATE_MAST || !vrrp->lower_prio_no_advert)
-			vrrp_init_instance_sands(vrrp);
+	{
+		if (recv_data_count != 1)
+			log_message(LOG_INFO, "recvmmsg(%d) loop received %u packets"
+					    , sock->fd_in, recv_data_count);
 	}
+#endif
 
 	return sock->fd_in;
 }
@@ -1173,10 +1250,11 @@ vrrp_read_dispatcher_thread(thread_ref_t thread)
 	else
 		fd = vrrp_dispatcher_read(sock);
 
-	/* register next dispatcher thread */
+	/* The dispatcher thread is persistent, so just set its next timeout */
 	if (fd != -1)
-		sock->thread = thread_add_read_sands(thread->master, vrrp_read_dispatcher_thread,
-						     sock, fd, vrrp_compute_timer(sock), 0);
+		thread_requeue_read(thread->master, fd, vrrp_compute_timer(sock));
+	else
+		thread_del_read(thread);
 }
 
 static void
@@ -1437,6 +1515,8 @@ vrrp_arp_thread(thread_ref_t thread)
 
 	set_time_now();
 
+	garp_tx_batch_open();
+
 	list_for_each_entry(vrrp, &vrrp_data->vrrp, e_list) {
 		if (!vrrp->garp_pending && !vrrp->gna_pending)
 			continue;
@@ -1451,6 +1531,8 @@ vrrp_arp_thread(thread_ref_t thread)
 		vrrp_arpna_send(vrrp, &vrrp->evip, &next_time);
 	}
 
+	garp_tx_batch_close();
+
 	if (next_time.tv_sec != INT_MAX) {
 		/* Register next timer tracker */
 		garp_next_time = next_time;
@@ -1460,6 +1542,112 @@ vrrp_arp_thread(thread_ref_t thread)
 		garp_thread = NULL;
 }
 
+/* Refresh gratuitous ARP/NA pacing */
+#define GARP_REFRESH_IDLE	ULONG_MAX
+
+/* Send the refresh messages queued on a garp_delay that its token bucket
+ * allows, and return how long until the next one can be sent. */
+static unsigned long
+vrrp_garp_refresh_send(garp_delay_t *gd)
+{
+	ip_address_t *ip_addr;
+	interface_t *ifp;
+	const timeval_t *next_time;
+
+	garp_refresh_fill(gd);
+
+	while (!list_empty(&gd->refresh_queue)) {
+		ip_addr = list_first_entry(&gd->refresh_queue, ip_address_t, refresh_list);
+		ifp = IF_BASE_IFP(ip_addr->ifp);
+
+		/* The address may have been removed since it was queued */
+		if (!ip_addr->set || (ifp->ifi_flags & IFF_NOARP)) {
+			vrrp_garp_refresh_dequeue(ip_addr);
+			continue;
+		}
+
+		/* Wait for any garp/gna interval. We wait 1us longer than vrrp_arp_thread()
+		 * so that delayed messages from a transition go first. */
+		if (!IP_IS6(ip_addr) ? gd->have_garp_interval : gd->have_gna_interval) {
+			next_time = !IP_IS6(ip_addr) ? &gd->garp_next_time : &gd->gna_next_time;
+			if (timercmp(&time_now, next_time, <))
+				return timer_long(timer_sub_now(*next_time)) + 1;
+		}
+
+		if (gd->refresh_tokens < TIMER_HZ)
+			return (unsigned long)((TIMER_HZ - gd->refresh_tokens + gd->refresh_pps - 1) / gd->refresh_pps);
+
+		/* This takes a token */
+		if (!IP_IS6(ip_addr))
+			send_gratuitous_arp_immediate(ifp, ip_addr);
+		else
+			ndisc_send_unsolicited_na_immediate(ifp, ip_addr);
+
+		/* Repeats go to the back of the queue, so they are spread out too */
+		if (--ip_addr->garp_refresh_rep)
+			list_move_tail(&ip_addr->refresh_list, &gd->refresh_queue);
+		else
+			list_del_init(&ip_addr->refresh_list);
+	}
+
+	return GARP_REFRESH_IDLE;
+}
+
+static void
+vrrp_garp_refresh_thread(__attribute__((unused)) thread_ref_t thread)
+{
+	garp_delay_t *gd;
+	unsigned long delay, next_delay = GARP_REFRESH_IDLE;
+
+	set_time_now();
+
+	garp_tx_batch_open();
+	list_for_each_entry(gd, &garp_delay, e_list) {
+		if (list_empty(&gd->refresh_queue))
+			continue;
+
+		delay = vrrp_garp_refresh_send(gd);
+		if (delay < next_delay)
+			next_delay = delay;
+	}
+	garp_tx_batch_close();
+
+	if (next_delay != GARP_REFRESH_IDLE)
+		garp_refresh_thread = thread_add_timer(master, vrrp_garp_refresh_thread, NULL, next_delay);
+	else
+		garp_refresh_thread = NULL;
+}
+
+/* Queue refresh messages for an address on the garp_delay of its interface.
+ * If it is still waiting from a previous refresh, it keeps its place. */
+void
+vrrp_garp_refresh_queue(ip_address_t *ip_addr, unsigned rep)
+{
+	garp_delay_t *gd = IF_BASE_IFP(ip_addr->ifp)->garp_delay;
+
+	/* set_default_garp_delay() gives every interface we refresh on a garp_delay */
+	if (!gd || !gd->refresh_pps || !rep)
+		return;
+
+	if (!ip_addr->garp_refresh_rep)
+		list_add_tail(&ip_addr->refresh_list, &gd->refresh_queue);
+	if (ip_addr->garp_refresh_rep < rep)
+		ip_addr->garp_refresh_rep = rep;
+
+	if (!garp_refresh_thread)
+		garp_refresh_thread = thread_add_event(master, vrrp_garp_refresh_thread, NULL, 0);
+}
+
+void
+vrrp_garp_refresh_dequeue(ip_address_t *ip_addr)
+{
+	if (!ip_addr->garp_refresh_rep)
+		return;
+
+	ip_addr->garp_refresh_rep = 0;
+	list_del_init(&ip_addr->refresh_list);
+}
+
 #ifdef _WITH_DUMP_THREADS_
 void
 dump_threads(void)
@@ -1504,6 +1692,7 @@ void
 register_vrrp_scheduler_addresses(void)
 {
 	register_thread_address("vrrp_arp_thread", vrrp_arp_thread);
+	register_thread_address("vrrp_garp_refresh_thread", vrrp_garp_refresh_thread);
 	register_thread_address("vrrp_dispatcher_init", vrrp_dispatcher_init);
 	register_thread_address("vrrp_gratuitous_arp_thread", vrrp_gratuitous_arp_thread);
 	register_thread_address("vrrp_lower_prio_gratuitous_arp_thread", vrrp_lower_prio_gratuitous_arp_thread);
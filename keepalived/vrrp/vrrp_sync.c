@@ -31,18 +31,13 @@
 #include "logger.h"
 #include "vrrp_scheduler.h"
 #include "parser.h"
+#include "keepalived_netlink.h"
 
 /* Instance name lookup */
 vrrp_t * __attribute__ ((pure))
-vrrp_get_instance(char *iname)
+vrrp_get_instance(const char *iname)
 {
-	vrrp_t *vrrp;
-
-	list_for_each_entry(vrrp, &vrrp_data->vrrp, e_list) {
-		if (strcmp(vrrp->iname, iname) == 0)
-			return vrrp;
-	}
-	return NULL;
+	return str_map_find_entry(&vrrp_data->vrrp_names, iname, vrrp_t, n_node);
 }
 
 /* Set instances group pointer */
@@ -184,6 +179,25 @@ vrrp_sync_master(vrrp_t *vrrp)
 	log_message(LOG_INFO, "VRRP_Group(%s) Syncing instances to MASTER state"
 			    , GROUP_NAME(sgroup));
 
+	/* Send the adverts of all the instances becoming master, and then
+	 * install their addresses in one netlink batch, rather than a batch
+	 * per instance. As in vrrp_state_master_tx(), the adverts go first
+	 * so that the old master can drop the VIPs. */
+	list_for_each_entry(isync, &sgroup->vrrp_instances, s_list) {
+		if (isync != vrrp && isync->state != VRRP_STATE_MAST)
+			vrrp_send_sync_master_adv(isync);
+	}
+	vrrp_tx_batch_flush();
+
+	netlink_batch_open();
+	list_for_each_entry(isync, &sgroup->vrrp_instances, s_list) {
+		if (isync != vrrp && isync->state != VRRP_STATE_MAST) {
+			vrrp_set_vips(isync);
+			isync->vips_preset = true;
+		}
+	}
+	netlink_batch_close_async();
+
 	/* Perform sync index */
 	list_for_each_entry(isync, &sgroup->vrrp_instances, s_list) {
 
@@ -199,6 +213,7 @@ vrrp_sync_master(vrrp_t *vrrp)
 				isync->stats->next_master_reason = vrrp->stats->master_reason;
 #endif
 				vrrp_state_goto_master(isync);
+				isync->master_adv_sent = false;
 				vrrp_thread_requeue_read(isync);
 //			}
 		}
@@ -158,14 +158,7 @@ alloc_track_if(const char *name, list_head_t *l, const vector_t *strvec)
 vrrp_script_t * __attribute__ ((pure))
 find_script_by_name(const char *name)
 {
-	vrrp_script_t *scr;
-
-	list_for_each_entry(scr, &vrrp_data->vrrp_script, e_list) {
-		if (!strcmp(scr->sname, name))
-			return scr;
-	}
-
-	return NULL;
+	return str_map_find_entry(&vrrp_data->vrrp_script_names, name, vrrp_script_t, n_node);
 }
 
 /* Track script dump */
@@ -282,13 +275,7 @@ alloc_track_script(const char *name, list_head_t *l, const vector_t *strvec)
 static vrrp_tracked_process_t * __attribute__ ((pure))
 find_tracked_process_by_name(const char *name)
 {
-	vrrp_tracked_process_t *process;
-
-	list_for_each_entry(process, &vrrp_data->vrrp_track_processes, e_list) {
-		if (!strcmp(process->pname, name))
-			return process;
-	}
-	return NULL;
+	return str_map_find_entry(&vrrp_data->vrrp_track_process_names, name, vrrp_tracked_process_t, n_node);
 }
 
 /* Track process dump */
@@ -396,17 +383,11 @@ alloc_track_process(const char *name, list_head_t *l, const vector_t *strvec)
 vrrp_tracked_bfd_t * __attribute__ ((pure))
 find_vrrp_tracked_bfd_by_name(const char *name)
 {
-	vrrp_tracked_bfd_t *bfd;
-
-	list_for_each_entry(bfd, &vrrp_data->vrrp_track_bfds, e_list) {
-		if (!strcmp(bfd->bname, name))
-			return bfd;
-	}
-	return NULL;
+	return str_map_find_entry(&vrrp_data->vrrp_track_bfd_names, name, vrrp_tracked_bfd_t, n_node);
 }
 
 vrrp_tracked_bfd_t *
-alloc_vrrp_tracked_bfd(const char *name, list_head_t *l)
+alloc_vrrp_tracked_bfd(const char *name)
 {
 	vrrp_tracked_bfd_t *tbfd;
 
@@ -416,12 +397,10 @@ alloc_vrrp_tracked_bfd(const char *name, list_head_t *l)
 		return NULL;
 	}
 
-	list_for_each_entry(tbfd, l, e_list) {
-		if (!strcmp(name, tbfd->bname)) {
-			report_config_error(CONFIG_GENERAL_ERROR, "BFD %s already specified", name);
-			skip_block(true);
-			return NULL;
-		}
+	if (find_vrrp_tracked_bfd_by_name(name)) {
+		report_config_error(CONFIG_GENERAL_ERROR, "BFD %s already specified", name);
+		skip_block(true);
+		return NULL;
 	}
 
 	PMALLOC(tbfd);
@@ -205,10 +205,19 @@ remove_vmac_auto_gen_addr(interface_t *ifp, struct in6_addr *addr)
 }
 #endif
 
-static int
+static void
+netlink_link_up_done(void *arg, int error)
+{
+	vrrp_t *vrrp = arg;
+
+	if (error)
+		log_message(LOG_INFO, "(%s) Error bringing up %s", vrrp->iname, vrrp->ifp->ifname);
+}
+
+/* The command is queued in the current netlink batch, if any */
+static void
 netlink_link_up(vrrp_t *vrrp)
 {
-	int status = 1;
 	struct {
 		struct nlmsghdr n;
 		struct ifinfomsg ifi;
@@ -224,11 +233,19 @@ netlink_link_up(vrrp_t *vrrp)
 	req.ifi.ifi_change |= IFF_UP;
 	req.ifi.ifi_flags |= IFF_UP;
 
-	if (netlink_talk(&nl_cmd, &req.n) < 0)
-		status = -1;
+	netlink_batch_add(&req.n, 0, netlink_link_up_done, vrrp);
+}
+
+#if HAVE_DECL_IFLA_INET6_ADDR_GEN_MODE
+static void
+netlink_addr_gen_mode_done(void *arg, int error)
+{
+	vrrp_t *vrrp = arg;
 
-	return status;
+	if (error)
+		log_message(LOG_INFO, "(%s) Error setting ADDR_GEN_MODE to NONE on %s", vrrp->iname, vrrp->ifp->ifname);
 }
+#endif
 
 bool
 set_link_local_address(const vrrp_t *vrrp)
@@ -440,6 +457,10 @@ netlink_link_add_vmac(vrrp_t *vrrp, const interface_t *old_interface)
 	 * to delete the generated address after bringing the interface up (see below).
 	 */
 
+	/* The interface has to exist before we get here, since we need its
+	 * ifindex, but we don't need to wait for the following commands */
+	netlink_batch_open();
+
 #if HAVE_DECL_IFLA_INET6_ADDR_GEN_MODE
 	/* This can't be part of create/update i/f msg since the kernel
 	 * doesn't process IFLA_AF_SPEC when links are created.
@@ -462,8 +483,7 @@ netlink_link_add_vmac(vrrp_t *vrrp, const interface_t *old_interface)
 	data->rta_len = (unsigned short)((char *)NLMSG_TAIL(&req.n) - (char *)data);
 	spec->rta_len = (unsigned short)((char *)NLMSG_TAIL(&req.n) - (char *)spec);
 
-	if (netlink_talk(&nl_cmd, &req.n) < 0)
-		log_message(LOG_INFO, "(%s) Error setting ADDR_GEN_MODE to NONE on %s", vrrp->iname, vrrp->ifp->ifname);
+	netlink_batch_add(&req.n, 0, netlink_addr_gen_mode_done, vrrp);
 #endif
 
 	/* We cannot include the link up setting with the ADDR_GEN_MODE message above
@@ -471,6 +491,8 @@ netlink_link_add_vmac(vrrp_t *vrrp, const interface_t *old_interface)
 	 * the ADDR_GEN_MODE setting is changed. */
 	netlink_link_up(vrrp);
 
+	netlink_batch_close_async();
+
 	/* Mark it as UP ! */
 	__set_bit(VRRP_VMAC_UP_BIT, &vrrp->flags);
 
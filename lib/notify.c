@@ -173,7 +173,9 @@ system_call_script(thread_master_t *m, thread_func_t func, void * arg, unsigned
 
 	if (pid) {
 		/* parent process */
-		if (func) {
+		if (!func)
+			thread_reap_child(m ? m : master, pid);
+		else {
 			thread_add_child(m, func, arg, pid, timer);
 #ifdef _SCRIPT_DEBUG_
 			if (do_script_debug)
@@ -38,13 +38,34 @@
 #include <sys/epoll.h>
 #include <unistd.h>
 #include <sys/signalfd.h>
+#include <sys/eventfd.h>
 #include <sys/utsname.h>
 #include <linux/version.h>
 #include <sched.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#ifdef _WITH_IO_URING_
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <poll.h>
+#include <endian.h>
+#endif
+#ifdef HAVE_PIDFD_OPEN
+#include <sys/pidfd.h>
+#endif
+#ifdef USE_PIDFD_OPEN_SYSCALL
+#include <sys/syscall.h>
+#endif
+#if defined HAVE_PIDFD_OPEN || defined USE_PIDFD_OPEN_SYSCALL
+#include <sys/prctl.h>
+#endif
 
 #include "scheduler.h"
 #include "memory.h"
 #include "rbtree_ka.h"
+#include "timer_wheel.h"
 #include "utils.h"
 #include "signals.h"
 #include "logger.h"
@@ -85,7 +106,7 @@ bool do_script_debug;
 #endif
 
 /* local variables */
-static bool shutting_down;
+static __thread bool shutting_down;
 static int sav_argc;
 static char * const *sav_argv;
 #ifdef THREAD_DUMP
@@ -101,6 +122,19 @@ static void (*shutdown_function)(int);
 static void (*thread_timeout_handler)(unsigned);
 static unsigned thread_timeout_min;
 
+#if defined HAVE_PIDFD_OPEN || defined USE_PIDFD_OPEN_SYSCALL
+#define USE_PIDFD
+/* Set if child processes are reaped when their pidfd becomes readable,
+ * rather than on SIGCHLD */
+static bool child_pidfds;
+#endif
+
+/* Thread function statistics, kept separately by each posix thread */
+static __thread bool func_stats_enabled;
+static __thread thread_func_stats_t *func_stats;
+static __thread size_t func_stats_size;
+static __thread size_t func_stats_used;
+
 /* Function that returns prog_name if pid is a known child */
 static char const * (*child_finder_name)(pid_t);
 
@@ -243,19 +277,73 @@ register_shutdown_function(void (*func)(int))
 }
 #endif
 
-/* Move ready thread into ready queue */
-static void
-thread_move_ready(thread_master_t *m, rb_root_cached_t *root, thread_t *thread, int type)
+/* Timer wheel expiry time of a thread */
+static inline uint64_t
+thread_expires(const timeval_t *sands)
+{
+	if (sands->tv_sec == TIMER_DISABLED)
+		return TW_NEVER;
+
+	return (uint64_t)sands->tv_sec * TIMER_HZ + (uint64_t)sands->tv_usec;
+}
+
+/* Priority class of a thread from its thread_add_*() flags */
+static inline thread_prio_t
+thread_flags_prio(unsigned flags)
+{
+	if (flags & THREAD_REALTIME)
+		return THREAD_PRIO_REALTIME;
+	if (flags & THREAD_BACKGROUND)
+		return THREAD_PRIO_BACKGROUND;
+	return THREAD_PRIO_NORMAL;
+}
+
+static inline void
+thread_add_ready(thread_master_t *m, thread_t *thread, int type)
 {
-	rb_erase_cached(&thread->n, root);
 	INIT_LIST_HEAD(&thread->e_list);
-	list_add_tail(&thread->e_list, &m->ready);
+	list_add_tail(&thread->e_list, &m->ready[thread->prio]);
 	if (thread->type != THREAD_TIMER_SHUTDOWN)
 		thread->type = type;
 }
 
 /* Move ready thread into ready queue */
 static void
+thread_move_ready(thread_master_t *m, timer_wheel_t *wheel, thread_t *thread, int type)
+{
+	timer_wheel_del(wheel, &thread->tw);
+	thread_add_ready(m, thread, type);
+}
+
+/* Move ready child thread into ready queue */
+static void
+thread_move_ready_child(thread_master_t *m, thread_t *thread, int type)
+{
+	rb_erase_cached(&thread->n, &m->child);
+	thread_add_ready(m, thread, type);
+}
+
+/* Move expired threads into ready queue */
+static void
+thread_tw_move_ready(thread_master_t *m, timer_wheel_t *wheel, int type)
+{
+	thread_t *thread;
+	timer_node_t *node;
+
+	while ((node = timer_wheel_expire(wheel, thread_expires(&time_now)))) {
+		thread = container_of(node, thread_t, tw);
+
+		if (type == THREAD_READ_TIMEOUT)
+			thread->event->read = NULL;
+		else if (type == THREAD_WRITE_TIMEOUT)
+			thread->event->write = NULL;
+
+		thread_add_ready(m, thread, type);
+	}
+}
+
+/* Move expired child threads into ready queue */
+static void
 thread_rb_move_ready(thread_master_t *m, rb_root_cached_t *root, int type)
 {
 	thread_t *thread;
@@ -267,12 +355,7 @@ thread_rb_move_ready(thread_master_t *m, rb_root_cached_t *root, int type)
 		if (thread->sands.tv_sec == TIMER_DISABLED || timercmp(&time_now, &thread->sands, <))
 			break;
 
-		if (type == THREAD_READ_TIMEOUT)
-			thread->event->read = NULL;
-		else if (type == THREAD_WRITE_TIMEOUT)
-			thread->event->write = NULL;
-
-		thread_move_ready(m, root, thread, type);
+		thread_move_ready_child(m, thread, type);
 	}
 }
 
@@ -296,6 +379,25 @@ thread_update_timer(rb_root_cached_t *root, timeval_t *timer_min)
 		*timer_min = first->sands;
 }
 
+/* Update timer value from a timer wheel, allowing for slack */
+static void
+thread_tw_update_timer(const timer_wheel_t *wheel, timeval_t *timer_min)
+{
+	uint64_t expires;
+	timeval_t sands;
+
+	if (timer_wheel_empty(wheel) ||
+	    (expires = timer_wheel_next_expiry(wheel)) == TW_NEVER)
+		return;
+
+	sands.tv_sec = (time_t)(expires / TIMER_HZ);
+	sands.tv_usec = (suseconds_t)(expires % TIMER_HZ);
+
+	if (!timerisset(timer_min) ||
+	    timercmp(&sands, timer_min, <=))
+		*timer_min = sands;
+}
+
 /* Compute the wait timer. Take care of timeouted fd */
 static timeval_t
 thread_set_timer(thread_master_t *m)
@@ -305,9 +407,9 @@ thread_set_timer(thread_master_t *m)
 
 	/* Prepare timer */
 	timerclear(&timer_wait_time);
-	thread_update_timer(&m->timer, &timer_wait_time);
-	thread_update_timer(&m->write, &timer_wait_time);
-	thread_update_timer(&m->read, &timer_wait_time);
+	thread_tw_update_timer(&m->timer, &timer_wait_time);
+	thread_tw_update_timer(&m->write, &timer_wait_time);
+	thread_tw_update_timer(&m->read, &timer_wait_time);
 	thread_update_timer(&m->child, &timer_wait_time);
 
 	if (timerisset(&timer_wait_time)) {
@@ -363,13 +465,10 @@ thread_timerfd_handler(thread_ref_t thread)
 		log_message(LOG_ERR, "scheduler: Error reading on timerfd fd:%d (%m)", m->timer_fd);
 
 	/* Read, Write, Timer, Child thread. */
-	thread_rb_move_ready(m, &m->read, THREAD_READ_TIMEOUT);
-	thread_rb_move_ready(m, &m->write, THREAD_WRITE_TIMEOUT);
-	thread_rb_move_ready(m, &m->timer, THREAD_READY_TIMER);
+	thread_tw_move_ready(m, &m->read, THREAD_READ_TIMEOUT);
+	thread_tw_move_ready(m, &m->write, THREAD_WRITE_TIMEOUT);
+	thread_tw_move_ready(m, &m->timer, THREAD_READY_TIMER);
 	thread_rb_move_ready(m, &m->child, THREAD_CHILD_TIMEOUT);
-
-	/* Register next timerfd thread */
-	m->timer_thread = thread_add_read(m, thread_timerfd_handler, NULL, m->timer_fd, TIMER_NEVER, 0);
 }
 
 /* Child PID cmp helper */
@@ -634,6 +733,178 @@ thread_events_resize(thread_master_t *m, int delta)
 	return 0;
 }
 
+/* Slab allocation of threads and thread events. Objects are cache line
+ * aligned and carved out of blocks aligned to THREAD_SLAB_BLOCK_SIZE, so
+ * the block an object belongs to is found by masking its address. */
+typedef struct _thread_slab_obj {
+	struct _thread_slab_obj	*next;
+} thread_slab_obj_t;
+
+typedef struct _thread_slab_block {
+	list_head_t		e_list;
+	thread_slab_obj_t	*free;		/* free objects in the block */
+	unsigned		in_use;
+#ifdef _MEM_CHECK_
+	void			*mem;		/* the MALLOC()ed memory holding the block */
+#endif
+} thread_slab_block_t;
+
+#define THREAD_SLAB_ROUNDUP(x)	(((x) + THREAD_CACHE_LINE - 1) & ~(size_t)(THREAD_CACHE_LINE - 1))
+#define THREAD_SLAB_HDR_SIZE	THREAD_SLAB_ROUNDUP(sizeof(thread_slab_block_t))
+
+static void
+thread_slab_init(thread_slab_t *slab, const char *name, size_t size)
+{
+	slab->name = name;
+	slab->obj_size = THREAD_SLAB_ROUNDUP(size);
+	slab->objs_per_block = (unsigned)((THREAD_SLAB_BLOCK_SIZE - THREAD_SLAB_HDR_SIZE) / slab->obj_size);
+	INIT_LIST_HEAD(&slab->partial);
+	INIT_LIST_HEAD(&slab->full);
+}
+
+/* Blocks must be aligned to their size. MALLOC() doesn't align its memory,
+ * so when memory checking, allocate twice the size and align the block
+ * within it, so that the memory is still tracked. */
+static void *
+thread_slab_block_alloc(void)
+{
+#ifdef _MEM_CHECK_
+	thread_slab_block_t *block;
+	void *mem;
+
+	if (!(mem = MALLOC(THREAD_SLAB_BLOCK_SIZE * 2)))
+		return NULL;
+
+	block = PTR_CAST(thread_slab_block_t, (char *)(((uintptr_t)mem + THREAD_SLAB_BLOCK_SIZE - 1) & ~(uintptr_t)(THREAD_SLAB_BLOCK_SIZE - 1)));
+	block->mem = mem;
+
+	return block;
+#else
+	void *mem;
+
+	if ((errno = posix_memalign(&mem, THREAD_SLAB_BLOCK_SIZE, THREAD_SLAB_BLOCK_SIZE)))
+		return NULL;
+
+	return mem;
+#endif
+}
+
+static void
+thread_slab_block_release(thread_slab_block_t *block)
+{
+#ifdef _MEM_CHECK_
+	FREE_ONLY(block->mem);
+#else
+	free(block);
+#endif
+}
+
+static thread_slab_block_t *
+thread_slab_block_new(thread_slab_t *slab)
+{
+	thread_slab_block_t *block;
+	thread_slab_obj_t *obj;
+	void *mem;
+	unsigned i;
+
+	if (!(mem = thread_slab_block_alloc())) {
+		log_message(LOG_INFO, "scheduler: Unable to allocate %s slab", slab->name);
+		exit(KEEPALIVED_EXIT_NO_MEMORY);
+	}
+
+	block = mem;
+	block->in_use = 0;
+	block->free = NULL;
+
+	/* Chain the objects so the lowest addresses are used first */
+	for (i = slab->objs_per_block; i-- > 0; ) {
+		obj = PTR_CAST(thread_slab_obj_t, (char *)mem + THREAD_SLAB_HDR_SIZE + i * slab->obj_size);
+		obj->next = block->free;
+		block->free = obj;
+	}
+
+	list_head_add(&block->e_list, &slab->partial);
+	slab->blocks++;
+	slab->block_allocs++;
+
+	return block;
+}
+
+static void *
+thread_slab_alloc(thread_slab_t *slab)
+{
+	thread_slab_block_t *block;
+	thread_slab_obj_t *obj;
+
+	if (list_empty(&slab->partial))
+		thread_slab_block_new(slab);
+	block = list_first_entry(&slab->partial, thread_slab_block_t, e_list);
+
+	obj = block->free;
+	block->free = obj->next;
+	if (!block->in_use++ && slab->empty_blocks)
+		slab->empty_blocks--;
+	if (!block->free)
+		list_move(&block->e_list, &slab->full);
+
+	slab->allocs++;
+	if (++slab->in_use > slab->peak)
+		slab->peak = slab->in_use;
+
+	memset(obj, 0, slab->obj_size);
+
+	return obj;
+}
+
+static void
+thread_slab_free(thread_slab_t *slab, void *p)
+{
+	thread_slab_block_t *block = PTR_CAST(thread_slab_block_t, (char *)((uintptr_t)p & ~(uintptr_t)(THREAD_SLAB_BLOCK_SIZE - 1)));
+	thread_slab_obj_t *obj = p;
+
+	if (!block->free)
+		list_move(&block->e_list, &slab->partial);
+
+	obj->next = block->free;
+	block->free = obj;
+
+	slab->frees++;
+	slab->in_use--;
+
+	if (--block->in_use)
+		return;
+
+	/* Keep one empty block in reserve so that we don't repeatedly
+	 * allocate and release a block at a boundary */
+	if (!slab->empty_blocks) {
+		slab->empty_blocks++;
+		list_move_tail(&block->e_list, &slab->partial);
+		return;
+	}
+
+	list_head_del(&block->e_list);
+	thread_slab_block_release(block);
+	slab->blocks--;
+	slab->block_frees++;
+}
+
+static void
+thread_slab_destroy(thread_slab_t *slab)
+{
+	thread_slab_block_t *block, *block_tmp;
+
+	list_for_each_entry_safe(block, block_tmp, &slab->partial, e_list)
+		thread_slab_block_release(block);
+	list_for_each_entry_safe(block, block_tmp, &slab->full, e_list)
+		thread_slab_block_release(block);
+
+	INIT_LIST_HEAD(&slab->partial);
+	INIT_LIST_HEAD(&slab->full);
+	slab->blocks = 0;
+	slab->empty_blocks = 0;
+	slab->in_use = 0;
+}
+
 static inline int
 thread_event_cmp(const void *key, const rb_node_t *a)
 {
@@ -648,23 +919,58 @@ thread_event_less(rb_node_t *a, const rb_node_t *b)
 	return rb_entry(a, thread_event_t, n)->fd < rb_entry_const(b, thread_event_t, n)->fd;
 }
 
+/* Make sure io_event_table has an entry for fd */
+static int
+thread_event_table_grow(thread_master_t *m, int fd)
+{
+	thread_event_t **table;
+	unsigned new_size;
+
+	if ((unsigned)fd < m->io_event_table_size)
+		return 0;
+
+	new_size = m->io_event_table_size ? m->io_event_table_size : THREAD_EVENT_TABLE_MIN;
+	while (new_size <= (unsigned)fd)
+		new_size *= 2;
+	if (new_size > THREAD_EVENT_TABLE_MAX)
+		new_size = THREAD_EVENT_TABLE_MAX;
+
+	if (m->io_event_table)
+		table = REALLOC(m->io_event_table, new_size * sizeof(*table));
+	else
+		table = MALLOC(new_size * sizeof(*table));
+	if (!table)
+		return -1;
+
+	memset(table + m->io_event_table_size, 0, (new_size - m->io_event_table_size) * sizeof(*table));
+	m->io_event_table = table;
+	m->io_event_table_size = new_size;
+
+	return 0;
+}
+
 static thread_event_t *
 thread_event_new(thread_master_t *m, int fd)
 {
 	thread_event_t *event;
 
-	PMALLOC(event);
-	if (!event)
+	if (fd < THREAD_EVENT_TABLE_MAX &&
+	    thread_event_table_grow(m, fd) < 0)
 		return NULL;
 
+	event = thread_slab_alloc(&m->event_slab);
+
 	if (thread_events_resize(m, 1) < 0) {
-		FREE(event);
+		thread_slab_free(&m->event_slab, event);
 		return NULL;
 	}
 
 	event->fd = fd;
 
-	rb_add(&event->n, &m->io_events, thread_event_less);
+	if (fd < THREAD_EVENT_TABLE_MAX)
+		m->io_event_table[fd] = event;
+	else
+		rb_add(&event->n, &m->io_events, thread_event_less);
 
 	return event;
 }
@@ -674,6 +980,11 @@ thread_event_get(thread_master_t *m, int fd)
 {
 	rb_node_t *node;
 
+	if ((unsigned)fd < m->io_event_table_size)
+		return m->io_event_table[fd];
+	if (fd < THREAD_EVENT_TABLE_MAX)
+		return NULL;
+
 	node = rb_find(&fd, &m->io_events, thread_event_cmp);
 
 	if (!node)
@@ -681,146 +992,767 @@ thread_event_get(thread_master_t *m, int fd)
 	return rb_entry(node, thread_event_t, n);
 }
 
-static int
-thread_event_set(const thread_t *thread)
+static void
+thread_event_remove(thread_master_t *m, thread_event_t *event)
 {
-	thread_event_t *event = thread->event;
-	thread_master_t *m = thread->master;
-	struct epoll_event ev = { .events = 0, .data.ptr = event };
-	int op;
-
-	if (__test_bit(THREAD_FL_READ_BIT, &event->flags))
-		ev.events |= EPOLLIN;
+	if (event->fd < THREAD_EVENT_TABLE_MAX)
+		m->io_event_table[event->fd] = NULL;
+	else
+		rb_erase(&event->n, &m->io_events);
+}
 
-	if (__test_bit(THREAD_FL_WRITE_BIT, &event->flags))
-		ev.events |= EPOLLOUT;
+#if defined _WITH_IO_URING_ || defined THREAD_DUMP
+/* Return the event with the next fd after event, or the first if event is NULL */
+static thread_event_t * __attribute__ ((pure))
+thread_event_next(const thread_master_t *m, const thread_event_t *event)
+{
+	unsigned fd = event ? (unsigned)event->fd + 1 : 0;
+	rb_node_t *node;
 
-	if (__test_bit(THREAD_FL_EPOLL_BIT, &event->flags))
-		op = EPOLL_CTL_MOD;
-	else
-		op = EPOLL_CTL_ADD;
+	if (!event || event->fd < THREAD_EVENT_TABLE_MAX) {
+		for (; fd < m->io_event_table_size; fd++) {
+			if (m->io_event_table[fd])
+				return m->io_event_table[fd];
+		}
 
-	if (epoll_ctl(m->epoll_fd, op, event->fd, &ev) < 0) {
-		log_message(LOG_INFO, "scheduler: Error %d performing control on EPOLL instance for fd %d (%m)", errno, event->fd);
-		return -1;
+		node = rb_first(&m->io_events);
 	}
+	else
+		node = rb_next(&event->n);
 
-	__set_bit(THREAD_FL_EPOLL_BIT, &event->flags);
-	return 0;
+	return node ? rb_entry(node, thread_event_t, n) : NULL;
 }
 
-static int
-thread_event_cancel(const thread_t *thread_cp)
-{
-	thread_t *thread = no_const(thread_t, thread_cp);
-	thread_event_t *event = thread->event;
-	thread_master_t *m = thread->master;
+#define thread_event_for_each(event, m)	\
+	for (event = thread_event_next(m, NULL); event; event = thread_event_next(m, event))
+#endif
 
-	if (!event) {
-		log_message(LOG_INFO, "scheduler: Error performing epoll_ctl DEL op no event linked?!");
-		return -1;
-	}
+#ifdef _WITH_IO_URING_
+/* io_uring support.
+ *
+ * Rather than using epoll_ctl() to register each fd, and epoll_wait() to wait
+ * for events, a one-shot poll request is queued on the submission ring each time
+ * a read or write thread is registered, and removal requests are queued when
+ * the thread_event is deleted. The queued requests are only submitted to the
+ * kernel, in a single io_uring_enter() call, when we next wait for events, so
+ * the per iteration cost is one system call however many fds are (re)registered.
+ *
+ * The thread functions still perform their own read()/recvmsg() etc, so the
+ * thread API is unchanged. */
+#define URING_SQ_ENTRIES	256
+#define URING_CQ_ENTRIES	4096
 
-	/* Ignore error if it was an SNMP fd, since we don't know
-	 * if they have been closed */
-	if (m->epoll_fd != -1 &&
-	    epoll_ctl(m->epoll_fd, EPOLL_CTL_DEL, event->fd, NULL) < 0)
-		log_message(LOG_INFO, "scheduler: Error performing epoll_ctl DEL op for fd:%d (%m)", event->fd);
+/* user_data layout for io_uring requests */
+#define URING_UD_FD_MASK	0xffffffffULL
+#define URING_UD_GEN_SHIFT	32
+#define URING_UD_GEN_MASK	0x3fffffffU
+#define URING_UD_WRITE		(1ULL << 62)
+#define URING_UD_INTERNAL	(1ULL << 63)
 
-	rb_erase(&event->n, &m->io_events);
-	if (event == m->current_event)
-		m->current_event = NULL;
-	thread_events_resize(m, -1);
-	FREE(thread->event);
-	return 0;
+static inline uint64_t
+uring_user_data(int fd, uint32_t gen, bool write)
+{
+	return (uint64_t)(unsigned)fd | (uint64_t)gen << URING_UD_GEN_SHIFT | (write ? URING_UD_WRITE : 0);
 }
 
-static int
-thread_event_del(const thread_t *thread_cp, unsigned flag)
+static inline int
+sys_io_uring_setup(unsigned entries, struct io_uring_params *p)
 {
-	thread_t *thread = no_const(thread_t, thread_cp);
-	thread_event_t *event = thread->event;
-
-	if (!__test_bit(flag, &event->flags))
-		return 0;
+	return (int)syscall(__NR_io_uring_setup, entries, p);
+}
 
-	if (flag == THREAD_FL_EPOLL_READ_BIT) {
-		__clear_bit(THREAD_FL_READ_BIT, &event->flags);
-		if (!__test_bit(THREAD_FL_EPOLL_WRITE_BIT, &event->flags))
-			return thread_event_cancel(thread);
+static inline int
+sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+	return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
 
-		event->read = NULL;
-	}
-	else if (flag == THREAD_FL_EPOLL_WRITE_BIT) {
-		__clear_bit(THREAD_FL_WRITE_BIT, &event->flags);
-		if (!__test_bit(THREAD_FL_EPOLL_READ_BIT, &event->flags))
-			return thread_event_cancel(thread);
+static void
+thread_uring_release(thread_master_t *m)
+{
+	thread_uring_t *u = m->uring;
 
-		event->write = NULL;
-	}
+	if (!u)
+		return;
 
-	if (thread_event_set(thread) < 0)
-		return -1;
+	if (u->sqes)
+		munmap(u->sqes, u->sqes_size);
+	if (u->cq_ring && u->cq_ring != u->sq_ring)
+		munmap(u->cq_ring, u->cq_ring_size);
+	if (u->sq_ring)
+		munmap(u->sq_ring, u->sq_ring_size);
+	if (u->fd != -1)
+		close(u->fd);
 
-	__clear_bit(flag, &event->flags);
-	return 0;
+	FREE(m->uring);
 }
 
-/* Make thread master. */
-thread_master_t *
-thread_make_master(void)
+static thread_uring_t *
+thread_uring_init(void)
 {
-	thread_master_t *new;
+	thread_uring_t *u;
+	struct io_uring_params p = { .flags = IORING_SETUP_CQSIZE, .cq_entries = URING_CQ_ENTRIES };
+	char *sq_ring, *cq_ring;
 
-	PMALLOC(new);
+	PMALLOC(u);
+	u->fd = sys_io_uring_setup(URING_SQ_ENTRIES, &p);
+	if (u->fd < 0) {
+		log_message(LOG_INFO, "scheduler: io_uring_setup failed (%m)");
+		FREE(u);
+		return NULL;
+	}
 
-	new->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
-	if (new->epoll_fd < 0) {
-		log_message(LOG_INFO, "scheduler: Error creating EPOLL instance (%m)");
-		FREE(new);
+	if (!(p.features & IORING_FEAT_NODROP)) {
+		log_message(LOG_INFO, "scheduler: kernel io_uring does not support IORING_FEAT_NODROP");
+		close(u->fd);
+		FREE(u);
 		return NULL;
 	}
 
-	new->read = RB_ROOT_CACHED;
-	new->write = RB_ROOT_CACHED;
-	new->timer = RB_ROOT_CACHED;
-	new->child = RB_ROOT_CACHED;
-	new->io_events = RB_ROOT;
-	new->child_pid = RB_ROOT;
-	INIT_LIST_HEAD(&new->event);
-#ifdef USE_SIGNAL_THREADS
-	INIT_LIST_HEAD(&new->signal);
-#endif
-	INIT_LIST_HEAD(&new->ready);
-	INIT_LIST_HEAD(&new->unuse);
+	u->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	u->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		if (u->cq_ring_size > u->sq_ring_size)
+			u->sq_ring_size = u->cq_ring_size;
+		u->cq_ring_size = u->sq_ring_size;
+	}
 
+	sq_ring = mmap(NULL, u->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQ_RING);
+	if (sq_ring == MAP_FAILED)
+		goto err;
+	u->sq_ring = sq_ring;
 
-	/* Register timerfd thread */
-	new->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
-	if (new->timer_fd < 0) {
-		log_message(LOG_ERR, "scheduler: Cant create timerfd (%m)");
-		FREE(new);
-		return NULL;
+	if (p.features & IORING_FEAT_SINGLE_MMAP)
+		cq_ring = sq_ring;
+	else {
+		cq_ring = mmap(NULL, u->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_CQ_RING);
+		if (cq_ring == MAP_FAILED)
+			goto err;
 	}
+	u->cq_ring = cq_ring;
 
-	new->signal_fd = signal_handler_init();
+	u->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+	u->sqes = mmap(NULL, u->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQES);
+	if (u->sqes == MAP_FAILED) {
+		u->sqes = NULL;
+		goto err;
+	}
 
-	new->timer_thread = thread_add_read(new, thread_timerfd_handler, NULL, new->timer_fd, TIMER_NEVER, 0);
+	u->sq_entries = p.sq_entries;
+	u->sq_mask = *PTR_CAST(unsigned, sq_ring + p.sq_off.ring_mask);
+	u->sq_head = PTR_CAST(unsigned, sq_ring + p.sq_off.head);
+	u->sq_tail = PTR_CAST(unsigned, sq_ring + p.sq_off.tail);
+	u->sq_array = PTR_CAST(unsigned, sq_ring + p.sq_off.array);
+	u->cq_mask = *PTR_CAST(unsigned, cq_ring + p.cq_off.ring_mask);
+	u->cq_head = PTR_CAST(unsigned, cq_ring + p.cq_off.head);
+	u->cq_tail = PTR_CAST(unsigned, cq_ring + p.cq_off.tail);
+	u->cqes = PTR_CAST(struct io_uring_cqe, cq_ring + p.cq_off.cqes);
 
-	add_signal_read_thread(new);
+	return u;
 
-	return new;
+err:
+	log_message(LOG_INFO, "scheduler: unable to map io_uring rings (%m)");
+	if (u->cq_ring && u->cq_ring != u->sq_ring)
+		munmap(u->cq_ring, u->cq_ring_size);
+	if (u->sq_ring)
+		munmap(u->sq_ring, u->sq_ring_size);
+	close(u->fd);
+	FREE(u);
+
+	return NULL;
 }
 
-#ifdef THREAD_DUMP
-static const char *
-timer_delay(timeval_t sands)
+/* Submit any queued requests, and optionally wait for a completion */
+static int
+thread_uring_enter(thread_uring_t *u, unsigned min_complete)
 {
-	static char str[43];
+	int ret;
 
-	if (sands.tv_sec == TIMER_DISABLED)
-		return "NEVER";
-	if (sands.tv_sec == 0 && sands.tv_usec == 0)
+	if (!u->to_submit && !min_complete)
+		return 0;
+
+	ret = sys_io_uring_enter(u->fd, u->to_submit, min_complete, min_complete ? IORING_ENTER_GETEVENTS : 0);
+	if (ret < 0)
+		return ret;
+
+	u->to_submit -= (unsigned)ret;
+
+	return 0;
+}
+
+static struct io_uring_sqe *
+thread_uring_get_sqe(thread_uring_t *u)
+{
+	unsigned tail = *u->sq_tail;
+	struct io_uring_sqe *sqe;
+
+	if (tail - __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE) >= u->sq_entries) {
+		/* The submission ring is full, so submit what we have queued */
+		while (thread_uring_enter(u, 0) < 0 && errno == EINTR);
+
+		if (tail - __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE) >= u->sq_entries) {
+			log_message(LOG_INFO, "scheduler: io_uring submission queue full (%m)");
+			return NULL;
+		}
+	}
+
+	sqe = &u->sqes[tail & u->sq_mask];
+	memset(sqe, 0, sizeof(*sqe));
+
+	return sqe;
+}
+
+static void
+thread_uring_queue_sqe(thread_uring_t *u)
+{
+	unsigned tail = *u->sq_tail;
+
+	u->sq_array[tail & u->sq_mask] = tail & u->sq_mask;
+	__atomic_store_n(u->sq_tail, tail + 1, __ATOMIC_RELEASE);
+	u->to_submit++;
+}
+
+static void
+thread_uring_arm(thread_master_t *m, thread_event_t *event, bool write)
+{
+	thread_uring_t *u = m->uring;
+	unsigned bit = write ? THREAD_FL_URING_WRITE_BIT : THREAD_FL_URING_READ_BIT;
+	struct io_uring_sqe *sqe;
+	uint32_t poll_mask;
+
+	if (__test_bit(bit, &event->flags))
+		return;
+
+	if (!(sqe = thread_uring_get_sqe(u))) {
+		/* thread_uring_wait() will arm it once the ring has space */
+		__set_bit(write ? THREAD_FL_URING_WRITE_PENDING_BIT : THREAD_FL_URING_READ_PENDING_BIT, &event->flags);
+		u->arm_pending = true;
+		return;
+	}
+
+	__clear_bit(write ? THREAD_FL_URING_WRITE_PENDING_BIT : THREAD_FL_URING_READ_PENDING_BIT, &event->flags);
+	event->uring_gen[write] = ++u->gen & URING_UD_GEN_MASK;
+
+	poll_mask = write ? POLLOUT : POLLIN;
+#if __BYTE_ORDER == __BIG_ENDIAN
+	poll_mask = poll_mask << 16 | poll_mask >> 16;
+#endif
+	sqe->opcode = IORING_OP_POLL_ADD;
+	sqe->fd = event->fd;
+	sqe->poll32_events = poll_mask;
+	sqe->user_data = uring_user_data(event->fd, event->uring_gen[write], write);
+	thread_uring_queue_sqe(u);
+
+	__set_bit(bit, &event->flags);
+}
+
+static void
+thread_uring_disarm(thread_master_t *m, thread_event_t *event, bool write)
+{
+	thread_uring_t *u = m->uring;
+	struct io_uring_sqe *sqe;
+
+	__clear_bit(write ? THREAD_FL_URING_WRITE_PENDING_BIT : THREAD_FL_URING_READ_PENDING_BIT, &event->flags);
+
+	if (!__test_and_clear_bit(write ? THREAD_FL_URING_WRITE_BIT : THREAD_FL_URING_READ_BIT, &event->flags))
+		return;
+
+	if (!(sqe = thread_uring_get_sqe(u)))
+		return;
+
+	sqe->opcode = IORING_OP_POLL_REMOVE;
+	sqe->fd = -1;
+	sqe->addr = uring_user_data(event->fd, event->uring_gen[write], write);
+	sqe->user_data = URING_UD_INTERNAL;
+	thread_uring_queue_sqe(u);
+}
+
+/* Arm the polls that did not fit on the submission ring when they were added */
+static void
+thread_uring_arm_pending(thread_master_t *m)
+{
+	thread_event_t *event;
+
+	m->uring->arm_pending = false;
+
+	thread_event_for_each(event, m) {
+		if (__test_and_clear_bit(THREAD_FL_URING_READ_PENDING_BIT, &event->flags) &&
+		    __test_bit(THREAD_FL_READ_BIT, &event->flags) && event->read)
+			thread_uring_arm(m, event, false);
+		if (__test_and_clear_bit(THREAD_FL_URING_WRITE_PENDING_BIT, &event->flags) &&
+		    __test_bit(THREAD_FL_WRITE_BIT, &event->flags) && event->write)
+			thread_uring_arm(m, event, true);
+	}
+}
+
+/* Submit queued requests, wait for completions, and convert them to epoll_events
+ * so that the normal epoll event handling can be used. */
+static int
+thread_uring_wait(thread_master_t *m)
+{
+	thread_uring_t *u = m->uring;
+	struct io_uring_cqe *cqe;
+	struct epoll_event *ep_ev;
+	thread_event_t *ev;
+	unsigned head, tail;
+	uint64_t user_data;
+	uint32_t events;
+	bool write;
+	int ret = 0;
+
+	if (u->arm_pending)
+		thread_uring_arm_pending(m);
+
+	head = *u->cq_head;
+	tail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+
+	/* EBUSY means the completion queue has overflowed, so we need to
+	 * reap completions before any more requests can be submitted. Don't
+	 * wait if any polls could not be armed, so they can be retried once
+	 * the completions have been reaped. */
+	if (thread_uring_enter(u, head == tail && !u->arm_pending ? 1 : 0) < 0 &&
+	    errno != EBUSY && errno != EAGAIN)
+		return -1;
+
+	tail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+	for (; head != tail && (unsigned)ret < m->epoll_size; head++) {
+		cqe = &u->cqes[head & u->cq_mask];
+		user_data = cqe->user_data;
+
+		if (user_data & URING_UD_INTERNAL)
+			continue;
+
+		/* Check this completion is for the currently armed poll */
+		write = !!(user_data & URING_UD_WRITE);
+		ev = thread_event_get(m, (int)(user_data & URING_UD_FD_MASK));
+		if (!ev ||
+		    ev->uring_gen[write] != ((user_data >> URING_UD_GEN_SHIFT) & URING_UD_GEN_MASK) ||
+		    !__test_and_clear_bit(write ? THREAD_FL_URING_WRITE_BIT : THREAD_FL_URING_READ_BIT, &ev->flags))
+			continue;
+
+		if (cqe->res == -ECANCELED)
+			continue;
+
+		if (cqe->res < 0)
+			events = EPOLLERR;
+		else if (write)
+			events = (uint32_t)cqe->res & (EPOLLOUT | EPOLLERR | EPOLLHUP);
+		else
+			events = (uint32_t)cqe->res & (EPOLLIN | EPOLLERR | EPOLLHUP | EPOLLRDHUP);
+
+		/* If the thread has timed out or been removed, there is nothing
+		 * to do, and it will be re-armed if a thread is added again */
+		if (!events || !(write ? ev->write : ev->read))
+			continue;
+
+		ep_ev = &m->epoll_events[ret++];
+		ep_ev->events = events;
+		ep_ev->data.ptr = ev;
+	}
+
+	__atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
+
+	return ret;
+}
+#endif
+
+static int
+thread_event_update(thread_master_t *m, thread_event_t *event)
+{
+	struct epoll_event ev = { .events = 0, .data.ptr = event };
+	int op;
+
+#ifdef _WITH_IO_URING_
+	if (m->uring) {
+		if (!__test_bit(THREAD_FL_READ_BIT, &event->flags))
+			thread_uring_disarm(m, event, false);
+		else if (event->read)
+			thread_uring_arm(m, event, false);
+
+		if (!__test_bit(THREAD_FL_WRITE_BIT, &event->flags))
+			thread_uring_disarm(m, event, true);
+		else if (event->write)
+			thread_uring_arm(m, event, true);
+
+		__set_bit(THREAD_FL_EPOLL_BIT, &event->flags);
+		return 0;
+	}
+#endif
+
+	if (__test_bit(THREAD_FL_READ_BIT, &event->flags))
+		ev.events |= EPOLLIN;
+
+	if (__test_bit(THREAD_FL_WRITE_BIT, &event->flags))
+		ev.events |= EPOLLOUT;
+
+	if (__test_bit(THREAD_FL_EPOLL_BIT, &event->flags))
+		op = EPOLL_CTL_MOD;
+	else
+		op = EPOLL_CTL_ADD;
+
+	if (epoll_ctl(m->epoll_fd, op, event->fd, &ev) < 0) {
+		log_message(LOG_INFO, "scheduler: Error %d performing control on EPOLL instance for fd %d (%m)", errno, event->fd);
+		return -1;
+	}
+
+	__set_bit(THREAD_FL_EPOLL_BIT, &event->flags);
+	return 0;
+}
+
+static inline int
+thread_event_set(const thread_t *thread)
+{
+	return thread_event_update(thread->master, thread->event);
+}
+
+static int
+thread_event_cancel(const thread_t *thread_cp)
+{
+	thread_t *thread = no_const(thread_t, thread_cp);
+	thread_event_t *event = thread->event;
+	thread_master_t *m = thread->master;
+
+	if (!event) {
+		log_message(LOG_INFO, "scheduler: Error performing epoll_ctl DEL op no event linked?!");
+		return -1;
+	}
+
+#ifdef _WITH_IO_URING_
+	if (m->uring) {
+		thread_uring_disarm(m, event, false);
+		thread_uring_disarm(m, event, true);
+	}
+#endif
+
+	/* Ignore error if it was an SNMP fd, since we don't know
+	 * if they have been closed */
+	if (m->epoll_fd != -1 &&
+	    epoll_ctl(m->epoll_fd, EPOLL_CTL_DEL, event->fd, NULL) < 0)
+		log_message(LOG_INFO, "scheduler: Error performing epoll_ctl DEL op for fd:%d (%m)", event->fd);
+
+	thread_event_remove(m, event);
+	if (event == m->current_event)
+		m->current_event = NULL;
+	thread_events_resize(m, -1);
+	thread_slab_free(&m->event_slab, event);
+	thread->event = NULL;
+	return 0;
+}
+
+static int
+thread_event_del(const thread_t *thread_cp, unsigned flag)
+{
+	thread_t *thread = no_const(thread_t, thread_cp);
+	thread_event_t *event = thread->event;
+
+	if (!__test_bit(flag, &event->flags))
+		return 0;
+
+	if (flag == THREAD_FL_EPOLL_READ_BIT) {
+		__clear_bit(THREAD_FL_READ_BIT, &event->flags);
+		if (!__test_bit(THREAD_FL_EPOLL_WRITE_BIT, &event->flags))
+			return thread_event_cancel(thread);
+
+		event->read = NULL;
+	}
+	else if (flag == THREAD_FL_EPOLL_WRITE_BIT) {
+		__clear_bit(THREAD_FL_WRITE_BIT, &event->flags);
+		if (!__test_bit(THREAD_FL_EPOLL_READ_BIT, &event->flags))
+			return thread_event_cancel(thread);
+
+		event->write = NULL;
+	}
+
+	if (thread_event_set(thread) < 0)
+		return -1;
+
+	__clear_bit(flag, &event->flags);
+	return 0;
+}
+
+#ifdef USE_PIDFD_OPEN_SYSCALL
+static int
+pidfd_open(pid_t pid, unsigned int flags)
+{
+	return (int)syscall(__NR_pidfd_open, pid, flags);
+}
+#endif
+
+#ifdef USE_PIDFD
+/* pidfd_open() is available since Linux 5.3 */
+static bool
+thread_pidfd_supported(void)
+{
+	int fd;
+
+	if ((fd = pidfd_open(getpid(), 0)) == -1)
+		return false;
+
+	close(fd);
+
+	return true;
+}
+#endif
+
+static void
+thread_destroy_reap(thread_master_t *m)
+{
+	thread_reap_t *reap, *reap_tmp;
+
+	/* The threads waiting for the pidfds have already been destroyed */
+	list_for_each_entry_safe(reap, reap_tmp, &m->reap, e_list) {
+		close(reap->pidfd);
+		list_del_init(&reap->e_list);
+		FREE(reap);
+	}
+}
+
+/* Make thread master. A worker master runs in a posix thread other than
+ * the main one, and so doesn't handle signals. */
+static thread_master_t *
+thread_make_master_common(bool worker)
+{
+	thread_master_t *new;
+	unsigned prio;
+
+	PMALLOC(new);
+
+	new->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (new->epoll_fd < 0) {
+		log_message(LOG_INFO, "scheduler: Error creating EPOLL instance (%m)");
+		FREE(new);
+		return NULL;
+	}
+
+	set_time_now();
+	timer_wheel_init(&new->read, thread_expires(&time_now));
+	timer_wheel_init(&new->write, thread_expires(&time_now));
+	timer_wheel_init(&new->timer, thread_expires(&time_now));
+	new->child = RB_ROOT_CACHED;
+	new->io_events = RB_ROOT;
+	thread_slab_init(&new->thread_slab, "thread", sizeof(thread_t));
+	thread_slab_init(&new->event_slab, "event", sizeof(thread_event_t));
+	new->unuse_high_water = THREAD_UNUSE_HIGH_WATER;
+	new->child_pid = RB_ROOT;
+	INIT_LIST_HEAD(&new->reap);
+	INIT_LIST_HEAD(&new->event);
+#ifdef USE_SIGNAL_THREADS
+	INIT_LIST_HEAD(&new->signal);
+#endif
+	for (prio = 0; prio < THREAD_PRIO_CLASSES; prio++)
+		INIT_LIST_HEAD(&new->ready[prio]);
+	INIT_LIST_HEAD(&new->unuse);
+
+
+	/* Register timerfd thread */
+	new->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (new->timer_fd < 0) {
+		log_message(LOG_ERR, "scheduler: Cant create timerfd (%m)");
+		FREE(new);
+		return NULL;
+	}
+
+	new->signal_fd = worker ? -1 : signal_handler_init();
+	new->remote_fd = -1;
+
+#ifdef USE_PIDFD
+	/* SIGCHLD must not be ignored, else the kernel reaps the children */
+	if (!worker && (child_pidfds = thread_pidfd_supported()))
+		signal_default(SIGCHLD);
+#endif
+
+	new->timer_thread = thread_add_read(new, thread_timerfd_handler, NULL, new->timer_fd, TIMER_NEVER, THREAD_PERSISTENT);
+
+	if (!worker)
+		add_signal_read_thread(new);
+
+	return new;
+}
+
+thread_master_t *
+thread_make_master(void)
+{
+	return thread_make_master_common(false);
+}
+
+thread_master_t *
+thread_make_worker_master(void)
+{
+	thread_master_t *new;
+
+	if (!(new = thread_make_master_common(true)))
+		return NULL;
+
+	/* A worker is always told what to do by another thread */
+	if (!thread_enable_remote_events(new)) {
+		thread_destroy_master(new);
+		return NULL;
+	}
+
+	return new;
+}
+
+/* Events can be posted to a thread master from another posix thread. The
+ * poster pushes the event onto a lock-free list, and writes to an eventfd
+ * if the list was empty so that the master turns the events into normal
+ * events. Taking the whole list at once means there is no ABA problem. */
+static thread_remote_t *
+thread_remote_take(thread_master_t *m)
+{
+	thread_remote_t *r, *next, *list = NULL;
+
+	/* Reverse the list so that events run in the order they were posted */
+	for (r = __atomic_exchange_n(&m->remote, NULL, __ATOMIC_ACQUIRE); r; r = next) {
+		next = r->next;
+		r->next = list;
+		list = r;
+	}
+
+	return list;
+}
+
+static void
+thread_remote_handler(thread_ref_t thread)
+{
+	thread_master_t *m = thread->master;
+	thread_remote_t *r, *next;
+	uint64_t count;
+
+	/* Reset the eventfd before taking the events, so that an event posted
+	 * after taking them cannot be missed */
+	if (read(m->remote_fd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+		log_message(LOG_ERR, "scheduler: Error reading on remote event fd:%d (%m)", m->remote_fd);
+
+	for (r = thread_remote_take(m); r; r = next) {
+		next = r->next;
+		thread_add_event(m, r->func, r->arg, r->val);
+		FREE(r);
+	}
+}
+
+static void
+thread_remote_discard(thread_master_t *m)
+{
+	thread_remote_t *r, *next;
+
+	for (r = thread_remote_take(m); r; r = next) {
+		next = r->next;
+		if (r->flags & THREAD_DESTROY_FREE_ARG)
+			FREE(r->arg);
+		FREE(r);
+	}
+}
+
+/* Must be called by the thread running the master, before any other
+ * thread posts events to it. */
+bool
+thread_enable_remote_events(thread_master_t *m)
+{
+	if (m->remote_fd != -1)
+		return true;
+
+	m->remote_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (m->remote_fd < 0) {
+		log_message(LOG_ERR, "scheduler: Cant create remote event fd (%m)");
+		m->remote_fd = -1;
+		return false;
+	}
+
+	m->remote_thread = thread_add_read(m, thread_remote_handler, NULL, m->remote_fd, TIMER_NEVER, THREAD_PERSISTENT);
+
+	return true;
+}
+
+/* Post an event to a master from any posix thread. If the master is cleaned
+ * up before the event runs, arg is freed if flags has THREAD_DESTROY_FREE_ARG. */
+void
+thread_add_remote_event(thread_master_t *m, thread_func_t func, void *arg, int val, unsigned flags)
+{
+	thread_remote_t *r, *head;
+	uint64_t one = 1;
+
+	PMALLOC(r);
+	r->func = func;
+	r->arg = arg;
+	r->val = val;
+	r->flags = flags;
+
+	head = __atomic_load_n(&m->remote, __ATOMIC_RELAXED);
+	do {
+		r->next = head;
+	} while (!__atomic_compare_exchange_n(&m->remote, &head, r, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+	/* Only the first event on the list needs to wake the master. r
+	 * must not be referenced now, since it may already have run. */
+	if (!head && write(m->remote_fd, &one, sizeof(one)) < 0)
+		log_message(LOG_ERR, "scheduler: Error writing on remote event fd:%d (%m)", m->remote_fd);
+}
+
+#ifdef _WITH_IO_URING_
+/* Switch the thread master between using epoll and io_uring. The fds
+ * currently registered are migrated to the new mechanism. */
+bool
+thread_set_io_uring(thread_master_t *m, bool enable)
+{
+	thread_event_t *event;
+	int epoll_fd;
+
+	if (!enable == !m->uring)
+		return true;
+
+	if (enable) {
+		if (!(m->uring = thread_uring_init())) {
+			log_message(LOG_INFO, "scheduler: unable to use io_uring, continuing to use epoll");
+			return false;
+		}
+
+		close(m->epoll_fd);
+		m->epoll_fd = -1;
+
+		thread_event_for_each(event, m) {
+			if (__test_bit(THREAD_FL_EPOLL_BIT, &event->flags))
+				thread_event_update(m, event);
+		}
+
+		log_message(LOG_INFO, "scheduler: using io_uring");
+
+		return true;
+	}
+
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (epoll_fd < 0) {
+		log_message(LOG_INFO, "scheduler: Error creating EPOLL instance (%m) - continuing to use io_uring");
+		return false;
+	}
+
+	/* Closing the ring cancels all the outstanding poll requests */
+	thread_uring_release(m);
+	m->epoll_fd = epoll_fd;
+
+	thread_event_for_each(event, m) {
+		__clear_bit(THREAD_FL_URING_READ_BIT, &event->flags);
+		__clear_bit(THREAD_FL_URING_WRITE_BIT, &event->flags);
+		__clear_bit(THREAD_FL_URING_READ_PENDING_BIT, &event->flags);
+		__clear_bit(THREAD_FL_URING_WRITE_PENDING_BIT, &event->flags);
+		if (__test_and_clear_bit(THREAD_FL_EPOLL_BIT, &event->flags))
+			thread_event_update(m, event);
+	}
+
+	log_message(LOG_INFO, "scheduler: using epoll");
+
+	return true;
+}
+#endif
+
+#ifdef THREAD_DUMP
+static const char *
+timer_delay(timeval_t sands)
+{
+	static char str[43];
+
+	if (sands.tv_sec == TIMER_DISABLED)
+		return "NEVER";
+	if (sands.tv_sec == 0 && sands.tv_usec == 0)
 		return "UNSET";
 
 	if (timercmp(&sands, &time_now, >=)) {
@@ -859,6 +1791,21 @@ thread_rb_dump(const rb_root_cached_t *root, const char *tree, FILE *fp)
 	conf_write(fp, "----[ End rb_dump ]----");
 }
 
+static void
+thread_tw_dump(const timer_wheel_t *wheel, const char *wheel_name, FILE *fp)
+{
+	thread_t *thread, *thread_sav;
+	unsigned i = 1;
+	unsigned slot;
+
+	conf_write(fp, "----[ Begin tw_dump %s (%u timers) ]----", wheel_name, wheel->count);
+
+	timer_wheel_for_each_entry_safe(thread, thread_sav, wheel, slot, tw)
+		write_thread_entry(fp, i++, thread);
+
+	conf_write(fp, "----[ End tw_dump ]----");
+}
+
 static void
 thread_list_dump(const list_head_t *l, const char *list_type, FILE *fp)
 {
@@ -874,33 +1821,51 @@ thread_list_dump(const list_head_t *l, const char *list_type, FILE *fp)
 }
 
 static void
-event_rb_dump(const rb_root_t *root, const char *tree, FILE *fp)
+event_dump(const thread_master_t *m, FILE *fp)
 {
 	thread_event_t *event;
 	int i = 1;
 
-	conf_write(fp, "----[ Begin rb_dump %s ]----", tree);
-	rb_for_each_entry(event, root, n)
+	conf_write(fp, "----[ Begin event_dump io_events (table size %u) ]----", m->io_event_table_size);
+	thread_event_for_each(event, m)
 		conf_write(fp, "#%.2d event %p fd %d, flags: 0x%lx, read %p, write %p"
 			     , i++, event, event->fd, event->flags
 			     , event->read, event->write);
-	conf_write(fp, "----[ End rb_dump ]----");
+	conf_write(fp, "----[ End event_dump ]----");
+}
+
+static void
+thread_slab_dump(const thread_slab_t *slab, FILE *fp)
+{
+	conf_write(fp, " %s: object size %zu, %u per block, blocks %u (%u empty), in use %u, peak %u"
+		     , slab->name, slab->obj_size, slab->objs_per_block
+		     , slab->blocks, slab->empty_blocks, slab->in_use, slab->peak);
+	conf_write(fp, " %s: allocs %lu, frees %lu, block allocs %lu, block frees %lu"
+		     , slab->name, slab->allocs, slab->frees
+		     , slab->block_allocs, slab->block_frees);
 }
 
 void
 dump_thread_data(const thread_master_t *m, FILE *fp)
 {
-	thread_rb_dump(&m->read, "read", fp);
-	thread_rb_dump(&m->write, "write", fp);
+	thread_tw_dump(&m->read, "read", fp);
+	thread_tw_dump(&m->write, "write", fp);
 	thread_rb_dump(&m->child, "child", fp);
-	thread_rb_dump(&m->timer, "timer", fp);
+	thread_tw_dump(&m->timer, "timer", fp);
 	thread_list_dump(&m->event, "event", fp);
-	thread_list_dump(&m->ready, "ready", fp);
+	thread_list_dump(&m->ready[THREAD_PRIO_REALTIME], "ready realtime", fp);
+	thread_list_dump(&m->ready[THREAD_PRIO_NORMAL], "ready", fp);
+	thread_list_dump(&m->ready[THREAD_PRIO_BACKGROUND], "ready background", fp);
 #ifdef USE_SIGNAL_THREADS
 	thread_list_dump(&m->signal, "signal", fp);
 #endif
 	thread_list_dump(&m->unuse, "unuse", fp);
-	event_rb_dump(&m->io_events, "io_events", fp);
+	event_dump(m, fp);
+	conf_write(fp, "----[ Begin slab stats ]----");
+	thread_slab_dump(&m->thread_slab, fp);
+	thread_slab_dump(&m->event_slab, fp);
+	conf_write(fp, " unuse threads %u, high-water %u, threads allocated %lu", m->unuse_count, m->unuse_high_water, m->alloc);
+	conf_write(fp, "----[ End slab stats ]----");
 }
 #endif
 
@@ -918,23 +1883,36 @@ thread_clean_unuse(thread_master_t * m)
 		list_del_init(&thread->e_list);
 
 		/* free the thread */
-		FREE(thread);
+		thread_slab_free(&m->thread_slab, thread);
 		m->alloc--;
 	}
 
 	INIT_LIST_HEAD(l);
+	m->unuse_count = 0;
 }
 
 /* Move thread to unuse list. */
 static void
 thread_add_unuse(thread_master_t *m, thread_t *thread)
 {
+	thread_t *oldest;
+
 	assert(m != NULL);
 
 	thread->type = THREAD_UNUSED;
 	thread->event = NULL;
 	INIT_LIST_HEAD(&thread->e_list);
 	list_add_tail(&thread->e_list, &m->unuse);
+
+	/* Don't let the unuse list grow beyond the high-water mark. The
+	 * oldest unused thread is the one that would be reused next. */
+	if (++m->unuse_count > m->unuse_high_water) {
+		oldest = list_first_entry(&m->unuse, thread_t, e_list);
+		list_head_del(&oldest->e_list);
+		thread_slab_free(&m->thread_slab, oldest);
+		m->unuse_count--;
+		m->alloc--;
+	}
 }
 
 /* Move list element to unuse queue */
@@ -977,8 +1955,21 @@ thread_destroy_rb(thread_master_t *m, rb_root_cached_t *root)
 	thread_t *thread;
 	thread_t *thread_sav;
 
-	rbtree_postorder_for_each_entry_safe(thread, thread_sav, &root->rb_root, n) {
-		/* The following are relevant for the read and write rb lists */
+	rbtree_postorder_for_each_entry_safe(thread, thread_sav, &root->rb_root, n)
+		thread_add_unuse(m, thread);
+
+	*root = RB_ROOT_CACHED;
+}
+
+static void
+thread_destroy_wheel(thread_master_t *m, timer_wheel_t *wheel)
+{
+	thread_t *thread;
+	thread_t *thread_sav;
+	unsigned i;
+
+	timer_wheel_for_each_entry_safe(thread, thread_sav, wheel, i, tw) {
+		/* The following are relevant for the read and write wheels */
 		if (thread->type == THREAD_READ ||
 		    thread->type == THREAD_WRITE) {
 			/* Do we have a thread_event, and does it need deleting? */
@@ -999,27 +1990,36 @@ thread_destroy_rb(thread_master_t *m, rb_root_cached_t *root)
 		thread_add_unuse(m, thread);
 	}
 
-	*root = RB_ROOT_CACHED;
+	timer_wheel_init(wheel, thread_expires(&time_now));
 }
 
 /* Cleanup master */
 void
 thread_cleanup_master(thread_master_t * m, bool keep_children)
 {
+	unsigned prio;
+
 	/* Unuse current thread lists */
 	m->current_event = NULL;
-	thread_destroy_rb(m, &m->read);
-	thread_destroy_rb(m, &m->write);
-	thread_destroy_rb(m, &m->timer);
+	thread_destroy_wheel(m, &m->read);
+	thread_destroy_wheel(m, &m->write);
+	thread_destroy_wheel(m, &m->timer);
 	if (!keep_children)
 		thread_destroy_rb(m, &m->child);
 	thread_destroy_list(m, &m->event);
 #ifdef USE_SIGNAL_THREADS
 	thread_destroy_list(m, &m->signal);
 #endif
-	thread_destroy_list(m, &m->ready);
-	if (!keep_children)
+	for (prio = 0; prio < THREAD_PRIO_CLASSES; prio++) {
+		thread_destroy_list(m, &m->ready[prio]);
+		m->ready_burst[prio] = 0;
+	}
+	if (m->watchdog)
+		thread_destroy_list(m, &m->watchdog->deferred);
+	if (!keep_children) {
 		m->child_pid = RB_ROOT;
+		thread_destroy_reap(m);
+	}
 
 	if (m->current_thread) {
 		thread_add_unuse(m, m->current_thread);
@@ -1035,6 +2035,10 @@ thread_cleanup_master(thread_master_t * m, bool keep_children)
 
 	m->timer_thread = NULL;
 
+	/* Events posted by other threads refer to the old state */
+	thread_remote_discard(m);
+	m->remote_thread = NULL;
+
 #ifdef _WITH_SNMP_
 	m->snmp_timer_thread = NULL;
 	FD_ZERO(&m->snmp_fdset);
@@ -1051,14 +2055,33 @@ thread_destroy_master(thread_master_t * m)
 		m->epoll_fd = -1;
 	}
 
+#ifdef _WITH_IO_URING_
+	/* As with the epoll fd, release the rings first so that
+	 * no requests are submitted while cleaning up */
+	thread_uring_release(m);
+#endif
+
 	if (m->timer_fd != -1)
 		close(m->timer_fd);
 
+	if (m->remote_fd != -1)
+		close(m->remote_fd);
+
 	if (m->signal_fd != -1)
 		signal_handler_destroy();
 
 	thread_cleanup_master(m, false);
 
+	thread_slab_destroy(&m->thread_slab);
+	thread_slab_destroy(&m->event_slab);
+	if (m->io_event_table)
+		FREE(m->io_event_table);
+	if (m->watchdog)
+		FREE(m->watchdog);
+
+	/* A forked child must not report its parent's statistics */
+	thread_clear_stats();
+
 	FREE(m);
 }
 
@@ -1091,13 +2114,17 @@ thread_new(thread_master_t *m)
 
 	/* If one thread is already allocated return it */
 	new = thread_trim_head(&m->unuse);
-	if (!new) {
-		PMALLOC(new);
+	if (new)
+		m->unuse_count--;
+	else {
+		new = thread_slab_alloc(&m->thread_slab);
 		m->alloc++;
 	}
 
 	INIT_LIST_HEAD(&new->e_list);
 	new->id = thread_get_id(m);
+	new->deferred = false;
+	new->prio = THREAD_PRIO_NORMAL;
 	return new;
 }
 
@@ -1134,7 +2161,9 @@ thread_add_read_sands(thread_master_t *m, thread_func_t func, void *arg, int fd,
 	thread->arg = arg;
 	thread->u.f.fd = fd;
 	thread->u.f.flags = flags;
+	thread->u.f.timer = TIMER_NEVER;
 	thread->event = event;
+	thread->prio = thread_flags_prio(flags);
 
 	/* Set & flag event */
 	__set_bit(THREAD_FL_READ_BIT, &event->flags);
@@ -1147,11 +2176,15 @@ thread_add_read_sands(thread_master_t *m, thread_func_t func, void *arg, int fd,
 		}
 		__set_bit(THREAD_FL_EPOLL_READ_BIT, &event->flags);
 	}
+#ifdef _WITH_IO_URING_
+	else if (m->uring)
+		thread_uring_arm(m, event, false);
+#endif
 
 	thread->sands = *sands;
 
-	/* Sort the thread. */
-	rb_add_cached(&thread->n, &m->read, thread_timer_less);
+	/* Queue the thread's timeout. */
+	timer_wheel_add(&m->read, &thread->tw, thread_expires(&thread->sands), 0);
 
 	return thread;
 }
@@ -1160,6 +2193,7 @@ thread_ref_t
 thread_add_read(thread_master_t *m, thread_func_t func, void *arg, int fd, unsigned long timer, unsigned flags)
 {
 	timeval_t sands;
+	thread_ref_t thread;
 
 	/* Compute read timeout value */
 	if (timer == TIMER_NEVER) {
@@ -1170,7 +2204,65 @@ thread_add_read(thread_master_t *m, thread_func_t func, void *arg, int fd, unsig
 		sands = timer_add_long(time_now, timer);
 	}
 
-	return thread_add_read_sands(m, func, arg, fd, &sands, flags);
+	thread = thread_add_read_sands(m, func, arg, fd, &sands, flags);
+	if (thread && (flags & THREAD_PERSISTENT))
+		no_const(thread_t, thread)->u.f.timer = timer;
+
+	return thread;
+}
+
+/* The persistent read thread of an event, if its function is running */
+static thread_t * __attribute__ ((pure))
+thread_current_persistent_read(const thread_master_t *m, const thread_event_t *event)
+{
+	thread_t *thread = m->current_thread;
+
+	if (!thread || thread->event != event ||
+	    !(thread->u.f.flags & THREAD_PERSISTENT) ||
+	    (thread->type != THREAD_READY_READ_FD && thread->type != THREAD_READ_TIMEOUT))
+		return NULL;
+
+	return thread;
+}
+
+/* Set the timeout a persistent read thread is requeued with, unless
+ * its function sets one. */
+static void
+thread_read_persist(thread_t *thread)
+{
+	if (thread->u.f.timer != TIMER_NEVER)
+		thread->sands = timer_add_long(time_now, thread->u.f.timer);
+	else if (thread->type == THREAD_READ_TIMEOUT) {
+		thread->sands.tv_sec = TIMER_DISABLED;
+		thread->sands.tv_usec = 0;
+	}
+}
+
+/* Requeue a persistent read thread after its function has run */
+static bool
+thread_read_rearm(thread_master_t *m, thread_t *thread)
+{
+	thread_event_t *event = thread->event;
+
+	/* The event will have been released if the fd has been closed */
+	if (!event ||
+	    !thread_current_persistent_read(m, event) ||
+	    thread->u.f.fd == -1 ||
+	    thread_event_get(m, thread->u.f.fd) != event ||
+	    !__test_bit(THREAD_FL_READ_BIT, &event->flags) ||
+	    event->read)
+		return false;
+
+	thread->type = THREAD_READ;
+	event->read = thread;
+#ifdef _WITH_IO_URING_
+	if (m->uring)
+		thread_uring_arm(m, event, false);
+#endif
+
+	timer_wheel_add(&m->read, &thread->tw, thread_expires(&thread->sands), 0);
+
+	return true;
 }
 
 void
@@ -1203,8 +2295,16 @@ thread_read_requeue(thread_master_t *m, int fd, const timeval_t *new_sands)
 	thread_event_t *event;
 
 	event = thread_event_get(m, fd);
-	if (!event || !event->read)
+	if (!event)
+		return;
+
+	if (!event->read) {
+		/* A persistent read thread whose function is running will be
+		 * requeued with the new timeout */
+		if ((thread = thread_current_persistent_read(m, event)))
+			thread->sands = *new_sands;
 		return;
+	}
 
 	thread = event->read;
 
@@ -1215,7 +2315,7 @@ thread_read_requeue(thread_master_t *m, int fd, const timeval_t *new_sands)
 
 	thread->sands = *new_sands;
 
-	rb_move_cached(&thread->n, &thread->master->read, thread_timer_less);
+	timer_wheel_mod(&thread->master->read, &thread->tw, thread_expires(&thread->sands));
 }
 
 /* Adjust the timeout of a read thread */
@@ -1259,6 +2359,7 @@ thread_add_write(thread_master_t *m, thread_func_t func, void *arg, int fd, unsi
 	thread->u.f.fd = fd;
 	thread->u.f.flags = flags;
 	thread->event = event;
+	thread->prio = thread_flags_prio(flags);
 
 	/* Set & flag event */
 	__set_bit(THREAD_FL_WRITE_BIT, &event->flags);
@@ -1271,6 +2372,10 @@ thread_add_write(thread_master_t *m, thread_func_t func, void *arg, int fd, unsi
 		}
 		__set_bit(THREAD_FL_EPOLL_WRITE_BIT, &event->flags);
 	}
+#ifdef _WITH_IO_URING_
+	else if (m->uring)
+		thread_uring_arm(m, event, true);
+#endif
 
 	/* Compute write timeout value */
 	if (timer == TIMER_NEVER)
@@ -1280,8 +2385,8 @@ thread_add_write(thread_master_t *m, thread_func_t func, void *arg, int fd, unsi
 		thread->sands = timer_add_long(time_now, timer);
 	}
 
-	/* Sort the thread. */
-	rb_add_cached(&thread->n, &m->write, thread_timer_less);
+	/* Queue the thread's timeout. */
+	timer_wheel_add(&m->write, &thread->tw, thread_expires(&thread->sands), 0);
 
 	return thread;
 }
@@ -1310,9 +2415,10 @@ thread_close_fd(thread_ref_t thread_cp)
 	thread->u.f.fd = -1;
 }
 
-/* Add timer event thread. */
-thread_ref_t
-thread_add_timer_uval(thread_master_t *m, thread_func_t func, void *arg, unsigned val, unsigned long timer)
+/* Add timer event thread. The thread may run up to slack usecs late, so
+ * that it can share a wakeup with other timers. */
+static thread_ref_t
+thread_add_timer_full(thread_master_t *m, thread_func_t func, void *arg, unsigned val, unsigned long timer, unsigned long slack, unsigned flags)
 {
 	thread_t *thread;
 
@@ -1324,6 +2430,7 @@ thread_add_timer_uval(thread_master_t *m, thread_func_t func, void *arg, unsigne
 	thread->func = func;
 	thread->arg = arg;
 	thread->u.uval = val;
+	thread->prio = thread_flags_prio(flags);
 
 	/* Do we need jitter here? */
 	if (timer == TIMER_NEVER)
@@ -1333,16 +2440,59 @@ thread_add_timer_uval(thread_master_t *m, thread_func_t func, void *arg, unsigne
 		thread->sands = timer_add_long(time_now, timer);
 	}
 
-	/* Sort by timeval. */
-	rb_add_cached(&thread->n, &m->timer, thread_timer_less);
+	/* Queue on the timer wheel. */
+	timer_wheel_add(&m->timer, &thread->tw, thread_expires(&thread->sands), slack);
 
 	return thread;
 }
 
+thread_ref_t
+thread_add_timer_uval(thread_master_t *m, thread_func_t func, void *arg, unsigned val, unsigned long timer)
+{
+	return thread_add_timer_full(m, func, arg, val, timer, m->timer_slack, 0);
+}
+
 thread_ref_t
 thread_add_timer(thread_master_t *m, thread_func_t func, void *arg, unsigned long timer)
 {
-	return thread_add_timer_uval(m, func, arg, 0, timer);
+	return thread_add_timer_full(m, func, arg, 0, timer, m->timer_slack, 0);
+}
+
+/* Add a timer thread with priority class flags */
+thread_ref_t
+thread_add_timer_flags(thread_master_t *m, thread_func_t func, void *arg, unsigned long timer, unsigned flags)
+{
+	return thread_add_timer_full(m, func, arg, 0, timer, m->timer_slack, flags);
+}
+
+thread_ref_t
+thread_add_timer_slack(thread_master_t *m, thread_func_t func, void *arg, unsigned long timer, unsigned long slack)
+{
+	return thread_add_timer_full(m, func, arg, 0, timer, slack, 0);
+}
+
+/* Set the number of unused threads kept for reuse */
+void
+thread_set_unuse_high_water(thread_master_t *m, unsigned high_water)
+{
+	thread_t *thread;
+
+	m->unuse_high_water = high_water;
+
+	while (m->unuse_count > high_water) {
+		thread = list_first_entry(&m->unuse, thread_t, e_list);
+		list_head_del(&thread->e_list);
+		thread_slab_free(&m->thread_slab, thread);
+		m->unuse_count--;
+		m->alloc--;
+	}
+}
+
+/* Set the default slack of timers added to the master */
+void
+thread_set_timer_slack(thread_master_t *m, unsigned long slack)
+{
+	m->timer_slack = slack;
 }
 
 void
@@ -1367,27 +2517,222 @@ timer_thread_update_timeout(thread_ref_t thread_cp, unsigned long timer)
 	set_time_now();
 	sands = timer_add_long(time_now, timer);
 
-	if (timercmp(&thread->sands, &sands, ==))
-		return;
+	if (timercmp(&thread->sands, &sands, ==))
+		return;
+
+	thread->sands = sands;
+
+	timer_wheel_mod(&thread->master->timer, &thread->tw, thread_expires(&thread->sands));
+}
+
+thread_ref_t
+thread_add_timer_shutdown(thread_master_t *m, thread_func_t func, void *arg, unsigned long timer)
+{
+	union {
+		thread_t *p;
+		const thread_t *cp;
+	} thread;
+
+	thread.cp = thread_add_timer(m, func, arg, timer);
+
+	thread.p->type = THREAD_TIMER_SHUTDOWN;
+
+	return thread.cp;
+}
+
+/* Move a child thread that has terminated onto the ready queue */
+static void
+thread_child_terminated(thread_t *thread, int status)
+{
+	thread_master_t *m = thread->master;
+
+	rb_erase(&thread->rb_data, &m->child_pid);
+
+	thread->u.c.status = status;
+
+	if (thread->type == THREAD_CHILD_TIMEOUT) {
+		/* The child had been timed out, but we have not processed the timeout
+		 * and it is still on the thread->ready queue. Since we have now got
+		 * the termination, just handle the termination instead. */
+		thread->type = THREAD_CHILD_TERMINATED;
+	}
+	else
+		thread_move_ready_child(m, thread, THREAD_CHILD_TERMINATED);
+}
+
+#ifdef USE_PIDFD
+/* If pidfd_open() fails, revert to reaping all children on SIGCHLD */
+static void
+thread_use_sigchld(thread_master_t *m)
+{
+	child_pidfds = false;
+	signal_set(SIGCHLD, thread_child_handler, m);
+
+	/* Reap any children that terminated while SIGCHLD was not handled */
+	thread_child_handler(NULL, 0);
+}
+
+static void
+thread_pidfd_reap_thread(thread_ref_t thread)
+{
+	thread_reap_t *reap = THREAD_ARG(thread);
+	int status;
+
+	if (!waitpid(reap->pid, &status, WNOHANG)) {
+		/* It hasn't terminated after all */
+		reap->thread = thread_add_read(thread->master, thread_pidfd_reap_thread, reap, reap->pidfd, TIMER_NEVER, 0);
+		return;
+	}
+
+#ifdef _SCRIPT_DEBUG_
+	if (do_script_debug)
+		log_message(LOG_INFO, "Reaped child %d, status 0x%x", reap->pid, (unsigned)status);
+#endif
+
+	thread_close_fd(thread);
+	list_del_init(&reap->e_list);
+	FREE(reap);
+}
+
+static void
+thread_add_reap(thread_master_t *m, pid_t pid, int pidfd)
+{
+	thread_reap_t *reap;
+
+	PMALLOC(reap);
+	reap->pid = pid;
+	reap->pidfd = pidfd;
+	list_add_tail(&reap->e_list, &m->reap);
+
+	reap->thread = thread_add_read(m, thread_pidfd_reap_thread, reap, pidfd, TIMER_NEVER, 0);
+}
+
+static void
+thread_pidfd_child_thread(thread_ref_t thread)
+{
+	thread_t *child = THREAD_ARG(thread);
+	pid_t pid;
+	int status;
+
+	child->u.c.pidfd_thread = NULL;
+
+	pid = waitpid(child->u.c.pid, &status, WNOHANG);
+	if (!pid) {
+		/* It hasn't terminated after all */
+		child->u.c.pidfd_thread = thread_add_read(thread->master, thread_pidfd_child_thread, child, thread->u.f.fd, TIMER_NEVER, THREAD_DESTROY_CLOSE_FD);
+		return;
+	}
+
+	thread_close_fd(thread);
+
+	if (pid == -1) {
+		log_message(LOG_INFO, "waitpid for child %d failed - %d (%m)", child->u.c.pid, errno);
+		return;
+	}
+
+#ifdef _SCRIPT_DEBUG_
+	if (do_script_debug)
+		log_message(LOG_INFO, "waitpid for %d returned 0x%x", pid, (unsigned)status);
+#endif
+
+	thread_child_terminated(child, status);
+}
+
+/* Have a child thread woken by its process's pidfd becoming readable */
+static void
+thread_watch_child(thread_master_t *m, thread_t *thread)
+{
+	thread_reap_t *reap;
+	int fd = -1;
+
+	/* If the process's previous child thread timed out, its pidfd is
+	 * waiting to be reaped, and we take it over. */
+	list_for_each_entry(reap, &m->reap, e_list) {
+		if (reap->pid == thread->u.c.pid) {
+			thread_cancel(reap->thread);
+			fd = reap->pidfd;
+			list_del_init(&reap->e_list);
+			FREE(reap);
+			break;
+		}
+	}
+
+	if (fd == -1 && (fd = pidfd_open(thread->u.c.pid, 0)) == -1) {
+		log_message(LOG_INFO, "pidfd_open for child %d failed - %d (%m), using SIGCHLD", thread->u.c.pid, errno);
+		thread_use_sigchld(m);
+		return;
+	}
+
+	thread->u.c.pidfd_thread = thread_add_read(m, thread_pidfd_child_thread, thread, fd, TIMER_NEVER, THREAD_DESTROY_CLOSE_FD);
+}
+
+/* Stop a child thread being woken by its process's pidfd. If the process
+ * may not yet have been reaped, the pidfd is kept to reap it. */
+static void
+thread_unwatch_child(thread_t *thread, bool reap)
+{
+	thread_ref_t pidfd_thread = thread->u.c.pidfd_thread;
+	int fd;
+
+	if (!pidfd_thread)
+		return;
+
+	thread->u.c.pidfd_thread = NULL;
+	fd = pidfd_thread->u.f.fd;
+	thread_cancel(pidfd_thread);
+
+	if (reap && child_pidfds)
+		thread_add_reap(thread->master, thread->u.c.pid, fd);
+	else
+		close(fd);
+}
+
+/* Restore the pidfd threads after thread_cleanup_master() kept the children */
+static void
+thread_rewatch_children(thread_master_t *m)
+{
+	thread_reap_t *reap;
+	thread_t *thread;
 
-	thread->sands = sands;
+	list_for_each_entry(reap, &m->reap, e_list)
+		reap->thread = thread_add_read(m, thread_pidfd_reap_thread, reap, reap->pidfd, TIMER_NEVER, 0);
 
-	rb_move_cached(&thread->n, &thread->master->timer, thread_timer_less);
+	rb_for_each_entry_cached(thread, &m->child, n) {
+		/* The pidfd thread was destroyed, and its pidfd closed */
+		thread->u.c.pidfd_thread = NULL;
+		if (child_pidfds)
+			thread_watch_child(m, thread);
+	}
 }
+#endif
 
-thread_ref_t
-thread_add_timer_shutdown(thread_master_t *m, thread_func_t func, void *arg, unsigned long timer)
+/* Have a child process that nothing waits for reaped when it terminates.
+ * If children are reaped on SIGCHLD there is nothing to do. */
+void
+thread_reap_child(
+#ifndef USE_PIDFD
+		  __attribute__((unused))
+#endif
+					  thread_master_t *m,
+#ifndef USE_PIDFD
+		  __attribute__((unused))
+#endif
+					  pid_t pid)
 {
-	union {
-		thread_t *p;
-		const thread_t *cp;
-	} thread;
+#ifdef USE_PIDFD
+	int fd;
 
-	thread.cp = thread_add_timer(m, func, arg, timer);
+	if (!m || !child_pidfds)
+		return;
 
-	thread.p->type = THREAD_TIMER_SHUTDOWN;
+	if ((fd = pidfd_open(pid, 0)) == -1) {
+		log_message(LOG_INFO, "pidfd_open for child %d failed - %d (%m), using SIGCHLD", pid, errno);
+		thread_use_sigchld(m);
+		return;
+	}
 
-	return thread.cp;
+	thread_add_reap(m, pid, fd);
+#endif
 }
 
 /* Add a child thread. */
@@ -1420,6 +2765,12 @@ thread_add_child(thread_master_t * m, thread_func_t func, void * arg, pid_t pid,
 	/* Sort by PID */
 	rb_add(&thread->rb_data, &m->child_pid, thread_child_pid_less);
 
+	thread->u.c.pidfd_thread = NULL;
+#ifdef USE_PIDFD
+	if (child_pidfds)
+		thread_watch_child(m, thread);
+#endif
+
 	return thread;
 }
 
@@ -1536,14 +2887,14 @@ thread_cancel(thread_ref_t thread_cp)
 	switch (thread->type) {
 	case THREAD_READ:
 		thread_event_del(thread, THREAD_FL_EPOLL_READ_BIT);
-		rb_erase_cached(&thread->n, &m->read);
+		timer_wheel_del(&m->read, &thread->tw);
 		break;
 	case THREAD_WRITE:
 		thread_event_del(thread, THREAD_FL_EPOLL_WRITE_BIT);
-		rb_erase_cached(&thread->n, &m->write);
+		timer_wheel_del(&m->write, &thread->tw);
 		break;
 	case THREAD_TIMER:
-		rb_erase_cached(&thread->n, &m->timer);
+		timer_wheel_del(&m->timer, &thread->tw);
 		break;
 	case THREAD_CHILD:
 		/* Does this need to kill the child, or is that the
@@ -1552,6 +2903,9 @@ thread_cancel(thread_ref_t thread_cp)
 		 */
 		rb_erase_cached(&thread->n, &m->child);
 		rb_erase(&thread->rb_data, &m->child_pid);
+#ifdef USE_PIDFD
+		thread_unwatch_child(thread, true);
+#endif
 		break;
 	case THREAD_READY_READ_FD:
 	case THREAD_READ_TIMEOUT:
@@ -1573,7 +2927,14 @@ thread_cancel(thread_ref_t thread_cp)
 #ifdef USE_SIGNAL_THREADS
 	case THREAD_SIGNAL:
 #endif
+		list_del_init(&thread->e_list);
+		break;
 	case THREAD_CHILD_TIMEOUT:
+		rb_erase(&thread->rb_data, &m->child_pid);
+#ifdef USE_PIDFD
+		thread_unwatch_child(thread, true);
+#endif
+		/* FALLTHROUGH */
 	case THREAD_CHILD_TERMINATED:
 		list_del_init(&thread->e_list);
 		break;
@@ -1587,24 +2948,41 @@ thread_cancel(thread_ref_t thread_cp)
 		break;
 	}
 
+	/* Stop process_threads() releasing the thread again */
+	if (thread == m->current_thread)
+		m->current_thread = NULL;
+
 	thread_add_unuse(m, thread);
 }
 
 void
 thread_cancel_read(thread_master_t *m, int fd)
 {
-	thread_t *thread, *thread_tmp;
+	thread_event_t *event;
+	thread_t *thread;
 
-	rb_for_each_entry_safe_cached(thread, thread_tmp, &m->read, n) {
-		if (thread->u.f.fd == fd) {
-			if (thread->event->write) {
-				thread_cancel(thread->event->write);
-				thread->event->write = NULL;
-			}
-			thread_cancel(thread);
-			break;
+	/* A thread waiting for read is referenced by its event */
+	event = thread_event_get(m, fd);
+	if (!event)
+		return;
+
+	if (!event->read) {
+		/* Stop a persistent read thread whose function is running */
+		if ((thread = thread_current_persistent_read(m, event))) {
+			thread->u.f.flags &= ~THREAD_PERSISTENT;
+			thread_event_del(thread, THREAD_FL_EPOLL_READ_BIT);
 		}
+		return;
+	}
+
+	if ((thread = event->read)->type != THREAD_READ)
+		return;
+
+	if (event->write) {
+		thread_cancel(event->write);
+		event->write = NULL;
 	}
+	thread_cancel(thread);
 }
 
 #ifdef _INCLUDE_UNUSED_CODE_
@@ -1654,7 +3032,7 @@ snmp_read_thread(thread_ref_t thread)
 		if (FD_ISSET(thread->u.f.fd, &master->snmp_fdset)) {
 			event = thread_event_get(thread->master, thread->u.f.fd);
 			if (!event || !event->read)
-				thread_add_read(thread->master, snmp_read_thread, thread->arg, thread->u.f.fd, TIMER_NEVER, 0);
+				thread_add_read(thread->master, snmp_read_thread, thread->arg, thread->u.f.fd, TIMER_NEVER, THREAD_BACKGROUND);
 		}
 	}
 }
@@ -1666,7 +3044,7 @@ snmp_timeout_thread(thread_ref_t thread)
 	run_alarms();
 	netsnmp_check_outstanding_agent_requests();
 
-	thread->master->snmp_timer_thread = thread_add_timer(thread->master, snmp_timeout_thread, thread->arg, TIMER_NEVER);
+	thread->master->snmp_timer_thread = thread_add_timer_flags(thread->master, snmp_timeout_thread, thread->arg, TIMER_NEVER, THREAD_BACKGROUND);
 
 	snmp_epoll_info(thread->master);
 }
@@ -1727,7 +3105,7 @@ snmp_epoll_info(thread_master_t *m)
 			fd += bit;
 			if (FD_ISSET(fd, &snmp_fdset)) {
 				/* Add the fd */
-				thread_add_read(m, snmp_read_thread, 0, fd, TIMER_NEVER, 0);
+				thread_add_read(m, snmp_read_thread, 0, fd, TIMER_NEVER, THREAD_BACKGROUND);
 				FD_SET(fd, &m->snmp_fdset);
 			} else {
 				/* Remove the fd */
@@ -1796,7 +3174,7 @@ snmp_epoll_update(thread_master_t *m, bool reset)
 				fd += bit;
 
 				/* Add the fd */
-				thread_add_read(m, snmp_read_thread, 0, fd, TIMER_NEVER, 0);
+				thread_add_read(m, snmp_read_thread, 0, fd, TIMER_NEVER, THREAD_BACKGROUND);
 				FD_SET(fd, &m->snmp_fdset);
 			}
 		}
@@ -1821,6 +3199,211 @@ snmp_epoll_clear(thread_master_t *m)
 }
 #endif
 
+/* Enable the scheduler watchdog, which defers deferrable threads while the
+ * deadline returned by the deadline function is less than budget usecs away.
+ * A budget of 0 disables the watchdog. */
+void
+thread_set_watchdog(thread_master_t *m, bool (*deadline)(timeval_t *), unsigned long budget)
+{
+	thread_watchdog_t *wd = m->watchdog;
+
+	if (!budget) {
+		if (wd) {
+			list_splice_init(&wd->deferred, m->ready[THREAD_PRIO_BACKGROUND].prev);
+			FREE(m->watchdog);
+		}
+		return;
+	}
+
+	if (!wd) {
+		PMALLOC(wd);
+		INIT_LIST_HEAD(&wd->deferred);
+		m->watchdog = wd;
+	}
+
+	wd->deadline = deadline;
+	wd->budget = budget;
+	wd->num_deferrable = 0;
+#ifdef _WITH_SNMP_
+	thread_add_deferrable(m, snmp_read_thread);
+	thread_add_deferrable(m, snmp_timeout_thread);
+#endif
+}
+
+void
+thread_add_deferrable(thread_master_t *m, thread_func_t func)
+{
+	thread_watchdog_t *wd = m->watchdog;
+
+	if (!wd || wd->num_deferrable >= THREAD_WD_DEFERRABLE_MAX)
+		return;
+
+	wd->deferrable[wd->num_deferrable++] = func;
+}
+
+/* Is the deadline less than the budget away? */
+static bool
+thread_watchdog_at_risk(const thread_watchdog_t *wd, timeval_t now)
+{
+	timeval_t deadline;
+
+	if (!wd->deadline(&deadline))
+		return false;
+
+	return timer_long(now) + wd->budget >= timer_long(deadline);
+}
+
+static bool
+thread_watchdog_defer(thread_master_t *m, thread_t *thread)
+{
+	thread_watchdog_t *wd = m->watchdog;
+	unsigned i;
+
+	/* A thread is only deferred once, so it can't be starved */
+	if (thread->deferred || shutting_down)
+		return false;
+
+	for (i = 0; i < wd->num_deferrable; i++) {
+		if (wd->deferrable[i] == thread->func)
+			break;
+	}
+
+	if (i == wd->num_deferrable ||
+	    !thread_watchdog_at_risk(wd, timer_now()))
+		return false;
+
+	thread->deferred = true;
+	list_add_tail(&thread->e_list, &wd->deferred);
+	wd->deferrals++;
+
+	return true;
+}
+
+static void
+thread_watchdog_iteration_start(thread_master_t *m)
+{
+	thread_watchdog_t *wd = m->watchdog;
+	timeval_t deadline;
+
+	wd->iteration_start = timer_now();
+	wd->iterations++;
+
+	/* Count each deadline we are running more than budget usecs late for once */
+	if (wd->deadline(&deadline) &&
+	    timer_long(wd->iteration_start) > timer_long(deadline) + wd->budget &&
+	    timercmp(&deadline, &wd->missed_deadline, !=)) {
+		wd->deadlines_missed++;
+		wd->missed_deadline = deadline;
+	}
+
+	/* Deferred threads are run in the background class, after the
+	 * background threads made ready this time */
+	list_splice_init(&wd->deferred, m->ready[THREAD_PRIO_BACKGROUND].prev);
+}
+
+static void
+thread_watchdog_iteration_end(thread_master_t *m)
+{
+	thread_watchdog_t *wd = m->watchdog;
+	uint64_t iteration_time;
+
+	if (!timerisset(&wd->iteration_start))
+		return;
+
+	iteration_time = timer_long(timer_now()) - timer_long(wd->iteration_start);
+	wd->iteration_time += iteration_time;
+	if (iteration_time > wd->max_iteration_time)
+		wd->max_iteration_time = iteration_time;
+
+	timerclear(&wd->iteration_start);
+}
+
+static void
+thread_watchdog_account(thread_watchdog_t *wd, int type, timeval_t start)
+{
+	enum thread_wd_queue queue;
+
+	switch (type) {
+	case THREAD_READY_TIMER:
+	case THREAD_READ_TIMEOUT:
+	case THREAD_WRITE_TIMEOUT:
+	case THREAD_TIMER_SHUTDOWN:
+		queue = THREAD_WD_TIMER;
+		break;
+	case THREAD_READY_READ_FD:
+	case THREAD_READY_WRITE_FD:
+	case THREAD_READ_ERROR:
+	case THREAD_WRITE_ERROR:
+		queue = THREAD_WD_IO;
+		break;
+	case THREAD_CHILD_TIMEOUT:
+	case THREAD_CHILD_TERMINATED:
+		queue = THREAD_WD_CHILD;
+		break;
+	default:
+		queue = THREAD_WD_EVENT;
+		break;
+	}
+
+	wd->queue_time[queue] += timer_long(timer_now()) - timer_long(start);
+	wd->queue_runs[queue]++;
+}
+
+void
+dump_thread_watchdog(const thread_master_t *m, FILE *fp)
+{
+	const thread_watchdog_t *wd = m->watchdog;
+	static const char *queue_names[THREAD_WD_QUEUES] = { "event", "timer", "io", "child" };
+	unsigned i;
+
+	if (!wd)
+		return;
+
+	fprintf(fp, "Scheduler watchdog, budget %luus\n", wd->budget);
+	fprintf(fp, "  iterations %lu, run %" PRIu64 "us, max iteration %" PRIu64 "us\n",
+		wd->iterations, wd->iteration_time, wd->max_iteration_time);
+	for (i = 0; i < THREAD_WD_QUEUES; i++)
+		fprintf(fp, "  %s queue: runs %lu, run %" PRIu64 "us\n",
+			queue_names[i], wd->queue_runs[i], wd->queue_time[i]);
+	fprintf(fp, "  deadlines missed %lu, threads deferred %lu\n",
+		wd->deadlines_missed, wd->deferrals);
+}
+
+/* The ready queue of the highest priority class with ready threads, unless
+ * it has used up its burst and a lower class has ready threads. */
+static list_head_t *
+thread_ready_queue(thread_master_t *m)
+{
+	list_head_t *queue = NULL;
+	unsigned prio, lower;
+
+	for (prio = 0; prio < THREAD_PRIO_CLASSES; prio++) {
+		if (list_empty(&m->ready[prio]))
+			continue;
+
+		if (!queue)
+			queue = &m->ready[prio];
+
+		for (lower = prio + 1; lower < THREAD_PRIO_CLASSES; lower++) {
+			if (!list_empty(&m->ready[lower]))
+				break;
+		}
+
+		if (lower == THREAD_PRIO_CLASSES) {
+			m->ready_burst[prio] = 0;
+			return &m->ready[prio];
+		}
+
+		if (m->ready_burst[prio]++ < THREAD_PRIO_BURST)
+			return &m->ready[prio];
+
+		/* Let a lower class thread run */
+		m->ready_burst[prio] = 0;
+	}
+
+	return queue;
+}
+
 /* Fetch next ready thread. */
 static list_head_t *
 thread_fetch_next_queue(thread_master_t *m)
@@ -1833,6 +3416,7 @@ thread_fetch_next_queue(thread_master_t *m)
 	int i;
 	timeval_t earliest_timer;
 	unsigned timeout;
+	list_head_t *queue;
 
 	assert(m != NULL);
 
@@ -1841,8 +3425,8 @@ thread_fetch_next_queue(thread_master_t *m)
 		return &m->event;
 
 	/* If there are ready threads process them */
-	if (!list_empty(&m->ready))
-		return &m->ready;
+	if ((queue = thread_ready_queue(m)))
+		return queue;
 
 	do {
 		/* Calculate and set wait timer. Take care of timeouted fd.  */
@@ -1863,8 +3447,16 @@ thread_fetch_next_queue(thread_master_t *m)
 			log_message(LOG_INFO, "calling epoll_wait");
 #endif
 
+		if (m->watchdog)
+			thread_watchdog_iteration_end(m);
+
 		/* Call epoll function. */
-		ret = epoll_wait(m->epoll_fd, m->epoll_events, m->epoll_count, -1);
+#ifdef _WITH_IO_URING_
+		if (m->uring)
+			ret = thread_uring_wait(m);
+		else
+#endif
+			ret = epoll_wait(m->epoll_fd, m->epoll_events, m->epoll_count, -1);
 
 #ifdef _EPOLL_DEBUG_
 		if (do_epoll_debug) {
@@ -1914,8 +3506,9 @@ thread_fetch_next_queue(thread_master_t *m)
 		} else
 			last_epoll_errno = 0;
 
-		/* Check to see if we are long overdue. This can happen on a very heavily loaded system */
-		if (min_auto_priority_delay && timerisset(&earliest_timer)) {
+		/* Check to see if we are long overdue. This can happen on a very heavily loaded system.
+		 * Only the main thread's master adjusts the process priority. */
+		if (min_auto_priority_delay && m == master && timerisset(&earliest_timer)) {
 			/* Re-read the current time to get the maximum accuracy */
 			set_time_now();
 
@@ -2001,12 +3594,207 @@ thread_fetch_next_queue(thread_master_t *m)
 		/* Update current time */
 		set_time_now();
 
+		if (m->watchdog)
+			thread_watchdog_iteration_start(m);
+
 		/* If there is a ready thread, return it. */
-		if (!list_empty(&m->ready))
-			return &m->ready;
+		if ((queue = thread_ready_queue(m)))
+			return queue;
 	} while (true);
 }
 
+/* Per thread function statistics. The table is indexed by a hash of the
+ * function address, using linear probing. */
+static inline size_t
+hash_func_addr(thread_func_t func)
+{
+	return (size_t)(((uint64_t)(uintptr_t)func * UINT64_C(0x9e3779b97f4a7c15)) >> 32);
+}
+
+static thread_func_stats_t *
+thread_func_stats_get(thread_func_t func)
+{
+	thread_func_stats_t *old_stats;
+	size_t old_size, i, h;
+
+	if (func_stats_used * 4 >= func_stats_size * 3) {
+		old_stats = func_stats;
+		old_size = func_stats_size;
+
+		func_stats_size = old_size ? old_size * 2 : THREAD_STATS_INITIAL_SIZE;
+		func_stats = MALLOC(func_stats_size * sizeof(*func_stats));
+
+		for (i = 0; i < old_size; i++) {
+			if (!old_stats[i].func)
+				continue;
+			h = hash_func_addr(old_stats[i].func) & (func_stats_size - 1);
+			while (func_stats[h].func)
+				h = (h + 1) & (func_stats_size - 1);
+			func_stats[h] = old_stats[i];
+		}
+
+		if (old_stats)
+			FREE(old_stats);
+	}
+
+	for (h = hash_func_addr(func) & (func_stats_size - 1); func_stats[h].func; h = (h + 1) & (func_stats_size - 1)) {
+		if (func_stats[h].func == func)
+			return &func_stats[h];
+	}
+
+	func_stats[h].func = func;
+	func_stats_used++;
+
+	return &func_stats[h];
+}
+
+static inline unsigned
+thread_stats_bucket(uint64_t usecs)
+{
+	unsigned bucket;
+
+	if (!usecs)
+		return 0;
+
+	bucket = 64 - (unsigned)__builtin_clzll(usecs);
+
+	return bucket < THREAD_STATS_BUCKETS ? bucket : THREAD_STATS_BUCKETS - 1;
+}
+
+static inline uint64_t
+timespec_usecs(const struct timespec *ts)
+{
+	return (uint64_t)ts->tv_sec * TIMER_HZ + (uint64_t)ts->tv_nsec / 1000;
+}
+
+static void
+thread_call_stats(thread_t *thread)
+{
+	thread_func_t func = thread->func;
+	thread_func_stats_t *stats;
+	timeval_t start, end;
+	struct timespec cpu_start, cpu_end;
+	uint64_t run_time, cpu_time, late = 0;
+	bool timed;
+
+	/* Only threads run because a timer expired have a scheduled time */
+	timed = (thread->type == THREAD_READY_TIMER ||
+		 thread->type == THREAD_READ_TIMEOUT ||
+		 thread->type == THREAD_WRITE_TIMEOUT ||
+		 thread->type == THREAD_CHILD_TIMEOUT) &&
+		thread->sands.tv_sec != TIMER_DISABLED;
+
+	/* timer_now() is on the same clock as sands */
+	start = timer_now();
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_start);
+
+	if (timed && timercmp(&start, &thread->sands, >))
+		late = timer_long(start) - timer_long(thread->sands);
+
+	/* thread may be freed by the function, so don't touch it after this */
+	(*func)(thread);
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_end);
+	end = timer_now();
+
+	run_time = timer_long(end) - timer_long(start);
+	cpu_time = timespec_usecs(&cpu_end) - timespec_usecs(&cpu_start);
+
+	stats = thread_func_stats_get(func);
+	stats->runs++;
+	stats->run_time += run_time;
+	stats->cpu_time += cpu_time;
+	if (run_time > stats->max_run_time)
+		stats->max_run_time = run_time;
+	stats->run_hist[thread_stats_bucket(run_time)]++;
+
+	if (timed) {
+		stats->timed_runs++;
+		stats->late_time += late;
+		if (late > stats->max_late)
+			stats->max_late = late;
+		stats->late_hist[thread_stats_bucket(late)]++;
+	}
+}
+
+static int
+thread_func_stats_cmp(const void *a, const void *b)
+{
+	const thread_func_stats_t *s1 = a, *s2 = b;
+
+	/* Sort by descending CPU time */
+	return s1->cpu_time < s2->cpu_time ? 1 : s1->cpu_time > s2->cpu_time ? -1 : 0;
+}
+
+static void
+dump_thread_hist(FILE *fp, const char *name, const unsigned long *hist)
+{
+	char buf[THREAD_STATS_BUCKETS * 24];
+	size_t len = 0;
+	unsigned i;
+
+	for (i = 0; i < THREAD_STATS_BUCKETS && len < sizeof(buf); i++) {
+		if (!hist[i])
+			continue;
+		len += (size_t)snprintf(buf + len, sizeof(buf) - len, " <%" PRIu64 "us:%lu",
+					i ? UINT64_C(1) << i : 1, hist[i]);
+	}
+
+	fprintf(fp, "    %s:%s\n", name, len ? buf : " none");
+}
+
+void
+dump_thread_stats(FILE *fp)
+{
+	thread_func_stats_t *sorted;
+	size_t i, n = 0;
+
+	fprintf(fp, "Thread function statistics for pid %d (%s)\n", getpid(), func_stats_enabled ? "enabled" : "disabled");
+
+	if (!func_stats_used)
+		return;
+
+	sorted = MALLOC(func_stats_used * sizeof(*sorted));
+	for (i = 0; i < func_stats_size; i++) {
+		if (func_stats[i].func)
+			sorted[n++] = func_stats[i];
+	}
+	qsort(sorted, n, sizeof(*sorted), thread_func_stats_cmp);
+
+	for (i = 0; i < n; i++) {
+#ifdef THREAD_DUMP
+		fprintf(fp, "  %s()\n", get_function_name(sorted[i].func));
+#else
+		fprintf(fp, "  %p\n", sorted[i].func);
+#endif
+		fprintf(fp, "    runs %lu, cpu %" PRIu64 "us, run %" PRIu64 "us, max run %" PRIu64 "us\n",
+			sorted[i].runs, sorted[i].cpu_time, sorted[i].run_time, sorted[i].max_run_time);
+		dump_thread_hist(fp, "run time", sorted[i].run_hist);
+		if (sorted[i].timed_runs) {
+			fprintf(fp, "    timer runs %lu, late %" PRIu64 "us, max late %" PRIu64 "us\n",
+				sorted[i].timed_runs, sorted[i].late_time, sorted[i].max_late);
+			dump_thread_hist(fp, "lateness", sorted[i].late_hist);
+		}
+	}
+
+	FREE(sorted);
+}
+
+void
+thread_set_stats(bool enable)
+{
+	func_stats_enabled = enable;
+}
+
+void
+thread_clear_stats(void)
+{
+	if (func_stats)
+		FREE(func_stats);
+	func_stats_size = 0;
+	func_stats_used = 0;
+}
+
 /* Call thread ! */
 static inline void
 thread_call(thread_t * thread)
@@ -2016,7 +3804,10 @@ thread_call(thread_t * thread)
 		log_message(LOG_INFO, "Calling thread function %s(), type %s, val/fd/pid %d, status %d id %lu", get_function_name(thread->func), get_thread_type_str(thread->type), thread->u.val, thread->u.c.status, thread->id);
 #endif
 
-	(*thread->func) (thread);
+	if (func_stats_enabled)
+		thread_call_stats(thread);
+	else
+		(*thread->func) (thread);
 }
 
 int
@@ -2026,6 +3817,8 @@ process_threads(thread_master_t *m)
 	list_head_t *thread_list;
 	int thread_type;
 	int exit_code = 0;
+	bool rearmed;
+	timeval_t start;
 
 	/*
 	 * Processing the master thread queues,
@@ -2054,14 +3847,24 @@ process_threads(thread_master_t *m)
 		if (!(thread = thread_trim_head(thread_list)))
 			continue;
 
+		if (m->watchdog && thread_watchdog_defer(m, thread))
+			continue;
+
 		m->current_thread = thread;
 		thread_type = thread->type;
+		rearmed = false;
+		timerclear(&start);
 
 		if (thread->type == THREAD_CHILD_TIMEOUT) {
 			/* We remove the thread from the child_pid queue here so that
 			 * if the termination arrives before we processed the timeout
 			 * we can still handle the termination. */
 			rb_erase(&thread->rb_data, &master->child_pid);
+#ifdef USE_PIDFD
+			/* If the timeout function doesn't add a new child thread
+			 * for the process, it still needs reaping */
+			thread_unwatch_child(thread, true);
+#endif
 		}
 
 		if (!shutting_down ||
@@ -2070,7 +3873,12 @@ process_threads(thread_master_t *m)
 		      thread->type == THREAD_READ_ERROR ||
 		      thread->type == THREAD_WRITE_ERROR) &&
 		     (thread->u.f.fd == m->timer_fd ||
-		      thread->u.f.fd == m->signal_fd
+		      thread->u.f.fd == m->signal_fd ||
+		      thread->u.f.fd == m->remote_fd
+#ifdef USE_PIDFD
+		      || thread->func == thread_pidfd_child_thread
+		      || thread->func == thread_pidfd_reap_thread
+#endif
 #ifdef _WITH_SNMP_
 		      || (snmp_running && FD_ISSET(thread->u.f.fd, &m->snmp_fdset))
 #endif
@@ -2082,13 +3890,30 @@ process_threads(thread_master_t *m)
 		    thread->type == THREAD_TERMINATE) {
 			exit_code = thread->u.val;
 
+			if (thread->event && thread_current_persistent_read(m, thread->event))
+				thread_read_persist(thread);
+
+			if (m->watchdog)
+				start = timer_now();
+
 			if (thread->func)
 				thread_call(thread);
 
+			/* The watchdog may have been disabled by a reload */
+			if (m->watchdog && timerisset(&start))
+				thread_watchdog_account(m->watchdog, thread_type, start);
+
 			/* If m->current_thread has been cleared, the thread
 			 * has been freed. This happens during a reload. */
 			thread = m->current_thread;
 
+			if (thread && thread_read_rearm(m, thread)) {
+				m->current_event = thread->event;
+				m->current_thread = NULL;
+				thread = NULL;
+				rearmed = true;
+			}
+
 			if (thread_type == THREAD_TERMINATE_START)
 				shutting_down = true;
 		} else if (thread->type == THREAD_READY_READ_FD ||
@@ -2107,7 +3932,7 @@ process_threads(thread_master_t *m)
 			m->current_event = (thread_type == THREAD_READY_READ_FD || thread_type == THREAD_READY_WRITE_FD) ? thread->event : NULL;
 			thread_add_unuse(m, thread);
 			m->current_thread = NULL;
-		} else
+		} else if (!rearmed)
 			m->current_event = NULL;
 
 		/* If we are shutting down, and the shutdown timer is not running and
@@ -2126,7 +3951,6 @@ process_threads(thread_master_t *m)
 static void
 process_child_termination(pid_t pid, int status)
 {
-	thread_master_t * m = master;
 	rb_node_t *thread_node;
 	thread_t *thread;
 
@@ -2142,18 +3966,12 @@ process_child_termination(pid_t pid, int status)
 	if (!thread_node)
 		return;
 
-	rb_erase(&thread->rb_data, &master->child_pid);
-
-	thread->u.c.status = status;
+#ifdef USE_PIDFD
+	/* The process has been reaped, so its pidfd is no longer needed */
+	thread_unwatch_child(thread, false);
+#endif
 
-	if (thread->type == THREAD_CHILD_TIMEOUT) {
-		/* The child had been timed out, but we have not processed the timeout
-		 * and it is still on the thread->ready queue. Since we have now got
-		 * the termination, just handle the termination instead. */
-		thread->type = THREAD_CHILD_TERMINATED;
-	}
-	else
-		thread_move_ready(m, &m->child, thread, THREAD_CHILD_TERMINATED);
+	thread_child_terminated(thread, status);
 }
 
 /* Synchronous signal handler to reap child processes */
@@ -2189,12 +4007,35 @@ thread_add_base_threads(thread_master_t *m,
 #endif
 								     bool with_snmp)
 {
-	m->timer_thread = thread_add_read(m, thread_timerfd_handler, NULL, m->timer_fd, TIMER_NEVER, 0);
+	m->timer_thread = thread_add_read(m, thread_timerfd_handler, NULL, m->timer_fd, TIMER_NEVER, THREAD_PERSISTENT);
 	add_signal_read_thread(m);
+	if (m->remote_fd != -1)
+		m->remote_thread = thread_add_read(m, thread_remote_handler, NULL, m->remote_fd, TIMER_NEVER, THREAD_PERSISTENT);
+#ifdef USE_PIDFD
+	thread_rewatch_children(m);
+#endif
 #ifdef _WITH_SNMP_
 	if (with_snmp)
-		m->snmp_timer_thread = thread_add_timer(m, snmp_timeout_thread, 0, TIMER_NEVER);
+		m->snmp_timer_thread = thread_add_timer_flags(m, snmp_timeout_thread, 0, TIMER_NEVER, THREAD_BACKGROUND);
+#endif
+}
+
+/* Set up reaping of child processes */
+void
+thread_set_child_handler(thread_master_t *m)
+{
+#ifdef USE_PIDFD
+	int subreaper = 0;
+
+	/* Children are reaped when their pidfd becomes readable, but orphaned
+	 * processes reparented to a child subreaper have no pidfd, so it must
+	 * still reap on SIGCHLD. */
+	if (child_pidfds &&
+	    (prctl(PR_GET_CHILD_SUBREAPER, &subreaper) || !subreaper))
+		return;
 #endif
+
+	signal_set(SIGCHLD, thread_child_handler, m);
 }
 
 /* Our infinite scheduling loop */
@@ -2202,7 +4043,7 @@ int
 launch_thread_scheduler(thread_master_t *m)
 {
 // TODO - do this somewhere better
-	signal_set(SIGCHLD, thread_child_handler, m);
+	thread_set_child_handler(m);
 
 	return process_threads(m);
 }
@@ -2223,6 +4064,11 @@ register_scheduler_addresses(void)
 	register_thread_address("snmp_read_thread", snmp_read_thread);
 #endif
 	register_thread_address("thread_timerfd_handler", thread_timerfd_handler);
+	register_thread_address("thread_remote_handler", thread_remote_handler);
+#ifdef USE_PIDFD
+	register_thread_address("thread_pidfd_child_thread", thread_pidfd_child_thread);
+	register_thread_address("thread_pidfd_reap_thread", thread_pidfd_reap_thread);
+#endif
 
 	register_signal_handler_address("thread_child_handler", thread_child_handler);
 }
@@ -26,25 +26,25 @@
 /* system includes */
 #include <sys/types.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <sys/timerfd.h>
 #ifdef _WITH_SNMP_
 #include <sys/select.h>
 #endif
-#ifdef THREAD_DUMP
 #include <stdio.h>
-#endif
 
 #include "timer.h"
 #include "list_head.h"
 #include "rbtree_ka.h"
+#include "timer_wheel.h"
 
 /* Thread types. */
 typedef enum {
-	THREAD_READ,		/* thread_master.read rb tree */
-	THREAD_WRITE,		/* thread_master.write rb tree */
-	THREAD_TIMER,		/* thread_master.timer rb tree */
-	THREAD_TIMER_SHUTDOWN,	/* thread_master.timer rb tree */
+	THREAD_READ,		/* thread_master.read timer wheel */
+	THREAD_WRITE,		/* thread_master.write timer wheel */
+	THREAD_TIMER,		/* thread_master.timer timer wheel */
+	THREAD_TIMER_SHUTDOWN,	/* thread_master.timer timer wheel */
 	THREAD_CHILD,		/* thread_master.child rb tree */
 #define THREAD_MAX_WAITING THREAD_CHILD
 	THREAD_UNUSED,		/* thread_master.unuse list_head */
@@ -75,15 +75,48 @@ enum thread_flags {
 	THREAD_FL_EPOLL_BIT,		/* fd is registered with epoll */
 	THREAD_FL_EPOLL_READ_BIT,	/* read is registered */
 	THREAD_FL_EPOLL_WRITE_BIT,	/* write is registered */
+#ifdef _WITH_IO_URING_
+	THREAD_FL_URING_READ_BIT,	/* io_uring read poll is armed */
+	THREAD_FL_URING_WRITE_BIT,	/* io_uring write poll is armed */
+	THREAD_FL_URING_READ_PENDING_BIT,  /* read poll is waiting for a free SQE */
+	THREAD_FL_URING_WRITE_PENDING_BIT, /* write poll is waiting for a free SQE */
+#endif
 };
 
 /* epoll def */
 #define THREAD_EPOLL_REALLOC_THRESH	64
 
+/* Events for fds below this are found by indexing m->io_event_table,
+ * and the io_events rbtree is only used for fds above it */
+#define THREAD_EVENT_TABLE_MAX		65536
+#define THREAD_EVENT_TABLE_MIN		64
+
 /* Thread flags for thread destruction */
 #define THREAD_DESTROY_CLOSE_FD	0x01
 #define THREAD_DESTROY_FREE_ARG	0x02
 
+/* A persistent read thread is requeued each time its function has run, until
+ * its fd is closed, deleted or cancelled, or another read thread is added for
+ * the fd. The timeout of a thread added with thread_add_read() is restarted,
+ * otherwise thread_requeue_read() must be called to set the next timeout. */
+#define THREAD_PERSISTENT	0x04
+
+/* Thread flags for the priority class of the thread when it is ready */
+#define THREAD_REALTIME		0x08
+#define THREAD_BACKGROUND	0x10
+
+/* Priority classes of ready threads. Higher classes are run first, but once
+ * THREAD_PRIO_BURST threads of a class have been run in a row while a lower
+ * class has ready threads, a thread of the lower class is run. */
+typedef enum {
+	THREAD_PRIO_REALTIME,		/* protocol timers and packets */
+	THREAD_PRIO_NORMAL,
+	THREAD_PRIO_BACKGROUND,		/* stats, SNMP, DBus etc */
+	THREAD_PRIO_CLASSES
+} thread_prio_t;
+
+#define THREAD_PRIO_BURST	8
+
 typedef struct _thread thread_t;
 typedef const thread_t * thread_ref_t;
 typedef void (*thread_func_t)(thread_ref_t);
@@ -94,10 +127,12 @@ typedef union {
 	struct {
 		int fd;		/* file descriptor in case of read/write. */
 		unsigned flags;
+		unsigned long timer;	/* timeout of a persistent read thread */
 	} f;
 	struct {
 		pid_t pid;	/* process id a child thread is wanting. */
 		int status;	/* return status of the process */
+		thread_ref_t pidfd_thread; /* thread waiting for the process's pidfd */
 	} c;
 } thread_arg2;
 
@@ -111,10 +146,13 @@ struct _thread {
 	timeval_t sands;		/* rest of time sands value. */
 	thread_arg2 u;			/* second argument of the event. */
 	struct _thread_event *event;	/* Thread Event back-pointer */
+	bool deferred;			/* deferred once by the watchdog */
+	thread_prio_t prio;		/* ready queue priority class */
 
 	union {
 		rb_node_t n;
 		list_head_t e_list;
+		timer_node_t tw;
 	};
 
 	rb_node_t rb_data;		/* PID or fd/vrid */
@@ -126,43 +164,173 @@ typedef struct _thread_event {
 	thread_t		*write;
 	unsigned long		flags;
 	int			fd;
+#ifdef _WITH_IO_URING_
+	uint32_t		uring_gen[2];	/* generation of armed read/write poll */
+#endif
 
 	rb_node_t		n;
 } thread_event_t;
 
+#ifdef _WITH_IO_URING_
+/* io_uring submission and completion rings */
+typedef struct _thread_uring {
+	int			fd;
+	unsigned		sq_entries;
+	unsigned		sq_mask;
+	unsigned		*sq_head;
+	unsigned		*sq_tail;
+	unsigned		*sq_array;
+	struct io_uring_sqe	*sqes;
+	unsigned		cq_mask;
+	unsigned		*cq_head;
+	unsigned		*cq_tail;
+	struct io_uring_cqe	*cqes;
+	void			*sq_ring;
+	size_t			sq_ring_size;
+	void			*cq_ring;
+	size_t			cq_ring_size;
+	size_t			sqes_size;
+	unsigned		to_submit;	/* queued SQEs not yet submitted */
+	uint32_t		gen;		/* poll request generation */
+	bool			arm_pending;	/* some polls are waiting for a free SQE */
+} thread_uring_t;
+#endif
+
+/* Per thread function run statistics. Histogram bucket n counts times
+ * in [2^(n-1), 2^n) usecs. */
+#define THREAD_STATS_BUCKETS		26
+#define THREAD_STATS_INITIAL_SIZE	64
+
+typedef struct _thread_func_stats {
+	thread_func_t		func;
+	unsigned long		runs;
+	uint64_t		run_time;	/* usecs */
+	uint64_t		cpu_time;	/* usecs */
+	uint64_t		max_run_time;
+	unsigned long		timed_runs;	/* runs due to timer expiry */
+	uint64_t		late_time;	/* total usecs run after sands */
+	uint64_t		max_late;
+	unsigned long		run_hist[THREAD_STATS_BUCKETS];
+	unsigned long		late_hist[THREAD_STATS_BUCKETS];
+} thread_func_stats_t;
+
+/* The scheduler watchdog. Time spent running threads is accounted by the
+ * queue they were run from, and while the next protocol deadline is less
+ * than budget usecs away, deferrable threads are deferred to the next
+ * iteration of the scheduling loop. */
+#define THREAD_WD_DEFERRABLE_MAX	16
+
+enum thread_wd_queue {
+	THREAD_WD_EVENT,
+	THREAD_WD_TIMER,
+	THREAD_WD_IO,
+	THREAD_WD_CHILD,
+	THREAD_WD_QUEUES
+};
+
+typedef struct _thread_watchdog {
+	bool			(*deadline)(timeval_t *);
+	unsigned long		budget;		/* usecs */
+	thread_func_t		deferrable[THREAD_WD_DEFERRABLE_MAX];
+	unsigned		num_deferrable;
+	list_head_t		deferred;	/* thread_t */
+	timeval_t		iteration_start;
+	timeval_t		missed_deadline;	/* the last deadline counted as missed */
+
+	/* Counters */
+	unsigned long		iterations;
+	uint64_t		iteration_time;	/* usecs */
+	uint64_t		max_iteration_time;
+	uint64_t		queue_time[THREAD_WD_QUEUES];
+	unsigned long		queue_runs[THREAD_WD_QUEUES];
+	unsigned long		deadlines_missed;
+	unsigned long		deferrals;
+} thread_watchdog_t;
+
+/* Slab of cache line aligned thread_t or thread_event_t objects */
+#define THREAD_CACHE_LINE		64
+#define THREAD_SLAB_BLOCK_SIZE		16384
+#define THREAD_UNUSE_HIGH_WATER		256
+
+typedef struct _thread_slab {
+	const char		*name;
+	size_t			obj_size;	/* rounded up to a cache line */
+	unsigned		objs_per_block;
+	list_head_t		partial;	/* blocks with free objects */
+	list_head_t		full;		/* blocks with no free objects */
+	unsigned		blocks;
+	unsigned		empty_blocks;
+	unsigned		in_use;
+	unsigned		peak;
+	unsigned long		allocs;
+	unsigned long		frees;
+	unsigned long		block_allocs;
+	unsigned long		block_frees;
+} thread_slab_t;
+
+/* Event posted to a thread master from another posix thread */
+typedef struct _thread_remote {
+	struct _thread_remote	*next;
+	thread_func_t		func;
+	void			*arg;
+	int			val;
+	unsigned		flags;		/* THREAD_DESTROY_FREE_ARG if discarded */
+} thread_remote_t;
+
+/* A child process that needs reaping, but nothing waits for */
+typedef struct _thread_reap {
+	pid_t			pid;
+	int			pidfd;
+	thread_ref_t		thread;		/* thread waiting for the pidfd */
+	list_head_t		e_list;
+} thread_reap_t;
+
 /* Master of the threads. */
 typedef struct _thread_master {
-	rb_root_cached_t	read;
-	rb_root_cached_t	write;
-	rb_root_cached_t	timer;
+	timer_wheel_t		read;
+	timer_wheel_t		write;
+	timer_wheel_t		timer;
 	rb_root_cached_t	child;
 	list_head_t		event;
 #ifdef USE_SIGNAL_THREADS
 	list_head_t		signal;
 #endif
-	list_head_t		ready;
+	list_head_t		ready[THREAD_PRIO_CLASSES];
+	unsigned		ready_burst[THREAD_PRIO_CLASSES];	/* run in a row with lower classes waiting */
 	list_head_t		unuse;
 
 	thread_t		*current_thread;
 
 	/* child process related */
 	rb_root_t		child_pid;
+	list_head_t		reap;		/* thread_reap_t */
 
 	/* epoll related */
-	rb_root_t		io_events;
+	thread_event_t		**io_event_table;	/* indexed by fd */
+	unsigned		io_event_table_size;
+	rb_root_t		io_events;	/* fds >= THREAD_EVENT_TABLE_MAX */
 	struct epoll_event	*epoll_events;
 	thread_event_t		*current_event;
 	unsigned int		epoll_size;
 	unsigned int		epoll_count;
 	int			epoll_fd;
+#ifdef _WITH_IO_URING_
+	thread_uring_t		*uring;		/* Set if using io_uring rather than epoll */
+#endif
 
 	/* timer related */
 	int			timer_fd;
 	thread_ref_t		timer_thread;
+	unsigned long		timer_slack;	/* default slack for thread_add_timer() */
 
 	/* signal related */
 	int			signal_fd;
 
+	/* events posted from other posix threads */
+	int			remote_fd;
+	thread_ref_t		remote_thread;
+	thread_remote_t		*remote;	/* lock-free, most recent first */
+
 #ifdef _WITH_SNMP_
 	/* snmp related */
 	thread_ref_t		snmp_timer_thread;
@@ -170,6 +338,14 @@ typedef struct _thread_master {
 	fd_set			snmp_fdset;
 #endif
 
+	/* Object allocation */
+	thread_slab_t		thread_slab;
+	thread_slab_t		event_slab;
+	unsigned		unuse_count;
+	unsigned		unuse_high_water;	/* max threads on unuse list */
+
+	thread_watchdog_t	*watchdog;
+
 	/* Local data */
 	unsigned long		alloc;
 	unsigned long		id;
@@ -251,6 +427,12 @@ extern void log_child_died(const char *, pid_t);
 extern int report_child_status(int, pid_t, const char *);
 #endif
 extern thread_master_t *thread_make_master(void);
+extern thread_master_t *thread_make_worker_master(void);
+extern bool thread_enable_remote_events(thread_master_t *);
+extern void thread_add_remote_event(thread_master_t *, thread_func_t, void *, int, unsigned);
+#ifdef _WITH_IO_URING_
+extern bool thread_set_io_uring(thread_master_t *, bool);
+#endif
 extern thread_ref_t thread_add_terminate_event(thread_master_t *);
 extern thread_ref_t thread_add_parent_terminate_event(thread_master_t *, int);
 extern thread_ref_t thread_add_start_terminate_event(thread_master_t *, thread_func_t);
@@ -268,11 +450,22 @@ extern void thread_del_write(thread_ref_t);
 extern void thread_close_fd(thread_ref_t);
 extern thread_ref_t thread_add_timer_uval(thread_master_t *, thread_func_t, void *, unsigned, unsigned long);
 extern thread_ref_t thread_add_timer(thread_master_t *, thread_func_t, void *, unsigned long);
+extern thread_ref_t thread_add_timer_flags(thread_master_t *, thread_func_t, void *, unsigned long, unsigned);
+extern thread_ref_t thread_add_timer_slack(thread_master_t *, thread_func_t, void *, unsigned long, unsigned long);
+extern void thread_set_timer_slack(thread_master_t *, unsigned long);
+extern void thread_set_unuse_high_water(thread_master_t *, unsigned);
+extern void thread_set_stats(bool);
+extern void thread_clear_stats(void);
+extern void dump_thread_stats(FILE *);
+extern void thread_set_watchdog(thread_master_t *, bool (*)(timeval_t *), unsigned long);
+extern void thread_add_deferrable(thread_master_t *, thread_func_t);
+extern void dump_thread_watchdog(const thread_master_t *, FILE *);
 extern void thread_update_arg2(thread_ref_t, const thread_arg2 *);
 extern void timer_thread_update_timeout(thread_ref_t, unsigned long);
 extern thread_ref_t thread_add_timer_shutdown(thread_master_t *, thread_func_t, void *, unsigned long);
 extern thread_ref_t thread_add_child(thread_master_t *, thread_func_t, void *, pid_t, unsigned long);
 extern void thread_children_reschedule(thread_master_t *, thread_func_t, unsigned long);
+extern void thread_reap_child(thread_master_t *, pid_t);
 extern thread_ref_t thread_add_event(thread_master_t *, thread_func_t, void *, int);
 extern void thread_cancel(thread_ref_t);
 extern void thread_cancel_read(thread_master_t *, int);
@@ -283,6 +476,7 @@ extern void snmp_epoll_clear(thread_master_t *);
 #endif
 extern int process_threads(thread_master_t *);
 extern void thread_child_handler(void *, int);
+extern void thread_set_child_handler(thread_master_t *);
 extern void thread_add_base_threads(thread_master_t *, bool);
 extern int launch_thread_scheduler(thread_master_t *);
 #ifndef _ONE_PROCESS_DEBUG_
@@ -89,6 +89,8 @@ get_signum(const char *sigfunc)
 		return SIGUSR2;
 	else if (!strcmp(sigfunc, "STATS_CLEAR"))
 		return SIGSTATS_CLEAR;
+	else if (!strcmp(sigfunc, "TSTATS"))
+		return SIGTSTATS;
 #ifdef _WITH_JSON_
 	else if (!strcmp(sigfunc, "JSON"))
 		return SIGJSON;
@@ -229,6 +231,37 @@ signal_ignore(int signo)
 	sigdelset(&parent_sig, signo);
 }
 
+/* Give a signal its default disposition, and stop handling it via signal_fd.
+ * Unlike ignoring SIGCHLD, this still leaves children to be waited for. */
+void
+signal_default(int signo)
+{
+	sigset_t sset;
+	struct sigaction sig;
+
+	sigaddset(&dfl_sig, signo);
+
+	if (sigismember(&signal_fd_set, signo)) {
+		sigdelset(&signal_fd_set, signo);
+		if (signal_fd != -1 &&
+		    signalfd(signal_fd, &signal_fd_set, 0) == -1)
+			log_message(LOG_INFO, "BUG - signal_fd update failed - %d (%s), please report", errno, strerror(errno));
+	}
+
+	sig.sa_handler = SIG_DFL;
+	sigemptyset(&sig.sa_mask);
+	sig.sa_flags = 0;
+	if (sigaction(signo, &sig, NULL))
+		log_message(LOG_INFO, "sigaction failed for signal %d", signo);
+
+	sigemptyset(&sset);
+	sigaddset(&sset, signo);
+	sigmask_func(SIG_UNBLOCK, &sset, NULL);
+
+	signal_handler_func[signo-1] = NULL;
+	signal_v[signo-1] = NULL;
+}
+
 /* Handlers callback  */
 static void
 signal_run_callback(thread_ref_t thread)
@@ -255,7 +288,7 @@ signal_run_callback(thread_ref_t thread)
 		list_for_each_entry_safe(t, t_tmp, &m->signal, next) {
 			if (t->u.val == sig) {
 				list_del_init(&t->next);
-				list_add_tail(&t->next, &m->ready);
+				list_add_tail(&t->next, &m->ready[t->prio]);
 				t->type = THREAD_READY;
 			}
 		}
@@ -36,6 +36,7 @@
 #define	SIGTDUMP		(SIGRTMAX)
 #endif
 #define	SIGSTATS_CLEAR		(SIGRTMAX - 1)
+#define	SIGTSTATS		(SIGRTMAX - 2)
 #ifndef _ONE_PROCESS_DEBUG_
 #endif
 
@@ -53,6 +54,7 @@ sigmask_func(int how, const sigset_t *set, sigset_t *oldset)
 extern int get_signum(const char *);
 extern void signal_set(int, void (*) (void *, int), void *);
 extern void signal_ignore(int);
+extern void signal_default(int);
 extern int signal_handler_init(void);
 extern void signal_handler_destroy(void);
 extern void signal_handler_script(void);
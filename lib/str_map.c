@@ -0,0 +1,123 @@
+/*
+ * Soft:        Keepalived is a failover program for the LVS project
+ *              <www.linuxvirtualserver.org>. It monitor & manipulate
+ *              a loadbalanced server pool using multi-layer checks.
+ *
+ * Part:        Hash map of objects keyed by name, used for the lookups
+ *              of instances, scripts, trackers and groups by name while
+ *              the configuration is read and when events are received.
+ *
+ * Author:      Alexandre Cassen, <acassen@linux-vs.org>
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *              See the GNU General Public License for more details.
+ *
+ *              This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU General Public License
+ *              as published by the Free Software Foundation; either version
+ *              2 of the License, or (at your option) any later version.
+ *
+ * Copyright (C) 2001-2017 Alexandre Cassen, <acassen@gmail.com>
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "str_map.h"
+#include "memory.h"
+#include "utils.h"
+
+#define STR_MAP_MIN_SIZE	16
+
+/* Add a node at the tail of its chain. The lists this replaces were searched
+ * from the start, so if a name is added more than once the first one added
+ * is the one found. */
+static void
+str_map_insert(hlist_head_t *head, str_map_node_t *node)
+{
+	hlist_node_t *last;
+
+	if (hlist_empty(head)) {
+		hlist_add_head(&node->h_list, head);
+		return;
+	}
+
+	for (last = head->first; last->next; last = last->next)
+		;
+	hlist_add_after(last, &node->h_list);
+}
+
+static void
+str_map_resize(str_map_t *map, unsigned size)
+{
+	hlist_head_t *old_hash = map->hash;
+	unsigned old_size = old_hash ? map->hash_mask + 1 : 0;
+	hlist_node_t *n, *n_tmp;
+	str_map_node_t *node;
+	unsigned i;
+
+	map->hash = MALLOC(size * sizeof(*map->hash));
+	map->hash_mask = size - 1;
+
+	for (i = 0; i < old_size; i++) {
+		hlist_for_each_safe(n, n_tmp, &old_hash[i]) {
+			node = hlist_entry(n, str_map_node_t, h_list);
+			str_map_insert(&map->hash[str_hash(node->key) & map->hash_mask], node);
+		}
+	}
+
+	FREE_PTR(old_hash);
+}
+
+void
+str_map_add(str_map_t *map, str_map_node_t *node, const char *key)
+{
+	if (!map->hash)
+		str_map_resize(map, STR_MAP_MIN_SIZE);
+	else if (map->count > map->hash_mask)
+		str_map_resize(map, (map->hash_mask + 1) * 2);
+
+	node->key = key;
+	str_map_insert(&map->hash[str_hash(key) & map->hash_mask], node);
+	map->count++;
+}
+
+void
+str_map_del(str_map_t *map, str_map_node_t *node)
+{
+	if (hlist_unhashed(&node->h_list))
+		return;
+
+	hlist_del_init(&node->h_list);
+	map->count--;
+}
+
+str_map_node_t * __attribute__ ((pure))
+str_map_find(const str_map_t *map, const char *key)
+{
+	hlist_node_t *n;
+	str_map_node_t *node;
+
+	if (!map->count)
+		return NULL;
+
+	hlist_for_each(n, &map->hash[str_hash(key) & map->hash_mask]) {
+		node = hlist_entry(n, str_map_node_t, h_list);
+		if (!strcmp(node->key, key))
+			return node;
+	}
+
+	return NULL;
+}
+
+/* The objects in the map are owned and freed by their registry list */
+void
+str_map_free(str_map_t *map)
+{
+	FREE_PTR(map->hash);
+	map->hash_mask = 0;
+	map->count = 0;
+}
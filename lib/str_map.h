@@ -0,0 +1,56 @@
+/*
+ * Soft:        Keepalived is a failover program for the LVS project
+ *              <www.linuxvirtualserver.org>. It monitor & manipulate
+ *              a loadbalanced server pool using multi-layer checks.
+ *
+ * Part:        str_map.c include file.
+ *
+ * Author:      Alexandre Cassen, <acassen@linux-vs.org>
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *              See the GNU General Public License for more details.
+ *
+ *              This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU General Public License
+ *              as published by the Free Software Foundation; either version
+ *              2 of the License, or (at your option) any later version.
+ *
+ * Copyright (C) 2001-2017 Alexandre Cassen, <acassen@gmail.com>
+ */
+
+#ifndef _STR_MAP_H
+#define _STR_MAP_H
+
+#include <stddef.h>
+
+#include "list_head.h"
+#include "container.h"
+
+/* A node is embedded in each object of a registry, and the key is a name
+ * owned by the object, which must not change while the object is in the map. */
+typedef struct _str_map_node {
+	hlist_node_t		h_list;
+	const char		*key;
+} str_map_node_t;
+
+/* An all zero map is empty, the hash table is allocated on first use */
+typedef struct _str_map {
+	hlist_head_t		*hash;
+	unsigned		hash_mask;
+	unsigned		count;
+} str_map_t;
+
+#define str_map_find_entry(map, name, type, member) ({				\
+	str_map_node_t *node_ = str_map_find(map, name);			\
+	node_ ? container_of(node_, type, member) : NULL;			\
+})
+
+/* Prototypes */
+extern void str_map_add(str_map_t *, str_map_node_t *, const char *);
+extern void str_map_del(str_map_t *, str_map_node_t *);
+extern str_map_node_t *str_map_find(const str_map_t *, const char *) __attribute__ ((pure));
+extern void str_map_free(str_map_t *);
+
+#endif
@@ -33,8 +33,8 @@
 #include "logger.h"
 #endif
 
-/* time_now holds current time */
-timeval_t time_now;
+/* time_now holds current time, as seen by the thread's scheduler */
+__thread timeval_t time_now;
 #ifdef _TIMER_CHECK_
 static timeval_t last_time;
 bool do_timer_check;
@@ -0,0 +1,249 @@
+/*
+ * Soft:        Keepalived is a failover program for the LVS project
+ *              <www.linuxvirtualserver.org>. It monitor & manipulate
+ *              a loadbalanced server pool using multi-layer checks.
+ *
+ * Part:        Hierarchical timing wheel. Insertion, removal and expiry
+ *              of a timer are O(1); timers further in the future are
+ *              held in coarser levels and cascaded down as the wheel
+ *              turns.
+ *
+ * Author:      Alexandre Cassen, <acassen@linux-vs.org>
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *              See the GNU General Public License for more details.
+ *
+ *              This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU General Public License
+ *              as published by the Free Software Foundation; either version
+ *              2 of the License, or (at your option) any later version.
+ *
+ * Copyright (C) 2001-2017 Alexandre Cassen, <acassen@gmail.com>
+ */
+
+#include "config.h"
+
+#include "timer_wheel.h"
+
+#define TW_RANGE	(1ULL << (TW_LEVELS * TW_LEVEL_BITS))
+
+void
+timer_wheel_init(timer_wheel_t *w, uint64_t now)
+{
+	unsigned i;
+
+	w->clk = now >> TW_TICK_SHIFT;
+	w->count = 0;
+	for (i = 0; i < TW_LEVELS; i++)
+		w->bitmap[i] = 0;
+	for (i = 0; i < TW_LEVELS * TW_LEVEL_SIZE; i++)
+		INIT_LIST_HEAD(&w->slots[i]);
+	INIT_LIST_HEAD(&w->never);
+}
+
+static void
+tw_enqueue(timer_wheel_t *w, timer_node_t *node)
+{
+	uint64_t tick, delta;
+	unsigned lvl, idx;
+
+	if (node->expires == TW_NEVER) {
+		node->slot = TW_SLOT_NEVER;
+		list_add_tail(&node->e_list, &w->never);
+		return;
+	}
+
+	tick = node->expires >> TW_TICK_SHIFT;
+	if (tick < w->clk)
+		tick = w->clk;
+	delta = tick - w->clk;
+
+	/* Beyond the range of the wheel, park the timer in the last slot; it
+	 * will be requeued when that slot is cascaded. */
+	if (delta >= TW_RANGE)
+		tick = w->clk + TW_RANGE - 1;
+
+	for (lvl = 0; lvl < TW_LEVELS - 1; lvl++) {
+		if (delta < 1ULL << ((lvl + 1) * TW_LEVEL_BITS))
+			break;
+	}
+
+	idx = (tick >> (lvl * TW_LEVEL_BITS)) & TW_LEVEL_MASK;
+	node->slot = lvl * TW_LEVEL_SIZE + idx;
+	list_add_tail(&node->e_list, &w->slots[node->slot]);
+	w->bitmap[lvl] |= 1ULL << idx;
+}
+
+static void
+tw_dequeue(timer_wheel_t *w, timer_node_t *node)
+{
+	list_head_del(&node->e_list);
+
+	if (node->slot != TW_SLOT_NEVER && list_empty(&w->slots[node->slot]))
+		w->bitmap[node->slot / TW_LEVEL_SIZE] &= ~(1ULL << (node->slot & TW_LEVEL_MASK));
+}
+
+void
+timer_wheel_add(timer_wheel_t *w, timer_node_t *node, uint64_t expires, unsigned long slack)
+{
+	node->expires = expires;
+	node->slack = slack;
+	tw_enqueue(w, node);
+	w->count++;
+}
+
+void
+timer_wheel_del(timer_wheel_t *w, timer_node_t *node)
+{
+	tw_dequeue(w, node);
+	w->count--;
+}
+
+void
+timer_wheel_mod(timer_wheel_t *w, timer_node_t *node, uint64_t expires)
+{
+	tw_dequeue(w, node);
+	node->expires = expires;
+	tw_enqueue(w, node);
+}
+
+/* Returns the first slot of level lvl, in order from the current position
+ * of the wheel, that has its bit set in bits, and sets *start to the first
+ * tick covered by that slot. */
+static unsigned
+tw_first_slot(const timer_wheel_t *w, unsigned lvl, uint64_t bits, uint64_t *start)
+{
+	unsigned shift = lvl * TW_LEVEL_BITS;
+	uint64_t pos = w->clk >> shift;
+	unsigned cur = pos & TW_LEVEL_MASK;
+	uint64_t later;
+	unsigned idx;
+
+	/* At level 0 the current slot is still pending. At the higher levels
+	 * it was cascaded when clk reached it, so anything in it now is a
+	 * full rotation away. */
+	later = bits & ~(((lvl ? 2ULL : 1ULL) << cur) - 1);
+
+	if (later) {
+		idx = (unsigned)__builtin_ctzll(later);
+		pos += idx - cur;
+	} else {
+		idx = (unsigned)__builtin_ctzll(bits);
+		pos += TW_LEVEL_SIZE + idx - cur;
+	}
+
+	*start = pos << shift;
+
+	return idx;
+}
+
+/* The next tick at which a level 0 slot needs expiring or a higher level
+ * slot needs cascading */
+static uint64_t
+tw_next_tick(const timer_wheel_t *w)
+{
+	uint64_t next = TW_NEVER;
+	uint64_t start;
+	unsigned lvl;
+
+	for (lvl = 0; lvl < TW_LEVELS; lvl++) {
+		if (!w->bitmap[lvl])
+			continue;
+
+		tw_first_slot(w, lvl, w->bitmap[lvl], &start);
+		if (start < next)
+			next = start;
+	}
+
+	return next;
+}
+
+/* Move the timers in the higher level slots starting at clk down the wheel */
+static void
+tw_cascade(timer_wheel_t *w)
+{
+	LIST_HEAD_INITIALIZE(pending);
+	timer_node_t *node, *node_tmp;
+	unsigned lvl, idx;
+
+	for (lvl = 1; lvl < TW_LEVELS; lvl++) {
+		if (w->clk & ((1ULL << (lvl * TW_LEVEL_BITS)) - 1))
+			break;
+	}
+
+	while (--lvl) {
+		idx = (w->clk >> (lvl * TW_LEVEL_BITS)) & TW_LEVEL_MASK;
+		if (!(w->bitmap[lvl] & (1ULL << idx)))
+			continue;
+
+		list_splice_init(&w->slots[lvl * TW_LEVEL_SIZE + idx], &pending);
+		w->bitmap[lvl] &= ~(1ULL << idx);
+
+		list_for_each_entry_safe(node, node_tmp, &pending, e_list)
+			tw_enqueue(w, node);
+		INIT_LIST_HEAD(&pending);
+	}
+}
+
+/* Returns the time by which the wheel next needs expiring, allowing for
+ * the slack of each timer, or TW_NEVER if there are no running timers.
+ * Timers whose slack overlaps are coalesced onto the same wakeup. */
+uint64_t
+timer_wheel_next_expiry(const timer_wheel_t *w)
+{
+	uint64_t best = TW_NEVER;
+	uint64_t bits, start;
+	timer_node_t *node;
+	unsigned lvl, idx;
+
+	for (lvl = 0; lvl < TW_LEVELS; lvl++) {
+		/* Slots are visited in time order, and nothing in a slot can
+		 * expire before the slot starts. */
+		for (bits = w->bitmap[lvl]; bits; bits &= ~(1ULL << idx)) {
+			idx = tw_first_slot(w, lvl, bits, &start);
+			if (start << TW_TICK_SHIFT >= best)
+				break;
+
+			list_for_each_entry(node, &w->slots[lvl * TW_LEVEL_SIZE + idx], e_list) {
+				if (node->expires + node->slack < best)
+					best = node->expires + node->slack;
+			}
+		}
+	}
+
+	return best;
+}
+
+/* Removes and returns a timer that has expired by now, or NULL if there
+ * are no more. */
+timer_node_t *
+timer_wheel_expire(timer_wheel_t *w, uint64_t now)
+{
+	uint64_t now_tick = now >> TW_TICK_SHIFT;
+	uint64_t next;
+	unsigned idx;
+	timer_node_t *node;
+
+	for (;;) {
+		idx = w->clk & TW_LEVEL_MASK;
+		if (w->bitmap[0] & (1ULL << idx)) {
+			list_for_each_entry(node, &w->slots[idx], e_list) {
+				if (node->expires <= now) {
+					timer_wheel_del(w, node);
+					return node;
+				}
+			}
+		}
+
+		if (w->clk >= now_tick)
+			return NULL;
+
+		/* Everything in the current slot has expired, so skip to the
+		 * next tick with work to do, or to now. */
+		next = tw_next_tick(w);
+		w->clk = next < now_tick ? next : now_tick;
+		tw_cascade(w);
+	}
+}
@@ -0,0 +1,80 @@
+/*
+ * Soft:        Keepalived is a failover program for the LVS project
+ *              <www.linuxvirtualserver.org>. It monitor & manipulate
+ *              a loadbalanced server pool using multi-layer checks.
+ *
+ * Part:        timer_wheel.c include file.
+ *
+ * Author:      Alexandre Cassen, <acassen@linux-vs.org>
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *              See the GNU General Public License for more details.
+ *
+ *              This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU General Public License
+ *              as published by the Free Software Foundation; either version
+ *              2 of the License, or (at your option) any later version.
+ *
+ * Copyright (C) 2001-2017 Alexandre Cassen, <acassen@gmail.com>
+ */
+
+#ifndef _TIMER_WHEEL_H
+#define _TIMER_WHEEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "list_head.h"
+
+/* The wheel has TW_LEVELS levels of TW_LEVEL_SIZE slots. A level 0 slot is
+ * one tick of 2^TW_TICK_SHIFT usecs, and each slot of level n covers a whole
+ * rotation of level n-1. Timers keep their exact expiry time in usecs, the
+ * slots are only used for bucketing. */
+#define TW_TICK_SHIFT	10
+#define TW_LEVEL_BITS	6
+#define TW_LEVEL_SIZE	(1U << TW_LEVEL_BITS)
+#define TW_LEVEL_MASK	(TW_LEVEL_SIZE - 1)
+#define TW_LEVELS	6
+
+#define TW_NEVER	UINT64_MAX	/* expiry time of a timer that is not running */
+#define TW_SLOT_NEVER	(TW_LEVELS * TW_LEVEL_SIZE)
+
+typedef struct _timer_node {
+	list_head_t		e_list;
+	uint64_t		expires;	/* usecs */
+	unsigned long		slack;		/* usecs expiry may be deferred by */
+	unsigned		slot;
+} timer_node_t;
+
+typedef struct _timer_wheel {
+	uint64_t		clk;		/* first tick not yet fully expired */
+	uint64_t		bitmap[TW_LEVELS];
+	list_head_t		slots[TW_LEVELS * TW_LEVEL_SIZE];
+	list_head_t		never;		/* timers with TW_NEVER expiry */
+	unsigned		count;
+} timer_wheel_t;
+
+static inline bool
+timer_wheel_empty(const timer_wheel_t *w)
+{
+	return !w->count;
+}
+
+/* Iterate over all timers on the wheel, in no particular order. The current
+ * node may be removed from the wheel while iterating. */
+#define timer_wheel_for_each_entry_safe(pos, n, w, i, member)				\
+	for (i = 0; i <= TW_SLOT_NEVER; i++)						\
+		list_for_each_entry_safe(pos, n,					\
+			i == TW_SLOT_NEVER ? &(w)->never : &(w)->slots[i], member.e_list)
+
+/* Prototypes */
+extern void timer_wheel_init(timer_wheel_t *, uint64_t);
+extern void timer_wheel_add(timer_wheel_t *, timer_node_t *, uint64_t, unsigned long);
+extern void timer_wheel_del(timer_wheel_t *, timer_node_t *);
+extern void timer_wheel_mod(timer_wheel_t *, timer_node_t *, uint64_t);
+extern uint64_t timer_wheel_next_expiry(const timer_wheel_t *) __attribute__((pure));
+extern timer_node_t *timer_wheel_expire(timer_wheel_t *, uint64_t);
+
+#endif
@@ -56,6 +56,9 @@
 #ifdef _HAVE_LIBKMOD_
 #include <libkmod.h>
 #endif
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
 
 /* Local includes */
 #include "utils.h"
@@ -67,6 +70,9 @@
 #include "logger.h"
 #include "process.h"
 #include "timer.h"
+#ifdef _WITH_PERF_
+#include "scheduler.h"
+#endif
 
 /* global vars */
 unsigned long debug = 0;
@@ -309,6 +315,9 @@ run_perf(const char *process, const char *network_namespace, const char *instanc
 			exit(0);
 		}
 
+		/* Nothing waits for perf, but it must still be reaped */
+		thread_reap_child(master, pid);
+
 		/* Parent */
 		char buf[sizeof(struct inotify_event) + NAME_MAX + 1] __attribute__((aligned(__alignof__(struct inotify_event))));
 		struct inotify_event *ie = PTR_CAST(struct inotify_event, buf);
@@ -384,6 +393,106 @@ run_perf(const char *process, const char *network_namespace, const char *instanc
 }
 #endif
 
+#ifdef __x86_64__
+/* Sum the 16 bit words of data in 16 or 32 byte blocks with SSE2 or AVX2,
+ * adding the words of each block into 32 bit lanes. A lane is added to at
+ * most twice per block, so the lanes are added into the 64 bit total before
+ * they could overflow. The result, truncated to 32 bits, is the same as
+ * adding the words one at a time to a 32 bit sum. Returns the number of
+ * bytes summed. */
+#define IN_CSUM_SIMD_MIN	64		/* Shorter data is summed by the scalar loop */
+#define IN_CSUM_LANE_BLOCKS	32768
+
+static size_t
+in_csum_sse2(const unsigned char *addr, size_t len, uint64_t *sum)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i acc, v;
+	uint32_t lanes[4];
+	size_t done = 0;
+	unsigned blocks;
+
+	while (len - done >= sizeof(__m128i)) {
+		acc = zero;
+		for (blocks = 0; blocks < IN_CSUM_LANE_BLOCKS && len - done >= sizeof(__m128i); blocks++) {
+			v = _mm_loadu_si128((const __m128i *)(addr + done));
+			acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(v, zero));
+			acc = _mm_add_epi32(acc, _mm_unpackhi_epi16(v, zero));
+			done += sizeof(__m128i);
+		}
+
+		_mm_storeu_si128((__m128i *)lanes, acc);
+		*sum += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+	}
+
+	return done;
+}
+
+static size_t __attribute__((target("avx2")))
+in_csum_avx2(const unsigned char *addr, size_t len, uint64_t *sum)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i acc, v;
+	uint32_t lanes[8];
+	size_t done = 0;
+	unsigned blocks, i;
+
+	while (len - done >= sizeof(__m256i)) {
+		acc = zero;
+		for (blocks = 0; blocks < IN_CSUM_LANE_BLOCKS && len - done >= sizeof(__m256i); blocks++) {
+			v = _mm256_loadu_si256((const __m256i *)(addr + done));
+			acc = _mm256_add_epi32(acc, _mm256_unpacklo_epi16(v, zero));
+			acc = _mm256_add_epi32(acc, _mm256_unpackhi_epi16(v, zero));
+			done += sizeof(__m256i);
+		}
+
+		_mm256_storeu_si256((__m256i *)lanes, acc);
+		for (i = 0; i < 8; i++)
+			*sum += lanes[i];
+	}
+
+	/* Avoid the AVX to SSE transition penalty */
+	_mm256_zeroupper();
+
+	return done + in_csum_sse2(addr + done, len - done, sum);
+}
+
+static size_t in_csum_simd_select(const unsigned char *, size_t, uint64_t *);
+static size_t (*in_csum_simd)(const unsigned char *, size_t, uint64_t *) = in_csum_simd_select;
+
+/* Choose the implementation the CPU supports the first time it is needed */
+static size_t
+in_csum_simd_select(const unsigned char *addr, size_t len, uint64_t *sum)
+{
+	in_csum_simd = __builtin_cpu_supports("avx2") ? in_csum_avx2 : in_csum_sse2;
+
+	return in_csum_simd(addr, len, sum);
+}
+
+/* Add the 16 bit words at the start of long data to the checksum, and
+ * return the number of bytes added */
+static inline size_t
+in_csum_vector(const void *addr, size_t len, uint32_t *csum)
+{
+	uint64_t sum = 0;
+	size_t done;
+
+	if (len < IN_CSUM_SIMD_MIN)
+		return 0;
+
+	done = in_csum_simd(addr, len, &sum);
+	*csum += (uint32_t)sum;
+
+	return done;
+}
+#else
+static inline size_t
+in_csum_vector(__attribute__((unused)) const void *addr, __attribute__((unused)) size_t len, __attribute__((unused)) uint32_t *csum)
+{
+	return 0;
+}
+#endif
+
 /* Compute a checksum */
 #ifdef USE_MEMCPY_FOR_ALIASING
 uint16_t
@@ -392,6 +501,7 @@ in_csum(const void *addr, size_t len, uint32_t csum, uint32_t *acc)
 	size_t nleft = len;
 	uint16_t w16;
 	const unsigned char *b_addr = addr;
+	size_t done;
 
 	/*
 	 *  Our algorithm is simple, using a 32 bit accumulator (sum),
@@ -409,6 +519,10 @@ in_csum(const void *addr, size_t len, uint32_t csum, uint32_t *acc)
 	 * but since the code is written to only access the original memory via
 	 * the unsigned char *, the compiler knows this might be aliasing.
 	 */
+	done = in_csum_vector(b_addr, nleft, &csum);
+	b_addr += done;
+	nleft -= done;
+
 	while (nleft > 1) {
 		memcpy(&w16, b_addr, sizeof(w16));
 		csum += w16;
@@ -439,13 +553,19 @@ in_csum(const void *addr, size_t len, uint32_t csum, uint32_t *acc)
 	const uint16_t_a *w = addr;
 	uint16_t answer;
 	uint32_t sum = csum;
+	size_t done;
 
 	/*
 	 *  Our algorithm is simple, using a 32 bit accumulator (sum),
 	 *  we add sequential 16 bit words to it, and at the end, fold
 	 *  back all the carry bits from the top 16 bits into the lower
 	 *  16 bits.
+	 *  Long data is mostly summed using vector instructions.
 	 */
+	done = in_csum_vector(w, nleft, &sum);
+	w += done / sizeof(*w);
+	nleft -= done;
+
 	while (nleft > 1) {
 		sum += *w++;
 		nleft -= 2;
@@ -472,7 +592,7 @@ in_csum(const void *addr, size_t len, uint32_t csum, uint32_t *acc)
 const char *
 inet_ntop2(uint32_t ip)
 {
-	static char buf[16];
+	static __thread char buf[16];
 	const unsigned char (*bytep)[4] = (const unsigned char (*)[4])&ip;
 
 	sprintf(buf, "%d.%d.%d.%d", (*bytep)[0], (*bytep)[1], (*bytep)[2], (*bytep)[3]);
@@ -713,7 +833,7 @@ inet_sockaddrtos2(const sockaddr_t *addr, char *addr_str)
 const char *
 inet_sockaddrtos(const sockaddr_t *addr)
 {
-	static char addr_str[INET6_ADDRSTRLEN];
+	static __thread char addr_str[INET6_ADDRSTRLEN];
 	inet_sockaddrtos2(addr, addr_str);
 	return addr_str;
 }
@@ -748,7 +868,7 @@ const char *
 inet_sockaddrtopair(const sockaddr_t *addr)
 {
 	char addr_str[INET6_ADDRSTRLEN];
-	static char ret[sizeof(addr_str) + 8];	/* '[' + addr_str + ']' + ':' + 'nnnnn' */
+	static __thread char ret[sizeof(addr_str) + 8];	/* '[' + addr_str + ']' + ':' + 'nnnnn' */
 
 	inet_sockaddrtos2(addr, addr_str);
 	snprintf(ret, sizeof(ret), "[%s]:%d"
@@ -776,7 +896,7 @@ inet_sockaddrtotrio_r(const sockaddr_t *addr, uint16_t proto, char *buf)
 const char *
 inet_sockaddrtotrio(const sockaddr_t *addr, uint16_t proto)
 {
-	static char ret[SOCKADDRTRIO_STR_LEN];
+	static __thread char ret[SOCKADDRTRIO_STR_LEN];
 
 	inet_sockaddrtotrio_r(addr, proto, ret);
 
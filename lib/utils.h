@@ -182,6 +182,61 @@ static inline bool inaddr_equal(sa_family_t family, const void *addr1, const voi
 	return false;
 }
 
+/* The finalisation mix of MurmurHash3, so that every bit of the input
+ * affects the low order bits used to select a hash chain */
+static inline uint32_t hash_mix32(uint32_t h)
+{
+	h ^= h >> 16;
+	h *= 0x85ebca6b;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35;
+	h ^= h >> 16;
+
+	return h;
+}
+
+static inline uint32_t inaddr_hash(sa_family_t family, const void *addr)
+{
+	if (family == AF_INET6) {
+		const struct in6_addr *a = (const struct in6_addr *) addr;
+
+		return hash_mix32(a->s6_addr32[0] ^ a->s6_addr32[1] ^ a->s6_addr32[2] ^ a->s6_addr32[3]);
+	}
+
+	return hash_mix32(((const struct in_addr *) addr)->s_addr);
+}
+
+/* FNV-1a, with the bits mixed as above */
+static inline __attribute__((pure)) uint32_t str_hash(const char *str)
+{
+	uint32_t h = 2166136261U;
+
+	while (*str) {
+		h ^= (uint8_t)*str++;
+		h *= 16777619U;
+	}
+
+	return hash_mix32(h);
+}
+
+/* 64 bit FNV-1a, continuing from h, for fingerprinting. Start with
+ * STR_HASH64_INIT. */
+#define STR_HASH64_INIT	14695981039346656037ULL
+
+static inline __attribute__((pure)) uint64_t str_hash64(uint64_t h, const char *str)
+{
+	while (*str) {
+		h ^= (uint8_t)*str++;
+		h *= 1099511628211ULL;
+	}
+
+	/* Separate consecutive strings */
+	h ^= 0xff;
+	h *= 1099511628211ULL;
+
+	return h;
+}
+
 static inline uint16_t csum_incremental_update32(const uint16_t old_csum, const uint32_t old_val, const uint32_t new_val)
 {
 	/* This technique for incremental IP checksum update is described in RFC1624,